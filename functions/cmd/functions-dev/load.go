@@ -0,0 +1,215 @@
+package main
+
+import (
+	"context"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"net"
+	"net/http"
+	"os"
+	"os/signal"
+	"path/filepath"
+	"strings"
+	"syscall"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/loadgen"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+// runLoad implements `functions-dev load`. It either targets a running
+// gateway (--url) or, for each runtime in --runtime and worker CPU placement
+// in --cpu-affinity, boots a throwaway dev server for --entry and drives it,
+// printing one report per run.
+//
+// Examples:
+//
+//	functions-dev load --entry dist/index.js --runtime quickjs-ng --mode closed --concurrency 32
+//	functions-dev load --entry dist/index.js --runtime bun,quickjs-ng --worker-script worker/worker.ts \
+//	    --mode open --rate 500 --payload-size 4096 --json > results.ndjson
+//	functions-dev load --url http://127.0.0.1:8080/functions/hello-world --mode open --rate 100
+//	functions-dev load --entry dist/index.js --mode open --rate 2000 --max-workers 32 --cpu-affinity off,core,cache
+func runLoad(args []string) int {
+	fs := flag.NewFlagSet("load", flag.ExitOnError)
+	url := fs.String("url", "", "Invoke URL of a running gateway; when empty a local dev server is started per runtime")
+	entry := fs.String("entry", "", "Function bundle served by the local dev server (required without --url)")
+	name := fs.String("name", "loadtest", "Function name for the local dev server")
+	runtimes := fs.String("runtime", "quickjs-ng", "Comma-separated runtimes to run against (bun, quickjs-ng)")
+	handler := fs.String("handler", "default", "Handler name")
+	workerScript := fs.String("worker-script", "", "Bun worker script (worker/worker.ts); required for the bun runtime")
+	quickjsPath := fs.String("quickjs-path", config.DefaultConfig().Worker.QuickJSPath, "Path to the quickjs-worker binary")
+	maxWorkers := fs.Int("max-workers", 10, "Max workers per function on the local dev server")
+	warmWorkers := fs.Int("warm-workers", 2, "Warm workers per function on the local dev server")
+	autoscale := fs.Bool("autoscale", true, "Pre-warm workers from arrival-rate estimates on the local dev server")
+	cpuAffinity := fs.String("cpu-affinity", "", "Comma-separated QuickJS worker CPU placements to run on the local dev server (off, core, cache)")
+	gatewayCores := fs.Int("gateway-cores", config.DefaultConfig().Worker.GatewayCores, "Physical cores kept for the local dev server and load generator with --cpu-affinity")
+	mode := fs.String("mode", loadgen.ModeClosed, "open (fixed arrival rate) or closed (fixed number of clients)")
+	rate := fs.Float64("rate", 100, "Open loop: requests per second")
+	concurrency := fs.Int("concurrency", 16, "Closed loop: clients; open loop: max requests in flight")
+	duration := fs.Duration("duration", 30*time.Second, "How long to send requests")
+	method := fs.String("method", http.MethodPost, "HTTP method")
+	payloadSize := fs.Int("payload-size", 0, "Request body size in bytes")
+	timeout := fs.Duration("timeout", 30*time.Second, "Per-request timeout")
+	sampleInterval := fs.Duration("sample-interval", time.Second, "Interval of the throughput/worker/queue time series")
+	asJSON := fs.Bool("json", false, "Print each report as one JSON line")
+	fs.Parse(args)
+
+	ctx, cancel := signal.NotifyContext(context.Background(), os.Interrupt, syscall.SIGTERM)
+	defer cancel()
+
+	lcfg := loadgen.Config{
+		Mode:           *mode,
+		Rate:           *rate,
+		Concurrency:    *concurrency,
+		Duration:       *duration,
+		Method:         *method,
+		PayloadSize:    *payloadSize,
+		Timeout:        *timeout,
+		SampleInterval: *sampleInterval,
+	}
+
+	emit := func(rep *loadgen.Report) {
+		if *asJSON {
+			json.NewEncoder(os.Stdout).Encode(rep)
+		} else {
+			rep.WriteText(os.Stdout)
+		}
+	}
+
+	if *url != "" {
+		lcfg.URL = *url
+		rep, err := loadgen.Run(ctx, &lcfg)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "load: %v\n", err)
+			return 1
+		}
+		emit(rep)
+		return 0
+	}
+
+	if *entry == "" {
+		fmt.Fprintln(os.Stderr, "load: --entry or --url is required")
+		return 2
+	}
+	absEntry, err := filepath.Abs(*entry)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "load: failed to resolve entry path: %v\n", err)
+		return 1
+	}
+	absQuickJS, err := filepath.Abs(*quickjsPath)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "load: failed to resolve quickjs path: %v\n", err)
+		return 1
+	}
+
+	log := logger.Default()
+	log.SetLevel(logger.LevelWarn)
+
+	type target struct{ runtime, placement string }
+	var targets []target
+	for _, runtime := range strings.Split(*runtimes, ",") {
+		runtime = strings.TrimSpace(runtime)
+		if runtime == "" {
+			continue
+		}
+		for _, placement := range strings.Split(*cpuAffinity, ",") {
+			targets = append(targets, target{runtime, strings.TrimSpace(placement)})
+		}
+	}
+
+	for _, t := range targets {
+		runtime := t.runtime
+		if runtime == "bun" && *workerScript == "" {
+			fmt.Fprintln(os.Stderr, "load: --worker-script is required for the bun runtime")
+			return 2
+		}
+
+		dir, err := os.MkdirTemp("", "functions-load-")
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "load: %v\n", err)
+			return 1
+		}
+		port, err := freePort()
+		if err != nil {
+			os.RemoveAll(dir)
+			fmt.Fprintf(os.Stderr, "load: %v\n", err)
+			return 1
+		}
+
+		cfg := config.DefaultConfig()
+		cfg.DataDir = dir
+		cfg.Metadata.DBPath = filepath.Join(dir, "functions.db")
+		cfg.Gateway.HTTPPort = port
+		cfg.Gateway.EnableHTTP = true
+		cfg.Worker.MaxWorkersPerFunction = *maxWorkers
+		cfg.Worker.WarmWorkersPerFunction = *warmWorkers
+		cfg.Worker.Autoscale = *autoscale
+		cfg.Worker.QuickJSPath = absQuickJS
+		cfg.Worker.CPUAffinity = t.placement
+		cfg.Worker.GatewayCores = *gatewayCores
+
+		srv, err := startDevServer(cfg, absEntry, *name, runtime, *handler, *workerScript, log)
+		if err != nil {
+			os.RemoveAll(dir)
+			fmt.Fprintf(os.Stderr, "load: %s: %v\n", runtime, err)
+			return 1
+		}
+		base := fmt.Sprintf("http://127.0.0.1:%d", port)
+		if err := waitHealthy(ctx, base+"/health", 10*time.Second); err != nil {
+			srv.stop(log)
+			os.RemoveAll(dir)
+			fmt.Fprintf(os.Stderr, "load: %s: %v\n", runtime, err)
+			return 1
+		}
+
+		lcfg.URL = base + "/functions/" + *name
+		rep, err := loadgen.Run(ctx, &lcfg)
+		srv.stop(log)
+		os.RemoveAll(dir)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "load: %s: %v\n", runtime, err)
+			return 1
+		}
+		rep.Runtime = runtime
+		rep.CPUAffinity = t.placement
+		emit(rep)
+		if ctx.Err() != nil {
+			break
+		}
+	}
+	return 0
+}
+
+// freePort asks the kernel for an unused TCP port
+func freePort() (int, error) {
+	l, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		return 0, fmt.Errorf("failed to find a free port: %w", err)
+	}
+	defer l.Close()
+	return l.Addr().(*net.TCPAddr).Port, nil
+}
+
+// waitHealthy polls url until it answers 200 or timeout elapses
+func waitHealthy(ctx context.Context, url string, timeout time.Duration) error {
+	deadline := time.Now().Add(timeout)
+	for {
+		resp, err := http.Get(url)
+		if err == nil {
+			resp.Body.Close()
+			if resp.StatusCode == http.StatusOK {
+				return nil
+			}
+		}
+		if time.Now().After(deadline) {
+			return fmt.Errorf("gateway at %s not healthy after %v", url, timeout)
+		}
+		select {
+		case <-ctx.Done():
+			return ctx.Err()
+		case <-time.After(50 * time.Millisecond):
+		}
+	}
+}
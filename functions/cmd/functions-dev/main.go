@@ -3,6 +3,7 @@ package main
 import (
 	"flag"
 	"fmt"
+	"net/http"
 	"os"
 	"os/signal"
 	"path/filepath"
@@ -26,13 +27,31 @@ import (
 //
 // Serves:
 //   http://127.0.0.1:8787/functions/hello-world
+//
+// Load testing (see load.go):
+//   functions-dev load --entry dist/index.js --runtime bun,quickjs-ng --mode open --rate 200
+//
+// Traffic replay (see replay.go):
+//   functions-dev --entry dist/index.js --capture traffic.bbcap --capture-rate 1
+//   functions-dev replay --file traffic.bbcap --url http://127.0.0.1:8787 --speed 2
 
 func main() {
+	if len(os.Args) > 1 && os.Args[1] == "load" {
+		os.Exit(runLoad(os.Args[2:]))
+	}
+	if len(os.Args) > 1 && os.Args[1] == "replay" {
+		os.Exit(runReplay(os.Args[2:]))
+	}
+
 	entry := flag.String("entry", "", "Path to function bundle or entry file (default: dist/index.js or src/index.ts|js)")
 	name := flag.String("name", "", "Function name (defaults to directory name)")
 	runtime := flag.String("runtime", "bun", "Runtime (bun or quickjs-ng)")
 	handler := flag.String("handler", "default", "Handler name")
 	port := flag.Int("port", 8787, "HTTP port for dev server")
+	profiling := flag.Bool("profiling", false, "Enable GET /functions/:name/profile (quickjs-ng only)")
+	workerScript := flag.String("worker-script", "", "Bun worker script (worker/worker.ts); required for the bun runtime")
+	captureFile := flag.String("capture", "", "Record sampled invocations to this capture file (replay with `functions-dev replay`)")
+	captureRate := flag.Float64("capture-rate", 1, "Fraction of invocations to record with --capture")
 	flag.Parse()
 
 	// Derive entry path if not provided.
@@ -89,6 +108,9 @@ func main() {
 	cfg.Metadata.DBPath = filepath.Join(devDir, "functions.db")
 	cfg.Gateway.HTTPPort = *port
 	cfg.Gateway.EnableHTTP = true
+	cfg.Worker.EnableProfiling = *profiling
+	cfg.Capture.FilePath = *captureFile
+	cfg.Capture.SampleRate = *captureRate
 
 	log := logger.Default()
 	log.SetLevel(logger.LevelDebug)
@@ -99,72 +121,112 @@ func main() {
 	log.Info("Data dir: %s", cfg.DataDir)
 	log.Info("HTTP port: %d", cfg.Gateway.HTTPPort)
 
+	srv, err := startDevServer(cfg, absEntry, fnName, *runtime, *handler, *workerScript, log)
+	if err != nil {
+		log.Error("%v", err)
+		os.Exit(1)
+	}
+
+	log.Info("bunbase dev running at http://127.0.0.1:%d/functions/%s", cfg.Gateway.HTTPPort, fnName)
+
+	// Wait for SIGINT/SIGTERM.
+	sigCh := make(chan os.Signal, 1)
+	signal.Notify(sigCh, os.Interrupt, syscall.SIGTERM)
+	<-sigCh
+
+	log.Info("Shutting down dev runner...")
+	srv.stop(log)
+	log.Info("Dev runner stopped")
+}
+
+// devServer is the in-process metadata store, scheduler and gateway behind
+// the dev runner and `functions-dev load`.
+type devServer struct {
+	store  *metadata.Store
+	sched  *scheduler.Scheduler
+	gw     *gateway.Gateway
+	budget *pool.Budget
+	blank  *pool.BlankPool
+	hosts  *pool.HostGroup
+}
+
+// startDevServer registers and deploys the bundle at absEntry as fnName in
+// cfg.Metadata.DBPath and starts the HTTP gateway on cfg.Gateway.HTTPPort.
+func startDevServer(cfg *config.Config, absEntry, fnName, runtime, handler, workerScript string, log *logger.Logger) (*devServer, error) {
 	// Initialize metadata store (dev DB).
 	store, err := metadata.NewStore(cfg.Metadata.DBPath)
 	if err != nil {
-		log.Error("Failed to initialize metadata store: %v", err)
-		os.Exit(1)
+		return nil, fmt.Errorf("failed to initialize metadata store: %w", err)
 	}
-	defer store.Close()
 
 	// Initialize scheduler and router.
 	sched := scheduler.NewScheduler(log)
+	sched.SetTenancy(&cfg.Tenancy)
 	rtr := router.NewRouter(store, sched, log)
+	if err := rtr.Load(); err != nil {
+		store.Close()
+		return nil, err
+	}
+	budget := pool.NewBudget(&cfg.Worker, log)
+	rtr.SetBudget(budget)
+	blank := pool.NewBlankPool(&cfg.Worker, log)
+	rtr.SetBlankPool(blank)
+	hosts := pool.NewHostGroup(&cfg.Worker, log)
+	rtr.SetHostGroup(hosts)
 
 	// Register dev function.
 	fnID := "dev-" + fnName
 	caps := capabilities.DefaultProfile("") // no project context for dev
-	fn, err := store.RegisterFunction(fnID, fnName, *runtime, *handler, caps)
+	fn, err := store.RegisterFunction(fnID, fnName, runtime, handler, caps)
 	if err != nil {
-		log.Error("Failed to register dev function: %v", err)
-		os.Exit(1)
+		store.Close()
+		return nil, fmt.Errorf("failed to register dev function: %w", err)
 	}
 
 	// Create dev version.
 	versionID := uuid.New().String()
 	version, err := store.CreateVersion(versionID, fn.ID, "dev", absEntry)
 	if err != nil {
-		log.Error("Failed to create dev version: %v", err)
-		os.Exit(1)
+		store.Close()
+		return nil, fmt.Errorf("failed to create dev version: %w", err)
 	}
 
 	// Mark function as deployed and set active version.
 	if err := store.DeployFunction(uuid.New().String(), fn.ID, version.ID); err != nil {
-		log.Error("Failed to deploy dev function: %v", err)
-		os.Exit(1)
+		store.Close()
+		return nil, fmt.Errorf("failed to deploy dev function: %w", err)
 	}
 
 	// Create pools for this deployed function (reuse main service logic locally).
-	if err := createDevPool(store, rtr, cfg, log); err != nil {
+	if err := createDevPool(store, rtr, cfg, workerScript, log); err != nil {
 		log.Warn("Failed to create dev pool: %v", err)
 	}
 
 	// Start HTTP gateway.
-	gw := gateway.NewGateway(rtr, sched, store, cfg, "", "", log)
+	gw := gateway.NewGateway(rtr, sched, store, cfg, workerScript, "", log)
 	go func() {
-		if err := gw.Start(); err != nil {
+		if err := gw.Start(); err != nil && err != http.ErrServerClosed {
 			log.Error("Dev HTTP gateway error: %v", err)
 		}
 	}()
 
-	log.Info("bunbase dev running at http://127.0.0.1:%d/functions/%s", cfg.Gateway.HTTPPort, fnName)
-
-	// Wait for SIGINT/SIGTERM.
-	sigCh := make(chan os.Signal, 1)
-	signal.Notify(sigCh, os.Interrupt, syscall.SIGTERM)
-	<-sigCh
+	return &devServer{store: store, sched: sched, gw: gw, budget: budget, blank: blank, hosts: hosts}, nil
+}
 
-	log.Info("Shutting down dev runner...")
-	if err := gw.Stop(); err != nil {
+func (d *devServer) stop(log *logger.Logger) {
+	if err := d.gw.Stop(); err != nil {
 		log.Warn("Error stopping dev gateway: %v", err)
 	}
-	sched.Stop()
-	log.Info("Dev runner stopped")
+	d.sched.Stop()
+	d.budget.Stop()
+	d.blank.Stop()
+	d.hosts.Stop()
+	d.store.Close()
 }
 
 // createDevPool is a small, local variant of createPoolsForDeployedFunctions
 // from the main functions binary. It assumes a single deployed function.
-func createDevPool(meta *metadata.Store, rtr *router.Router, cfg *config.Config, logr *logger.Logger) error {
+func createDevPool(meta *metadata.Store, rtr *router.Router, cfg *config.Config, workerScript string, logr *logger.Logger) error {
 	functions, err := meta.ListFunctions()
 	if err != nil {
 		return fmt.Errorf("failed to list functions: %w", err)
@@ -203,7 +265,7 @@ func createDevPool(meta *metadata.Store, rtr *router.Router, cfg *config.Config,
 		}
 
 		// For QuickJS, QuickJSPath is used directly; worker script is unused.
-		runtimeWorkerScript := ""
+		runtimeWorkerScript := workerScript
 
 		p := pool.NewPool(
 			fn.ID,
@@ -0,0 +1,74 @@
+package main
+
+import (
+	"context"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"os"
+	"os/signal"
+	"syscall"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/capture"
+	"github.com/kartikbazzad/bunbase/functions/internal/loadgen"
+)
+
+// runReplay implements `functions-dev replay`. It sends the invocations in a
+// capture file to a running gateway at their recorded pace (scaled by
+// --speed) and compares the latencies with the captured ones.
+//
+// Examples:
+//
+//	functions-dev replay --file traffic.bbcap --url http://127.0.0.1:8787
+//	functions-dev replay --file traffic.bbcap --url http://127.0.0.1:8787 --speed 5 --function hello-world --json
+func runReplay(args []string) int {
+	fs := flag.NewFlagSet("replay", flag.ExitOnError)
+	file := fs.String("file", "", "Capture file written by the gateway (required)")
+	url := fs.String("url", "http://127.0.0.1:8787", "Base URL of the gateway to replay against")
+	speed := fs.Float64("speed", 1, "Replay speed multiplier; 0 sends back to back")
+	function := fs.String("function", "", "Send every record to this function instead of the captured path")
+	concurrency := fs.Int("concurrency", 256, "Max requests in flight; arrivals beyond it are dropped")
+	limit := fs.Int("limit", 0, "Replay at most this many records (0 = all)")
+	timeout := fs.Duration("timeout", 30*time.Second, "Per-request timeout")
+	asJSON := fs.Bool("json", false, "Print the report as one JSON line")
+	fs.Parse(args)
+
+	if *file == "" {
+		fmt.Fprintln(os.Stderr, "replay: --file is required")
+		return 2
+	}
+	f, err := os.Open(*file)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "replay: %v\n", err)
+		return 1
+	}
+	defer f.Close()
+	r, err := capture.NewReader(f)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "replay: %s: %v\n", *file, err)
+		return 1
+	}
+
+	ctx, cancel := signal.NotifyContext(context.Background(), os.Interrupt, syscall.SIGTERM)
+	defer cancel()
+
+	rep, err := loadgen.Replay(ctx, r, &loadgen.ReplayConfig{
+		BaseURL:     *url,
+		Speed:       *speed,
+		Function:    *function,
+		Concurrency: *concurrency,
+		Timeout:     *timeout,
+		Limit:       *limit,
+	})
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "replay: %v\n", err)
+		return 1
+	}
+	if *asJSON {
+		json.NewEncoder(os.Stdout).Encode(rep)
+	} else {
+		rep.WriteText(os.Stdout)
+	}
+	return 0
+}
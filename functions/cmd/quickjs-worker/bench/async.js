@@ -0,0 +1,20 @@
+// Promise-heavy handler: sequential awaits plus a fan-out, all resolved through the job queue.
+async function step(v) {
+  return v + 1;
+}
+
+async function lookup(key) {
+  await null;
+  return { key, value: key.length };
+}
+
+export default async function handler(req) {
+  let n = 0;
+  for (let i = 0; i < 20; i++) {
+    n = await step(n);
+  }
+  const keys = Array.from({ length: 32 }, (_, i) => "key-" + i);
+  const rows = await Promise.all(keys.map(lookup));
+  const total = await rows.reduce(async (acc, row) => (await acc) + row.value, Promise.resolve(0));
+  return Response.json({ n, rows: rows.length, total, method: req.method });
+}
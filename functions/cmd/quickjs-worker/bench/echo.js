@@ -0,0 +1,6 @@
+// Returns the request body unchanged; stresses body decoding, base64 and response escaping.
+export default function handler(req) {
+  return new Response(req.body || "", {
+    headers: { "Content-Type": req.headers.get("content-type") || "application/octet-stream" },
+  });
+}
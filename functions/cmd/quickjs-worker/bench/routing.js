@@ -0,0 +1,22 @@
+// Table-driven router over path segments and query parameters, as a small REST API would do.
+const routes = [
+  ["GET", /^\/users$/, () => ({ list: "users" })],
+  ["GET", /^\/users\/([^/]+)$/, (m) => ({ user: m[1] })],
+  ["GET", /^\/users\/([^/]+)\/posts$/, (m) => ({ user: m[1], list: "posts" })],
+  ["GET", /^\/users\/([^/]+)\/posts\/([^/]+)$/, (m) => ({ user: m[1], post: m[2] })],
+  ["POST", /^\/users\/([^/]+)\/posts$/, (m) => ({ user: m[1], created: true })],
+  ["GET", /^\/orgs\/([^/]+)\/repos\/([^/]+)\/issues\/(\d+)\/comments$/, (m) => ({ org: m[1], repo: m[2], issue: Number(m[3]) })],
+  ["GET", /^\/search$/, () => ({ search: true })],
+];
+
+export default function handler(req) {
+  const url = new URL(req.url);
+  const params = {};
+  url.searchParams.forEach((v, k) => { params[k] = v; });
+  for (const [method, re, fn] of routes) {
+    if (method !== req.method) continue;
+    const m = url.pathname.match(re);
+    if (m) return Response.json({ ...fn(m), params });
+  }
+  return new Response(JSON.stringify({ error: "not found", path: url.pathname }), { status: 404 });
+}
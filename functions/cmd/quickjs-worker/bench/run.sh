@@ -0,0 +1,16 @@
+#!/bin/sh
+# Run every bench fixture and print one JSON result per line.
+#
+#   ./bench/run.sh [worker-binary] [extra --bench options...]
+#
+# Example: ./bench/run.sh ./quickjs-worker --iterations 20000 > results.ndjson
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORKER=${1:-$DIR/../quickjs-worker}
+[ $# -gt 0 ] && shift
+
+for bundle in "$DIR"/*.js; do
+	name=$(basename "$bundle" .js)
+	"$WORKER" --bench --name "$name" --bundle "$bundle" --corpus "$DIR/$name.ndjson" "$@"
+done
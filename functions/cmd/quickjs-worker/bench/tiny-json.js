@@ -0,0 +1,5 @@
+// Smallest realistic handler: read a query param, return a small JSON document.
+export default function handler(req) {
+  const url = new URL(req.url);
+  return Response.json({ ok: true, name: url.searchParams.get("name") || "world" });
+}
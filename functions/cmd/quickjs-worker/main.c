@@ -8,10 +8,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <math.h>
 #include <unistd.h>
 #include <sys/resource.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
 
 // QuickJS-NG headers
 #include "quickjs.h"
@@ -24,14 +32,16 @@
 #define MAX_LINE_LENGTH 1024 * 1024  // 1MB max line length for NDJSON
 #define MAX_BUNDLE_SIZE 10 * 1024 * 1024  // 10MB max bundle size
 
-// Global state
-static JSContext *ctx = NULL;
-static JSRuntime *rt = NULL;
-static JSValue handler_func = JS_UNDEFINED;
+// Global state. The runtime, context and per-invocation state are
+// thread-local so that threaded mode (WORKER_THREADS) can run one runtime per
+// thread; every other mode has a single thread.
+static __thread JSContext *ctx = NULL;
+static __thread JSRuntime *rt = NULL;
+static __thread JSValue handler_func = JS_UNDEFINED;
 static char *bundle_path = NULL;
 static char worker_id[64] = {0};
 /* Current invocation ID; set at start of execute_handler, cleared at end. Used by console override. */
-static char current_invoke_id[64] = {0};
+static __thread char current_invoke_id[64] = {0};
 
 // Capabilities structure
 typedef struct {
@@ -41,15 +51,164 @@ typedef struct {
     int allow_eval;
     long max_memory;
     int max_fds;
+    int log_level;  // console calls below this level are ignored (LOG_*)
 } capabilities_t;
 
 static capabilities_t caps = {0};
 
+enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
+
+// Growable byte buffer used to build messages whose size isn't known up front
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buf_t;
+
+// Per-invocation timestamps (Unix ns), reported back for traced invocations
+typedef struct {
+    int enabled;  // set when the invoke payload carries a traceparent
+    int64_t parsed;
+    int64_t request_built;
+    int64_t handler_start;
+    int64_t handler_settled;
+    int64_t serialized;
+} invoke_timings_t;
+
+static __thread invoke_timings_t timings = {0};
+
+// Heap size reported with responses; computing it walks the heap, so it is
+// sampled at most once per HEAP_SAMPLE_NS
+#define HEAP_SAMPLE_NS 1000000000LL
+static __thread int64_t heap_sampled_at = 0;
+
+// Heartbeat (STATS_INTERVAL_MS): a reporter thread writes a "stats" frame
+// every interval with the process's JS heap, garbage collections, RSS,
+// invocations and event-loop lag. It runs beside the JS threads, so a worker
+// stuck in a handler keeps reporting how long it has been stuck. Each JS
+// thread publishes its figures in its own slot around every message; the
+// reporter only reads them.
+#define STATS_MAX_THREADS 64
+
+typedef struct {
+    int64_t busy_since;   // monotonic ns the current message started; 0 when idle
+    int64_t heap;         // runtime malloc bytes, sampled with heap_sampled_at
+    int64_t gcs;          // automatic collections, seen as moves of the GC threshold
+    size_t gc_threshold;  // written by the owning thread only
+} thread_stats_t;
+
+static long stats_interval_ms = 0;
+static thread_stats_t thread_stats[STATS_MAX_THREADS];
+static int stats_threads = 1;      // slots in use; slot 0 is the main thread
+static __thread int stats_slot = 0;
+static int64_t stats_invocations = 0;
+
+// Console output is buffered per invocation and written as one "logs" frame:
+// ahead of the invocation's response (in the same flush), once LOG_BATCH_BYTES
+// are buffered, or once the oldest line is LOG_FLUSH_NS old. An invocation may
+// log log_max_lines lines and log_max_bytes bytes (LOG_MAX_LINES,
+// LOG_MAX_BYTES); lines past either limit are dropped and counted.
+#define LOG_BATCH_BYTES (64 * 1024)
+#define LOG_FLUSH_NS 200000000LL
+#define LOG_LINE_MAX (16 * 1024)
+#define LOG_DEFAULT_MAX_LINES 1000
+#define LOG_DEFAULT_MAX_BYTES (1024 * 1024)
+
+typedef struct {
+    buf_t entries;     // comma-separated {"level":..,"message":..} objects
+    int count;         // entries buffered
+    char id[64];       // invocation the entries belong to
+    int64_t oldest;    // monotonic time of the first buffered entry
+    long lines;        // lines accepted for this invocation
+    long bytes;        // message bytes accepted for this invocation
+    long dropped;      // lines over the limits not yet reported
+} log_buffer_t;
+
+static __thread log_buffer_t logbuf = {0};
+static long log_max_lines = LOG_DEFAULT_MAX_LINES;
+static long log_max_bytes = LOG_DEFAULT_MAX_BYTES;
+
+// --bench mode: messages are counted instead of written to stdout
+static int bench_mode = 0;
+
+// Blank mode (BLANK_WORKER): start without a bundle and wait for a "load"
+// message carrying the bundle and capabilities of the function to run
+static int blank_mode = 0;
+
+// Host mode (HOST_WORKER): one runtime hosts many functions, each loaded into
+// its own JSContext with its own handler and capabilities. Messages name the
+// function they are for; the least recently used function is unloaded when
+// the table is full or the runtime exceeds HOST_MEMORY_MB.
+#define HOST_DEFAULT_MAX_FUNCTIONS 64
+
+typedef struct {
+    char function_id[128];
+    JSContext *ctx;
+    JSValue handler;
+    capabilities_t caps;
+    int profiling_allowed;
+    uint64_t last_used;  // tick of the last message for this function
+} host_function_t;
+
+static int host_mode = 0;
+static host_function_t *host_functions = NULL;
+static int host_max_functions = HOST_DEFAULT_MAX_FUNCTIONS;
+static int host_count = 0;
+static size_t host_memory_limit = 0;  // bytes of runtime malloc; 0 is unlimited
+static uint64_t host_tick = 0;
+static JSContext *retired_ctx = NULL; // replaced by a reload; freed after the message
+static JSContext *host_ctx = NULL;    // parses control messages; hosts no function
+static int saved_argc = 0;
+static char **saved_argv = NULL;
+
+// Threaded mode (WORKER_THREADS > 1): the main thread compiles the bundle
+// once and reads stdin; each of the threads instantiates its own runtime from
+// the shared bytecode and takes messages from one queue, so an invocation
+// runs on whichever thread is idle. Replies carry the message ID and may be
+// written in any order.
+typedef struct queued_line {
+    char *line;
+    size_t len;
+    struct queued_line *next;
+} queued_line_t;
+
+static int worker_threads = 0;
+static uint8_t *shared_bytecode = NULL;
+static size_t shared_bytecode_len = 0;
+static pthread_mutex_t queue_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static queued_line_t *queue_head = NULL;
+static queued_line_t *queue_tail = NULL;
+static int queue_closed = 0;
+static int threads_ready = 0;
+static int threads_failed = 0;
+
+// Sampling profiler. SIGPROF only raises a flag; the stack itself is captured
+// from the QuickJS interrupt handler, where it is safe to touch the runtime.
+#define PROFILE_MAX_STACKS 2048
+#define PROFILE_MAX_FRAMES 64
+#define PROFILE_DEFAULT_HZ 99
+#define PROFILE_MAX_HZ 1000
+
+typedef struct {
+    char *stack;      // folded frames, outermost first, ';'-separated
+    uint32_t hash;
+    uint64_t count;
+} profile_entry_t;
+
+static int profiling_allowed = 0;
+static int profiling_active = 0;
+static int profile_hz = 0;
+static volatile sig_atomic_t profile_sample_pending = 0;
+static profile_entry_t profile_entries[PROFILE_MAX_STACKS];
+static uint64_t profile_samples = 0;
+static uint64_t profile_dropped = 0;
+
 // Forward declarations
 static void send_ready(void);
 static void send_error(const char *id, const char *message, const char *code);
 static void send_response(const char *id, int status, const char *headers_json, const char *body_base64);
-static void send_log(const char *id, const char *level, const char *message);
+static void log_write_locked(void);
 static int load_bundle(const char *path);
 static int execute_handler(const char *invoke_id, const char *method, const char *path, 
                           const char *headers_json, const char *query_json, const char *body_base64);
@@ -57,11 +216,117 @@ static void setup_capabilities(void);
 static void enforce_resource_limits(void);
 static void add_web_apis(JSContext *ctx);
 static void add_console_override(JSContext *ctx);
+static int parse_log_level(const char *name);
+static void console_forget(JSContext *c);
+static int interrupt_handler(JSRuntime *rt, void *opaque);
+static void buf_append(buf_t *b, const char *s, size_t n);
+static void buf_appendf(buf_t *b, const char *fmt, ...);
+static void buf_append_json_escaped(buf_t *b, const char *s, size_t n);
+static void buf_free(buf_t *b);
+static void bench_record_message(const char *type, const char *payload);
 
 // Send NDJSON message to stdout
 static void send_message(const char *type, const char *id, const char *payload) {
+    if (bench_mode) {
+        logbuf.count = 0;
+        logbuf.dropped = 0;
+        logbuf.entries.len = 0;
+        bench_record_message(type, payload);
+        return;
+    }
+    flockfile(stdout);
+    log_write_locked();
     printf("{\"id\":\"%s\",\"type\":\"%s\",\"payload\":%s}\n", id, type, payload);
     fflush(stdout);
+    funlockfile(stdout);
+}
+
+// Wall-clock time in Unix nanoseconds, comparable with the host's time.Now()
+static int64_t now_unix_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t now_mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Mark the start of a message on this thread, for the heartbeat's lag
+static void stats_begin(void) {
+    __atomic_store_n(&thread_stats[stats_slot].busy_since, now_mono_ns(), __ATOMIC_RELAXED);
+}
+
+// Publish this thread's heap and collections once a message is handled
+static void stats_end(void) {
+    thread_stats_t *s = &thread_stats[stats_slot];
+    if (stats_interval_ms > 0 && rt) {
+        // quickjs-ng raises the threshold after every automatic collection
+        size_t threshold = JS_GetGCThreshold(rt);
+        if (s->gc_threshold != 0 && threshold != s->gc_threshold) {
+            __atomic_add_fetch(&s->gcs, 1, __ATOMIC_RELAXED);
+        }
+        s->gc_threshold = threshold;
+        int64_t now = now_unix_ns();
+        if (now - heap_sampled_at >= HEAP_SAMPLE_NS) {
+            JSMemoryUsage usage;
+            JS_ComputeMemoryUsage(rt, &usage);
+            heap_sampled_at = now;
+            __atomic_store_n(&s->heap, (int64_t)usage.malloc_size, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&s->busy_since, 0, __ATOMIC_RELAXED);
+}
+
+static int64_t process_rss(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    long size = 0, resident = 0;
+    int ok = fscanf(f, "%ld %ld", &size, &resident) == 2;
+    fclose(f);
+    return ok ? (int64_t)resident * sysconf(_SC_PAGESIZE) : 0;
+}
+
+static void send_stats(void) {
+    int64_t now = now_mono_ns();
+    long long heap = 0, gcs = 0, lag = 0;
+    int n = __atomic_load_n(&stats_threads, __ATOMIC_RELAXED);
+    if (n > STATS_MAX_THREADS) n = STATS_MAX_THREADS;
+    for (int i = 0; i < n; i++) {
+        heap += __atomic_load_n(&thread_stats[i].heap, __ATOMIC_RELAXED);
+        gcs += __atomic_load_n(&thread_stats[i].gcs, __ATOMIC_RELAXED);
+        int64_t since = __atomic_load_n(&thread_stats[i].busy_since, __ATOMIC_RELAXED);
+        if (since > 0 && now - since > lag) lag = now - since;
+    }
+    char payload[256];
+    snprintf(payload, sizeof(payload),
+             "{\"heap\":%lld,\"gcs\":%lld,\"rss\":%lld,\"invocations\":%lld,\"lag_ms\":%lld}",
+             heap, gcs, (long long)process_rss(),
+             (long long)__atomic_load_n(&stats_invocations, __ATOMIC_RELAXED), lag / 1000000LL);
+    send_message("stats", worker_id, payload);
+}
+
+static void *stats_reporter(void *arg) {
+    (void)arg;
+    struct timespec interval = { stats_interval_ms / 1000, (stats_interval_ms % 1000) * 1000000L };
+    for (;;) {
+        nanosleep(&interval, NULL);
+        send_stats();
+    }
+    return NULL;
+}
+
+// Start the heartbeat; called once the worker has sent "ready"
+static void stats_start(void) {
+    if (stats_interval_ms <= 0 || bench_mode) return;
+    pthread_t reporter;
+    if (pthread_create(&reporter, NULL, stats_reporter, NULL) != 0) {
+        fprintf(stderr, "[WARN] Failed to start the stats reporter\n");
+        return;
+    }
+    pthread_detach(reporter);
 }
 
 static void send_ready(void) {
@@ -78,75 +343,361 @@ static void send_error(const char *id, const char *message, const char *code) {
 }
 
 static void send_response(const char *id, int status, const char *headers_json, const char *body_base64) {
-    // Escape JSON string for body (simple escaping)
-    char escaped_body[16384] = "";
-    if (body_base64 && strlen(body_base64) > 0) {
-        // Simple JSON string escaping
-        size_t j = 0;
-        for (size_t i = 0; i < strlen(body_base64) && j < sizeof(escaped_body) - 1; i++) {
-            char c = body_base64[i];
-            if (c == '"') {
-                escaped_body[j++] = '\\';
-                escaped_body[j++] = '"';
-            } else if (c == '\\') {
-                escaped_body[j++] = '\\';
-                escaped_body[j++] = '\\';
-            } else if (c == '\n') {
-                escaped_body[j++] = '\\';
-                escaped_body[j++] = 'n';
-            } else if (c == '\r') {
-                escaped_body[j++] = '\\';
-                escaped_body[j++] = 'r';
+    buf_t payload = {0};
+    buf_appendf(&payload, "{\"status\":%d,\"headers\":%s,\"body\":\"",
+                status, headers_json ? headers_json : "{}");
+    if (body_base64) {
+        buf_append_json_escaped(&payload, body_base64, strlen(body_base64));
+    }
+    buf_append(&payload, "\"", 1);
+    
+    if (timings.enabled) {
+        timings.serialized = now_unix_ns();
+        buf_appendf(&payload,
+                    ",\"timings\":{\"parsed\":%lld,\"request_built\":%lld,\"handler_start\":%lld,"
+                    "\"handler_settled\":%lld,\"serialized\":%lld}",
+                    (long long)timings.parsed, (long long)timings.request_built,
+                    (long long)timings.handler_start, (long long)timings.handler_settled,
+                    (long long)timings.serialized);
+    }
+    if (!host_mode) {
+        int64_t now = now_unix_ns();
+        if (now - heap_sampled_at >= HEAP_SAMPLE_NS) {
+            JSMemoryUsage usage;
+            JS_ComputeMemoryUsage(rt, &usage);
+            heap_sampled_at = now;
+            __atomic_store_n(&thread_stats[stats_slot].heap, (int64_t)usage.malloc_size, __ATOMIC_RELAXED);
+            buf_appendf(&payload, ",\"heap\":%lld", (long long)usage.malloc_size);
+        }
+    }
+    buf_append(&payload, "}", 1);
+    
+    if (payload.data) {
+        send_message("response", id, payload.data);
+    } else {
+        send_error(id, "Failed to allocate response", "RESPONSE_TOO_LARGE");
+    }
+    buf_free(&payload);
+}
+
+static int buf_reserve(buf_t *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + extra + 1) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) return -1;
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static void buf_append(buf_t *b, const char *s, size_t n) {
+    if (buf_reserve(b, n) != 0) return;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void buf_appendf(buf_t *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0 || buf_reserve(b, (size_t)n) != 0) return;
+    va_start(ap, fmt);
+    vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    b->len += (size_t)n;
+}
+
+// Append s as the contents of a JSON string (without surrounding quotes)
+static void buf_append_json_escaped(buf_t *b, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        switch (c) {
+        case '"':  buf_append(b, "\\\"", 2); break;
+        case '\\': buf_append(b, "\\\\", 2); break;
+        case '\n': buf_append(b, "\\n", 2); break;
+        case '\r': buf_append(b, "\\r", 2); break;
+        case '\t': buf_append(b, "\\t", 2); break;
+        default:
+            if (c < 0x20) {
+                buf_appendf(b, "\\u%04x", c);
             } else {
-                escaped_body[j++] = c;
+                buf_append(b, (const char *)&s[i], 1);
             }
         }
-        escaped_body[j] = '\0';
     }
-    
-    char payload[32768];  // Increased size for larger responses
-    snprintf(payload, sizeof(payload),
-             "{\"status\":%d,\"headers\":%s,\"body\":\"%s\"}",
-             status,
-             headers_json ? headers_json : "{}",
-             escaped_body);
-    send_message("response", id, payload);
-}
-
-/* Escape string for JSON and truncate to fit in out_buf (includes null). Returns out_buf. */
-static char *escape_json_str(const char *in, char *out_buf, size_t out_size) {
-    if (!out_size) return out_buf;
-    size_t j = 0;
-    for (const char *p = in; p && *p && j < out_size - 1; p++) {
-        if (*p == '"' || *p == '\\') {
-            if (j + 2 >= out_size) break;
-            out_buf[j++] = '\\';
-            out_buf[j++] = *p;
-        } else if (*p == '\n') {
-            if (j + 2 >= out_size) break;
-            out_buf[j++] = '\\';
-            out_buf[j++] = 'n';
-        } else if (*p == '\r') {
-            if (j + 2 >= out_size) break;
-            out_buf[j++] = '\\';
-            out_buf[j++] = 'r';
-        } else {
-            out_buf[j++] = *p;
+}
+
+static void buf_free(buf_t *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+// Write the buffered log entries as one "logs" frame. The caller holds the
+// stdout lock and flushes.
+static void log_write_locked(void) {
+    if (logbuf.count == 0 && logbuf.dropped == 0) return;
+    printf("{\"id\":\"%s\",\"type\":\"logs\",\"payload\":{\"entries\":[%s],\"dropped\":%ld}}\n",
+           logbuf.id, logbuf.entries.data ? logbuf.entries.data : "", logbuf.dropped);
+    logbuf.count = 0;
+    logbuf.dropped = 0;
+    logbuf.entries.len = 0;
+    if (logbuf.entries.data) logbuf.entries.data[0] = '\0';
+}
+
+static void log_flush(void) {
+    if (logbuf.count == 0 && logbuf.dropped == 0) return;
+    if (bench_mode) {
+        logbuf.count = 0;
+        logbuf.dropped = 0;
+        logbuf.entries.len = 0;
+        return;
+    }
+    flockfile(stdout);
+    log_write_locked();
+    fflush(stdout);
+    funlockfile(stdout);
+}
+
+// Buffer one console line for the current invocation
+static void log_record(const char *level, const char *message, size_t len) {
+    const char *id = current_invoke_id[0] ? current_invoke_id : "bundle";
+    if (strcmp(id, logbuf.id) != 0) {
+        log_flush();
+        strncpy(logbuf.id, id, sizeof(logbuf.id) - 1);
+        logbuf.id[sizeof(logbuf.id) - 1] = '\0';
+        logbuf.lines = 0;
+        logbuf.bytes = 0;
+    }
+    if (len > LOG_LINE_MAX) {
+        // Cut on a UTF-8 character boundary
+        len = LOG_LINE_MAX;
+        while (len > 0 && ((unsigned char)message[len] & 0xC0) == 0x80) len--;
+    }
+    if (logbuf.lines >= log_max_lines || logbuf.bytes + (long)len > log_max_bytes) {
+        logbuf.dropped++;
+        return;
+    }
+    logbuf.lines++;
+    logbuf.bytes += (long)len;
+
+    if (logbuf.count == 0) {
+        logbuf.oldest = now_mono_ns();
+    } else {
+        buf_append(&logbuf.entries, ",", 1);
+    }
+    buf_append(&logbuf.entries, "{\"level\":\"", 11);
+    buf_append_json_escaped(&logbuf.entries, level, strlen(level));
+    buf_append(&logbuf.entries, "\",\"message\":\"", 13);
+    buf_append_json_escaped(&logbuf.entries, message, len);
+    buf_append(&logbuf.entries, "\"}", 2);
+    logbuf.count++;
+
+    if (logbuf.entries.len >= LOG_BATCH_BYTES || now_mono_ns() - logbuf.oldest >= LOG_FLUSH_NS) {
+        log_flush();
+    }
+}
+
+// Append the standard (padded) base64 encoding of in
+static void base64_encode(buf_t *b, const unsigned char *in, size_t len) {
+    static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    if (buf_reserve(b, ((len + 2) / 3) * 4) != 0) return;
+    char *out = b->data + b->len;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        *out++ = base64_chars[(v >> 18) & 0x3F];
+        *out++ = base64_chars[(v >> 12) & 0x3F];
+        *out++ = base64_chars[(v >> 6) & 0x3F];
+        *out++ = base64_chars[v & 0x3F];
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)in[i + 1] << 8;
+        *out++ = base64_chars[(v >> 18) & 0x3F];
+        *out++ = base64_chars[(v >> 12) & 0x3F];
+        *out++ = i + 1 < len ? base64_chars[(v >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    b->len = (size_t)(out - b->data);
+    b->data[b->len] = '\0';
+}
+
+static void profile_sigprof(int sig) {
+    (void)sig;
+    profile_sample_pending = 1;
+}
+
+static void profile_reset(void) {
+    for (int i = 0; i < PROFILE_MAX_STACKS; i++) {
+        free(profile_entries[i].stack);
+        profile_entries[i].stack = NULL;
+        profile_entries[i].count = 0;
+    }
+    profile_samples = 0;
+    profile_dropped = 0;
+}
+
+static uint32_t profile_hash(const char *s, size_t n) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void profile_record(const char *stack, size_t n) {
+    uint32_t h = profile_hash(stack, n);
+    for (int probe = 0; probe < PROFILE_MAX_STACKS; probe++) {
+        profile_entry_t *e = &profile_entries[(h + probe) % PROFILE_MAX_STACKS];
+        if (!e->stack) {
+            e->stack = strndup(stack, n);
+            if (!e->stack) break;
+            e->hash = h;
+            e->count = 1;
+            profile_samples++;
+            return;
+        }
+        if (e->hash == h && strlen(e->stack) == n && memcmp(e->stack, stack, n) == 0) {
+            e->count++;
+            profile_samples++;
+            return;
         }
     }
-    out_buf[j] = '\0';
-    return out_buf;
+    profile_dropped++;
 }
 
-static void send_log(const char *id, const char *level, const char *message) {
-    char msg_escaped[768];
-    escape_json_str(message ? message : "", msg_escaped, sizeof(msg_escaped));
-    char payload[1024];
-    snprintf(payload, sizeof(payload),
-             "{\"level\":\"%s\",\"message\":\"%s\"}",
-             level ? level : "info",
-             msg_escaped);
-    send_message("log", id, payload);
+/*
+ * Convert a QuickJS backtrace ("    at fn (file:line:col)" per line, innermost
+ * first) into a folded stack ("outer;...;inner") keyed by function and line.
+ */
+static void profile_capture_sample(void) {
+    JSValue err = JS_NewError(ctx);
+    if (JS_IsException(err)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return;
+    }
+    JSValue stack_val = JS_GetPropertyStr(ctx, err, "stack");
+    const char *stack = JS_IsString(stack_val) ? JS_ToCString(ctx, stack_val) : NULL;
+
+    buf_t frames[PROFILE_MAX_FRAMES];
+    int nframes = 0;
+    for (const char *p = stack; p && *p && nframes < PROFILE_MAX_FRAMES;) {
+        const char *eol = strchr(p, '\n');
+        const char *end = eol ? eol : p + strlen(p);
+        while (p < end && *p == ' ') p++;
+        if (end - p > 3 && strncmp(p, "at ", 3) == 0) {
+            p += 3;
+            buf_t *f = &frames[nframes++];
+            memset(f, 0, sizeof(*f));
+            // Drop the column so samples aggregate per line: "fn (file:10:5)" -> "fn (file:10)"
+            const char *open = memchr(p, '(', (size_t)(end - p));
+            const char *col = memrchr(p, ':', (size_t)(end - p));
+            const char *line = col ? memrchr(p, ':', (size_t)(col - p)) : NULL;
+            if (open && line && line > open && end[-1] == ')') {
+                buf_append(f, p, (size_t)(col - p));
+                buf_append(f, ")", 1);
+            } else {
+                buf_append(f, p, (size_t)(end - p));
+            }
+            for (size_t k = 0; k < f->len; k++) {
+                if (f->data[k] == ';') f->data[k] = '_';  // ';' separates frames
+            }
+        }
+        p = eol ? eol + 1 : NULL;
+    }
+
+    if (nframes > 0) {
+        buf_t folded = {0};
+        for (int i = nframes - 1; i >= 0; i--) {
+            if (folded.len) buf_append(&folded, ";", 1);
+            if (frames[i].data) buf_append(&folded, frames[i].data, frames[i].len);
+            buf_free(&frames[i]);
+        }
+        if (folded.data) profile_record(folded.data, folded.len);
+        buf_free(&folded);
+    }
+
+    if (stack) JS_FreeCString(ctx, stack);
+    JS_FreeValue(ctx, stack_val);
+    JS_FreeValue(ctx, err);
+}
+
+static int interrupt_handler(JSRuntime *rt, void *opaque) {
+    (void)rt;
+    (void)opaque;
+    if (profile_sample_pending) {
+        profile_sample_pending = 0;
+        if (profiling_active) {
+            profile_capture_sample();
+        }
+    }
+    // Long invocations ship their logs while they run
+    if (logbuf.count > 0 && now_mono_ns() - logbuf.oldest >= LOG_FLUSH_NS) {
+        log_flush();
+    }
+    return 0;
+}
+
+static int profile_start(int hz) {
+    if (hz <= 0) hz = PROFILE_DEFAULT_HZ;
+    if (hz > PROFILE_MAX_HZ) hz = PROFILE_MAX_HZ;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = profile_sigprof;
+    sa.sa_flags = SA_RESTART;  // don't break the blocking getline on stdin
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) != 0) {
+        return -1;
+    }
+
+    profile_reset();
+    profile_hz = hz;
+    profiling_active = 1;
+
+    struct itimerval tv;
+    tv.it_interval.tv_sec = 0;
+    tv.it_interval.tv_usec = 1000000 / hz;
+    tv.it_value = tv.it_interval;
+    if (setitimer(ITIMER_PROF, &tv, NULL) != 0) {
+        profiling_active = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void profile_stop(void) {
+    struct itimerval tv;
+    memset(&tv, 0, sizeof(tv));
+    setitimer(ITIMER_PROF, &tv, NULL);
+    profiling_active = 0;
+    profile_sample_pending = 0;
+}
+
+// Send aggregated samples as a "profile" message in folded-stack format
+static void send_profile(const char *id) {
+    buf_t folded = {0};
+    for (int i = 0; i < PROFILE_MAX_STACKS; i++) {
+        profile_entry_t *e = &profile_entries[i];
+        if (!e->stack) continue;
+        buf_appendf(&folded, "%s %llu\n", e->stack, (unsigned long long)e->count);
+    }
+
+    buf_t payload = {0};
+    buf_appendf(&payload, "{\"hz\":%d,\"samples\":%llu,\"dropped\":%llu,\"folded\":\"",
+                profile_hz, (unsigned long long)profile_samples, (unsigned long long)profile_dropped);
+    if (folded.data) buf_append_json_escaped(&payload, folded.data, folded.len);
+    buf_append(&payload, "\"}", 2);
+
+    send_message("profile", id, payload.data ? payload.data : "{}");
+    buf_free(&payload);
+    buf_free(&folded);
+    profile_reset();
 }
 
 // Setup capabilities from environment
@@ -162,6 +713,7 @@ static void setup_capabilities(void) {
     caps.allow_network = getenv("ALLOW_NETWORK") != NULL;
     caps.allow_child_process = getenv("ALLOW_CHILD_PROCESS") != NULL;
     caps.allow_eval = getenv("ALLOW_EVAL") != NULL;
+    profiling_allowed = getenv("ALLOW_PROFILING") != NULL;
     
     const char *max_mem = getenv("MAX_MEMORY");
     if (max_mem) {
@@ -172,6 +724,8 @@ static void setup_capabilities(void) {
     if (max_fds) {
         caps.max_fds = atoi(max_fds);
     }
+
+    caps.log_level = parse_log_level(getenv("LOG_LEVEL"));
 }
 
 // Missing cutils symbol override
@@ -403,63 +957,400 @@ static void add_web_apis(JSContext *ctx) {
     }
 }
 
-// C callback for JS console: __bunbase_log(level, message). Sends log to host via send_log.
-static JSValue js_bunbase_log(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    const char *level = "info";
-    const char *message = "";
-    const char *level_to_free = NULL;
-    const char *message_to_free = NULL;
-    if (argc >= 2) {
-        level_to_free = JS_ToCString(ctx, argv[0]);
-        message_to_free = JS_ToCString(ctx, argv[1]);
-        level = level_to_free ? level_to_free : "info";
-        message = message_to_free ? message_to_free : "";
-    } else if (argc >= 1) {
-        message_to_free = JS_ToCString(ctx, argv[0]);
-        message = message_to_free ? message_to_free : "";
-    }
-    send_log(current_invoke_id[0] ? current_invoke_id : "bundle", level, message);
-    if (level_to_free) JS_FreeCString(ctx, level_to_free);
-    if (message_to_free) JS_FreeCString(ctx, message_to_free);
+/*
+ * Native console. Each method carries its level as magic and returns before
+ * touching its arguments when the level is below the function's minimum
+ * (caps.log_level), so debug logging left in production costs one C call.
+ * Arguments are formatted straight into a buffer: strings as-is, objects and
+ * arrays as JSON (through toJSON when they have one), errors by their stack.
+ * Nesting deeper than CONSOLE_MAX_DEPTH, more than CONSOLE_MAX_ITEMS entries
+ * per object, and output past LOG_LINE_MAX are elided. A leading format
+ * string followed by arguments may use %s, %d/%i, %f, %o/%O/%j, %c and %%.
+ */
+#define CONSOLE_MAX_DEPTH 4
+#define CONSOLE_MAX_ITEMS 100
+#define CONSOLE_MAX_LABELS 64
+
+static const char *const log_level_names[] = {"debug", "info", "warn", "error"};
+
+// Parse a minimum log level name; unknown names keep everything
+static int parse_log_level(const char *name) {
+    for (int i = 0; name && i < LOG_ERROR + 1; i++) {
+        if (strcasecmp(name, log_level_names[i]) == 0) return i;
+    }
+    return LOG_DEBUG;
+}
+
+// console.time and console.count state, per context
+typedef struct {
+    JSContext *ctx;
+    char label[64];
+    int64_t value;  // start (monotonic ns) for timers, calls for counters
+} console_label_t;
+
+static __thread console_label_t console_timers[CONSOLE_MAX_LABELS];
+static __thread console_label_t console_counters[CONSOLE_MAX_LABELS];
+
+static console_label_t *console_label(console_label_t *table, JSContext *c, const char *label, int create) {
+    console_label_t *free_slot = NULL;
+    for (int i = 0; i < CONSOLE_MAX_LABELS; i++) {
+        if (table[i].ctx == c && strcmp(table[i].label, label) == 0) return &table[i];
+        if (!table[i].ctx && !free_slot) free_slot = &table[i];
+    }
+    if (!create || !free_slot) return NULL;
+    free_slot->ctx = c;
+    snprintf(free_slot->label, sizeof(free_slot->label), "%s", label);
+    free_slot->value = 0;
+    return free_slot;
+}
+
+// Drop the timers and counters of a context that is being freed
+static void console_forget(JSContext *c) {
+    for (int i = 0; i < CONSOLE_MAX_LABELS; i++) {
+        if (console_timers[i].ctx == c) console_timers[i].ctx = NULL;
+        if (console_counters[i].ctx == c) console_counters[i].ctx = NULL;
+    }
+}
+
+// Clear a pending exception raised while formatting; console never throws
+static void console_clear_exception(JSContext *c) {
+    JS_FreeValue(c, JS_GetException(c));
+}
+
+static void console_append_cstring(JSContext *c, buf_t *out, JSValueConst v, int quoted) {
+    size_t len;
+    const char *s = JS_ToCStringLen(c, &len, v);
+    if (!s) {
+        console_clear_exception(c);
+        buf_append(out, quoted ? "null" : "[object]", quoted ? 4 : 8);
+        return;
+    }
+    if (quoted) {
+        buf_append(out, "\"", 1);
+        buf_append_json_escaped(out, s, len);
+        buf_append(out, "\"", 1);
+    } else {
+        buf_append(out, s, len);
+    }
+    JS_FreeCString(c, s);
+}
+
+static void console_format_value(JSContext *c, buf_t *out, JSValueConst v, int depth);
+
+static void console_format_object(JSContext *c, buf_t *out, JSValueConst v, int depth) {
+    int is_array = JS_IsArray(c, v) > 0;
+    if (depth >= CONSOLE_MAX_DEPTH) {
+        buf_append(out, is_array ? "\"[Array]\"" : "\"[Object]\"", is_array ? 9 : 10);
+        return;
+    }
+    if (is_array) {
+        int64_t len = 0;
+        if (JS_GetLength(c, v, &len) < 0) {
+            console_clear_exception(c);
+        }
+        buf_append(out, "[", 1);
+        for (int64_t i = 0; i < len; i++) {
+            if (i) buf_append(out, ",", 1);
+            if (i == CONSOLE_MAX_ITEMS || out->len > LOG_LINE_MAX) {
+                buf_appendf(out, "\"... %lld more\"", (long long)(len - i));
+                break;
+            }
+            JSValue item = JS_GetPropertyUint32(c, v, (uint32_t)i);
+            console_format_value(c, out, item, depth + 1);
+            JS_FreeValue(c, item);
+        }
+        buf_append(out, "]", 1);
+        return;
+    }
+
+    JSPropertyEnum *props = NULL;
+    uint32_t nprops = 0;
+    if (JS_GetOwnPropertyNames(c, &props, &nprops, v, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        console_clear_exception(c);
+        buf_append(out, "{}", 2);
+        return;
+    }
+    buf_append(out, "{", 1);
+    int written = 0;
+    for (uint32_t i = 0; i < nprops; i++) {
+        if (written == CONSOLE_MAX_ITEMS || out->len > LOG_LINE_MAX) {
+            buf_appendf(out, ",\"...\":\"%u more\"", nprops - i);
+            break;
+        }
+        JSValue item = JS_GetProperty(c, v, props[i].atom);
+        if (JS_IsException(item)) {
+            console_clear_exception(c);
+            item = JS_UNDEFINED;
+        }
+        // Like JSON.stringify, leave out undefined values and functions
+        if (JS_IsUndefined(item) || JS_IsFunction(c, item) || JS_IsSymbol(item)) {
+            JS_FreeValue(c, item);
+            continue;
+        }
+        const char *key = JS_AtomToCString(c, props[i].atom);
+        if (written++) buf_append(out, ",", 1);
+        buf_append(out, "\"", 1);
+        if (key) buf_append_json_escaped(out, key, strlen(key));
+        buf_append(out, "\":", 2);
+        if (key) JS_FreeCString(c, key);
+        console_format_value(c, out, item, depth + 1);
+        JS_FreeValue(c, item);
+    }
+    buf_append(out, "}", 1);
+    JS_FreePropertyEnum(c, props, nprops);
+}
+
+// Format v as a top-level argument (depth 0) or as JSON inside an object
+static void console_format_value(JSContext *c, buf_t *out, JSValueConst v, int depth) {
+    if (JS_IsString(v)) {
+        console_append_cstring(c, out, v, depth > 0);
+        return;
+    }
+    if (JS_IsUndefined(v)) {
+        buf_append(out, depth > 0 ? "null" : "undefined", depth > 0 ? 4 : 9);
+        return;
+    }
+    if (JS_IsSymbol(v)) {
+        JSValue desc = JS_GetPropertyStr(c, v, "description");
+        buf_t sym = {0};
+        buf_append(&sym, "Symbol(", 7);
+        if (JS_IsString(desc)) console_append_cstring(c, &sym, desc, 0);
+        buf_append(&sym, ")", 1);
+        JS_FreeValue(c, desc);
+        if (depth > 0) buf_append(out, "\"", 1);
+        if (sym.data) buf_append(out, sym.data, sym.len);
+        if (depth > 0) buf_append(out, "\"", 1);
+        buf_free(&sym);
+        return;
+    }
+    if (!JS_IsObject(v)) {
+        // Numbers, booleans, null and BigInts print as themselves
+        console_append_cstring(c, out, v, 0);
+        return;
+    }
+    if (JS_IsFunction(c, v)) {
+        JSValue name = JS_GetPropertyStr(c, v, "name");
+        buf_append(out, depth > 0 ? "\"[Function: " : "[Function: ", depth > 0 ? 12 : 11);
+        if (JS_IsString(name)) console_append_cstring(c, out, name, 0);
+        buf_append(out, depth > 0 ? "]\"" : "]", depth > 0 ? 2 : 1);
+        JS_FreeValue(c, name);
+        return;
+    }
+    if (JS_IsError(c, v)) {
+        JSValue stack = JS_GetPropertyStr(c, v, "stack");
+        buf_t text = {0};
+        console_append_cstring(c, &text, v, 0);
+        if (JS_IsString(stack)) {
+            buf_append(&text, "\n", 1);
+            console_append_cstring(c, &text, stack, 0);
+        }
+        JS_FreeValue(c, stack);
+        if (depth > 0) {
+            buf_append(out, "\"", 1);
+            if (text.data) buf_append_json_escaped(out, text.data, text.len);
+            buf_append(out, "\"", 1);
+        } else if (text.data) {
+            buf_append(out, text.data, text.len);
+        }
+        buf_free(&text);
+        return;
+    }
+    JSValue to_json = JS_GetPropertyStr(c, v, "toJSON");
+    if (JS_IsFunction(c, to_json)) {
+        // Dates and other objects that define their JSON form. Like
+        // JSON.stringify, toJSON is called once: an object it returns is
+        // written as it is, even if it has a toJSON of its own.
+        JSValue j = JS_Call(c, to_json, v, 0, NULL);
+        JS_FreeValue(c, to_json);
+        if (JS_IsException(j)) {
+            console_clear_exception(c);
+            buf_append(out, "null", 4);
+            return;
+        }
+        if (JS_IsObject(j) && !JS_IsFunction(c, j)) {
+            console_format_object(c, out, j, depth);
+        } else {
+            console_format_value(c, out, j, depth > 0 ? depth : 1);
+        }
+        JS_FreeValue(c, j);
+        return;
+    }
+    JS_FreeValue(c, to_json);
+    console_format_object(c, out, v, depth);
+}
+
+// Format console arguments into out, applying a leading format string
+static void console_format_args(JSContext *c, buf_t *out, int argc, JSValueConst *argv) {
+    int next = 0;
+    if (argc > 1 && JS_IsString(argv[0])) {
+        size_t len;
+        const char *fmt = JS_ToCStringLen(c, &len, argv[0]);
+        if (fmt && memchr(fmt, '%', len)) {
+            next = 1;
+            size_t start = 0;
+            for (size_t i = 0; i + 1 < len; i++) {
+                if (fmt[i] != '%') continue;
+                char spec = fmt[i + 1];
+                if (spec != '%' && (next >= argc || !strchr("sdifoOjc", spec))) continue;
+                buf_append(out, fmt + start, i - start);
+                start = i + 2;
+                i++;
+                if (spec == '%') {
+                    buf_append(out, "%", 1);
+                    continue;
+                }
+                JSValueConst arg = argv[next++];
+                switch (spec) {
+                case 's':
+                    if (JS_IsObject(arg) && !JS_IsFunction(c, arg) && !JS_IsError(c, arg)) {
+                        console_format_value(c, out, arg, 0);
+                    } else {
+                        console_append_cstring(c, out, arg, 0);
+                    }
+                    break;
+                case 'd':
+                case 'i': {
+                    double d;
+                    if (JS_IsBigInt(c, arg)) {
+                        console_append_cstring(c, out, arg, 0);
+                    } else if (JS_ToFloat64(c, &d, arg) < 0) {
+                        console_clear_exception(c);
+                        buf_append(out, "NaN", 3);
+                    } else if (isnan(d) || isinf(d)) {
+                        buf_appendf(out, "%s", isnan(d) ? "NaN" : d > 0 ? "Infinity" : "-Infinity");
+                    } else {
+                        buf_appendf(out, "%.0f", trunc(d));
+                    }
+                    break;
+                }
+                case 'f': {
+                    double d;
+                    if (JS_ToFloat64(c, &d, arg) < 0) {
+                        console_clear_exception(c);
+                        d = NAN;
+                    }
+                    JSValue num = JS_NewFloat64(c, d);
+                    console_append_cstring(c, out, num, 0);
+                    JS_FreeValue(c, num);
+                    break;
+                }
+                case 'c':
+                    break;  // CSS styling has no meaning in a log line
+                default:
+                    console_format_value(c, out, arg, 0);
+                }
+            }
+            buf_append(out, fmt + start, len - start);
+        }
+        if (fmt) JS_FreeCString(c, fmt);
+    }
+    // Separate every argument after the first, even an empty one, and the
+    // arguments left over after a format string
+    for (int i = next; i < argc && out->len <= LOG_LINE_MAX; i++) {
+        if (i) buf_append(out, " ", 1);
+        console_format_value(c, out, argv[i], 0);
+    }
+}
+
+// console.log/info/warn/error/debug; magic is the level
+static JSValue js_console_log(JSContext *c, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    if (magic < caps.log_level) return JS_UNDEFINED;
+    buf_t out = {0};
+    console_format_args(c, &out, argc, argv);
+    log_record(log_level_names[magic], out.data ? out.data : "", out.len);
+    buf_free(&out);
+    return JS_UNDEFINED;
+}
+
+// Copy the label argument of console.time/count ("default" when absent)
+static void console_label_arg(JSContext *c, int argc, JSValueConst *argv, char *label, size_t size) {
+    const char *s = NULL;
+    if (argc > 0 && !JS_IsUndefined(argv[0])) {
+        s = JS_ToCString(c, argv[0]);
+        if (!s) console_clear_exception(c);
+    }
+    snprintf(label, size, "%s", s ? s : "default");
+    if (s) JS_FreeCString(c, s);
+}
+
+enum { CONSOLE_TIME, CONSOLE_TIME_LOG, CONSOLE_TIME_END, CONSOLE_COUNT, CONSOLE_COUNT_RESET };
+
+// console.time/timeLog/timeEnd/count/countReset; they log at info level
+static JSValue js_console_label(JSContext *c, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    char label[64];
+    console_label_arg(c, argc, argv, label, sizeof(label));
+    char line[128];
+    int n = 0;
+    switch (magic) {
+    case CONSOLE_TIME: {
+        console_label_t *t = console_label(console_timers, c, label, 1);
+        if (t) t->value = now_mono_ns();
+        return JS_UNDEFINED;
+    }
+    case CONSOLE_TIME_LOG:
+    case CONSOLE_TIME_END: {
+        console_label_t *t = console_label(console_timers, c, label, 0);
+        if (!t) {
+            n = snprintf(line, sizeof(line), "Timer '%s' does not exist", label);
+            if (LOG_WARN >= caps.log_level) log_record("warn", line, (size_t)n);
+            return JS_UNDEFINED;
+        }
+        double ms = (double)(now_mono_ns() - t->value) / 1e6;
+        if (magic == CONSOLE_TIME_END) t->ctx = NULL;
+        if (LOG_INFO < caps.log_level) return JS_UNDEFINED;
+        n = snprintf(line, sizeof(line), "%s: %.3fms", label, ms);
+        break;
+    }
+    case CONSOLE_COUNT: {
+        console_label_t *t = console_label(console_counters, c, label, 1);
+        if (!t) return JS_UNDEFINED;
+        t->value++;
+        if (LOG_INFO < caps.log_level) return JS_UNDEFINED;
+        n = snprintf(line, sizeof(line), "%s: %lld", label, (long long)t->value);
+        break;
+    }
+    case CONSOLE_COUNT_RESET: {
+        console_label_t *t = console_label(console_counters, c, label, 0);
+        if (t) t->ctx = NULL;
+        return JS_UNDEFINED;
+    }
+    }
+    if (n > 0) {
+        // Timer lines get any extra timeLog/timeEnd arguments appended
+        buf_t out = {0};
+        buf_append(&out, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+        if (magic == CONSOLE_TIME_LOG && argc > 1) {
+            buf_append(&out, " ", 1);
+            console_format_args(c, &out, argc - 1, argv + 1);
+        }
+        log_record("info", out.data ? out.data : "", out.len);
+        buf_free(&out);
+    }
     return JS_UNDEFINED;
 }
 
-/* Helper: stringify multiple args for console.log("a", 1) -> "a 1" */
 static void add_console_override(JSContext *ctx) {
+    static const struct { const char *name; int level; } log_methods[] = {
+        {"log", LOG_INFO}, {"info", LOG_INFO}, {"warn", LOG_WARN},
+        {"error", LOG_ERROR}, {"debug", LOG_DEBUG},
+    };
+    static const struct { const char *name; int op; } label_methods[] = {
+        {"time", CONSOLE_TIME}, {"timeLog", CONSOLE_TIME_LOG}, {"timeEnd", CONSOLE_TIME_END},
+        {"count", CONSOLE_COUNT}, {"countReset", CONSOLE_COUNT_RESET},
+    };
     JSValue global = JS_GetGlobalObject(ctx);
-    JSValue log_fn = JS_NewCFunction(ctx, js_bunbase_log, "__bunbase_log", 2);
-    JS_SetPropertyStr(ctx, global, "__bunbase_log", log_fn);
-
-    const char *console_inject =
-        "(function(){"
-        "  function stringifyArgs(args){"
-        "    if (!args || args.length === 0) return '';"
-        "    try {"
-        "      return Array.from(args).map(function(x){"
-        "        if (x === null) return 'null';"
-        "        if (typeof x === 'object') return JSON.stringify(x);"
-        "        return String(x);"
-        "      }).join(' ');"
-        "    } catch(e) { return String(args[0]); }"
-        "  }"
-        "  globalThis.console = {"
-        "    log: function(){ __bunbase_log('info', stringifyArgs(arguments)); },"
-        "    info: function(){ __bunbase_log('info', stringifyArgs(arguments)); },"
-        "    warn: function(){ __bunbase_log('warn', stringifyArgs(arguments)); },"
-        "    error: function(){ __bunbase_log('error', stringifyArgs(arguments)); },"
-        "    debug: function(){ __bunbase_log('debug', stringifyArgs(arguments)); }"
-        "  };"
-        "})();";
-    JSValue result = JS_Eval(ctx, console_inject, strlen(console_inject), "<console-override>", JS_EVAL_TYPE_GLOBAL);
-    if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[WARN] Failed to add console override: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
-    } else {
-        JS_FreeValue(ctx, result);
+    JSValue console = JS_NewObject(ctx);
+    for (size_t i = 0; i < sizeof(log_methods) / sizeof(log_methods[0]); i++) {
+        JS_SetPropertyStr(ctx, console, log_methods[i].name,
+                          JS_NewCFunctionMagic(ctx, js_console_log, log_methods[i].name, 0,
+                                               JS_CFUNC_generic_magic, log_methods[i].level));
     }
+    for (size_t i = 0; i < sizeof(label_methods) / sizeof(label_methods[0]); i++) {
+        JS_SetPropertyStr(ctx, console, label_methods[i].name,
+                          JS_NewCFunctionMagic(ctx, js_console_label, label_methods[i].name, 0,
+                                               JS_CFUNC_generic_magic, label_methods[i].op));
+    }
+    JS_SetPropertyStr(ctx, global, "console", console);
     JS_FreeValue(ctx, global);
 }
 
@@ -506,12 +1397,21 @@ static void enforce_resource_limits(void) {
     }
 }
 
-// Load JavaScript bundle and extract handler
-static int load_bundle(const char *path) {
+// Report and clear the pending exception of ctx
+static void log_exception(const char *what) {
+    JSValue exception = JS_GetException(ctx);
+    const char *error = JS_ToCString(ctx, exception);
+    fprintf(stderr, "[ERROR] %s: %s\n", what, error ? error : "unknown error");
+    if (error) JS_FreeCString(ctx, error);
+    JS_FreeValue(ctx, exception);
+}
+
+// Compile a bundle into an unevaluated module function; JS_EXCEPTION on error
+static JSValue compile_bundle(const char *path) {
     FILE *f = fopen(path, "r");
     if (!f) {
         fprintf(stderr, "[ERROR] Failed to open bundle: %s\n", path);
-        return -1;
+        return JS_EXCEPTION;
     }
     
     fseek(f, 0, SEEK_END);
@@ -521,121 +1421,92 @@ static int load_bundle(const char *path) {
     if (size > MAX_BUNDLE_SIZE) {
         fprintf(stderr, "[ERROR] Bundle too large: %ld bytes\n", size);
         fclose(f);
-        return -1;
+        return JS_EXCEPTION;
     }
     
     char *code = malloc(size + 1);
     if (!code) {
         fprintf(stderr, "[ERROR] Failed to allocate memory for bundle\n");
         fclose(f);
-        return -1;
+        return JS_EXCEPTION;
     }
     
     size_t read = fread(code, 1, size, f);
     fclose(f);
     code[read] = '\0';
     
-    // Properly load ES module in QuickJS:
-    // 1. Compile the module
-    // 2. Set import.meta
-    // 3. Execute the module function
-    // 4. Get module namespace
-    // 5. Extract exports
-    
-    // Step 1: Compile the module
-    JSValue module_func = JS_Eval(ctx, code, size, path, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    JSValue module_func = JS_Eval(ctx, code, read, path, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    free(code);
     if (JS_IsException(module_func)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Failed to compile bundle: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
-        free(code);
-        return -1;
+        log_exception("Failed to compile bundle");
     }
-    
-    // Step 2: Resolve the module (required before execution)
+    return module_func;
+}
+
+// Evaluate a compiled module and take its handler export. Consumes module_func.
+//
+// Properly load ES module in QuickJS:
+// 1. Resolve the module
+// 2. Set import.meta
+// 3. Execute the module function
+// 4. Get module namespace
+// 5. Extract exports
+static int instantiate_bundle(JSValue module_func) {
+    // Step 1: Resolve the module (required before execution)
     if (JS_ResolveModule(ctx, module_func) < 0) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Failed to resolve module: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
+        log_exception("Failed to resolve module");
         JS_FreeValue(ctx, module_func);
-        free(code);
         return -1;
     }
     
-    // Step 3: Set import.meta (required for modules)
+    // Step 2: Set import.meta (required for modules)
     if (js_module_set_import_meta(ctx, module_func, 1, 1) < 0) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Failed to set import.meta: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
+        log_exception("Failed to set import.meta");
         JS_FreeValue(ctx, module_func);
-        free(code);
         return -1;
     }
     
-    // Step 4: Get the module definition (keep a reference to module_func)
+    // Step 3: Get the module definition (keep a reference to module_func)
     JSModuleDef *m = JS_VALUE_GET_PTR(module_func);
     if (!m) {
         fprintf(stderr, "[ERROR] Failed to get module definition\n");
         JS_FreeValue(ctx, module_func);
-        free(code);
         return -1;
     }
     
-    // Step 5: Execute the module function (duplicate to keep reference)
+    // Step 4: Execute the module function (duplicate to keep reference)
     JSValue result = JS_EvalFunction(ctx, JS_DupValue(ctx, module_func));
     if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Failed to execute bundle: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
+        log_exception("Failed to execute bundle");
         JS_FreeValue(ctx, module_func);
-        free(code);
         return -1;
     }
     
-    // Step 6: Await the result if it's a promise (modules can be async)
+    // Await the result if it's a promise (modules can be async)
     // Note: js_std_await always handles promises, even if result is not a promise
     result = js_std_await(ctx, result);
     if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Module execution failed: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
+        log_exception("Module execution failed");
         JS_FreeValue(ctx, module_func);
-        free(code);
         return -1;
     }
     
-    // Step 7: Get the module namespace (m is still valid)
+    // Step 5: Get the module namespace (m is still valid)
     JSValue module_ns = JS_GetModuleNamespace(ctx, m);
     JS_FreeValue(ctx, module_func);
     JS_FreeValue(ctx, result);
     
     if (JS_IsException(module_ns)) {
-        JSValue exception = JS_GetException(ctx);
-        const char *error = JS_ToCString(ctx, exception);
-        fprintf(stderr, "[ERROR] Failed to get module namespace: %s\n", error);
-        JS_FreeCString(ctx, error);
-        JS_FreeValue(ctx, exception);
-        free(code);
+        log_exception("Failed to get module namespace");
         return -1;
     }
     
-    // Step 5: Get default export from module namespace
+    // Get default export from module namespace
     JSValue default_export = JS_GetPropertyStr(ctx, module_ns, "default");
     
     if (JS_IsFunction(ctx, default_export)) {
         handler_func = default_export;
         JS_FreeValue(ctx, module_ns);
-        free(code);
         return 0;
     }
     
@@ -648,7 +1519,6 @@ static int load_bundle(const char *path) {
     if (JS_IsFunction(ctx, handler)) {
         handler_func = handler;
         JS_FreeValue(ctx, module_ns);
-        free(code);
         return 0;
     }
     
@@ -658,10 +1528,28 @@ static int load_bundle(const char *path) {
     }
     JS_FreeValue(ctx, module_ns);
     fprintf(stderr, "[ERROR] No handler function found (expected default export or 'handler')\n");
-    free(code);
     return -1;
 }
 
+// Load JavaScript bundle and extract handler
+static int load_bundle(const char *path) {
+    JSValue module_func = compile_bundle(path);
+    if (JS_IsException(module_func)) {
+        return -1;
+    }
+    return instantiate_bundle(module_func);
+}
+
+// Load a bundle from bytecode written by JS_WriteObject, skipping the parser
+static int load_bundle_bytecode(const uint8_t *buf, size_t len) {
+    JSValue module_func = JS_ReadObject(ctx, buf, len, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(module_func)) {
+        log_exception("Failed to read bundle bytecode");
+        return -1;
+    }
+    return instantiate_bundle(module_func);
+}
+
 // Execute handler function with request
 static int execute_handler(const char *invoke_id, const char *method, const char *path,
                           const char *headers_json, const char *query_json, const char *body_base64) {
@@ -675,13 +1563,9 @@ static int execute_handler(const char *invoke_id, const char *method, const char
         current_invoke_id[sizeof(current_invoke_id) - 1] = '\0';
     }
 
-    // Create Request object with proper URL
-    char request_code[8192];
-    // Build full URL with path (query params will be added via searchParams)
-    char full_url[1024];
-    snprintf(full_url, sizeof(full_url), "%s", path ? path : "/");
-    
-    snprintf(request_code, sizeof(request_code),
+    // Create Request object with proper URL (query params are added via searchParams)
+    buf_t request_code = {0};
+    buf_appendf(&request_code,
              "(function() {"
              "  const urlStr = '%s';"
              "  const url = new URL(urlStr, 'http://localhost');"
@@ -692,14 +1576,21 @@ static int execute_handler(const char *invoke_id, const char *method, const char
              "  const req = new Request(url.toString(), { method: '%s', headers: headers, body: body });"
              "  return req;"
              "})()",
-             full_url,
+             path ? path : "/",
              query_json ? query_json : "{}",
              headers_json ? headers_json : "{}",
              body_base64 ? body_base64 : "",
              body_base64 ? body_base64 : "",
              method ? method : "GET");
+    if (!request_code.data) {
+        send_error(invoke_id, "Failed to allocate request", "REQUEST_CREATION_ERROR");
+        current_invoke_id[0] = '\0';
+        return -1;
+    }
     
-    JSValue request_val = JS_Eval(ctx, request_code, strlen(request_code), "<request>", JS_EVAL_TYPE_GLOBAL);
+    JSValue request_val = JS_Eval(ctx, request_code.data, request_code.len, "<request>", JS_EVAL_TYPE_GLOBAL);
+    buf_free(&request_code);
+    timings.request_built = now_unix_ns();
     if (JS_IsException(request_val)) {
         JSValue exception = JS_GetException(ctx);
         const char *error = JS_ToCString(ctx, exception);
@@ -711,6 +1602,7 @@ static int execute_handler(const char *invoke_id, const char *method, const char
     }
     
     // Call handler (may return a Promise)
+    timings.handler_start = now_unix_ns();
     JSValue result = JS_Call(ctx, handler_func, JS_UNDEFINED, 1, &request_val);
     JS_FreeValue(ctx, request_val);
     
@@ -726,6 +1618,7 @@ static int execute_handler(const char *invoke_id, const char *method, const char
     
     // Await the result if it's a Promise (handler is async)
     result = js_std_await(ctx, result);
+    timings.handler_settled = now_unix_ns();
     if (JS_IsException(result)) {
         JSValue exception = JS_GetException(ctx);
         const char *error = JS_ToCString(ctx, exception);
@@ -783,7 +1676,7 @@ static int execute_handler(const char *invoke_id, const char *method, const char
     // Response.json() creates a Response with body property containing the JSON string
     const char *body_str = "";
     char *body_to_free = NULL;
-    char encoded_body[16384] = "";
+    buf_t encoded_body = {0};
     const char *body_encoded = "";
     
     if (!JS_IsUndefined(body_val) && !JS_IsNull(body_val)) {
@@ -791,37 +1684,16 @@ static int execute_handler(const char *invoke_id, const char *method, const char
             body_str = JS_ToCString(ctx, body_val);
             body_to_free = (char *)body_str;
             
-            // Base64 encode the body string
-            // Simple base64 encoding implementation
-            const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-            size_t len = strlen(body_str);
-            size_t i = 0, j = 0;
-            
-            for (i = 0; i < len && j < sizeof(encoded_body) - 4; i += 3) {
-                uint32_t b = (unsigned char)body_str[i] << 16;
-                if (i + 1 < len) b |= (unsigned char)body_str[i + 1] << 8;
-                if (i + 2 < len) b |= (unsigned char)body_str[i + 2];
-                
-                encoded_body[j++] = base64_chars[(b >> 18) & 0x3F];
-                encoded_body[j++] = base64_chars[(b >> 12) & 0x3F];
-                if (i + 1 < len) {
-                    encoded_body[j++] = base64_chars[(b >> 6) & 0x3F];
-                } else {
-                    encoded_body[j++] = '=';
-                }
-                if (i + 2 < len) {
-                    encoded_body[j++] = base64_chars[b & 0x3F];
-                } else {
-                    encoded_body[j++] = '=';
-                }
+            base64_encode(&encoded_body, (const unsigned char *)body_str, strlen(body_str));
+            if (encoded_body.data) {
+                body_encoded = encoded_body.data;
             }
-            encoded_body[j] = '\0';
-            body_encoded = encoded_body;
         }
     }
     
     // Send response with base64-encoded body
     send_response(invoke_id, status, headers_str, body_encoded);
+    buf_free(&encoded_body);
     
     // Free C strings
     if (headers_to_free) {
@@ -840,7 +1712,463 @@ static int execute_handler(const char *invoke_id, const char *method, const char
     return 0;
 }
 
+// Handle an invoke message: unpack the payload and run the handler
+static void handle_invoke_message(JSValueConst msg_val, const char *invoke_id) {
+    JSValue payload_val = JS_GetPropertyStr(ctx, msg_val, "payload");
+    if (JS_IsUndefined(payload_val)) {
+        send_error(invoke_id, "Missing payload in invoke message", "INVALID_MESSAGE");
+        return;
+    }
+
+    // Only traced invocations report timings
+    JSValue traceparent_val = JS_GetPropertyStr(ctx, payload_val, "traceparent");
+    timings.enabled = JS_IsString(traceparent_val);
+    JS_FreeValue(ctx, traceparent_val);
+
+    // Extract method, path, headers, query, body from payload
+    JSValue method_val = JS_GetPropertyStr(ctx, payload_val, "method");
+    JSValue path_val = JS_GetPropertyStr(ctx, payload_val, "path");
+    JSValue headers_val = JS_GetPropertyStr(ctx, payload_val, "headers");
+    JSValue query_val = JS_GetPropertyStr(ctx, payload_val, "query");
+    JSValue body_val = JS_GetPropertyStr(ctx, payload_val, "body");
+
+    // Convert to C strings
+    const char *method = JS_ToCString(ctx, method_val);
+    const char *path = JS_ToCString(ctx, path_val);
+
+    // Convert headers and query to JSON strings
+    JSValue headers_json_val = JS_JSONStringify(ctx, headers_val, JS_UNDEFINED, JS_UNDEFINED);
+    JSValue query_json_val = JS_JSONStringify(ctx, query_val, JS_UNDEFINED, JS_UNDEFINED);
+    const char *headers_json = JS_ToCString(ctx, headers_json_val);
+    const char *query_json = JS_ToCString(ctx, query_json_val);
+    const char *body_str = JS_ToCString(ctx, body_val);
+
+    // Execute handler
+    execute_handler(invoke_id,
+                   method ? method : "GET",
+                   path ? path : "/",
+                   headers_json ? headers_json : "{}",
+                   query_json ? query_json : "{}",
+                   body_str ? body_str : "");
+
+    // Free C strings
+    if (method) JS_FreeCString(ctx, method);
+    if (path) JS_FreeCString(ctx, path);
+    if (headers_json) JS_FreeCString(ctx, headers_json);
+    if (query_json) JS_FreeCString(ctx, query_json);
+    if (body_str) JS_FreeCString(ctx, body_str);
+
+    // Free JS values
+    JS_FreeValue(ctx, method_val);
+    JS_FreeValue(ctx, path_val);
+    JS_FreeValue(ctx, headers_val);
+    JS_FreeValue(ctx, query_val);
+    JS_FreeValue(ctx, body_val);
+    JS_FreeValue(ctx, headers_json_val);
+    JS_FreeValue(ctx, query_json_val);
+    JS_FreeValue(ctx, payload_val);
+}
+
+/*
+ * Handle a profile message. {"action":"start","hz":N} arms the sampling timer;
+ * {"action":"stop"} disarms it and replies with a "profile" message under the
+ * same id. Profiling must be enabled by the host (ALLOW_PROFILING).
+ */
+static void handle_profile_message(JSValueConst msg_val, const char *id) {
+    if (!profiling_allowed) {
+        send_error(id, "Profiling is not enabled for this worker", "PROFILING_DISABLED");
+        return;
+    }
+
+    JSValue payload_val = JS_GetPropertyStr(ctx, msg_val, "payload");
+    JSValue action_val = JS_GetPropertyStr(ctx, payload_val, "action");
+    JSValue hz_val = JS_GetPropertyStr(ctx, payload_val, "hz");
+    const char *action = JS_ToCString(ctx, action_val);
+    int32_t hz = 0;
+    if (!JS_IsUndefined(hz_val)) {
+        JS_ToInt32(ctx, &hz, hz_val);
+    }
+
+    if (action && strcmp(action, "start") == 0) {
+        if (profile_start(hz) != 0) {
+            send_error(id, strerror(errno), "PROFILING_ERROR");
+        }
+    } else if (action && strcmp(action, "stop") == 0) {
+        profile_stop();
+        send_profile(id);
+    } else {
+        send_error(id, "Unknown profile action", "INVALID_MESSAGE");
+    }
+
+    if (action) JS_FreeCString(ctx, action);
+    JS_FreeValue(ctx, hz_val);
+    JS_FreeValue(ctx, action_val);
+    JS_FreeValue(ctx, payload_val);
+}
+
+static void restrict_globals(void);
+static JSContext *new_context(void);
+static void enqueue_line(char *line, size_t len);
+static void handle_invoke_message(JSValueConst msg_val, const char *invoke_id);
+
+// Read a load payload's capability fields into caps and profiling_allowed
+static void read_load_caps(JSValueConst payload_val) {
+    static const struct { const char *name; int *flag; } flags[] = {
+        {"allow_filesystem", &caps.allow_filesystem},
+        {"allow_network", &caps.allow_network},
+        {"allow_child_process", &caps.allow_child_process},
+        {"allow_eval", &caps.allow_eval},
+        {"allow_profiling", &profiling_allowed},
+    };
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        JSValue v = JS_GetPropertyStr(ctx, payload_val, flags[i].name);
+        *flags[i].flag = JS_ToBool(ctx, v) > 0;
+        JS_FreeValue(ctx, v);
+    }
+    int64_t max_memory = 0;
+    int32_t max_fds = 0;
+    JSValue v = JS_GetPropertyStr(ctx, payload_val, "max_memory");
+    if (!JS_IsUndefined(v)) {
+        JS_ToInt64(ctx, &max_memory, v);
+    }
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, payload_val, "max_fds");
+    if (!JS_IsUndefined(v)) {
+        JS_ToInt32(ctx, &max_fds, v);
+    }
+    JS_FreeValue(ctx, v);
+    caps.max_memory = (long)max_memory;
+    caps.max_fds = max_fds;
+
+    v = JS_GetPropertyStr(ctx, payload_val, "log_level");
+    const char *log_level = JS_IsString(v) ? JS_ToCString(ctx, v) : NULL;
+    caps.log_level = parse_log_level(log_level);
+    if (log_level) JS_FreeCString(ctx, log_level);
+    JS_FreeValue(ctx, v);
+}
+
+/*
+ * Handle a load message in blank mode. The payload carries what a dedicated
+ * worker would get from its environment: bundle_path, the allow_* flags,
+ * max_memory and max_fds. Replies "loaded" under the same id. A worker loads
+ * exactly one bundle; the host terminates it when loading fails.
+ */
+static void handle_load_message(JSValueConst msg_val, const char *id) {
+    if (!blank_mode || !JS_IsUndefined(handler_func)) {
+        send_error(id, "Worker already has a bundle loaded", "ALREADY_LOADED");
+        return;
+    }
+
+    JSValue payload_val = JS_GetPropertyStr(ctx, msg_val, "payload");
+    JSValue path_val = JS_GetPropertyStr(ctx, payload_val, "bundle_path");
+    const char *path = JS_ToCString(ctx, path_val);
+    if (!path || !*path) {
+        send_error(id, "Missing bundle_path in load message", "INVALID_MESSAGE");
+        goto done;
+    }
+
+    read_load_caps(payload_val);
+    enforce_resource_limits();
+    restrict_globals();
+
+    bundle_path = strdup(path);
+    if (!bundle_path || load_bundle(bundle_path) != 0) {
+        send_error(id, "Failed to load bundle", "LOAD_ERROR");
+    } else {
+        send_message("loaded", id, "{}");
+    }
+
+done:
+    if (path) JS_FreeCString(ctx, path);
+    JS_FreeValue(ctx, path_val);
+    JS_FreeValue(ctx, payload_val);
+}
+
+/*
+ * Handle a reload message: load payload.bundle_path into a fresh context and,
+ * once it has compiled and exported a handler, swap it in for the current
+ * one. The worker runs one message at a time, so an invocation in flight has
+ * finished before the swap. Capabilities and rlimits are kept as they are. On
+ * failure the previous bundle stays loaded and serving. Replies "reloaded".
+ */
+static void handle_reload_message(JSValueConst msg_val, const char *id) {
+    if (host_mode || worker_threads > 1 || JS_IsUndefined(handler_func)) {
+        send_error(id, "Reload is not supported by this worker", "RELOAD_UNSUPPORTED");
+        return;
+    }
+
+    JSValue payload_val = JS_GetPropertyStr(ctx, msg_val, "payload");
+    JSValue path_val = JS_GetPropertyStr(ctx, payload_val, "bundle_path");
+    const char *path = JS_ToCString(ctx, path_val);
+    JSContext *old_ctx = ctx;
+    JSValue old_handler = handler_func;
+    if (!path || !*path) {
+        send_error(id, "Missing bundle_path in reload message", "INVALID_MESSAGE");
+        goto done;
+    }
+
+    JSContext *fresh = new_context();
+    if (!fresh) {
+        send_error(id, "Failed to create context", "RELOAD_ERROR");
+        goto done;
+    }
+    ctx = fresh;
+    handler_func = JS_UNDEFINED;
+    restrict_globals();
+    if (load_bundle(path) != 0) {
+        if (!JS_IsUndefined(handler_func)) {
+            JS_FreeValue(fresh, handler_func);
+        }
+        console_forget(fresh);
+        JS_FreeContext(fresh);
+        ctx = old_ctx;
+        handler_func = old_handler;
+        send_error(id, "Failed to load bundle", "RELOAD_ERROR");
+        goto done;
+    }
+
+    // The message values still belong to old_ctx; process_line frees it
+    // after them.
+    JS_FreeValue(old_ctx, old_handler);
+    retired_ctx = old_ctx;
+    send_message("reloaded", id, "{}");
+
+done:
+    if (path) JS_FreeCString(old_ctx, path);
+    JS_FreeValue(old_ctx, path_val);
+    JS_FreeValue(old_ctx, payload_val);
+}
+
+static host_function_t *host_find(const char *function_id) {
+    for (int i = 0; i < host_count; i++) {
+        if (strcmp(host_functions[i].function_id, function_id) == 0) {
+            return &host_functions[i];
+        }
+    }
+    return NULL;
+}
+
+// Make f the current function: the invoke path reads ctx, handler_func,
+// caps and profiling_allowed
+static void host_select(host_function_t *f) {
+    f->last_used = ++host_tick;
+    ctx = f->ctx;
+    handler_func = f->handler;
+    caps = f->caps;
+    profiling_allowed = f->profiling_allowed;
+}
+
+static void host_deselect(void) {
+    ctx = host_ctx;
+    handler_func = JS_UNDEFINED;
+    memset(&caps, 0, sizeof(caps));
+    profiling_allowed = 0;
+}
+
+static void host_unload(host_function_t *f) {
+    fprintf(stderr, "[INFO] Unloading function %s\n", f->function_id);
+    JS_FreeValue(f->ctx, f->handler);
+    console_forget(f->ctx);
+    JS_FreeContext(f->ctx);
+    *f = host_functions[--host_count];
+    JS_RunGC(rt);
+}
+
+// Unload the least recently used function, except keep
+static int host_evict_lru(const host_function_t *keep) {
+    host_function_t *lru = NULL;
+    for (int i = 0; i < host_count; i++) {
+        host_function_t *f = &host_functions[i];
+        if (f != keep && (!lru || f->last_used < lru->last_used)) {
+            lru = f;
+        }
+    }
+    if (!lru) {
+        return -1;
+    }
+    host_unload(lru);
+    return 0;
+}
+
+static size_t host_memory_used(void) {
+    JSMemoryUsage usage;
+    JS_ComputeMemoryUsage(rt, &usage);
+    return (size_t)usage.malloc_size;
+}
+
+static const char *payload_function_id(JSValueConst payload_val, JSValue *id_val) {
+    *id_val = JS_GetPropertyStr(host_ctx, payload_val, "function_id");
+    return JS_IsString(*id_val) ? JS_ToCString(host_ctx, *id_val) : NULL;
+}
+
+/*
+ * Host mode load: compile the function's bundle into a new context. Loading
+ * a function that is already hosted only refreshes its LRU position. Process
+ * rlimits are the host's own; max_memory and max_fds are not applied per
+ * function.
+ */
+static void host_handle_load(JSValueConst msg_val, const char *id) {
+    JSValue payload_val = JS_GetPropertyStr(host_ctx, msg_val, "payload");
+    JSValue fid_val, path_val = JS_UNDEFINED;
+    const char *fid = payload_function_id(payload_val, &fid_val);
+    const char *path = NULL;
+    if (!fid || !*fid || strlen(fid) >= sizeof(host_functions[0].function_id)) {
+        send_error(id, "Missing or invalid function_id in load message", "INVALID_MESSAGE");
+        goto done;
+    }
+    host_function_t *f = host_find(fid);
+    if (f) {
+        f->last_used = ++host_tick;
+        send_message("loaded", id, "{}");
+        goto done;
+    }
+    path_val = JS_GetPropertyStr(host_ctx, payload_val, "bundle_path");
+    path = JS_ToCString(host_ctx, path_val);
+    if (!path || !*path) {
+        send_error(id, "Missing bundle_path in load message", "INVALID_MESSAGE");
+        goto done;
+    }
+
+    while (host_count >= host_max_functions && host_evict_lru(NULL) == 0) {
+    }
+    JSContext *fctx = new_context();
+    if (!fctx) {
+        send_error(id, "Failed to create context", "LOAD_ERROR");
+        goto done;
+    }
+    ctx = fctx;
+    read_load_caps(payload_val);
+    restrict_globals();
+    handler_func = JS_UNDEFINED;
+    if (load_bundle(path) != 0) {
+        if (!JS_IsUndefined(handler_func)) {
+            JS_FreeValue(fctx, handler_func);
+        }
+        console_forget(fctx);
+        JS_FreeContext(fctx);
+        host_deselect();
+        send_error(id, "Failed to load bundle", "LOAD_ERROR");
+        goto done;
+    }
+    f = &host_functions[host_count++];
+    memset(f, 0, sizeof(*f));
+    strcpy(f->function_id, fid);
+    f->ctx = fctx;
+    f->handler = handler_func;
+    f->caps = caps;
+    f->profiling_allowed = profiling_allowed;
+    f->last_used = ++host_tick;
+    host_deselect();
+
+    // Compiled modules are the bulk of a function's memory; shed the coldest
+    while (host_memory_limit > 0 && host_memory_used() > host_memory_limit && host_evict_lru(f) == 0) {
+        f = host_find(fid);
+    }
+    send_message("loaded", id, "{}");
+
+done:
+    if (path) JS_FreeCString(host_ctx, path);
+    JS_FreeValue(host_ctx, path_val);
+    if (fid) JS_FreeCString(host_ctx, fid);
+    JS_FreeValue(host_ctx, fid_val);
+    JS_FreeValue(host_ctx, payload_val);
+}
+
+static void host_handle_unload(JSValueConst msg_val, const char *id) {
+    JSValue payload_val = JS_GetPropertyStr(host_ctx, msg_val, "payload");
+    JSValue fid_val;
+    const char *fid = payload_function_id(payload_val, &fid_val);
+    host_function_t *f = fid ? host_find(fid) : NULL;
+    if (f) {
+        host_unload(f);
+    }
+    send_message("unloaded", id, "{}");
+    if (fid) JS_FreeCString(host_ctx, fid);
+    JS_FreeValue(host_ctx, fid_val);
+    JS_FreeValue(host_ctx, payload_val);
+}
+
+// Route an invoke to the function named in its payload. Unknown functions,
+// including ones evicted since they were loaded, get NOT_LOADED so the host
+// can load them again and retry.
+static void host_handle_invoke(JSValueConst msg_val, const char *id) {
+    JSValue payload_val = JS_GetPropertyStr(host_ctx, msg_val, "payload");
+    JSValue fid_val;
+    const char *fid = payload_function_id(payload_val, &fid_val);
+    host_function_t *f = fid ? host_find(fid) : NULL;
+    if (!f) {
+        send_error(id, "Function is not loaded in this host", "NOT_LOADED");
+    } else {
+        host_select(f);
+        handle_invoke_message(msg_val, id);
+        host_deselect();
+    }
+    if (fid) JS_FreeCString(host_ctx, fid);
+    JS_FreeValue(host_ctx, fid_val);
+    JS_FreeValue(host_ctx, payload_val);
+}
+
 // Parse and process NDJSON messages from stdin
+// Handle one NDJSON message from the control plane
+static void process_line(const char *line, size_t len) {
+    // Parse JSON message using QuickJS JSON parser
+    stats_begin();
+    JSValue msg_val = JS_ParseJSON(ctx, line, len, "<stdin>");
+    memset(&timings, 0, sizeof(timings));
+    timings.parsed = now_unix_ns();
+    if (JS_IsException(msg_val)) {
+        JSValue exception = JS_GetException(ctx);
+        const char *error = JS_ToCString(ctx, exception);
+        fprintf(stderr, "[ERROR] Failed to parse message: %s\n", error);
+        JS_FreeCString(ctx, error);
+        JS_FreeValue(ctx, exception);
+        stats_end();
+        return;
+    }
+    
+    // Extract message type and ID
+    JSValue type_val = JS_GetPropertyStr(ctx, msg_val, "type");
+    const char *type_str = JS_ToCString(ctx, type_val);
+    JSValue id_val = JS_GetPropertyStr(ctx, msg_val, "id");
+    const char *msg_id = JS_ToCString(ctx, id_val);
+    if (type_str && strcmp(type_str, "invoke") == 0) {
+        __atomic_add_fetch(&stats_invocations, 1, __ATOMIC_RELAXED);
+    }
+    
+    if (host_mode && type_str && strcmp(type_str, "invoke") == 0) {
+        host_handle_invoke(msg_val, msg_id ? msg_id : "unknown");
+    } else if (host_mode && type_str && strcmp(type_str, "load") == 0) {
+        host_handle_load(msg_val, msg_id ? msg_id : "unknown");
+    } else if (host_mode && type_str && strcmp(type_str, "unload") == 0) {
+        host_handle_unload(msg_val, msg_id ? msg_id : "unknown");
+    } else if (type_str && strcmp(type_str, "invoke") == 0) {
+        if (JS_IsUndefined(handler_func)) {
+            send_error(msg_id ? msg_id : "unknown", "No bundle loaded", "NOT_LOADED");
+        } else {
+            handle_invoke_message(msg_val, msg_id ? msg_id : "unknown");
+        }
+    } else if (type_str && strcmp(type_str, "load") == 0) {
+        handle_load_message(msg_val, msg_id ? msg_id : "unknown");
+    } else if (type_str && strcmp(type_str, "reload") == 0) {
+        handle_reload_message(msg_val, msg_id ? msg_id : "unknown");
+    } else if (type_str && strcmp(type_str, "profile") == 0) {
+        handle_profile_message(msg_val, msg_id ? msg_id : "unknown");
+    }
+    
+    if (msg_id) JS_FreeCString(ctx, msg_id);
+    JS_FreeValue(ctx, id_val);
+    if (type_str) JS_FreeCString(ctx, type_str);
+    JS_FreeValue(ctx, type_val);
+    JS_FreeValue(ctx, msg_val);
+    if (retired_ctx) {
+        console_forget(retired_ctx);
+        JS_FreeContext(retired_ctx);
+        retired_ctx = NULL;
+        JS_RunGC(rt);
+    }
+    stats_end();
+}
+
 static void process_messages(void) {
     char *line = NULL;
     size_t len = 0;
@@ -857,88 +2185,12 @@ static void process_messages(void) {
             read--;
         }
         
-        // Parse JSON message using QuickJS JSON parser
-        JSValue msg_val = JS_ParseJSON(ctx, line, read, "<stdin>");
-        if (JS_IsException(msg_val)) {
-            JSValue exception = JS_GetException(ctx);
-            const char *error = JS_ToCString(ctx, exception);
-            fprintf(stderr, "[ERROR] Failed to parse message: %s\n", error);
-            JS_FreeCString(ctx, error);
-            JS_FreeValue(ctx, exception);
+        if (worker_threads > 1) {
+            enqueue_line(line, (size_t)read);
+        } else {
+            process_line(line, (size_t)read);
             free(line);
-            line = NULL;
-            len = 0;
-            continue;
         }
-        
-        // Extract message type
-        JSValue type_val = JS_GetPropertyStr(ctx, msg_val, "type");
-        const char *type_str = JS_ToCString(ctx, type_val);
-        
-        if (type_str && strcmp(type_str, "invoke") == 0) {
-            // Extract invoke ID
-            JSValue id_val = JS_GetPropertyStr(ctx, msg_val, "id");
-            const char *invoke_id = JS_ToCString(ctx, id_val);
-            
-            // Extract payload
-            JSValue payload_val = JS_GetPropertyStr(ctx, msg_val, "payload");
-            if (!JS_IsUndefined(payload_val)) {
-                // Extract method, path, headers, query, body from payload
-                JSValue method_val = JS_GetPropertyStr(ctx, payload_val, "method");
-                JSValue path_val = JS_GetPropertyStr(ctx, payload_val, "path");
-                JSValue headers_val = JS_GetPropertyStr(ctx, payload_val, "headers");
-                JSValue query_val = JS_GetPropertyStr(ctx, payload_val, "query");
-                JSValue body_val = JS_GetPropertyStr(ctx, payload_val, "body");
-                
-                // Convert to C strings
-                const char *method = JS_ToCString(ctx, method_val);
-                const char *path = JS_ToCString(ctx, path_val);
-                
-                // Convert headers and query to JSON strings
-                JSValue headers_json_val = JS_JSONStringify(ctx, headers_val, JS_UNDEFINED, JS_UNDEFINED);
-                JSValue query_json_val = JS_JSONStringify(ctx, query_val, JS_UNDEFINED, JS_UNDEFINED);
-                const char *headers_json = JS_ToCString(ctx, headers_json_val);
-                const char *query_json = JS_ToCString(ctx, query_json_val);
-                const char *body_str = JS_ToCString(ctx, body_val);
-                
-                // Execute handler
-                execute_handler(invoke_id ? invoke_id : "unknown",
-                               method ? method : "GET",
-                               path ? path : "/",
-                               headers_json ? headers_json : "{}",
-                               query_json ? query_json : "{}",
-                               body_str ? body_str : "");
-                
-                // Free C strings
-                if (invoke_id) JS_FreeCString(ctx, invoke_id);
-                if (method) JS_FreeCString(ctx, method);
-                if (path) JS_FreeCString(ctx, path);
-                if (headers_json) JS_FreeCString(ctx, headers_json);
-                if (query_json) JS_FreeCString(ctx, query_json);
-                if (body_str) JS_FreeCString(ctx, body_str);
-                
-                // Free JS values
-                JS_FreeValue(ctx, method_val);
-                JS_FreeValue(ctx, path_val);
-                JS_FreeValue(ctx, headers_val);
-                JS_FreeValue(ctx, query_val);
-                JS_FreeValue(ctx, body_val);
-                JS_FreeValue(ctx, headers_json_val);
-                JS_FreeValue(ctx, query_json_val);
-            } else {
-                send_error(invoke_id ? invoke_id : "unknown", "Missing payload in invoke message", "INVALID_MESSAGE");
-            }
-            
-            if (invoke_id) JS_FreeCString(ctx, invoke_id);
-            JS_FreeValue(ctx, id_val);
-            JS_FreeValue(ctx, payload_val);
-        }
-        
-        if (type_str) JS_FreeCString(ctx, type_str);
-        JS_FreeValue(ctx, type_val);
-        JS_FreeValue(ctx, msg_val);
-        
-        free(line);
         line = NULL;
         len = 0;
     }
@@ -948,53 +2200,213 @@ static void process_messages(void) {
     }
 }
 
-int main(int argc, char **argv) {
-    // Get worker ID and bundle path from environment
-    const char *wid = getenv("WORKER_ID");
-    if (wid) {
-        strncpy(worker_id, wid, sizeof(worker_id) - 1);
+static int init_runtime(int argc, char **argv, const JSMallocFunctions *mf);
+
+// Free this thread's handler, context and runtime
+static void free_runtime(void) {
+    if (!JS_IsUndefined(handler_func)) {
+        JS_FreeValue(ctx, handler_func);
+        handler_func = JS_UNDEFINED;
+    }
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+    ctx = NULL;
+    rt = NULL;
+}
+
+static void *worker_thread(void *arg) {
+    (void)arg;
+    // Threads past the last slot share it
+    stats_slot = __atomic_fetch_add(&stats_threads, 1, __ATOMIC_RELAXED);
+    if (stats_slot >= STATS_MAX_THREADS) stats_slot = STATS_MAX_THREADS - 1;
+    int ok = init_runtime(saved_argc, saved_argv, NULL) == 0;
+    if (ok && load_bundle_bytecode(shared_bytecode, shared_bytecode_len) != 0) {
+        free_runtime();
+        ok = 0;
+    }
+
+    pthread_mutex_lock(&queue_mu);
+    if (ok) {
+        threads_ready++;
     } else {
-        snprintf(worker_id, sizeof(worker_id), "worker-%ld", (long)getpid());
+        threads_failed++;
     }
-    
-    bundle_path = getenv("BUNDLE_PATH");
-    if (!bundle_path) {
-        fprintf(stderr, "[ERROR] BUNDLE_PATH environment variable required\n");
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_mu);
+    if (!ok) {
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&queue_mu);
+        while (!queue_head && !queue_closed) {
+            pthread_cond_wait(&queue_cond, &queue_mu);
+        }
+        queued_line_t *q = queue_head;
+        if (q) {
+            queue_head = q->next;
+            if (!queue_head) {
+                queue_tail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&queue_mu);
+        if (!q) {
+            break;  // closed and drained
+        }
+        process_line(q->line, q->len);
+        free(q->line);
+        free(q);
+    }
+    free_runtime();
+    return NULL;
+}
+
+// Queue a message for the worker threads; takes ownership of line
+static void enqueue_line(char *line, size_t len) {
+    queued_line_t *q = malloc(sizeof(*q));
+    if (!q) {
+        fprintf(stderr, "[ERROR] Failed to queue message\n");
+        free(line);
+        return;
+    }
+    q->line = line;
+    q->len = len;
+    q->next = NULL;
+    pthread_mutex_lock(&queue_mu);
+    if (queue_tail) {
+        queue_tail->next = q;
+    } else {
+        queue_head = q;
+    }
+    queue_tail = q;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mu);
+}
+
+static void close_queue(pthread_t *threads, int started) {
+    pthread_mutex_lock(&queue_mu);
+    queue_closed = 1;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_mu);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Threaded mode: compile once, start worker_threads runtimes from the
+// bytecode and feed them from stdin. Profiling is process-wide (SIGPROF) and
+// is not available here.
+static int run_threaded(int argc, char **argv) {
+    profiling_allowed = 0;
+    saved_argc = argc;
+    saved_argv = argv;
+
+    // The bundle is parsed once on a scratch runtime
+    if (init_runtime(argc, argv, NULL) != 0) {
         return 1;
     }
-    
-    // Setup capabilities
-    setup_capabilities();
-    
-    // Enforce resource limits
-    enforce_resource_limits();
-    
-    // Initialize QuickJS runtime
-    rt = JS_NewRuntime();
+    JSValue module_func = compile_bundle(bundle_path);
+    if (!JS_IsException(module_func)) {
+        size_t len = 0;
+        uint8_t *bc = JS_WriteObject(ctx, &len, module_func, JS_WRITE_OBJ_BYTECODE);
+        if (bc) {
+            shared_bytecode = malloc(len);
+            if (shared_bytecode) {
+                memcpy(shared_bytecode, bc, len);
+                shared_bytecode_len = len;
+            }
+            js_free(ctx, bc);
+        }
+        JS_FreeValue(ctx, module_func);
+    }
+    free_runtime();
+    if (!shared_bytecode) {
+        send_error("bundle-load", "Failed to load bundle", "BUNDLE_LOAD_ERROR");
+        return 1;
+    }
+
+    pthread_t *threads = calloc((size_t)worker_threads, sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "[ERROR] Failed to allocate worker threads\n");
+        return 1;
+    }
+    int started = 0;
+    while (started < worker_threads && pthread_create(&threads[started], NULL, worker_thread, NULL) == 0) {
+        started++;
+    }
+    pthread_mutex_lock(&queue_mu);
+    while (threads_ready + threads_failed < started) {
+        pthread_cond_wait(&queue_cond, &queue_mu);
+    }
+    int ready = threads_ready;
+    pthread_mutex_unlock(&queue_mu);
+    if (ready < worker_threads) {
+        close_queue(threads, started);
+        free(threads);
+        send_error("bundle-load", "Failed to start worker threads", "BUNDLE_LOAD_ERROR");
+        return 1;
+    }
+
+    fprintf(stderr, "[INFO] Running %d worker threads from %zu bytes of shared bytecode\n", worker_threads, shared_bytecode_len);
+    send_ready();
+    stats_start();
+    process_messages();
+
+    close_queue(threads, started);
+    free(threads);
+    free(shared_bytecode);
+    return 0;
+}
+
+// Create the runtime and context with polyfills and capability restrictions applied.
+// mf is NULL for the default allocator.
+static int init_runtime(int argc, char **argv, const JSMallocFunctions *mf) {
+    rt = mf ? JS_NewRuntime2(mf, NULL) : JS_NewRuntime();
     if (!rt) {
         fprintf(stderr, "[ERROR] Failed to create QuickJS runtime\n");
-        return 1;
+        return -1;
     }
     
-    ctx = JS_NewContext(rt);
+    // Interrupt handler is polled by the interpreter; used for profiler sampling
+    JS_SetInterruptHandler(rt, interrupt_handler, NULL);
+    js_std_init_handlers(rt);
+    
+    saved_argc = argc;
+    saved_argv = argv;
+    ctx = new_context();
     if (!ctx) {
-        fprintf(stderr, "[ERROR] Failed to create QuickJS context\n");
         JS_FreeRuntime(rt);
-        return 1;
+        return -1;
+    }
+    
+    // Blank and host workers apply the restrictions once the function is known
+    if (!blank_mode && !host_mode) {
+        restrict_globals();
+    }
+    return 0;
+}
+
+// Create a context on rt with the standard library and polyfills
+static JSContext *new_context(void) {
+    JSContext *c = JS_NewContext(rt);
+    if (!c) {
+        fprintf(stderr, "[ERROR] Failed to create QuickJS context\n");
+        return NULL;
     }
     
     // Load standard library
-    js_std_init_handlers(rt);
-    js_std_add_helpers(ctx, argc, argv);
+    js_std_add_helpers(c, saved_argc, saved_argv);
     
     // Add Web API polyfills (URL, Response, Request)
-    add_base64_polyfills(ctx);
-    add_web_apis(ctx);
-    add_console_override(ctx);
-    
-    // Disable eval if not allowed
+    add_base64_polyfills(c);
+    add_web_apis(c);
+    add_console_override(c);
+    return c;
+}
+
+// Remove eval and Function from the global scope unless eval is allowed
+static void restrict_globals(void) {
     if (!caps.allow_eval) {
-        // Remove eval and Function from global scope
         JSValue global = JS_GetGlobalObject(ctx);
         JSAtom eval_atom = JS_NewAtom(ctx, "eval");
         JSAtom function_atom = JS_NewAtom(ctx, "Function");
@@ -1004,9 +2416,382 @@ int main(int argc, char **argv) {
         JS_FreeAtom(ctx, function_atom);
         JS_FreeValue(ctx, global);
     }
+}
+
+// --bench: replay a request corpus through the invoke path without IPC.
+// Every allocation made by the runtime is counted through a wrapping allocator.
+#define BENCH_DEFAULT_ITERATIONS 10000
+#define BENCH_DEFAULT_WARMUP 1000
+#define BENCH_DEFAULT_GC_EVERY 100
+
+static uint64_t bench_allocs = 0;
+static uint64_t bench_alloc_bytes = 0;
+static uint64_t bench_responses = 0;
+static uint64_t bench_errors = 0;
+static uint64_t bench_response_bytes = 0;
+
+static void bench_record_message(const char *type, const char *payload) {
+    if (strcmp(type, "response") == 0) {
+        bench_responses++;
+        bench_response_bytes += strlen(payload);
+    } else if (strcmp(type, "error") == 0) {
+        if (bench_errors++ == 0) {
+            fprintf(stderr, "[WARN] bench: first error: %s\n", payload);
+        }
+    }
+}
+
+static void *bench_js_calloc(void *opaque, size_t count, size_t size) {
+    (void)opaque;
+    bench_allocs++;
+    bench_alloc_bytes += count * size;
+    return calloc(count, size);
+}
+
+static void *bench_js_malloc(void *opaque, size_t size) {
+    (void)opaque;
+    bench_allocs++;
+    bench_alloc_bytes += size;
+    return malloc(size);
+}
+
+static void bench_js_free(void *opaque, void *ptr) {
+    (void)opaque;
+    free(ptr);
+}
+
+static void *bench_js_realloc(void *opaque, void *ptr, size_t size) {
+    (void)opaque;
+    if (size > 0) {
+        bench_allocs++;
+        bench_alloc_bytes += size;
+    }
+    return realloc(ptr, size);
+}
+
+static size_t bench_js_malloc_usable_size(const void *ptr) {
+    return malloc_usable_size((void *)ptr);
+}
+
+static const JSMallocFunctions bench_malloc_funcs = {
+    bench_js_calloc,
+    bench_js_malloc,
+    bench_js_free,
+    bench_js_realloc,
+    bench_js_malloc_usable_size,
+};
+
+static int bench_cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t bench_percentile(const int64_t *sorted, size_t n, double q) {
+    if (n == 0) return 0;
+    return sorted[(size_t)(q * (double)(n - 1))];
+}
+
+// Turn corpus lines into invoke messages. Each line is an invoke payload; "body_text"
+// is base64-encoded into "body" and "body_bytes" synthesizes a JSON body of that size.
+static const char *bench_prepare_source =
+    "(function(line, i) {"
+    "  const p = JSON.parse(line);"
+    "  if (typeof p.body_text === 'string') { p.body = btoa(p.body_text); }"
+    "  if (typeof p.body_bytes === 'number') {"
+    "    const pad = Math.max(0, p.body_bytes - 11);"
+    "    p.body = btoa('{\"data\":\"' + 'x'.repeat(pad) + '\"}');"
+    "  }"
+    "  delete p.body_text;"
+    "  delete p.body_bytes;"
+    "  return JSON.stringify({ id: 'bench-' + i, type: 'invoke', payload: p });"
+    "})";
+
+static char **bench_load_corpus(const char *path, size_t *count) {
+    *count = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[ERROR] Failed to open corpus: %s\n", path);
+        return NULL;
+    }
+    JSValue prepare = JS_Eval(ctx, bench_prepare_source, strlen(bench_prepare_source),
+                              "<bench-corpus>", JS_EVAL_TYPE_GLOBAL);
+    if (JS_IsException(prepare)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        fclose(f);
+        return NULL;
+    }
+    
+    char **lines = NULL;
+    size_t n = 0, cap = 0;
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t read;
+    while ((read = getline(&line, &len, f)) != -1) {
+        while (read > 0 && (line[read - 1] == '\n' || line[read - 1] == '\r')) {
+            line[--read] = '\0';
+        }
+        if (read == 0) continue;
+        
+        JSValue args[2] = { JS_NewStringLen(ctx, line, (size_t)read), JS_NewInt32(ctx, (int32_t)n) };
+        JSValue msg = JS_Call(ctx, prepare, JS_UNDEFINED, 2, args);
+        JS_FreeValue(ctx, args[0]);
+        if (JS_IsException(msg)) {
+            JSValue exception = JS_GetException(ctx);
+            const char *error = JS_ToCString(ctx, exception);
+            fprintf(stderr, "[WARN] bench: skipping corpus line %zu: %s\n", n + 1, error ? error : "?");
+            JS_FreeCString(ctx, error);
+            JS_FreeValue(ctx, exception);
+            continue;
+        }
+        const char *msg_str = JS_ToCString(ctx, msg);
+        if (msg_str) {
+            if (n == cap) {
+                cap = cap ? cap * 2 : 16;
+                char **grown = realloc(lines, cap * sizeof(*lines));
+                if (!grown) {
+                    JS_FreeCString(ctx, msg_str);
+                    JS_FreeValue(ctx, msg);
+                    break;
+                }
+                lines = grown;
+            }
+            lines[n++] = strdup(msg_str);
+            JS_FreeCString(ctx, msg_str);
+        }
+        JS_FreeValue(ctx, msg);
+    }
+    free(line);
+    fclose(f);
+    JS_FreeValue(ctx, prepare);
+    *count = n;
+    return lines;
+}
+
+static int run_bench(int argc, char **argv) {
+    const char *bundle = getenv("BUNDLE_PATH");
+    const char *corpus_path = NULL;
+    const char *name = NULL;
+    long iterations = BENCH_DEFAULT_ITERATIONS;
+    long warmup = BENCH_DEFAULT_WARMUP;
+    long gc_every = BENCH_DEFAULT_GC_EVERY;
+    
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!val) {
+            fprintf(stderr, "[ERROR] bench: %s requires a value\n", arg);
+            return 2;
+        }
+        if (strcmp(arg, "--bundle") == 0) bundle = val;
+        else if (strcmp(arg, "--corpus") == 0) corpus_path = val;
+        else if (strcmp(arg, "--name") == 0) name = val;
+        else if (strcmp(arg, "--iterations") == 0) iterations = atol(val);
+        else if (strcmp(arg, "--warmup") == 0) warmup = atol(val);
+        else if (strcmp(arg, "--gc-every") == 0) gc_every = atol(val);
+        else {
+            fprintf(stderr, "[ERROR] bench: unknown option %s\n", arg);
+            return 2;
+        }
+        i++;
+    }
+    if (!bundle || !corpus_path || iterations <= 0 || warmup < 0 || gc_every < 0) {
+        fprintf(stderr, "usage: quickjs-worker --bench --bundle <file.js> --corpus <file.ndjson>"
+                        " [--name label] [--iterations N] [--warmup N] [--gc-every N]\n");
+        return 2;
+    }
+    if (!name) {
+        const char *slash = strrchr(bundle, '/');
+        name = slash ? slash + 1 : bundle;
+    }
+    
+    bench_mode = 1;
+    snprintf(worker_id, sizeof(worker_id), "bench-%ld", (long)getpid());
+    bundle_path = (char *)bundle;
+    // Capabilities come from the environment as usual; rlimits are not applied
+    setup_capabilities();
+    if (init_runtime(argc, argv, &bench_malloc_funcs) != 0) {
+        return 1;
+    }
+    
+    int rc = 1;
+    size_t nreqs = 0;
+    char **reqs = NULL;
+    int64_t *latencies = NULL;
+    int64_t *gc_pauses = NULL;
+    size_t ngc = 0;
+    
+    if (load_bundle(bundle) != 0) {
+        goto done;
+    }
+    reqs = bench_load_corpus(corpus_path, &nreqs);
+    if (nreqs == 0) {
+        fprintf(stderr, "[ERROR] bench: corpus %s has no usable requests\n", corpus_path);
+        goto done;
+    }
+    latencies = malloc((size_t)iterations * sizeof(*latencies));
+    gc_pauses = malloc(((size_t)(gc_every ? iterations / gc_every : 0) + 1) * sizeof(*gc_pauses));
+    if (!latencies || !gc_pauses) {
+        fprintf(stderr, "[ERROR] bench: out of memory\n");
+        goto done;
+    }
+    
+    for (long i = 0; i < warmup; i++) {
+        const char *req = reqs[(size_t)i % nreqs];
+        process_line(req, strlen(req));
+    }
+    JS_RunGC(rt);
+    
+    JSMemoryUsage before, after;
+    JS_ComputeMemoryUsage(rt, &before);
+    bench_responses = bench_errors = bench_response_bytes = 0;
+    
+    uint64_t allocs = 0, alloc_bytes = 0;
+    int64_t total_ns = 0;
+    for (long i = 0; i < iterations; i++) {
+        const char *req = reqs[(size_t)i % nreqs];
+        size_t req_len = strlen(req);
+        uint64_t a0 = bench_allocs, b0 = bench_alloc_bytes;
+        int64_t t0 = now_mono_ns();
+        process_line(req, req_len);
+        latencies[i] = now_mono_ns() - t0;
+        total_ns += latencies[i];
+        allocs += bench_allocs - a0;
+        alloc_bytes += bench_alloc_bytes - b0;
+        
+        // Cycle collection is timed on its own so it doesn't blur per-invoke latency
+        if (gc_every && (i + 1) % gc_every == 0) {
+            int64_t g0 = now_mono_ns();
+            JS_RunGC(rt);
+            gc_pauses[ngc++] = now_mono_ns() - g0;
+        }
+    }
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &after);
+    
+    qsort(latencies, (size_t)iterations, sizeof(*latencies), bench_cmp_i64);
+    qsort(gc_pauses, ngc, sizeof(*gc_pauses), bench_cmp_i64);
+    int64_t gc_total = 0;
+    for (size_t i = 0; i < ngc; i++) gc_total += gc_pauses[i];
+    
+    buf_t out = {0};
+    buf_append(&out, "{\"name\":\"", 9);
+    buf_append_json_escaped(&out, name, strlen(name));
+    buf_appendf(&out,
+                "\",\"requests\":%zu,\"iterations\":%ld,\"warmup\":%ld,"
+                "\"ns_per_invoke\":%.1f,\"p50_ns\":%lld,\"p99_ns\":%lld,\"max_ns\":%lld,"
+                "\"allocs_per_invoke\":%.2f,\"alloc_bytes_per_invoke\":%.1f,"
+                "\"heap_before_bytes\":%lld,\"heap_after_bytes\":%lld,\"heap_growth_bytes\":%lld,"
+                "\"live_allocs_growth\":%lld,"
+                "\"gc_runs\":%zu,\"gc_pause_total_ns\":%lld,\"gc_pause_p50_ns\":%lld,\"gc_pause_max_ns\":%lld,"
+                "\"responses\":%llu,\"errors\":%llu,\"response_bytes_per_invoke\":%.1f}\n",
+                nreqs, iterations, warmup,
+                (double)total_ns / (double)iterations,
+                (long long)bench_percentile(latencies, (size_t)iterations, 0.50),
+                (long long)bench_percentile(latencies, (size_t)iterations, 0.99),
+                (long long)latencies[iterations - 1],
+                (double)allocs / (double)iterations,
+                (double)alloc_bytes / (double)iterations,
+                (long long)before.malloc_size, (long long)after.malloc_size,
+                (long long)(after.malloc_size - before.malloc_size),
+                (long long)(after.malloc_count - before.malloc_count),
+                ngc, (long long)gc_total,
+                (long long)bench_percentile(gc_pauses, ngc, 0.50),
+                (long long)(ngc ? gc_pauses[ngc - 1] : 0),
+                (unsigned long long)bench_responses, (unsigned long long)bench_errors,
+                (double)bench_response_bytes / (double)iterations);
+    if (out.data) {
+        fputs(out.data, stdout);
+        fflush(stdout);
+    }
+    buf_free(&out);
+    rc = bench_errors ? 3 : 0;
+    
+done:
+    for (size_t i = 0; i < nreqs; i++) free(reqs[i]);
+    free(reqs);
+    free(latencies);
+    free(gc_pauses);
+    if (!JS_IsUndefined(handler_func)) {
+        JS_FreeValue(ctx, handler_func);
+    }
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return run_bench(argc, argv);
+    }
+    
+    // Get worker ID and bundle path from environment
+    const char *wid = getenv("WORKER_ID");
+    if (wid) {
+        strncpy(worker_id, wid, sizeof(worker_id) - 1);
+    } else {
+        snprintf(worker_id, sizeof(worker_id), "worker-%ld", (long)getpid());
+    }
+    
+    blank_mode = getenv("BLANK_WORKER") != NULL;
+    host_mode = getenv("HOST_WORKER") != NULL;
+    if (host_mode) {
+        const char *max_fns = getenv("HOST_MAX_FUNCTIONS");
+        if (max_fns && atoi(max_fns) > 0) {
+            host_max_functions = atoi(max_fns);
+        }
+        const char *mem_mb = getenv("HOST_MEMORY_MB");
+        if (mem_mb && atol(mem_mb) > 0) {
+            host_memory_limit = (size_t)atol(mem_mb) * 1024 * 1024;
+        }
+        host_functions = calloc((size_t)host_max_functions, sizeof(host_function_t));
+        if (!host_functions) {
+            fprintf(stderr, "[ERROR] Failed to allocate host function table\n");
+            return 1;
+        }
+    }
+    bundle_path = getenv("BUNDLE_PATH");
+    if (!bundle_path && !blank_mode && !host_mode) {
+        fprintf(stderr, "[ERROR] BUNDLE_PATH environment variable required\n");
+        return 1;
+    }
+    const char *threads_env = getenv("WORKER_THREADS");
+    if (threads_env && !blank_mode && !host_mode) {
+        worker_threads = atoi(threads_env);
+    }
+
+    // Per-invocation log limits apply in every mode
+    const char *log_lines = getenv("LOG_MAX_LINES");
+    if (log_lines && atol(log_lines) > 0) {
+        log_max_lines = atol(log_lines);
+    }
+    const char *log_bytes = getenv("LOG_MAX_BYTES");
+    if (log_bytes && atol(log_bytes) > 0) {
+        log_max_bytes = atol(log_bytes);
+    }
+    const char *stats_ms = getenv("STATS_INTERVAL_MS");
+    if (stats_ms && atol(stats_ms) > 0) {
+        stats_interval_ms = atol(stats_ms);
+    }
+    
+    // Setup capabilities; blank workers and hosted functions receive theirs
+    // in the load message
+    if (!blank_mode && !host_mode) {
+        setup_capabilities();
+        enforce_resource_limits();
+    }
+    
+    if (worker_threads > 1) {
+        return run_threaded(argc, argv);
+    }
+    
+    // Initialize QuickJS runtime
+    if (init_runtime(argc, argv, NULL) != 0) {
+        return 1;
+    }
+    host_ctx = ctx;
     
     // Load bundle
-    if (load_bundle(bundle_path) != 0) {
+    if (!blank_mode && !host_mode && load_bundle(bundle_path) != 0) {
         send_error("bundle-load", "Failed to load bundle", "BUNDLE_LOAD_ERROR");
         JS_FreeContext(ctx);
         JS_FreeRuntime(rt);
@@ -1015,11 +2800,18 @@ int main(int argc, char **argv) {
     
     // Send ready message
     send_ready();
+    stats_start();
     
     // Process messages from stdin
     process_messages();
     
     // Cleanup
+    profile_stop();
+    profile_reset();
+    while (host_count > 0) {
+        host_unload(&host_functions[host_count - 1]);
+    }
+    free(host_functions);
     if (!JS_IsUndefined(handler_func)) {
         JS_FreeValue(ctx, handler_func);
     }
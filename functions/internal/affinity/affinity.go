@@ -0,0 +1,554 @@
+// Package affinity pins QuickJS worker processes to CPUs, so that hot
+// functions keep their caches warm and the service's own threads do not
+// compete with workers for cores.
+//
+// With a policy set (WorkerConfig.CPUAffinity), the service reads the
+// topology of the CPUs it may run on and reserves the first
+// WorkerConfig.GatewayCores physical cores for itself: the gateway, the pools
+// and the IPC readers. The remaining cores run workers:
+//
+//   - "core": each worker process is pinned to one physical core and its SMT
+//     siblings (a threaded process to one core per thread). The least loaded
+//     core is picked, so pools spread over physical cores before two workers
+//     share one. Among equally loaded cores, one sharing an L2, then an L3,
+//     with the function's other workers wins.
+//   - "cache": each worker process is pinned to the cores of its function's
+//     last-level cache domain and the kernel balances it within. A function
+//     places workers in another domain only while its own is a full worker
+//     per core busier than the least loaded one.
+//
+// Loads are the placer's own bookkeeping of the workers it pinned; the kernel
+// still time-shares a core that has more workers than it has CPUs. When the
+// topology cannot be read or affinity cannot be set (systems other than
+// Linux), the policy is disabled and workers run wherever the kernel puts
+// them.
+package affinity
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+// Policies for WorkerConfig.CPUAffinity; "" and "off" disable placement
+const (
+	PolicyCore  = "core"
+	PolicyCache = "cache"
+)
+
+const sysfsCPU = "/sys/devices/system/cpu"
+
+// ErrUnavailable is returned when CPU affinity cannot be used on this system
+var ErrUnavailable = errors.New("CPU affinity unavailable")
+
+// CPUSet is a sorted list of logical CPU numbers
+type CPUSet []int
+
+// String formats the set as a kernel CPU list, such as "0-3,8"
+func (s CPUSet) String() string {
+	var b strings.Builder
+	for i := 0; i < len(s); {
+		j := i
+		for j+1 < len(s) && s[j+1] == s[j]+1 {
+			j++
+		}
+		if b.Len() > 0 {
+			b.WriteByte(',')
+		}
+		b.WriteString(strconv.Itoa(s[i]))
+		if j > i {
+			b.WriteByte('-')
+			b.WriteString(strconv.Itoa(s[j]))
+		}
+		i = j + 1
+	}
+	return b.String()
+}
+
+// ParseCPUList parses a kernel CPU list, such as "0-3,8"
+func ParseCPUList(list string) (CPUSet, error) {
+	var s CPUSet
+	for _, part := range strings.Split(strings.TrimSpace(list), ",") {
+		if part == "" {
+			continue
+		}
+		lo, hi, isRange := strings.Cut(part, "-")
+		first, err := strconv.Atoi(lo)
+		if err != nil {
+			return nil, fmt.Errorf("invalid CPU list %q", list)
+		}
+		last := first
+		if isRange {
+			if last, err = strconv.Atoi(hi); err != nil || last < first {
+				return nil, fmt.Errorf("invalid CPU list %q", list)
+			}
+		}
+		for cpu := first; cpu <= last; cpu++ {
+			s = append(s, cpu)
+		}
+	}
+	sort.Ints(s)
+	return s, nil
+}
+
+// Core is one physical core
+type Core struct {
+	CPUs CPUSet // its logical CPUs: the SMT siblings the service may use
+	L2   int    // group of cores sharing an L2 cache
+	L3   int    // group of cores sharing the last-level cache, the core's domain
+}
+
+// Topology is the physical cores of a set of CPUs, in CPU order
+type Topology struct {
+	Cores   []Core
+	Domains int // last-level cache domains; Core.L3 is below it
+}
+
+// ReadTopology groups cpus into physical cores and cache domains from the
+// CPU directories under sysfs (normally /sys/devices/system/cpu). CPUs
+// without cache information share their package's domain.
+func ReadTopology(sysfs string, cpus CPUSet) (*Topology, error) {
+	if len(cpus) == 0 {
+		return nil, fmt.Errorf("no CPUs")
+	}
+	allowed := make(map[int]bool, len(cpus))
+	for _, cpu := range cpus {
+		allowed[cpu] = true
+	}
+	t := &Topology{}
+	seen := make(map[string]bool)
+	l2s, l3s := make(map[string]int), make(map[string]int)
+	index := func(ids map[string]int, key string) int {
+		id, ok := ids[key]
+		if !ok {
+			id = len(ids)
+			ids[key] = id
+		}
+		return id
+	}
+	for _, cpu := range cpus {
+		dir := filepath.Join(sysfs, "cpu"+strconv.Itoa(cpu))
+		if _, err := os.Stat(dir); err != nil {
+			return nil, fmt.Errorf("CPU %d: %w", cpu, err)
+		}
+		siblings, err := readCPUList(dir, "topology/thread_siblings_list")
+		if err != nil || len(siblings) == 0 {
+			siblings = CPUSet{cpu}
+		}
+		if seen[siblings.String()] {
+			continue
+		}
+		seen[siblings.String()] = true
+
+		core := Core{}
+		for _, sibling := range siblings {
+			if allowed[sibling] {
+				core.CPUs = append(core.CPUs, sibling)
+			}
+		}
+		l2, l3 := "core "+siblings.String(), ""
+		if pkg, err := os.ReadFile(filepath.Join(dir, "topology/physical_package_id")); err == nil {
+			l3 = "package " + strings.TrimSpace(string(pkg))
+		}
+		caches, _ := filepath.Glob(filepath.Join(dir, "cache", "index*"))
+		top := 0
+		for _, cache := range caches {
+			if kind, _ := os.ReadFile(filepath.Join(cache, "type")); strings.TrimSpace(string(kind)) == "Instruction" {
+				continue
+			}
+			data, err := os.ReadFile(filepath.Join(cache, "level"))
+			if err != nil {
+				continue
+			}
+			level, err := strconv.Atoi(strings.TrimSpace(string(data)))
+			if err != nil {
+				continue
+			}
+			shared, err := readCPUList(cache, "shared_cpu_list")
+			if err != nil {
+				continue
+			}
+			if level == 2 {
+				l2 = "L2 " + shared.String()
+			}
+			if level > top && level >= 2 {
+				top, l3 = level, "LLC "+shared.String()
+			}
+		}
+		core.L2 = index(l2s, l2)
+		core.L3 = index(l3s, l3)
+		t.Cores = append(t.Cores, core)
+	}
+	t.Domains = len(l3s)
+	return t, nil
+}
+
+func readCPUList(dir, name string) (CPUSet, error) {
+	data, err := os.ReadFile(filepath.Join(dir, name))
+	if err != nil {
+		return nil, err
+	}
+	return ParseCPUList(string(data))
+}
+
+// Placer assigns worker processes to the worker cores of one topology. A nil
+// Placer is valid and places nothing.
+type Placer struct {
+	policy  string
+	topo    *Topology
+	gateway CPUSet // the service's own CPUs; nil when none are reserved
+	workers []int  // indexes of the cores workers may use
+
+	// What the service ran with before it was pinned, restored by Close
+	pinned     bool
+	original   CPUSet
+	maxProcs   int
+	log        *logger.Logger
+	closing    sync.Once
+	forgetting func()
+
+	mu          sync.Mutex
+	load        []int // worker threads pinned to each core
+	domainLoad  []int // worker threads pinned to each cache domain
+	domainCores []int // worker cores in each cache domain
+	functions   map[string]*placement
+}
+
+// placement is where a function's workers are
+type placement struct {
+	workers int
+	home    int         // cache policy: the function's domain; -1 until it has one
+	l2, l3  map[int]int // core policy: worker threads per L2 group and domain
+}
+
+// NewPlacer plans placement on topo, reserving its first gatewayCores cores
+// for the service. It pins nothing by itself; see Open.
+func NewPlacer(policy string, topo *Topology, gatewayCores int) (*Placer, error) {
+	if policy != PolicyCore && policy != PolicyCache {
+		return nil, fmt.Errorf("unknown CPU affinity policy %q (want %q or %q)", policy, PolicyCore, PolicyCache)
+	}
+	if gatewayCores < 0 {
+		gatewayCores = 0
+	}
+	if gatewayCores >= len(topo.Cores) {
+		return nil, fmt.Errorf("%w: %d physical cores, %d reserved for the gateway", ErrUnavailable, len(topo.Cores), gatewayCores)
+	}
+	p := &Placer{
+		policy:      policy,
+		topo:        topo,
+		load:        make([]int, len(topo.Cores)),
+		domainLoad:  make([]int, topo.Domains),
+		domainCores: make([]int, topo.Domains),
+		functions:   make(map[string]*placement),
+	}
+	for i, core := range topo.Cores {
+		if i < gatewayCores {
+			p.gateway = append(p.gateway, core.CPUs...)
+			continue
+		}
+		p.workers = append(p.workers, i)
+		p.domainCores[core.L3]++
+	}
+	return p, nil
+}
+
+// Open reads the topology of the CPUs the service may run on, pins the
+// service to its reserved cores and returns a Placer for the rest
+func Open(policy string, gatewayCores int, log *logger.Logger) (*Placer, error) {
+	original, err := getAffinity(0)
+	if err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrUnavailable, err)
+	}
+	topo, err := ReadTopology(sysfsCPU, original)
+	if err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrUnavailable, err)
+	}
+	p, err := NewPlacer(policy, topo, gatewayCores)
+	if err != nil {
+		return nil, err
+	}
+	p.log = log
+	if len(p.gateway) > 0 {
+		if err := SetProcess(os.Getpid(), p.gateway); err != nil {
+			return nil, fmt.Errorf("%w: %v", ErrUnavailable, err)
+		}
+		p.pinned, p.original = true, original
+		// Go sizes its scheduler to the CPUs it saw at startup
+		if os.Getenv("GOMAXPROCS") == "" {
+			p.maxProcs = runtime.GOMAXPROCS(len(p.gateway))
+		}
+	}
+	return p, nil
+}
+
+// nodePlacers holds the node's Placer for each policy and reservation, so
+// the gateway and the pools share one
+var nodePlacers = struct {
+	sync.Mutex
+	byKey  map[string]*Placer
+	failed map[string]bool
+}{byKey: make(map[string]*Placer), failed: make(map[string]bool)}
+
+// ForPolicy returns the node's Placer for policy, or nil when policy is off
+// or cannot be used; the reason is logged once. The first call pins the
+// service to its reserved cores.
+func ForPolicy(policy string, gatewayCores int, log *logger.Logger) *Placer {
+	if policy == "" || policy == "off" {
+		return nil
+	}
+	key := fmt.Sprintf("%s/%d", policy, gatewayCores)
+	nodePlacers.Lock()
+	defer nodePlacers.Unlock()
+	if p := nodePlacers.byKey[key]; p != nil {
+		return p
+	}
+	if nodePlacers.failed[key] {
+		return nil
+	}
+	p, err := Open(policy, gatewayCores, log)
+	if err != nil {
+		nodePlacers.failed[key] = true
+		log.Warn("CPU affinity disabled, workers run on any CPU: %v", err)
+		return nil
+	}
+	p.forgetting = func() {
+		nodePlacers.Lock()
+		if nodePlacers.byKey[key] == p {
+			delete(nodePlacers.byKey, key)
+		}
+		nodePlacers.Unlock()
+	}
+	nodePlacers.byKey[key] = p
+	if len(p.gateway) > 0 {
+		log.Info("Pinned the service to CPUs %s; %s workers on %d cores", p.gateway, policy, len(p.workers))
+	} else {
+		log.Info("Placing %s workers on %d cores", policy, len(p.workers))
+	}
+	return p
+}
+
+// Close gives the service back the CPUs it ran on before Open. Workers
+// already pinned stay where they are.
+func (p *Placer) Close() {
+	if p == nil {
+		return
+	}
+	p.closing.Do(func() {
+		if p.forgetting != nil {
+			p.forgetting()
+		}
+		if !p.pinned {
+			return
+		}
+		if err := SetProcess(os.Getpid(), p.original); err != nil && p.log != nil {
+			p.log.Warn("Failed to restore the service's CPU affinity: %v", err)
+		}
+		if p.maxProcs > 0 {
+			runtime.GOMAXPROCS(p.maxProcs)
+		}
+	})
+}
+
+// GatewayCPUs returns the CPUs reserved for the service
+func (p *Placer) GatewayCPUs() CPUSet {
+	if p == nil {
+		return nil
+	}
+	return p.gateway
+}
+
+// Slot is the CPUs one worker process is pinned to
+type Slot struct {
+	p        *Placer
+	function string
+	cores    []int // core policy
+	domain   int   // cache policy
+	threads  int
+	cpus     CPUSet
+	released bool
+}
+
+// Place pins pid, a worker process of function with threads runtime
+// threads, to the best CPUs for it. function is "" for processes not bound
+// to one function.
+func (p *Placer) Place(function string, threads int, pid int) (*Slot, error) {
+	if p == nil {
+		return nil, ErrUnavailable
+	}
+	s := p.reserve(function, threads)
+	if err := SetProcess(pid, s.cpus); err != nil {
+		s.Release()
+		return nil, err
+	}
+	return s, nil
+}
+
+// Move pins pid again for function, as Place, and releases s
+func (s *Slot) Move(function string, threads int, pid int) (*Slot, error) {
+	if s == nil {
+		return nil, ErrUnavailable
+	}
+	moved, err := s.p.Place(function, threads, pid)
+	if err != nil {
+		return nil, err
+	}
+	s.Release()
+	return moved, nil
+}
+
+// CPUs returns the CPUs of the slot
+func (s *Slot) CPUs() CPUSet {
+	if s == nil {
+		return nil
+	}
+	return s.cpus
+}
+
+// Release returns the slot's CPUs to the placer once the worker is gone
+func (s *Slot) Release() {
+	if s == nil {
+		return
+	}
+	p := s.p
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	if s.released {
+		return
+	}
+	s.released = true
+	fp := p.functions[s.function]
+	if fp != nil {
+		fp.workers--
+	}
+	if p.policy == PolicyCache {
+		p.domainLoad[s.domain] -= s.threads
+	} else {
+		for _, c := range s.cores {
+			core := p.topo.Cores[c]
+			p.load[c]--
+			p.domainLoad[core.L3]--
+			if fp != nil {
+				fp.l2[core.L2]--
+				fp.l3[core.L3]--
+			}
+		}
+	}
+	if fp != nil && fp.workers == 0 {
+		delete(p.functions, s.function)
+	}
+}
+
+// reserve books CPUs for a worker of function without pinning it
+func (p *Placer) reserve(function string, threads int) *Slot {
+	if threads < 1 {
+		threads = 1
+	}
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	fp := p.functions[function]
+	if fp == nil {
+		fp = &placement{home: -1, l2: make(map[int]int), l3: make(map[int]int)}
+		if function != "" {
+			p.functions[function] = fp
+		}
+	}
+	fp.workers++
+	s := &Slot{p: p, function: function, threads: threads}
+	if p.policy == PolicyCache {
+		s.domain = p.pickDomain(fp)
+		p.domainLoad[s.domain] += threads
+		for _, c := range p.workers {
+			if p.topo.Cores[c].L3 == s.domain {
+				s.cpus = append(s.cpus, p.topo.Cores[c].CPUs...)
+			}
+		}
+	} else {
+		for i := 0; i < threads; i++ {
+			c := p.pickCore(fp, s.cores, threads <= len(p.workers))
+			core := p.topo.Cores[c]
+			s.cores = append(s.cores, c)
+			s.cpus = append(s.cpus, core.CPUs...)
+			p.load[c]++
+			p.domainLoad[core.L3]++
+			fp.l2[core.L2]++
+			fp.l3[core.L3]++
+		}
+	}
+	sort.Ints(s.cpus)
+	return s
+}
+
+// pickCore returns the least loaded worker core. Ties go to a core sharing
+// an L2, then a domain, with the function's workers, then to the least
+// loaded domain. With distinct set, cores already in the slot are skipped.
+func (p *Placer) pickCore(fp *placement, taken []int, distinct bool) int {
+	best := -1
+	for _, c := range p.workers {
+		if distinct && containsInt(taken, c) {
+			continue
+		}
+		if best < 0 || p.coreBefore(c, best, fp) {
+			best = c
+		}
+	}
+	return best
+}
+
+func (p *Placer) coreBefore(a, b int, fp *placement) bool {
+	if p.load[a] != p.load[b] {
+		return p.load[a] < p.load[b]
+	}
+	ca, cb := p.topo.Cores[a], p.topo.Cores[b]
+	locality := func(c Core) int {
+		score := 0
+		if fp.l2[c.L2] > 0 {
+			score += 2
+		}
+		if fp.l3[c.L3] > 0 {
+			score++
+		}
+		return score
+	}
+	if la, lb := locality(ca), locality(cb); la != lb {
+		return la > lb
+	}
+	return p.domainLoad[ca.L3]*p.domainCores[cb.L3] < p.domainLoad[cb.L3]*p.domainCores[ca.L3]
+}
+
+// pickDomain returns the function's domain unless it is a worker per core
+// busier than the least loaded one
+func (p *Placer) pickDomain(fp *placement) int {
+	perCore := func(d int) float64 {
+		return float64(p.domainLoad[d]) / float64(p.domainCores[d])
+	}
+	least := -1
+	for d := range p.domainCores {
+		if p.domainCores[d] > 0 && (least < 0 || perCore(d) < perCore(least)) {
+			least = d
+		}
+	}
+	if fp.home < 0 {
+		fp.home = least
+	}
+	if perCore(fp.home) < perCore(least)+1 {
+		return fp.home
+	}
+	return least
+}
+
+func containsInt(s []int, v int) bool {
+	for _, x := range s {
+		if x == v {
+			return true
+		}
+	}
+	return false
+}
@@ -0,0 +1,151 @@
+package affinity
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// fakeSysfs lays out two sockets of four cores with two SMT threads each.
+// CPU n and n+8 are siblings; each core has its own L2 and each socket one L3.
+func fakeSysfs(t *testing.T) string {
+	root := t.TempDir()
+	for cpu := 0; cpu < 16; cpu++ {
+		core, socket := cpu%8, cpu%8/4
+		files := map[string]string{
+			"topology/thread_siblings_list": fmt.Sprintf("%d,%d", core, core+8),
+			"topology/physical_package_id":  fmt.Sprint(socket),
+			"cache/index0/level":            "1",
+			"cache/index0/type":             "Data",
+			"cache/index0/shared_cpu_list":  fmt.Sprintf("%d,%d", core, core+8),
+			"cache/index1/level":            "1",
+			"cache/index1/type":             "Instruction",
+			"cache/index1/shared_cpu_list":  fmt.Sprintf("%d,%d", core, core+8),
+			"cache/index2/level":            "2",
+			"cache/index2/type":             "Unified",
+			"cache/index2/shared_cpu_list":  fmt.Sprintf("%d,%d", core, core+8),
+			"cache/index3/level":            "3",
+			"cache/index3/type":             "Unified",
+			"cache/index3/shared_cpu_list":  fmt.Sprintf("%d-%d,%d-%d", socket*4, socket*4+3, socket*4+8, socket*4+11),
+		}
+		for name, data := range files {
+			path := filepath.Join(root, fmt.Sprintf("cpu%d", cpu), name)
+			if err := os.MkdirAll(filepath.Dir(path), 0o755); err != nil {
+				t.Fatal(err)
+			}
+			if err := os.WriteFile(path, []byte(data+"\n"), 0o644); err != nil {
+				t.Fatal(err)
+			}
+		}
+	}
+	return root
+}
+
+func allCPUs() CPUSet {
+	cpus, _ := ParseCPUList("0-15")
+	return cpus
+}
+
+func TestReadTopology(t *testing.T) {
+	topo, err := ReadTopology(fakeSysfs(t), allCPUs())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(topo.Cores) != 8 || topo.Domains != 2 {
+		t.Fatalf("%d cores in %d domains, want 8 in 2", len(topo.Cores), topo.Domains)
+	}
+	for i, core := range topo.Cores {
+		if core.CPUs.String() != fmt.Sprintf("%d,%d", i, i+8) || core.L2 != i || core.L3 != i/4 {
+			t.Errorf("core %d = %+v", i, core)
+		}
+	}
+	if s := (CPUSet{0, 1, 2, 3, 8, 10, 11}).String(); s != "0-3,8,10-11" {
+		t.Errorf("String() = %q", s)
+	}
+}
+
+func TestCorePlacementSpreadsAndGroups(t *testing.T) {
+	topo, err := ReadTopology(fakeSysfs(t), allCPUs())
+	if err != nil {
+		t.Fatal(err)
+	}
+	p, err := NewPlacer(PolicyCore, topo, 1)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if p.GatewayCPUs().String() != "0,8" {
+		t.Errorf("gateway CPUs %s", p.GatewayCPUs())
+	}
+
+	// Seven worker cores: two functions spread over all of them without
+	// sharing one, each staying in its own domain while it has room
+	domains := map[string]map[int]bool{"a": {}, "b": {}}
+	cores := make(map[int]string)
+	var slots []*Slot
+	for i := 0; i < 3; i++ {
+		for _, fn := range []string{"a", "b"} {
+			s := p.reserve(fn, 1)
+			slots = append(slots, s)
+			c := s.cores[0]
+			if c == 0 {
+				t.Fatalf("%s placed on the gateway core", fn)
+			}
+			if other, ok := cores[c]; ok {
+				t.Fatalf("%s placed on core %d of %s with cores free", fn, c, other)
+			}
+			cores[c] = fn
+			domains[fn][topo.Cores[c].L3] = true
+		}
+	}
+	if len(domains["a"]) != 1 || len(domains["b"]) != 1 {
+		t.Errorf("functions split across domains: %v", domains)
+	}
+
+	// The eighth worker takes the last free core, the ninth shares one
+	s := p.reserve("a", 1)
+	if _, ok := cores[s.cores[0]]; ok {
+		t.Errorf("core %d reused while one was free", s.cores[0])
+	}
+	if s := p.reserve("a", 1); p.load[s.cores[0]] != 2 {
+		t.Errorf("ninth worker on core %d with load %d", s.cores[0], p.load[s.cores[0]])
+	}
+
+	for _, s := range slots {
+		s.Release()
+		s.Release()
+	}
+	if len(p.functions) != 1 || p.functions["b"] != nil {
+		t.Errorf("functions after release: %v", p.functions)
+	}
+}
+
+func TestCachePlacementKeepsFunctionsInDomains(t *testing.T) {
+	topo, err := ReadTopology(fakeSysfs(t), allCPUs())
+	if err != nil {
+		t.Fatal(err)
+	}
+	p, err := NewPlacer(PolicyCache, topo, 0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	a, b := p.reserve("a", 1), p.reserve("b", 1)
+	if a.domain == b.domain {
+		t.Errorf("both functions in domain %d", a.domain)
+	}
+	if a.CPUs().String() != "0-3,8-11" && a.CPUs().String() != "4-7,12-15" {
+		t.Errorf("slot CPUs %s are not one domain", a.CPUs())
+	}
+	// "a" stays home until its domain is a worker per core busier
+	for i := 0; i < 4; i++ {
+		if s := p.reserve("a", 1); s.domain != a.domain {
+			t.Fatalf("worker %d of a left its domain at loads %v", i+2, p.domainLoad)
+		}
+	}
+	if s := p.reserve("a", 1); s.domain != b.domain {
+		t.Errorf("sixth worker of a stayed home at loads %v", p.domainLoad)
+	}
+	if _, err := NewPlacer(PolicyCore, topo, 8); err == nil {
+		t.Error("reserved every core for the gateway")
+	}
+}
@@ -0,0 +1,69 @@
+package affinity
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"strconv"
+	"syscall"
+	"unsafe"
+)
+
+// cpuMask is a cpu_set_t: room for CPUs 0-1023
+type cpuMask [16]uint64
+
+// SetProcess pins every thread of pid to cpus. Threads the process starts
+// later inherit the mask of the thread that starts them.
+func SetProcess(pid int, cpus CPUSet) error {
+	if len(cpus) == 0 {
+		return fmt.Errorf("no CPUs to pin process %d to", pid)
+	}
+	tasks, err := os.ReadDir(fmt.Sprintf("/proc/%d/task", pid))
+	if err != nil {
+		return setAffinity(pid, cpus)
+	}
+	for _, task := range tasks {
+		tid, err := strconv.Atoi(task.Name())
+		if err != nil {
+			continue
+		}
+		// A thread may exit while we walk the list
+		if err := setAffinity(tid, cpus); err != nil && !errors.Is(err, syscall.ESRCH) {
+			return fmt.Errorf("failed to pin thread %d of process %d to CPUs %s: %w", tid, pid, cpus, err)
+		}
+	}
+	return nil
+}
+
+func setAffinity(tid int, cpus CPUSet) error {
+	var mask cpuMask
+	for _, cpu := range cpus {
+		if cpu < 0 || cpu >= len(mask)*64 {
+			return fmt.Errorf("CPU %d out of range", cpu)
+		}
+		mask[cpu/64] |= 1 << (uint(cpu) % 64)
+	}
+	_, _, errno := syscall.RawSyscall(syscall.SYS_SCHED_SETAFFINITY, uintptr(tid), unsafe.Sizeof(mask), uintptr(unsafe.Pointer(&mask)))
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// getAffinity returns the CPUs thread tid may run on; 0 is the calling thread
+func getAffinity(tid int) (CPUSet, error) {
+	var mask cpuMask
+	_, _, errno := syscall.RawSyscall(syscall.SYS_SCHED_GETAFFINITY, uintptr(tid), unsafe.Sizeof(mask), uintptr(unsafe.Pointer(&mask)))
+	if errno != 0 {
+		return nil, errno
+	}
+	var cpus CPUSet
+	for i, word := range mask {
+		for bit := 0; bit < 64; bit++ {
+			if word&(1<<uint(bit)) != 0 {
+				cpus = append(cpus, i*64+bit)
+			}
+		}
+	}
+	return cpus, nil
+}
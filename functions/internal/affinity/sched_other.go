@@ -0,0 +1,12 @@
+//go:build !linux
+
+package affinity
+
+// SetProcess pins every thread of pid to cpus; only Linux supports it
+func SetProcess(pid int, cpus CPUSet) error {
+	return ErrUnavailable
+}
+
+func getAffinity(tid int) (CPUSet, error) {
+	return nil, ErrUnavailable
+}
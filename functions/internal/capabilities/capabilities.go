@@ -21,10 +21,15 @@ type Capabilities struct {
 	// Resource limits
 	MaxMemory          int64         // Maximum memory in bytes (0 = unlimited)
 	MaxCPU             time.Duration // Maximum CPU time (0 = unlimited)
+	CPUQuota           time.Duration // CPU time per second of wall time for each worker: cgroup cpu.max (0 = unlimited)
+	CPUWeight          int           // Share of CPU against other functions under contention, 1-10000: cgroup cpu.weight (0 = default 100)
 	MaxFileDescriptors int           // Maximum open file descriptors (0 = unlimited)
 
 	// Project/tenant identification
 	ProjectID string
+
+	// Minimum console level kept: "debug", "info", "warn" or "error" ("" keeps all)
+	LogLevel string
 }
 
 // CapabilityOption is a function that modifies capabilities
@@ -74,6 +79,20 @@ func WithCPULimit(duration time.Duration) CapabilityOption {
 	}
 }
 
+// WithCPUQuota sets the CPU time each worker may use per second
+func WithCPUQuota(perSecond time.Duration) CapabilityOption {
+	return func(c *Capabilities) {
+		c.CPUQuota = perSecond
+	}
+}
+
+// WithCPUWeight sets the function's share of CPU under contention
+func WithCPUWeight(weight int) CapabilityOption {
+	return func(c *Capabilities) {
+		c.CPUWeight = weight
+	}
+}
+
 // WithFileDescriptorLimit sets the maximum number of open file descriptors
 func WithFileDescriptorLimit(count int) CapabilityOption {
 	return func(c *Capabilities) {
@@ -81,6 +100,13 @@ func WithFileDescriptorLimit(count int) CapabilityOption {
 	}
 }
 
+// WithLogLevel sets the minimum console level kept ("debug", "info", "warn" or "error")
+func WithLogLevel(level string) CapabilityOption {
+	return func(c *Capabilities) {
+		c.LogLevel = level
+	}
+}
+
 // Validate checks if capabilities are valid
 func (c *Capabilities) Validate() error {
 	if c.MaxMemory < 0 {
@@ -89,6 +115,17 @@ func (c *Capabilities) Validate() error {
 	if c.MaxFileDescriptors < 0 {
 		return ErrInvalidFileDescriptorLimit
 	}
+	if c.MaxCPU < 0 || c.CPUQuota < 0 {
+		return ErrInvalidCPULimit
+	}
+	if c.CPUWeight < 0 || c.CPUWeight > 10000 {
+		return ErrInvalidCPUWeight
+	}
+	switch c.LogLevel {
+	case "", "debug", "info", "warn", "error":
+	default:
+		return ErrInvalidLogLevel
+	}
 	return nil
 }
 
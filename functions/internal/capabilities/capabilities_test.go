@@ -140,6 +140,18 @@ func TestValidate(t *testing.T) {
 	if err := caps.Validate(); err != ErrInvalidFileDescriptorLimit {
 		t.Errorf("Expected ErrInvalidFileDescriptorLimit, got %v", err)
 	}
+	
+	caps.MaxFileDescriptors = 0
+	caps.LogLevel = "verbose"
+	if err := caps.Validate(); err != ErrInvalidLogLevel {
+		t.Errorf("Expected ErrInvalidLogLevel, got %v", err)
+	}
+	
+	caps.LogLevel = ""
+	caps.CPUWeight = 20000
+	if err := caps.Validate(); err != ErrInvalidCPUWeight {
+		t.Errorf("Expected ErrInvalidCPUWeight, got %v", err)
+	}
 }
 
 func TestCapabilityOptions(t *testing.T) {
@@ -5,6 +5,9 @@ import "errors"
 var (
 	ErrInvalidMemoryLimit          = errors.New("invalid memory limit")
 	ErrInvalidFileDescriptorLimit  = errors.New("invalid file descriptor limit")
+	ErrInvalidLogLevel             = errors.New("invalid log level")
+	ErrInvalidCPULimit             = errors.New("invalid CPU limit")
+	ErrInvalidCPUWeight            = errors.New("invalid CPU weight")
 	ErrCapabilityNotAllowed        = errors.New("capability not allowed")
 	ErrPathNotAllowed              = errors.New("path not allowed")
 	ErrDomainNotAllowed            = errors.New("domain not allowed")
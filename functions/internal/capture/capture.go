@@ -0,0 +1,260 @@
+// Package capture records gateway invocations to a compact binary file that
+// can later be replayed against a local instance.
+//
+// File layout:
+//
+//	header  = "BBCAP" version(1) 0 0              8 bytes
+//	record  = uvarint(len(payload)) payload
+//	payload = varint   arrival delta (ns since the previous record's arrival; the first is Unix ns)
+//	          string   function id, function name, version, method, path
+//	          uvarint  header count, then string key, string value per header
+//	          uvarint  query count, then string key, string value per parameter
+//	          bytes    body (possibly truncated)
+//	          uvarint  original body size
+//	          uvarint  response status
+//	          uvarint  gateway latency (ns)
+//
+// Strings and bytes are uvarint length followed by the raw bytes. Records are
+// written when the invocation completes, so arrivals can be slightly out of order.
+package capture
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"sort"
+	"time"
+)
+
+const (
+	magic   = "BBCAP"
+	version = 1
+
+	// maxRecordSize bounds a single record when reading, to reject corrupt lengths
+	maxRecordSize = 64 << 20
+)
+
+// ErrBadFormat is returned when a file is not a capture file or is corrupt
+var ErrBadFormat = errors.New("capture: not a capture file or corrupt record")
+
+// Record is one captured invocation
+type Record struct {
+	Arrival      time.Time
+	FunctionID   string
+	FunctionName string
+	Version      string
+	Method       string
+	Path         string
+	Headers      map[string]string
+	Query        map[string]string
+	Body         []byte
+	BodySize     int // size of the original body; larger than len(Body) when truncated
+	Status       int
+	Latency      time.Duration // arrival until the response was written
+}
+
+// Writer encodes records to an io.Writer. It is not safe for concurrent use.
+type Writer struct {
+	w           io.Writer
+	buf         []byte
+	lastArrival int64
+}
+
+// NewWriter writes the file header and returns a Writer
+func NewWriter(w io.Writer) (*Writer, error) {
+	header := append([]byte(magic), version, 0, 0)
+	if _, err := w.Write(header); err != nil {
+		return nil, err
+	}
+	return &Writer{w: w}, nil
+}
+
+// Write appends one record
+func (cw *Writer) Write(rec *Record) error {
+	b := cw.buf[:0]
+	arrival := rec.Arrival.UnixNano()
+	b = binary.AppendVarint(b, arrival-cw.lastArrival)
+	cw.lastArrival = arrival
+	b = appendString(b, rec.FunctionID)
+	b = appendString(b, rec.FunctionName)
+	b = appendString(b, rec.Version)
+	b = appendString(b, rec.Method)
+	b = appendString(b, rec.Path)
+	b = appendMap(b, rec.Headers)
+	b = appendMap(b, rec.Query)
+	b = binary.AppendUvarint(b, uint64(len(rec.Body)))
+	b = append(b, rec.Body...)
+	bodySize := rec.BodySize
+	if bodySize < len(rec.Body) {
+		bodySize = len(rec.Body)
+	}
+	b = binary.AppendUvarint(b, uint64(bodySize))
+	b = binary.AppendUvarint(b, uint64(rec.Status))
+	b = binary.AppendUvarint(b, uint64(rec.Latency))
+	cw.buf = b
+
+	var lenBuf [binary.MaxVarintLen64]byte
+	n := binary.PutUvarint(lenBuf[:], uint64(len(b)))
+	if _, err := cw.w.Write(lenBuf[:n]); err != nil {
+		return err
+	}
+	_, err := cw.w.Write(b)
+	return err
+}
+
+func appendString(b []byte, s string) []byte {
+	b = binary.AppendUvarint(b, uint64(len(s)))
+	return append(b, s...)
+}
+
+// appendMap writes keys in sorted order so identical records encode identically
+func appendMap(b []byte, m map[string]string) []byte {
+	keys := make([]string, 0, len(m))
+	for k := range m {
+		keys = append(keys, k)
+	}
+	sort.Strings(keys)
+	b = binary.AppendUvarint(b, uint64(len(keys)))
+	for _, k := range keys {
+		b = appendString(b, k)
+		b = appendString(b, m[k])
+	}
+	return b
+}
+
+// Reader decodes records written by Writer
+type Reader struct {
+	r           *bufio.Reader
+	buf         []byte
+	lastArrival int64
+}
+
+// NewReader validates the file header and returns a Reader
+func NewReader(r io.Reader) (*Reader, error) {
+	br := bufio.NewReader(r)
+	header := make([]byte, len(magic)+3)
+	if _, err := io.ReadFull(br, header); err != nil {
+		return nil, ErrBadFormat
+	}
+	if string(header[:len(magic)]) != magic {
+		return nil, ErrBadFormat
+	}
+	if header[len(magic)] != version {
+		return nil, fmt.Errorf("capture: unsupported version %d", header[len(magic)])
+	}
+	return &Reader{r: br}, nil
+}
+
+// Next returns the next record, or io.EOF after the last one
+func (cr *Reader) Next() (*Record, error) {
+	size, err := binary.ReadUvarint(cr.r)
+	if err != nil {
+		if err == io.EOF {
+			return nil, io.EOF
+		}
+		return nil, ErrBadFormat
+	}
+	if size > maxRecordSize {
+		return nil, ErrBadFormat
+	}
+	if uint64(cap(cr.buf)) < size {
+		cr.buf = make([]byte, size)
+	}
+	b := cr.buf[:size]
+	if _, err := io.ReadFull(cr.r, b); err != nil {
+		// A partially written final record (e.g. the gateway was killed)
+		if err == io.ErrUnexpectedEOF {
+			return nil, io.EOF
+		}
+		return nil, err
+	}
+
+	d := decoder{b: b}
+	rec := &Record{}
+	cr.lastArrival += d.varint()
+	rec.Arrival = time.Unix(0, cr.lastArrival)
+	rec.FunctionID = d.string()
+	rec.FunctionName = d.string()
+	rec.Version = d.string()
+	rec.Method = d.string()
+	rec.Path = d.string()
+	rec.Headers = d.stringMap()
+	rec.Query = d.stringMap()
+	rec.Body = d.bytes()
+	rec.BodySize = int(d.uvarint())
+	rec.Status = int(d.uvarint())
+	rec.Latency = time.Duration(d.uvarint())
+	if d.err {
+		return nil, ErrBadFormat
+	}
+	return rec, nil
+}
+
+// decoder reads fields from one record payload; any overrun sets err
+type decoder struct {
+	b   []byte
+	err bool
+}
+
+func (d *decoder) uvarint() uint64 {
+	v, n := binary.Uvarint(d.b)
+	if n <= 0 {
+		d.err = true
+		d.b = nil
+		return 0
+	}
+	d.b = d.b[n:]
+	return v
+}
+
+func (d *decoder) varint() int64 {
+	v, n := binary.Varint(d.b)
+	if n <= 0 {
+		d.err = true
+		d.b = nil
+		return 0
+	}
+	d.b = d.b[n:]
+	return v
+}
+
+func (d *decoder) bytes() []byte {
+	n := d.uvarint()
+	if n > uint64(len(d.b)) {
+		d.err = true
+		d.b = nil
+		return nil
+	}
+	out := make([]byte, n)
+	copy(out, d.b[:n])
+	d.b = d.b[n:]
+	return out
+}
+
+func (d *decoder) string() string {
+	n := d.uvarint()
+	if n > uint64(len(d.b)) {
+		d.err = true
+		d.b = nil
+		return ""
+	}
+	s := string(d.b[:n])
+	d.b = d.b[n:]
+	return s
+}
+
+func (d *decoder) stringMap() map[string]string {
+	n := d.uvarint()
+	if n > uint64(len(d.b)) { // every entry takes at least two bytes
+		d.err = true
+		return nil
+	}
+	m := make(map[string]string, n)
+	for i := uint64(0); i < n && !d.err; i++ {
+		k := d.string()
+		m[k] = d.string()
+	}
+	return m
+}
@@ -0,0 +1,119 @@
+package capture
+
+import (
+	"bytes"
+	"io"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+func TestWriterReaderRoundTrip(t *testing.T) {
+	base := time.Unix(1700000000, 123456789)
+	recs := []*Record{
+		{
+			Arrival: base, FunctionID: "fn-1", FunctionName: "hello", Version: "v1",
+			Method: "POST", Path: "/functions/hello",
+			Headers: map[string]string{"Content-Type": "application/json"},
+			Query:   map[string]string{"name": "alice"},
+			Body:    []byte(`{"a":1}`), BodySize: 7, Status: 200, Latency: 3 * time.Millisecond,
+		},
+		// Completed before the first one arrived: arrivals may go backwards
+		{
+			Arrival: base.Add(-time.Millisecond), FunctionID: "fn-2", FunctionName: "other",
+			Method: "GET", Path: "/functions/other",
+			Headers: map[string]string{}, Query: map[string]string{},
+			Body: []byte{}, Status: 500, Latency: time.Second,
+		},
+	}
+
+	var buf bytes.Buffer
+	w, err := NewWriter(&buf)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, rec := range recs {
+		if err := w.Write(rec); err != nil {
+			t.Fatal(err)
+		}
+	}
+	// A torn final record is treated as the end of the file
+	buf.Write([]byte{0x40, 1, 2})
+
+	r, err := NewReader(&buf)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i, want := range recs {
+		got, err := r.Next()
+		if err != nil {
+			t.Fatalf("record %d: %v", i, err)
+		}
+		if !got.Arrival.Equal(want.Arrival) {
+			t.Errorf("record %d arrival = %v, want %v", i, got.Arrival, want.Arrival)
+		}
+		got.Arrival = want.Arrival
+		if !reflect.DeepEqual(got, want) {
+			t.Errorf("record %d = %+v, want %+v", i, got, want)
+		}
+	}
+	if _, err := r.Next(); err != io.EOF {
+		t.Fatalf("after last record: %v, want io.EOF", err)
+	}
+
+	if _, err := NewReader(bytes.NewReader([]byte("not a capture"))); err != ErrBadFormat {
+		t.Fatalf("bad header: %v, want ErrBadFormat", err)
+	}
+}
+
+func TestRecorderRedactsAndTruncates(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "traffic.bbcap")
+	log := logger.New(io.Discard, logger.LevelError, "")
+	rec, err := NewRecorder(path, Options{SampleRate: 1, MaxBodyBytes: 4, RedactHeaders: []string{"x-secret"}}, log)
+	if err != nil {
+		t.Fatal(err)
+	}
+	rec.AddRedactor(RedactQuery("token"))
+	rec.AddRedactor(func(r *Record) bool { return r.Path != "/functions/private" })
+
+	headers := map[string]string{"Authorization": "Bearer abc", "X-Secret": "s", "Accept": "*/*"}
+	rec.Record(&Record{Arrival: time.Now(), Path: "/functions/hello", Headers: headers,
+		Query: map[string]string{"token": "t", "q": "x"}, Body: []byte("0123456789"), Status: 200})
+	rec.Record(&Record{Arrival: time.Now(), Path: "/functions/private", Status: 200})
+	if err := rec.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if len(headers) != 3 {
+		t.Fatalf("caller's header map was modified: %v", headers)
+	}
+
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+	r, err := NewReader(f)
+	if err != nil {
+		t.Fatal(err)
+	}
+	got, err := r.Next()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(got.Headers, map[string]string{"Accept": "*/*"}) {
+		t.Errorf("headers = %v", got.Headers)
+	}
+	if got.Query["token"] != "REDACTED" || got.Query["q"] != "x" {
+		t.Errorf("query = %v", got.Query)
+	}
+	if string(got.Body) != "0123" || got.BodySize != 10 {
+		t.Errorf("body = %q (size %d), want truncated to 4 of 10", got.Body, got.BodySize)
+	}
+	if _, err := r.Next(); err != io.EOF {
+		t.Fatalf("dropped record was written: %v", err)
+	}
+}
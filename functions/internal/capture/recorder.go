@@ -0,0 +1,240 @@
+package capture
+
+import (
+	"bufio"
+	"fmt"
+	"math/rand"
+	"net/http"
+	"os"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+const (
+	recorderQueueSize     = 1024
+	recorderFlushInterval = time.Second
+)
+
+// DefaultRedactedHeaders are always removed from captured requests
+var DefaultRedactedHeaders = []string{
+	"Authorization",
+	"Proxy-Authorization",
+	"Cookie",
+	"X-Bunbase-API-Key",
+}
+
+// Redactor rewrites a record before it is written. It may remove or mask
+// headers, query parameters or the body, and returns false to drop the record.
+type Redactor func(rec *Record) bool
+
+// RedactHeaders returns a Redactor that removes the named headers (case-insensitive)
+func RedactHeaders(names ...string) Redactor {
+	canonical := make(map[string]bool, len(names))
+	for _, n := range names {
+		canonical[http.CanonicalHeaderKey(n)] = true
+	}
+	return func(rec *Record) bool {
+		for k := range rec.Headers {
+			if canonical[http.CanonicalHeaderKey(k)] {
+				delete(rec.Headers, k)
+			}
+		}
+		return true
+	}
+}
+
+// RedactQuery returns a Redactor that replaces the values of the named query parameters
+func RedactQuery(names ...string) Redactor {
+	return func(rec *Record) bool {
+		for _, n := range names {
+			if _, ok := rec.Query[n]; ok {
+				rec.Query[n] = "REDACTED"
+			}
+		}
+		return true
+	}
+}
+
+// Options configures a Recorder
+type Options struct {
+	SampleRate    float64  // fraction of invocations to record (0 < rate <= 1)
+	MaxBodyBytes  int      // bodies are truncated to this size; 0 drops bodies, < 0 keeps them whole
+	RedactHeaders []string // removed in addition to DefaultRedactedHeaders
+}
+
+// Recorder samples invocations and appends them to a capture file from a
+// background goroutine. Recording never blocks an invocation: when the queue
+// is full the record is dropped and counted. A nil *Recorder is a no-op.
+type Recorder struct {
+	opts      Options
+	redactors []Redactor
+	queue     chan *Record
+	file      *os.File
+	buf       *bufio.Writer
+	writer    *Writer
+	dropped   int64
+	done      chan struct{}
+	closed    bool
+	mu        sync.RWMutex // guards redactors and closed
+	logger    *logger.Logger
+}
+
+// NewRecorder creates the capture file at path (truncating it) and starts the writer
+func NewRecorder(path string, opts Options, log *logger.Logger) (*Recorder, error) {
+	if opts.SampleRate <= 0 || opts.SampleRate > 1 {
+		return nil, fmt.Errorf("capture: sample rate must be in (0, 1], got %v", opts.SampleRate)
+	}
+	f, err := os.OpenFile(path, os.O_CREATE|os.O_WRONLY|os.O_TRUNC, 0o600)
+	if err != nil {
+		return nil, fmt.Errorf("capture: %w", err)
+	}
+	buf := bufio.NewWriterSize(f, 64<<10)
+	w, err := NewWriter(buf)
+	if err != nil {
+		f.Close()
+		return nil, fmt.Errorf("capture: %w", err)
+	}
+	r := &Recorder{
+		opts:      opts,
+		redactors: []Redactor{RedactHeaders(append(append([]string{}, DefaultRedactedHeaders...), opts.RedactHeaders...)...)},
+		queue:     make(chan *Record, recorderQueueSize),
+		file:      f,
+		buf:       buf,
+		writer:    w,
+		done:      make(chan struct{}),
+		logger:    log,
+	}
+	go r.run()
+	return r, nil
+}
+
+// AddRedactor registers an additional redaction hook, applied after the built-in ones
+func (r *Recorder) AddRedactor(fn Redactor) {
+	if r == nil {
+		return
+	}
+	r.mu.Lock()
+	r.redactors = append(r.redactors, fn)
+	r.mu.Unlock()
+}
+
+// Sample reports whether the current invocation should be recorded
+func (r *Recorder) Sample() bool {
+	if r == nil {
+		return false
+	}
+	return r.opts.SampleRate >= 1 || rand.Float64() < r.opts.SampleRate
+}
+
+// Record queues rec for writing. Its maps are copied before redaction, but
+// they and the body must not be modified after the call.
+func (r *Recorder) Record(rec *Record) {
+	if r == nil {
+		return
+	}
+	rec.BodySize = len(rec.Body)
+	if r.opts.MaxBodyBytes >= 0 && len(rec.Body) > r.opts.MaxBodyBytes {
+		rec.Body = rec.Body[:r.opts.MaxBodyBytes]
+	}
+	r.mu.RLock()
+	defer r.mu.RUnlock()
+	if r.closed {
+		return
+	}
+	select {
+	case r.queue <- rec:
+	default:
+		atomic.AddInt64(&r.dropped, 1)
+	}
+}
+
+// Dropped returns the number of records lost because the queue was full
+func (r *Recorder) Dropped() int64 {
+	if r == nil {
+		return 0
+	}
+	return atomic.LoadInt64(&r.dropped)
+}
+
+func (r *Recorder) run() {
+	defer close(r.done)
+	ticker := time.NewTicker(recorderFlushInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case rec, ok := <-r.queue:
+			if !ok {
+				if err := r.buf.Flush(); err != nil {
+					r.logger.Warn("Capture flush failed: %v", err)
+				}
+				return
+			}
+			r.write(rec)
+		case <-ticker.C:
+			if err := r.buf.Flush(); err != nil {
+				r.logger.Warn("Capture flush failed: %v", err)
+			}
+		}
+	}
+}
+
+func (r *Recorder) write(rec *Record) {
+	// Copy the maps so redactors can edit them without racing the caller
+	rec.Headers = copyMap(rec.Headers)
+	rec.Query = copyMap(rec.Query)
+	r.mu.RLock()
+	for _, redact := range r.redactors {
+		if !redact(rec) {
+			r.mu.RUnlock()
+			return
+		}
+	}
+	r.mu.RUnlock()
+	if err := r.writer.Write(rec); err != nil {
+		r.logger.Warn("Capture write failed: %v", err)
+	}
+}
+
+func copyMap(m map[string]string) map[string]string {
+	out := make(map[string]string, len(m))
+	for k, v := range m {
+		out[k] = v
+	}
+	return out
+}
+
+// Close flushes queued records and closes the file
+func (r *Recorder) Close() error {
+	if r == nil {
+		return nil
+	}
+	r.mu.Lock()
+	if r.closed {
+		r.mu.Unlock()
+		return nil
+	}
+	r.closed = true
+	close(r.queue)
+	r.mu.Unlock()
+
+	<-r.done
+	if n := r.Dropped(); n > 0 {
+		r.logger.Warn("Capture dropped %d records (queue full)", n)
+	}
+	return r.file.Close()
+}
+
+// ParseHeaderList splits a comma-separated header list, ignoring blanks
+func ParseHeaderList(s string) []string {
+	var out []string
+	for _, h := range strings.Split(s, ",") {
+		if h = strings.TrimSpace(h); h != "" {
+			out = append(out, h)
+		}
+	}
+	return out
+}
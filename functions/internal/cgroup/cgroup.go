@@ -0,0 +1,447 @@
+// Package cgroup places worker processes in cgroup v2 groups, so that CPU
+// and memory limits hold per worker and CPU is shared fairly per function.
+//
+// The service is given a delegated root (WorkerConfig.CgroupRoot), a cgroup
+// v2 directory it may write that holds no processes itself. Under it every
+// function gets a group that carries its cpu.weight, and every worker process
+// gets a leaf group in its function's group with cpu.max, memory.max and
+// memory.high:
+//
+//	<root>/<function>/<worker>
+//
+// Blank workers wait in _blank and move to their function's group once they
+// are bound; host processes run in _hosts with no per-function limits. When
+// the root is not configured, is not a cgroup v2 directory, or cannot enable
+// the cpu and memory controllers, placement is disabled and workers run where
+// the service runs, limited only by their rlimits.
+package cgroup
+
+import (
+	"bufio"
+	"bytes"
+	"errors"
+	"fmt"
+	"math"
+	"os"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+)
+
+const (
+	// cpuPeriod is the cpu.max period; a CPU allowance per second is scaled to it
+	cpuPeriod = 100 * time.Millisecond
+
+	// memoryHighRatio places memory.high below memory.max, so a worker is
+	// throttled and reclaimed before it is OOM-killed
+	memoryHighRatio = 0.9
+
+	pressureInterval = 2 * time.Second
+
+	BlankGroup = "_blank"
+	HostsGroup = "_hosts"
+)
+
+// ErrUnavailable is returned when the root cannot be used for placement
+var ErrUnavailable = errors.New("cgroup v2 delegation unavailable")
+
+// Limits are applied when a worker is placed; zero fields keep the kernel
+// defaults (no quota, weight 100, no memory limit)
+type Limits struct {
+	CPUPerSecond time.Duration // CPU time per second of wall time, across all threads: cpu.max
+	CPUWeight    int           // the function's share against other functions (1-10000): cpu.weight
+	MemoryMax    int64         // bytes: memory.max; memory.high is set to 90% of it
+}
+
+// Pressure is the share of the last 10 seconds, in percent, in which some
+// tasks were stalled waiting for a resource (PSI "some avg10")
+type Pressure struct {
+	CPU    float64
+	Memory float64
+}
+
+// Manager places workers under one delegated root. A nil Manager is valid
+// and places nothing.
+type Manager struct {
+	root   string
+	logger *logger.Logger
+
+	mu        sync.Mutex
+	functions map[string]int // leaf groups per function group, to remove empty ones
+
+	cpuPressure atomic.Uint64 // float64 bits
+	memPressure atomic.Uint64
+	stop        chan struct{}
+	closing     sync.Once
+}
+
+// Open checks that root is a usable cgroup v2 directory, enables the cpu
+// and memory controllers for its children and starts sampling its pressure
+func Open(root string, log *logger.Logger) (*Manager, error) {
+	if root == "" {
+		return nil, ErrUnavailable
+	}
+	controllers, err := os.ReadFile(filepath.Join(root, "cgroup.controllers"))
+	if err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrUnavailable, err)
+	}
+	for _, c := range []string{"cpu", "memory"} {
+		if !hasField(controllers, c) {
+			return nil, fmt.Errorf("%w: controller %s is not delegated to %s", ErrUnavailable, c, root)
+		}
+	}
+	if err := enableControllers(root); err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrUnavailable, err)
+	}
+	m := &Manager{
+		root:      root,
+		logger:    log,
+		functions: make(map[string]int),
+		stop:      make(chan struct{}),
+	}
+	m.samplePressure()
+	go m.pressureLoop()
+	return m, nil
+}
+
+// nodeManagers holds the node's Manager for each root, so every pool and
+// worker shares one
+var nodeManagers = struct {
+	sync.Mutex
+	byRoot map[string]*Manager
+	failed map[string]bool
+}{byRoot: make(map[string]*Manager), failed: make(map[string]bool)}
+
+// ForRoot returns the node's Manager for root, or nil when root is empty or
+// unusable; the reason is logged once
+func ForRoot(root string, log *logger.Logger) *Manager {
+	if root == "" {
+		return nil
+	}
+	nodeManagers.Lock()
+	defer nodeManagers.Unlock()
+	if m := nodeManagers.byRoot[root]; m != nil {
+		return m
+	}
+	if nodeManagers.failed[root] {
+		return nil
+	}
+	m, err := Open(root, log)
+	if err != nil {
+		nodeManagers.failed[root] = true
+		log.Warn("Worker cgroups disabled, running workers with rlimits only: %v", err)
+		return nil
+	}
+	log.Info("Placing workers in cgroups under %s", root)
+	nodeManagers.byRoot[root] = m
+	return m
+}
+
+// Close stops pressure sampling
+func (m *Manager) Close() {
+	if m == nil {
+		return
+	}
+	m.closing.Do(func() { close(m.stop) })
+}
+
+// Place moves pid into a new leaf group for worker under function's group
+// and applies limits
+func (m *Manager) Place(function, worker string, pid int, limits Limits) (*Group, error) {
+	if m == nil {
+		return nil, ErrUnavailable
+	}
+	fnDir := filepath.Join(m.root, functionGroup(function))
+	leaf := filepath.Join(fnDir, "w-"+groupName(worker))
+
+	m.mu.Lock()
+	if m.functions[fnDir] == 0 {
+		if err := os.Mkdir(fnDir, 0o755); err != nil && !os.IsExist(err) {
+			m.mu.Unlock()
+			return nil, fmt.Errorf("failed to create cgroup %s: %w", fnDir, err)
+		}
+		if err := enableControllers(fnDir); err != nil {
+			m.mu.Unlock()
+			return nil, err
+		}
+	}
+	m.functions[fnDir]++
+	m.mu.Unlock()
+
+	g := &Group{m: m, fnDir: fnDir, path: leaf}
+	if err := os.Mkdir(leaf, 0o755); err != nil && !os.IsExist(err) {
+		g.release()
+		return nil, fmt.Errorf("failed to create cgroup %s: %w", leaf, err)
+	}
+	if err := g.apply(limits); err != nil {
+		g.Remove()
+		return nil, err
+	}
+	if err := writeFile(leaf, "cgroup.procs", strconv.Itoa(pid)); err != nil {
+		g.Remove()
+		return nil, err
+	}
+	return g, nil
+}
+
+// Pressure returns the CPU and memory pressure of all workers, sampled every
+// pressureInterval
+func (m *Manager) Pressure() Pressure {
+	if m == nil {
+		return Pressure{}
+	}
+	return Pressure{
+		CPU:    math.Float64frombits(m.cpuPressure.Load()),
+		Memory: math.Float64frombits(m.memPressure.Load()),
+	}
+}
+
+// Pressured reports whether CPU or memory pressure is above threshold
+// percent; it is always false for a nil Manager or a threshold <= 0
+func (m *Manager) Pressured(threshold float64) bool {
+	if m == nil || threshold <= 0 {
+		return false
+	}
+	p := m.Pressure()
+	return p.CPU > threshold || p.Memory > threshold
+}
+
+func (m *Manager) pressureLoop() {
+	ticker := time.NewTicker(pressureInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			m.samplePressure()
+		case <-m.stop:
+			return
+		}
+	}
+}
+
+func (m *Manager) samplePressure() {
+	if cpu, err := readPressure(m.root, "cpu.pressure"); err == nil {
+		m.cpuPressure.Store(math.Float64bits(cpu))
+		prometrics.SetWorkerPressure("cpu", cpu)
+	}
+	if mem, err := readPressure(m.root, "memory.pressure"); err == nil {
+		m.memPressure.Store(math.Float64bits(mem))
+		prometrics.SetWorkerPressure("memory", mem)
+	}
+}
+
+// Group is a worker's leaf group
+type Group struct {
+	m     *Manager
+	fnDir string
+	path  string
+
+	mu      sync.Mutex
+	removed bool
+}
+
+// Usage is what a worker's group has consumed
+type Usage struct {
+	MemoryBytes  int64         // memory.current
+	CPU          time.Duration // cpu.stat usage_usec
+	CPUThrottled time.Duration // cpu.stat throttled_usec
+	OOMKills     int64         // memory.events oom_kill
+	Pressure     Pressure
+}
+
+// Path returns the group's directory
+func (g *Group) Path() string {
+	return g.path
+}
+
+// MemoryBytes returns the memory charged to the group, page cache included
+func (g *Group) MemoryBytes() (int64, error) {
+	data, err := os.ReadFile(filepath.Join(g.path, "memory.current"))
+	if err != nil {
+		return 0, err
+	}
+	return strconv.ParseInt(string(bytes.TrimSpace(data)), 10, 64)
+}
+
+// Usage reads the group's accounting files
+func (g *Group) Usage() (Usage, error) {
+	var u Usage
+	var err error
+	if u.MemoryBytes, err = g.MemoryBytes(); err != nil {
+		return u, err
+	}
+	stat, err := readKeyed(g.path, "cpu.stat")
+	if err != nil {
+		return u, err
+	}
+	u.CPU = time.Duration(stat["usage_usec"]) * time.Microsecond
+	u.CPUThrottled = time.Duration(stat["throttled_usec"]) * time.Microsecond
+	if events, err := readKeyed(g.path, "memory.events"); err == nil {
+		u.OOMKills = events["oom_kill"]
+	}
+	u.Pressure.CPU, _ = readPressure(g.path, "cpu.pressure")
+	u.Pressure.Memory, _ = readPressure(g.path, "memory.pressure")
+	return u, nil
+}
+
+// Move places the group's processes in a new leaf under function's group
+// with new limits and removes the old leaf; a blank worker moves once it is
+// bound to a function
+func (g *Group) Move(function, worker string, pid int, limits Limits) (*Group, error) {
+	moved, err := g.m.Place(function, worker, pid, limits)
+	if err != nil {
+		return nil, err
+	}
+	g.Remove()
+	return moved, nil
+}
+
+// Remove deletes the leaf group, and its function's group once that is
+// empty. The group's processes must have exited.
+func (g *Group) Remove() {
+	if g == nil {
+		return
+	}
+	g.mu.Lock()
+	defer g.mu.Unlock()
+	if g.removed {
+		return
+	}
+	g.removed = true
+	if err := os.Remove(g.path); err != nil && !os.IsNotExist(err) {
+		g.m.logger.Debug("Failed to remove cgroup %s: %v", g.path, err)
+	}
+	g.release()
+}
+
+// release drops the group's count on its function's group
+func (g *Group) release() {
+	m := g.m
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	if m.functions[g.fnDir]--; m.functions[g.fnDir] > 0 {
+		return
+	}
+	delete(m.functions, g.fnDir)
+	if err := os.Remove(g.fnDir); err != nil && !os.IsNotExist(err) {
+		m.logger.Debug("Failed to remove cgroup %s: %v", g.fnDir, err)
+	}
+}
+
+func (g *Group) apply(l Limits) error {
+	if l.CPUPerSecond > 0 {
+		quota := l.CPUPerSecond.Microseconds() * int64(cpuPeriod) / int64(time.Second)
+		if quota < 1000 {
+			quota = 1000 // the kernel minimum, 1ms
+		}
+		if err := writeFile(g.path, "cpu.max", fmt.Sprintf("%d %d", quota, cpuPeriod.Microseconds())); err != nil {
+			return err
+		}
+	}
+	if l.CPUWeight > 0 {
+		if err := writeFile(g.fnDir, "cpu.weight", strconv.Itoa(l.CPUWeight)); err != nil {
+			return err
+		}
+	}
+	if l.MemoryMax > 0 {
+		if err := writeFile(g.path, "memory.max", strconv.FormatInt(l.MemoryMax, 10)); err != nil {
+			return err
+		}
+		high := int64(float64(l.MemoryMax) * memoryHighRatio)
+		if err := writeFile(g.path, "memory.high", strconv.FormatInt(high, 10)); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func enableControllers(dir string) error {
+	return writeFile(dir, "cgroup.subtree_control", "+cpu +memory")
+}
+
+func writeFile(dir, name, value string) error {
+	if err := os.WriteFile(filepath.Join(dir, name), []byte(value), 0o644); err != nil {
+		return fmt.Errorf("failed to write %s to %s/%s: %w", value, dir, name, err)
+	}
+	return nil
+}
+
+// functionGroup names a function's group. BlankGroup and HostsGroup are used
+// as they are. Every other name gets a prefix, so a function cannot name ".",
+// "..", one of those groups, or a cgroupfs interface file.
+func functionGroup(function string) string {
+	if function == BlankGroup || function == HostsGroup {
+		return function
+	}
+	return "fn-" + groupName(function)
+}
+
+// groupName makes s safe as a single path element
+func groupName(s string) string {
+	if s == "" {
+		return "_"
+	}
+	return strings.Map(func(r rune) rune {
+		switch {
+		case r >= 'a' && r <= 'z', r >= 'A' && r <= 'Z', r >= '0' && r <= '9', r == '-', r == '_', r == '.', r == '@':
+			return r
+		}
+		return '_'
+	}, s)
+}
+
+func hasField(data []byte, field string) bool {
+	for _, f := range bytes.Fields(data) {
+		if string(f) == field {
+			return true
+		}
+	}
+	return false
+}
+
+// readPressure returns "some avg10" from a PSI file
+func readPressure(dir, name string) (float64, error) {
+	data, err := os.ReadFile(filepath.Join(dir, name))
+	if err != nil {
+		return 0, err
+	}
+	sc := bufio.NewScanner(bytes.NewReader(data))
+	for sc.Scan() {
+		fields := strings.Fields(sc.Text())
+		if len(fields) == 0 || fields[0] != "some" {
+			continue
+		}
+		for _, f := range fields[1:] {
+			if v, ok := strings.CutPrefix(f, "avg10="); ok {
+				return strconv.ParseFloat(v, 64)
+			}
+		}
+	}
+	return 0, fmt.Errorf("no some avg10 in %s/%s", dir, name)
+}
+
+// readKeyed parses a flat keyed file of "key value" lines
+func readKeyed(dir, name string) (map[string]int64, error) {
+	data, err := os.ReadFile(filepath.Join(dir, name))
+	if err != nil {
+		return nil, err
+	}
+	out := make(map[string]int64)
+	sc := bufio.NewScanner(bytes.NewReader(data))
+	for sc.Scan() {
+		fields := strings.Fields(sc.Text())
+		if len(fields) != 2 {
+			continue
+		}
+		if v, err := strconv.ParseInt(fields[1], 10, 64); err == nil {
+			out[fields[0]] = v
+		}
+	}
+	return out, nil
+}
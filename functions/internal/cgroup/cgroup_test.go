@@ -0,0 +1,136 @@
+package cgroup
+
+import (
+	"errors"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+// fakeRoot makes a directory that looks like a delegated cgroup v2 root with
+// the given controllers. Unlike cgroupfs, new groups get no interface files.
+func fakeRoot(t *testing.T, controllers string) string {
+	root := t.TempDir()
+	files := map[string]string{
+		"cgroup.controllers": controllers,
+		"cpu.pressure":       "some avg10=12.50 avg60=3.00 avg300=1.00 total=100\nfull avg10=1.00 avg60=0.00 avg300=0.00 total=5\n",
+		"memory.pressure":    "some avg10=0.25 avg60=0.00 avg300=0.00 total=7\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+	}
+	for name, data := range files {
+		if err := os.WriteFile(filepath.Join(root, name), []byte(data), 0o644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	return root
+}
+
+func readFile(t *testing.T, path ...string) string {
+	t.Helper()
+	data, err := os.ReadFile(filepath.Join(path...))
+	if err != nil {
+		t.Fatal(err)
+	}
+	return strings.TrimSpace(string(data))
+}
+
+func TestPlaceAppliesLimits(t *testing.T) {
+	root := fakeRoot(t, "cpuset cpu io memory pids")
+	m, err := Open(root, logger.New(io.Discard, logger.LevelError, ""))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer m.Close()
+	if got := readFile(t, root, "cgroup.subtree_control"); got != "+cpu +memory" {
+		t.Errorf("root subtree_control = %q", got)
+	}
+	if p := m.Pressure(); p.CPU != 12.5 || p.Memory != 0.25 {
+		t.Errorf("pressure = %+v", p)
+	}
+	if !m.Pressured(10) || m.Pressured(20) || m.Pressured(0) {
+		t.Error("Pressured does not follow the CPU pressure of 12.5%")
+	}
+
+	g, err := m.Place("fn/1", "w1", 4242, Limits{CPUPerSecond: 500 * time.Millisecond, CPUWeight: 50, MemoryMax: 100 << 20})
+	if err != nil {
+		t.Fatal(err)
+	}
+	fnDir := filepath.Join(root, "fn-fn_1")
+	if g.Path() != filepath.Join(fnDir, "w-w1") {
+		t.Errorf("group path %s", g.Path())
+	}
+	for _, c := range []struct{ dir, file, want string }{
+		{fnDir, "cgroup.subtree_control", "+cpu +memory"},
+		{fnDir, "cpu.weight", "50"},
+		{g.Path(), "cpu.max", "50000 100000"},
+		{g.Path(), "memory.max", "104857600"},
+		{g.Path(), "memory.high", "94371840"},
+		{g.Path(), "cgroup.procs", "4242"},
+	} {
+		if got := readFile(t, c.dir, c.file); got != c.want {
+			t.Errorf("%s = %q, want %q", c.file, got, c.want)
+		}
+	}
+
+	// A blank worker moves to its function's group once bound
+	b, err := m.Place(BlankGroup, "w2", 4343, Limits{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	moved, err := b.Move("fn/1", "w2", 4343, Limits{MemoryMax: 1 << 20})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if got := readFile(t, moved.Path(), "cgroup.procs"); got != "4343" {
+		t.Errorf("moved cgroup.procs = %q", got)
+	}
+	if m.functions[fnDir] != 2 || m.functions[filepath.Join(root, BlankGroup)] != 0 {
+		t.Errorf("group counts after move: %v", m.functions)
+	}
+}
+
+func TestPlaceKeepsFunctionsInsideTheRoot(t *testing.T) {
+	root := fakeRoot(t, "cpu memory")
+	m, err := Open(root, logger.New(io.Discard, logger.LevelError, ""))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer m.Close()
+	for _, name := range []string{".", "..", BlankGroup, HostsGroup, "cgroup.procs", "../x", ""} {
+		g, err := m.Place(name, "..", 4242, Limits{})
+		if err != nil {
+			t.Fatalf("Place(%q): %v", name, err)
+		}
+		fnDir := filepath.Dir(g.Path())
+		if filepath.Dir(fnDir) != root || filepath.Base(g.Path()) != "w-.." {
+			t.Errorf("function %q placed at %s", name, g.Path())
+		}
+		if reserved := name == BlankGroup || name == HostsGroup; reserved != !strings.HasPrefix(filepath.Base(fnDir), "fn-") {
+			t.Errorf("function %q got group %s", name, filepath.Base(fnDir))
+		}
+		if got := readFile(t, g.Path(), "cgroup.procs"); got != "4242" {
+			t.Errorf("function %q: cgroup.procs = %q", name, got)
+		}
+		g.Remove()
+	}
+	if _, err := os.Stat(filepath.Join(root, "cgroup.controllers")); err != nil {
+		t.Errorf("root was removed: %v", err)
+	}
+}
+
+func TestOpenWithoutDelegation(t *testing.T) {
+	if _, err := Open(fakeRoot(t, "cpu pids"), nil); !errors.Is(err, ErrUnavailable) {
+		t.Errorf("root without the memory controller: err %v", err)
+	}
+	if _, err := Open(filepath.Join(t.TempDir(), "missing"), nil); !errors.Is(err, ErrUnavailable) {
+		t.Errorf("missing root: err %v", err)
+	}
+	var m *Manager
+	if _, err := m.Place("fn", "w", 1, Limits{}); !errors.Is(err, ErrUnavailable) || m.Pressured(1) {
+		t.Errorf("nil Manager placed a worker or reported pressure")
+	}
+}
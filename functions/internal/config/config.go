@@ -14,11 +14,15 @@ type Config struct {
 	Gateway    GatewayConfig
 	Metadata   MetadataConfig
 	Logs       LogsConfig
+	Tracing    TracingConfig
+	Capture    CaptureConfig
+	Tenancy    TenancyConfig
 }
 
 type WorkerConfig struct {
 	MaxWorkersPerFunction  int
 	WarmWorkersPerFunction int
+	MaxQueuedPerFunction   int // Invocations that may wait for a busy worker at MaxWorkersPerFunction; <= 0 is unbounded
 	IdleTimeout            time.Duration
 	StartupTimeout         time.Duration
 	ExecutionTimeout       time.Duration
@@ -27,6 +31,29 @@ type WorkerConfig struct {
 	Runtime                string                      // "bun" or "quickjs" or "quickjs-ng"
 	QuickJSPath            string                      // Path to quickjs-worker binary
 	Capabilities           *capabilities.Capabilities  // Security capabilities
+	EnableProfiling        bool                        // Allow on-demand CPU profiling of QuickJS workers
+	Autoscale              bool                        // Pre-warm workers ahead of predicted demand; WarmWorkersPerFunction becomes the floor
+	AutoscaleInterval      time.Duration               // How often arrival-rate estimates are updated
+	ScaleDownDelay         time.Duration               // How long demand must stay lower before the warm set shrinks
+	MaxWorkersPerNode      int                         // Live workers across all functions; 0 is unlimited
+	MaxNodeMemoryMB        int                         // Measured RSS of all workers; 0 is unlimited
+	BorrowWorkers          int                         // Extra workers a function may run beyond MaxWorkersPerFunction while the node budget has room
+	MemorySampleInterval   time.Duration               // How often worker RSS is measured for MaxNodeMemoryMB
+	BlankWorkers           int                         // QuickJS workers kept started without a bundle, shared by all functions for cold starts; 0 disables
+	HostProcesses          int                         // QuickJS host processes that each run many functions in separate contexts; 0 disables
+	FunctionsPerHost       int                         // Functions loaded in one host process before the least recently used is unloaded
+	HostMemoryMB           int                         // Runtime memory of a host process above which its least recently used functions are unloaded; 0 is unlimited
+	HostLimitedFunctions   bool                        // Also host functions whose capabilities set max_memory or max_fds; a host process does not apply them
+	WorkerThreads          int                         // QuickJS threads per worker process, each its own runtime and pool slot; <= 1 is one process per worker
+	MaxLogLinesPerInvocation int                       // QuickJS console lines kept per invocation; later lines are dropped and counted
+	MaxLogBytesPerInvocation int                       // QuickJS console bytes kept per invocation
+	CgroupRoot             string                      // Delegated cgroup v2 directory QuickJS workers are placed under; "" disables
+	PrewarmMaxPressure     float64                     // Worker CPU or memory pressure (PSI some avg10, percent) above which pre-warming pauses; 0 never pauses
+	CPUAffinity            string                      // QuickJS worker CPU placement: "core", "cache", or "" (off)
+	GatewayCores           int                         // Physical cores reserved for the service's own threads when CPUAffinity is set
+	StatsInterval          time.Duration               // QuickJS worker heartbeat period; 0 disables heartbeats and recycling
+	RecycleMemoryRatio     float64                     // Recycle a worker whose RSS or JS heap passes this fraction of its memory limit; 0 never
+	RecycleLag             time.Duration               // Recycle a worker that has been handling one message for longer; 0 uses ExecutionTimeout
 }
 
 type GatewayConfig struct {
@@ -43,6 +70,39 @@ type LogsConfig struct {
 	JSONLPath string
 	Retention time.Duration
 	LokiURL   string // Loki HTTP API base URL (e.g. http://loki:3100). If set, logstore uses Loki.
+	// Log shipping to Loki; zero values use the logstore defaults
+	ShipQueueSize  int           // Log lines buffered per node before lines are sampled and dropped
+	ShipBatchBytes int           // Message bytes that trigger a push
+	ShipBatchWait  time.Duration // Longest a line waits before it is pushed
+}
+
+type TracingConfig struct {
+	OTLPEndpoint string // OTLP/HTTP collector base URL (e.g. http://localhost:4318). Takes precedence over FilePath.
+	FilePath     string // Append OTLP/JSON span batches to this file instead of a collector
+}
+
+type CaptureConfig struct {
+	FilePath      string   // Record sampled invocations to this file (binary capture format); empty disables capture
+	SampleRate    float64  // Fraction of invocations recorded
+	MaxBodyBytes  int      // Request bodies are truncated to this size; -1 keeps them whole
+	RedactHeaders []string // Removed in addition to Authorization, Proxy-Authorization, Cookie and X-Bunbase-API-Key
+}
+
+// TenancyConfig shares the node's invocation slots fairly between projects
+// (InvokeRequest.ProjectID; requests without one belong to "default").
+// Fair queuing is off while MaxConcurrent and every project cap are 0.
+type TenancyConfig struct {
+	MaxConcurrent        int                     // Node-wide concurrent invocations divided by share under contention; 0 is unlimited
+	DefaultShare         float64                 // Weight of projects without an entry in Projects
+	DefaultBurst         int                     // Invocations an idle project may run ahead of its share when it becomes busy
+	DefaultMaxConcurrent int                     // Cap on a project's concurrent invocations across all its functions; 0 is uncapped
+	Projects             map[string]ProjectQuota // Per-project overrides, keyed by project ID
+}
+
+type ProjectQuota struct {
+	Share         float64
+	Burst         int
+	MaxConcurrent int
 }
 
 func DefaultConfig() *Config {
@@ -52,6 +112,7 @@ func DefaultConfig() *Config {
 		Worker: WorkerConfig{
 			MaxWorkersPerFunction:  10,
 			WarmWorkersPerFunction: 2,
+			MaxQueuedPerFunction:   1000,
 			IdleTimeout:            5 * time.Minute,
 			StartupTimeout:          10 * time.Second,
 			ExecutionTimeout:        30 * time.Second,
@@ -60,6 +121,19 @@ func DefaultConfig() *Config {
 			Runtime:                 "bun", // Default to bun for backward compatibility
 			QuickJSPath:             "./cmd/quickjs-worker/quickjs-worker",
 			Capabilities:             nil,  // Will be set per-function
+			Autoscale:              true,
+			AutoscaleInterval:      time.Second,
+			ScaleDownDelay:         time.Minute,
+			BorrowWorkers:          5,
+			MemorySampleInterval:   10 * time.Second,
+			BlankWorkers:           2,
+			FunctionsPerHost:       64,
+			MaxLogLinesPerInvocation: 1000,
+			MaxLogBytesPerInvocation: 1 << 20,
+			PrewarmMaxPressure:     40,
+			GatewayCores:           1,
+			StatsInterval:          time.Second,
+			RecycleMemoryRatio:     0.9,
 		},
 		Gateway: GatewayConfig{
 			HTTPPort:   8080,
@@ -73,6 +147,17 @@ func DefaultConfig() *Config {
 			JSONLPath: "./data/logs",
 			Retention: 30 * 24 * time.Hour, // 30 days
 			LokiURL:   "http://localhost:3100",
+			ShipQueueSize:  65536,
+			ShipBatchBytes: 1 << 20,
+			ShipBatchWait:  time.Second,
+		},
+		Capture: CaptureConfig{
+			SampleRate:   0.01,
+			MaxBodyBytes: 64 * 1024,
+		},
+		Tenancy: TenancyConfig{
+			DefaultShare: 1,
+			DefaultBurst: 10,
 		},
 	}
 }
@@ -3,15 +3,20 @@ package gateway
 import (
 	"context"
 	"encoding/json"
+	"errors"
 	"fmt"
 	"io"
+	"math"
 	"net/http"
 	"os"
+	"strconv"
 	"strings"
 	"time"
 
 	"github.com/google/uuid"
+	"github.com/kartikbazzad/bunbase/functions/internal/affinity"
 	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
+	"github.com/kartikbazzad/bunbase/functions/internal/capture"
 	"github.com/kartikbazzad/bunbase/functions/internal/config"
 	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
@@ -20,6 +25,8 @@ import (
 	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
 	"github.com/kartikbazzad/bunbase/functions/internal/router"
 	"github.com/kartikbazzad/bunbase/functions/internal/scheduler"
+	"github.com/kartikbazzad/bunbase/functions/internal/tracing"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
 )
 
 // Gateway provides HTTP endpoints for function invocations and management
@@ -33,6 +40,9 @@ type Gateway struct {
 	initScript   string
 	server       *http.Server
 	logStore     logstore.Store
+	tracer       *tracing.Tracer   // nil when tracing is disabled
+	capture      *capture.Recorder // nil when traffic capture is disabled
+	placer       *affinity.Placer  // nil unless workers are pinned to CPUs
 }
 
 // NewGateway creates a new HTTP gateway
@@ -46,17 +56,39 @@ func NewGateway(r *router.Router, s *scheduler.Scheduler, meta *metadata.Store,
 		initScript:   initScript,
 		logger:       log,
 	}
-	lokiURL := ""
-	if cfg != nil && cfg.Logs.LokiURL != "" {
-		lokiURL = cfg.Logs.LokiURL
+	var logsCfg *config.LogsConfig
+	if cfg != nil {
+		logsCfg = &cfg.Logs
 	}
-	if lokiURL == "" {
-		lokiURL = os.Getenv("LOKI_URL")
+	g.logStore = logstore.NewNodeStore(logsCfg, log)
+	if cfg != nil {
+		// Pins the service to its reserved cores before any worker starts
+		g.placer = affinity.ForPolicy(cfg.Worker.CPUAffinity, cfg.Worker.GatewayCores, log)
 	}
-	if lokiURL != "" {
-		g.logStore = logstore.NewLokiStore(lokiURL)
-	} else {
-		g.logStore = &logstore.NoopStore{}
+	otlpEndpoint, traceFile := "", ""
+	if cfg != nil {
+		otlpEndpoint, traceFile = cfg.Tracing.OTLPEndpoint, cfg.Tracing.FilePath
+	}
+	if otlpEndpoint == "" {
+		otlpEndpoint = os.Getenv("OTEL_EXPORTER_OTLP_ENDPOINT")
+	}
+	tracer, err := tracing.NewTracerFromConfig(otlpEndpoint, traceFile, log)
+	if err != nil {
+		log.Warn("Tracing disabled: %v", err)
+	}
+	g.tracer = tracer
+	if cfg != nil && cfg.Capture.FilePath != "" {
+		rec, err := capture.NewRecorder(cfg.Capture.FilePath, capture.Options{
+			SampleRate:    cfg.Capture.SampleRate,
+			MaxBodyBytes:  cfg.Capture.MaxBodyBytes,
+			RedactHeaders: cfg.Capture.RedactHeaders,
+		}, log)
+		if err != nil {
+			log.Warn("Traffic capture disabled: %v", err)
+		} else {
+			g.capture = rec
+			log.Info("Capturing %.2f%% of invocations to %s", cfg.Capture.SampleRate*100, cfg.Capture.FilePath)
+		}
 	}
 
 	mux := http.NewServeMux()
@@ -74,6 +106,12 @@ func NewGateway(r *router.Router, s *scheduler.Scheduler, meta *metadata.Store,
 	return g
 }
 
+// AddCaptureRedactor registers a hook that scrubs captured invocations before
+// they are written. It is a no-op when capture is disabled.
+func (g *Gateway) AddCaptureRedactor(fn capture.Redactor) {
+	g.capture.AddRedactor(fn)
+}
+
 // Start starts the HTTP server
 func (g *Gateway) Start() error {
 	g.logger.Info("Starting HTTP gateway on %s", g.server.Addr)
@@ -82,6 +120,13 @@ func (g *Gateway) Start() error {
 
 // Stop stops the HTTP server
 func (g *Gateway) Stop() error {
+	defer g.tracer.Close()
+	defer g.capture.Close()
+	defer g.placer.Close()
+	if c, ok := g.logStore.(io.Closer); ok {
+		defer c.Close()
+	}
+
 	if g.server == nil {
 		return nil
 	}
@@ -156,7 +201,122 @@ func (g *Gateway) handleLogs(w http.ResponseWriter, r *http.Request, functionNam
 	json.NewEncoder(w).Encode(entries)
 }
 
-// handleFunctions routes /functions/... to either logs or invoke
+// handleProfile handles GET /functions/:id/profile?seconds=N&hz=H.
+// It samples every worker of the function for N seconds and returns the
+// merged profile in folded-stack format.
+func (g *Gateway) handleProfile(w http.ResponseWriter, r *http.Request, functionNameOrID string) {
+	if r.Method != http.MethodGet {
+		http.Error(w, "Method not allowed", http.StatusMethodNotAllowed)
+		return
+	}
+	if g.cfg == nil || !g.cfg.Worker.EnableProfiling {
+		http.Error(w, "Profiling is disabled", http.StatusForbidden)
+		return
+	}
+	fn, p, err := g.router.Route(functionNameOrID)
+	if err != nil {
+		if err == router.ErrFunctionNotFound {
+			http.Error(w, "Function not found", http.StatusNotFound)
+			return
+		}
+		http.Error(w, fmt.Sprintf("Routing error: %v", err), http.StatusInternalServerError)
+		return
+	}
+	if p == nil {
+		http.Error(w, "Function has no running workers", http.StatusConflict)
+		return
+	}
+
+	seconds := 10
+	if s := r.URL.Query().Get("seconds"); s != "" {
+		if n, err := strconv.Atoi(s); err == nil && n > 0 {
+			seconds = n
+		}
+	}
+	if seconds > 60 {
+		seconds = 60
+	}
+	hz := 0 // worker default
+	if s := r.URL.Query().Get("hz"); s != "" {
+		if n, err := strconv.Atoi(s); err == nil && n > 0 {
+			hz = n
+		}
+	}
+
+	g.logger.Info("Collecting %ds profile for function %s", seconds, fn.ID)
+	result, err := p.Profile(r.Context(), time.Duration(seconds)*time.Second, hz)
+	if err != nil {
+		switch err {
+		case pool.ErrNoWorkers:
+			http.Error(w, "Function has no running workers", http.StatusConflict)
+		case pool.ErrNotProfilable:
+			http.Error(w, "Profiling is only supported for the quickjs runtime", http.StatusBadRequest)
+		default:
+			http.Error(w, fmt.Sprintf("Failed to collect profile: %v", err), http.StatusInternalServerError)
+		}
+		return
+	}
+
+	w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+	w.Header().Set("X-Profile-Workers", strconv.Itoa(result.Workers))
+	w.Header().Set("X-Profile-Samples", strconv.FormatInt(result.Samples, 10))
+	w.Header().Set("X-Profile-Dropped", strconv.FormatInt(result.Dropped, 10))
+	w.Write([]byte(result.Folded()))
+}
+
+// functionStats is the body of GET /functions/:id/stats
+type functionStats struct {
+	FunctionID   string `json:"function_id"`
+	Version      string `json:"version,omitempty"`
+	WarmWorkers  int    `json:"warm_workers"`
+	BusyWorkers  int    `json:"busy_workers"`
+	TotalWorkers int    `json:"total_workers"`
+	MaxWorkers   int    `json:"max_workers"`
+	QueueDepth   int    `json:"queue_depth"`
+
+	ServiceTimeMS   float64 `json:"service_time_ms"`
+	SpawningWorkers int     `json:"spawning_workers"`
+	TargetWorkers   int     `json:"target_workers"`
+	ArrivalRate     float64 `json:"arrival_rate"`
+	RSSBytes        int64   `json:"rss_bytes"`
+}
+
+// handleStats handles GET /functions/:id/stats: the current pool and queue state,
+// cheap enough to poll while load testing
+func (g *Gateway) handleStats(w http.ResponseWriter, r *http.Request, functionNameOrID string) {
+	if r.Method != http.MethodGet {
+		http.Error(w, "Method not allowed", http.StatusMethodNotAllowed)
+		return
+	}
+	fn, p, err := g.router.Route(functionNameOrID)
+	if err != nil {
+		if err == router.ErrFunctionNotFound {
+			http.Error(w, "Function not found", http.StatusNotFound)
+			return
+		}
+		http.Error(w, fmt.Sprintf("Routing error: %v", err), http.StatusInternalServerError)
+		return
+	}
+	stats := functionStats{FunctionID: fn.ID}
+	if p != nil {
+		ps := p.GetStats()
+		stats.Version = ps.Version
+		stats.WarmWorkers = ps.WarmWorkers
+		stats.BusyWorkers = ps.BusyWorkers
+		stats.TotalWorkers = ps.TotalWorkers
+		stats.MaxWorkers = ps.MaxWorkers
+		stats.ServiceTimeMS = float64(ps.ServiceTime) / float64(time.Millisecond)
+		stats.SpawningWorkers = ps.SpawningWorkers
+		stats.TargetWorkers = ps.TargetWorkers
+		stats.ArrivalRate = ps.ArrivalRate
+		stats.RSSBytes = ps.RSSBytes
+	}
+	stats.QueueDepth = g.scheduler.QueueDepth(fn.ID)
+	w.Header().Set("Content-Type", "application/json")
+	json.NewEncoder(w).Encode(stats)
+}
+
+// handleFunctions routes /functions/... to logs, profile, stats or invoke
 func (g *Gateway) handleFunctions(w http.ResponseWriter, r *http.Request) {
 	path := r.URL.Path
 	if len(path) < 11 {
@@ -175,11 +335,35 @@ func (g *Gateway) handleFunctions(w http.ResponseWriter, r *http.Request) {
 		g.handleLogs(w, r, funcPart)
 		return
 	}
+	if strings.HasSuffix(suffix, "/profile") {
+		// GET /functions/:id/profile
+		funcPart := strings.TrimSuffix(suffix, "/profile")
+		funcPart = strings.TrimSuffix(funcPart, "/")
+		if funcPart == "" {
+			http.Error(w, "Function name required", http.StatusBadRequest)
+			return
+		}
+		g.handleProfile(w, r, funcPart)
+		return
+	}
+	if strings.HasSuffix(suffix, "/stats") {
+		// GET /functions/:id/stats
+		funcPart := strings.TrimSuffix(suffix, "/stats")
+		funcPart = strings.TrimSuffix(funcPart, "/")
+		if funcPart == "" {
+			http.Error(w, "Function name required", http.StatusBadRequest)
+			return
+		}
+		g.handleStats(w, r, funcPart)
+		return
+	}
 	g.handleInvoke(w, r)
 }
 
 // handleInvoke handles function invocation requests
 func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
+	arrival := time.Now()
+
 	// Extract function name from path
 	// Path format: /functions/:name
 	path := r.URL.Path
@@ -194,9 +378,20 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 
+	trace := g.tracer.StartTrace(r.Header.Get("traceparent"), "invoke "+functionName)
+	defer trace.End()
+	if trace != nil {
+		w.Header().Set("traceresponse", trace.SpanContext().Traceparent())
+		trace.SetAttribute("http.method", r.Method)
+		trace.SetAttribute("faas.name", functionName)
+	}
+
 	// Route to function
-	fn, _, err := g.router.Route(functionName)
+	routeStart := time.Now()
+	fn, fnPool, err := g.router.Route(functionName)
+	trace.Record("router.route", routeStart, time.Now())
 	if err != nil {
+		trace.SetError(err.Error())
 		if err == router.ErrFunctionNotFound {
 			http.Error(w, "Function not found", http.StatusNotFound)
 			return
@@ -210,8 +405,7 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 	}
 
 	// Check if pool is missing (lazy load)
-	pool, err := g.router.GetPool(fn.ID)
-	if err != nil || pool == nil {
+	if fnPool == nil {
 		// Pool missing, try to create it
 		g.logger.Info("Lazy loading pool for function %s", fn.ID)
 
@@ -220,7 +414,7 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 			return
 		}
 
-		version, err := g.metadata.GetVersionByID(fn.ActiveVersionID)
+		version, err := g.router.ActiveVersion(fn.ID)
 		if err != nil {
 			g.logger.Error("Failed to get version %s: %v", fn.ActiveVersionID, err)
 			http.Error(w, "Failed to load function version", http.StatusInternalServerError)
@@ -235,11 +429,33 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 	}
 
 	// Parse request
+	parseStart := time.Now()
 	req, err := g.parseRequest(r)
 	if err != nil {
 		http.Error(w, fmt.Sprintf("Failed to parse request: %v", err), http.StatusBadRequest)
 		return
 	}
+	trace.Record("gateway.parse_request", parseStart, time.Now(), "http.request.body.size", strconv.Itoa(len(req.Body)))
+
+	// Sampled invocations are captured once the response has been written
+	status := http.StatusInternalServerError
+	if g.capture.Sample() {
+		defer func() {
+			g.capture.Record(&capture.Record{
+				Arrival:      arrival,
+				FunctionID:   fn.ID,
+				FunctionName: fn.Name,
+				Version:      fn.ActiveVersionID,
+				Method:       req.Method,
+				Path:         req.Path,
+				Headers:      req.Headers,
+				Query:        req.Query,
+				Body:         req.Body,
+				Status:       status,
+				Latency:      time.Since(arrival),
+			})
+		}()
+	}
 
 	// Set deadline (default 30 seconds)
 	deadlineMS := int64(30000)
@@ -253,6 +469,7 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 	// Create context with deadline
 	ctx, cancel := context.WithTimeout(r.Context(), time.Duration(deadlineMS)*time.Millisecond)
 	defer cancel()
+	ctx = tracing.ContextWithTrace(ctx, trace)
 
 	// Log invocation attempt
 	g.logger.Debug("Invoking function %s (method: %s, path: %s)", fn.ID, req.Method, req.Path)
@@ -260,18 +477,34 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 	// Schedule invocation
 	result, err := g.scheduler.Schedule(ctx, fn.ID, req)
 	if err != nil {
+		trace.SetError(err.Error())
 		g.logger.Error("Invocation failed for function %s: %v", fn.ID, err)
-		http.Error(w, fmt.Sprintf("Invocation failed: %v", err), http.StatusInternalServerError)
+		var admission *pool.AdmissionError
+		if errors.As(err, &admission) {
+			// Shed before queueing: tell the client when to come back
+			w.Header().Set("Retry-After", strconv.Itoa(int(math.Ceil(admission.RetryAfter.Seconds()))))
+			status = http.StatusServiceUnavailable
+			if errors.Is(err, pool.ErrDeadlineUnmeetable) {
+				status = http.StatusTooManyRequests
+			}
+		}
+		http.Error(w, fmt.Sprintf("Invocation failed: %v", err), status)
 		return
 	}
 
 	g.logger.Debug("Invocation completed for function %s (success: %v, duration: %v)", fn.ID, result.Success, result.ExecutionTime)
+	if result.IsColdStart {
+		w.Header().Set("X-Bunbase-Cold-Start", "true")
+	}
 
 	// Write response
 	if !result.Success {
+		trace.SetError(result.Error)
 		http.Error(w, result.Error, http.StatusInternalServerError)
 		return
 	}
+	trace.SetAttribute("http.response.status_code", strconv.Itoa(result.Status))
+	status = result.Status
 
 	// Set response headers
 	for k, v := range result.Headers {
@@ -283,6 +516,7 @@ func (g *Gateway) handleInvoke(w http.ResponseWriter, r *http.Request) {
 	if len(result.Body) > 0 {
 		w.Write(result.Body)
 	}
+	worker.ReleaseBody(result.Body)
 }
 
 // parseRequest parses an HTTP request into an InvokeRequest
@@ -595,15 +829,6 @@ func (g *Gateway) createPoolForFunction(fn *metadata.Function, version *metadata
 		runtimeWorkerScript = ""
 	}
 
-	// Check if pool already exists
-	existingPool, err := g.router.GetPool(fn.ID)
-	if err == nil && existingPool != nil {
-		// Unregister existing pool
-		g.router.UnregisterPool(fn.ID)
-		// Stop pool gracefully
-		existingPool.Stop()
-	}
-
 	// Create new pool
 	p := pool.NewPool(
 		fn.ID,
@@ -619,8 +844,15 @@ func (g *Gateway) createPoolForFunction(fn *metadata.Function, version *metadata
 		p.SetLogStore(g.logStore)
 	}
 
-	// Register pool
-	g.router.RegisterPool(fn.ID, p)
+	// Switch traffic to the new pool once it has taken over the previous
+	// deployment's warm workers; the previous pool finishes its in-flight
+	// invocations in the background
+	ctx, cancel := context.WithTimeout(context.Background(), poolCfg.StartupTimeout)
+	existingPool := g.router.ReplacePool(ctx, fn.ID, p)
+	cancel()
+	if existingPool != nil {
+		go existingPool.Drain(poolCfg.ExecutionTimeout)
+	}
 
 	g.logger.Info("Created pool for function %s (version %s, runtime %s)", fn.ID, version.Version, fn.Runtime)
 
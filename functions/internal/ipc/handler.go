@@ -17,6 +17,7 @@ import (
 	"github.com/kartikbazzad/bunbase/functions/internal/pool"
 	"github.com/kartikbazzad/bunbase/functions/internal/router"
 	"github.com/kartikbazzad/bunbase/functions/internal/scheduler"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
 )
 
 // Handler handles IPC requests
@@ -46,18 +47,11 @@ func (h *Handler) SetDependencies(meta *metadata.Store, cfg *config.Config, work
 	h.cfg = cfg
 	h.workerScript = workerScript
 	h.initScript = initScript
-	lokiURL := ""
-	if cfg != nil && cfg.Logs.LokiURL != "" {
-		lokiURL = cfg.Logs.LokiURL
-	}
-	if lokiURL == "" {
-		lokiURL = os.Getenv("LOKI_URL")
-	}
-	if lokiURL != "" {
-		h.logStore = logstore.NewLokiStore(lokiURL)
-	} else {
-		h.logStore = &logstore.NoopStore{}
+	var logsCfg *config.LogsConfig
+	if cfg != nil {
+		logsCfg = &cfg.Logs
 	}
+	h.logStore = logstore.NewNodeStore(logsCfg, h.logger)
 }
 
 // Handle handles an IPC request
@@ -166,6 +160,7 @@ func (h *Handler) handleInvoke(frame *RequestFrame) *ResponseFrame {
 		if len(result.Body) > 0 {
 			respPayload.Body = base64.StdEncoding.EncodeToString(result.Body)
 		}
+		worker.ReleaseBody(result.Body)
 	} else {
 		respPayload.Error = result.Error
 	}
@@ -510,15 +505,6 @@ func (h *Handler) createPoolForFunction(fn *metadata.Function, version *metadata
 		runtimeWorkerScript = ""
 	}
 
-	// Check if pool already exists
-	existingPool, err := h.router.GetPool(fn.ID)
-	if err == nil && existingPool != nil {
-		// Unregister existing pool
-		h.router.UnregisterPool(fn.ID)
-		// Stop pool gracefully
-		existingPool.Stop()
-	}
-
 	// Create new pool
 	p := pool.NewPool(
 		fn.ID,
@@ -534,8 +520,15 @@ func (h *Handler) createPoolForFunction(fn *metadata.Function, version *metadata
 		p.SetLogStore(h.logStore)
 	}
 
-	// Register pool
-	h.router.RegisterPool(fn.ID, p)
+	// Switch traffic to the new pool once it has taken over the previous
+	// deployment's warm workers; the previous pool finishes its in-flight
+	// invocations in the background
+	ctx, cancel := context.WithTimeout(context.Background(), poolCfg.StartupTimeout)
+	existingPool := h.router.ReplacePool(ctx, fn.ID, p)
+	cancel()
+	if existingPool != nil {
+		go existingPool.Drain(poolCfg.ExecutionTimeout)
+	}
 
 	h.logger.Info("Created pool for function %s (version %s, runtime %s)", fn.ID, version.Version, fn.Runtime)
 
@@ -1,6 +1,7 @@
 package ipc
 
 import (
+	"io"
 	"net"
 	"os"
 	"sync"
@@ -108,6 +109,9 @@ func (s *Server) Stop() error {
 
 	s.running = false
 	s.mu.Unlock()
+	if c, ok := s.handler.logStore.(io.Closer); ok {
+		c.Close()
+	}
 
 	// Close all active connections
 	s.connMu.Lock()
@@ -0,0 +1,139 @@
+package loadgen
+
+import (
+	"math/bits"
+	"time"
+)
+
+const (
+	subBucketBits  = 10
+	subBucketCount = 1 << subBucketBits
+	subBucketHalf  = subBucketCount / 2
+
+	// Values above this are clamped; nothing we measure should take an hour
+	histogramMaxValue = int64(time.Hour)
+)
+
+// Histogram is a fixed-size latency histogram in the style of HdrHistogram.
+// Values (nanoseconds) below 1024 are counted exactly; above that, each power
+// of two is split into 512 linear sub-buckets, so every percentile is reported
+// within 0.2% of the recorded value regardless of the range covered.
+// Histogram is not safe for concurrent use.
+type Histogram struct {
+	counts []int64
+	total  int64
+	min    int64
+	max    int64
+	sum    float64
+}
+
+// NewHistogram creates an empty histogram
+func NewHistogram() *Histogram {
+	return &Histogram{counts: make([]int64, bucketIndex(histogramMaxValue)+1)}
+}
+
+func bucketIndex(v int64) int {
+	if v < subBucketCount {
+		return int(v)
+	}
+	shift := bits.Len64(uint64(v)) - subBucketBits
+	sub := int(v >> uint(shift))
+	return subBucketCount + (shift-1)*subBucketHalf + (sub - subBucketHalf)
+}
+
+// bucketUpperBound returns the highest value that maps to bucket idx
+func bucketUpperBound(idx int) int64 {
+	if idx < subBucketCount {
+		return int64(idx)
+	}
+	shift := (idx-subBucketCount)/subBucketHalf + 1
+	sub := int64((idx-subBucketCount)%subBucketHalf + subBucketHalf)
+	return (sub+1)<<uint(shift) - 1
+}
+
+// Record adds one observation
+func (h *Histogram) Record(d time.Duration) {
+	v := int64(d)
+	if v < 0 {
+		v = 0
+	}
+	if v > histogramMaxValue {
+		v = histogramMaxValue
+	}
+	h.counts[bucketIndex(v)]++
+	if h.total == 0 || v < h.min {
+		h.min = v
+	}
+	if v > h.max {
+		h.max = v
+	}
+	h.total++
+	h.sum += float64(v)
+}
+
+// Merge adds all observations of other into h
+func (h *Histogram) Merge(other *Histogram) {
+	if other.total == 0 {
+		return
+	}
+	for i, c := range other.counts {
+		h.counts[i] += c
+	}
+	if h.total == 0 || other.min < h.min {
+		h.min = other.min
+	}
+	if other.max > h.max {
+		h.max = other.max
+	}
+	h.total += other.total
+	h.sum += other.sum
+}
+
+// Count returns the number of observations
+func (h *Histogram) Count() int64 {
+	return h.total
+}
+
+// Min returns the smallest observation
+func (h *Histogram) Min() time.Duration {
+	return time.Duration(h.min)
+}
+
+// Max returns the largest observation
+func (h *Histogram) Max() time.Duration {
+	return time.Duration(h.max)
+}
+
+// Mean returns the average observation
+func (h *Histogram) Mean() time.Duration {
+	if h.total == 0 {
+		return 0
+	}
+	return time.Duration(h.sum / float64(h.total))
+}
+
+// Quantile returns the value at quantile q (0..1), e.g. 0.999 for p99.9
+func (h *Histogram) Quantile(q float64) time.Duration {
+	if h.total == 0 {
+		return 0
+	}
+	if q <= 0 {
+		return time.Duration(h.min)
+	}
+	rank := int64(q*float64(h.total) + 0.5)
+	if rank < 1 {
+		rank = 1
+	}
+	var seen int64
+	for i, c := range h.counts {
+		seen += c
+		if seen >= rank {
+			v := bucketUpperBound(i)
+			if v > h.max {
+				v = h.max
+			}
+			return time.Duration(v)
+		}
+	}
+	return time.Duration(h.max)
+}
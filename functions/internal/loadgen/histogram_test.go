@@ -0,0 +1,54 @@
+package loadgen
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+func TestHistogramQuantilesWithinPrecision(t *testing.T) {
+	h := NewHistogram()
+	for i := 1; i <= 100000; i++ {
+		h.Record(time.Duration(i) * time.Microsecond)
+	}
+	if h.Count() != 100000 {
+		t.Fatalf("count = %d, want 100000", h.Count())
+	}
+	for _, tc := range []struct {
+		q    float64
+		want time.Duration
+	}{
+		{0.5, 50 * time.Millisecond},
+		{0.99, 99 * time.Millisecond},
+		{0.999, 99900 * time.Microsecond},
+	} {
+		got := h.Quantile(tc.q)
+		if diff := math.Abs(float64(got-tc.want)) / float64(tc.want); diff > 0.002 {
+			t.Errorf("p%v = %v, want %v (±0.2%%)", tc.q*100, got, tc.want)
+		}
+	}
+	if h.Min() != time.Microsecond || h.Max() != 100*time.Millisecond {
+		t.Errorf("min/max = %v/%v", h.Min(), h.Max())
+	}
+}
+
+func TestHistogramSmallValuesExactAndMerge(t *testing.T) {
+	cold, warm := NewHistogram(), NewHistogram()
+	for i := 0; i < 10; i++ {
+		warm.Record(500)
+	}
+	cold.Record(3 * time.Second)
+
+	all := NewHistogram()
+	all.Merge(warm)
+	all.Merge(cold)
+	if all.Count() != 11 {
+		t.Fatalf("count = %d, want 11", all.Count())
+	}
+	if got := all.Quantile(0.5); got != 500 {
+		t.Errorf("p50 = %v, want 500ns", got)
+	}
+	if got := all.Quantile(1); got != 3*time.Second {
+		t.Errorf("p100 = %v, want 3s", got)
+	}
+}
@@ -0,0 +1,343 @@
+// Package loadgen drives a functions gateway endpoint with synthetic traffic
+// and records latency histograms split by cold and warm invocations.
+package loadgen
+
+import (
+	"bytes"
+	"context"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+)
+
+const (
+	// ModeOpen issues requests at a fixed arrival rate, independent of how
+	// fast they complete. Latency is measured from the intended send time,
+	// so a stalled server is not hidden by the generator slowing down.
+	ModeOpen = "open"
+	// ModeClosed runs a fixed number of clients that each wait for their
+	// response before sending the next request.
+	ModeClosed = "closed"
+
+	// ColdStartHeader is set by the gateway on responses served by a freshly spawned worker
+	ColdStartHeader = "X-Bunbase-Cold-Start"
+)
+
+// Config describes one load run
+type Config struct {
+	URL            string        // invoke URL, e.g. http://127.0.0.1:8787/functions/hello
+	Mode           string        // ModeOpen or ModeClosed
+	Rate           float64       // open loop: requests per second
+	Concurrency    int           // closed loop: clients; open loop: max requests in flight
+	Duration       time.Duration // how long to send requests
+	Method         string        // HTTP method (default POST)
+	PayloadSize    int           // request body size in bytes; 0 sends no body
+	Timeout        time.Duration // per-request timeout (default 30s)
+	SampleInterval time.Duration // how often throughput and pool stats are sampled (default 1s)
+	Client         *http.Client  // optional
+}
+
+// Sample is one point of the time series collected during a run
+type Sample struct {
+	ElapsedMS     int64   `json:"elapsed_ms"`
+	ThroughputRPS float64 `json:"throughput_rps"`
+	Errors        int64   `json:"errors"`
+	InFlight      int64   `json:"in_flight"`
+	WarmWorkers   int     `json:"warm_workers"`
+	BusyWorkers   int     `json:"busy_workers"`
+	TotalWorkers  int     `json:"total_workers"`
+	QueueDepth    int     `json:"queue_depth"`
+}
+
+// poolStats mirrors the gateway's GET /functions/:name/stats body
+type poolStats struct {
+	WarmWorkers  int `json:"warm_workers"`
+	BusyWorkers  int `json:"busy_workers"`
+	TotalWorkers int `json:"total_workers"`
+	QueueDepth   int `json:"queue_depth"`
+}
+
+type run struct {
+	cfg    *Config
+	client *http.Client
+	body   []byte
+
+	mu       sync.Mutex
+	all      *Histogram
+	cold     *Histogram
+	warm     *Histogram
+	statuses map[string]int64
+	requests int64
+	errors   int64
+	dropped  int64
+	inFlight int64
+	done     int64 // completed since the last sample
+}
+
+// Run executes the load described by cfg and returns its report
+func Run(ctx context.Context, cfg *Config) (*Report, error) {
+	if cfg.URL == "" {
+		return nil, fmt.Errorf("loadgen: URL is required")
+	}
+	if cfg.Method == "" {
+		cfg.Method = http.MethodPost
+	}
+	if cfg.Timeout <= 0 {
+		cfg.Timeout = 30 * time.Second
+	}
+	if cfg.SampleInterval <= 0 {
+		cfg.SampleInterval = time.Second
+	}
+	if cfg.Concurrency <= 0 {
+		cfg.Concurrency = 1
+	}
+	switch cfg.Mode {
+	case ModeOpen:
+		if cfg.Rate <= 0 {
+			return nil, fmt.Errorf("loadgen: open loop needs a positive rate")
+		}
+	case ModeClosed:
+	default:
+		return nil, fmt.Errorf("loadgen: unknown mode %q (want %s or %s)", cfg.Mode, ModeOpen, ModeClosed)
+	}
+
+	client := cfg.Client
+	if client == nil {
+		client = &http.Client{
+			Timeout: cfg.Timeout,
+			Transport: &http.Transport{
+				MaxIdleConns:        cfg.Concurrency,
+				MaxIdleConnsPerHost: cfg.Concurrency,
+				IdleConnTimeout:     90 * time.Second,
+			},
+		}
+	}
+
+	r := &run{
+		cfg:      cfg,
+		client:   client,
+		body:     Payload(cfg.PayloadSize),
+		all:      NewHistogram(),
+		cold:     NewHistogram(),
+		warm:     NewHistogram(),
+		statuses: make(map[string]int64),
+	}
+
+	ctx, cancel := context.WithCancel(ctx)
+	defer cancel()
+
+	var samples []Sample
+	samplerDone := make(chan struct{})
+	start := time.Now()
+	go func() {
+		defer close(samplerDone)
+		samples = r.sample(ctx, start)
+	}()
+
+	if cfg.Mode == ModeOpen {
+		r.openLoop(ctx, start)
+	} else {
+		r.closedLoop(ctx, start)
+	}
+	elapsed := time.Since(start)
+	cancel()
+	<-samplerDone
+
+	return r.report(elapsed, samples), nil
+}
+
+// Payload returns a JSON document of exactly size bytes (nil for size <= 0)
+func Payload(size int) []byte {
+	if size <= 0 {
+		return nil
+	}
+	const prefix, suffix = `{"data":"`, `"}`
+	if size < len(prefix)+len(suffix) {
+		return bytes.Repeat([]byte(" "), size)
+	}
+	b := make([]byte, 0, size)
+	b = append(b, prefix...)
+	b = append(b, bytes.Repeat([]byte("x"), size-len(prefix)-len(suffix))...)
+	b = append(b, suffix...)
+	return b
+}
+
+func (r *run) openLoop(ctx context.Context, start time.Time) {
+	interval := time.Duration(float64(time.Second) / r.cfg.Rate)
+	slots := make(chan struct{}, r.cfg.Concurrency)
+	timer := time.NewTimer(0)
+	defer timer.Stop()
+	var wg sync.WaitGroup
+
+	for i := int64(0); ; i++ {
+		intended := start.Add(time.Duration(i) * interval)
+		if intended.Sub(start) >= r.cfg.Duration {
+			break
+		}
+		if d := time.Until(intended); d > 0 {
+			if !timer.Stop() {
+				select {
+				case <-timer.C:
+				default:
+				}
+			}
+			timer.Reset(d)
+			select {
+			case <-timer.C:
+			case <-ctx.Done():
+				wg.Wait()
+				return
+			}
+		}
+		select {
+		case slots <- struct{}{}:
+		default:
+			// In-flight cap reached; count the arrival as dropped rather than
+			// delaying the schedule
+			r.mu.Lock()
+			r.dropped++
+			r.mu.Unlock()
+			continue
+		}
+		wg.Add(1)
+		go func(intended time.Time) {
+			defer wg.Done()
+			defer func() { <-slots }()
+			r.do(ctx, intended)
+		}(intended)
+	}
+	wg.Wait()
+}
+
+func (r *run) closedLoop(ctx context.Context, start time.Time) {
+	deadline := start.Add(r.cfg.Duration)
+	var wg sync.WaitGroup
+	for i := 0; i < r.cfg.Concurrency; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for ctx.Err() == nil && time.Now().Before(deadline) {
+				r.do(ctx, time.Now())
+			}
+		}()
+	}
+	wg.Wait()
+}
+
+// do sends one request and records its latency measured from intended
+func (r *run) do(ctx context.Context, intended time.Time) {
+	r.mu.Lock()
+	r.inFlight++
+	r.mu.Unlock()
+
+	var body io.Reader
+	if r.body != nil {
+		body = bytes.NewReader(r.body)
+	}
+	status := "error"
+	cold := false
+	ok := false
+	req, err := http.NewRequestWithContext(ctx, r.cfg.Method, r.cfg.URL, body)
+	if err == nil {
+		if r.body != nil {
+			req.Header.Set("Content-Type", "application/json")
+		}
+		var resp *http.Response
+		resp, err = r.client.Do(req)
+		if err == nil {
+			io.Copy(io.Discard, resp.Body)
+			resp.Body.Close()
+			status = strconv.Itoa(resp.StatusCode)
+			cold = resp.Header.Get(ColdStartHeader) == "true"
+			ok = resp.StatusCode < 400
+		}
+	}
+	latency := time.Since(intended)
+
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.inFlight--
+	if ctx.Err() != nil && err != nil {
+		// Cancelled at the end of the run; not a server error
+		return
+	}
+	r.requests++
+	r.done++
+	r.statuses[status]++
+	if !ok {
+		r.errors++
+		return
+	}
+	r.all.Record(latency)
+	if cold {
+		r.cold.Record(latency)
+	} else {
+		r.warm.Record(latency)
+	}
+}
+
+// sample collects throughput and pool state every SampleInterval until ctx is done
+func (r *run) sample(ctx context.Context, start time.Time) []Sample {
+	statsURL := strings.TrimSuffix(r.cfg.URL, "/") + "/stats"
+	ticker := time.NewTicker(r.cfg.SampleInterval)
+	defer ticker.Stop()
+
+	var samples []Sample
+	var lastErrors int64
+	last := start
+	for {
+		select {
+		case <-ctx.Done():
+			return samples
+		case now := <-ticker.C:
+			r.mu.Lock()
+			s := Sample{
+				ElapsedMS:     now.Sub(start).Milliseconds(),
+				ThroughputRPS: float64(r.done) / now.Sub(last).Seconds(),
+				Errors:        r.errors - lastErrors,
+				InFlight:      r.inFlight,
+			}
+			r.done = 0
+			lastErrors = r.errors
+			r.mu.Unlock()
+			last = now
+
+			if ps, err := r.fetchStats(ctx, statsURL); err == nil {
+				s.WarmWorkers = ps.WarmWorkers
+				s.BusyWorkers = ps.BusyWorkers
+				s.TotalWorkers = ps.TotalWorkers
+				s.QueueDepth = ps.QueueDepth
+			} else {
+				s.WarmWorkers, s.BusyWorkers, s.TotalWorkers, s.QueueDepth = -1, -1, -1, -1
+			}
+			samples = append(samples, s)
+		}
+	}
+}
+
+func (r *run) fetchStats(ctx context.Context, url string) (*poolStats, error) {
+	ctx, cancel := context.WithTimeout(ctx, r.cfg.SampleInterval)
+	defer cancel()
+	req, err := http.NewRequestWithContext(ctx, http.MethodGet, url, nil)
+	if err != nil {
+		return nil, err
+	}
+	resp, err := r.client.Do(req)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != http.StatusOK {
+		return nil, fmt.Errorf("stats: %s", resp.Status)
+	}
+	var ps poolStats
+	if err := json.NewDecoder(resp.Body).Decode(&ps); err != nil {
+		return nil, err
+	}
+	return &ps, nil
+}
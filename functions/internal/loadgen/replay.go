@@ -0,0 +1,294 @@
+package loadgen
+
+import (
+	"bytes"
+	"context"
+	"fmt"
+	"io"
+	"net/http"
+	"net/url"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/capture"
+)
+
+// ReplayConfig describes a replay of a capture file
+type ReplayConfig struct {
+	BaseURL     string        // gateway base URL, e.g. http://127.0.0.1:8080
+	Speed       float64       // 1 keeps the captured pace, 2 replays twice as fast; <= 0 sends back to back
+	Function    string        // when set, every record is sent to /functions/<Function>
+	Concurrency int           // max requests in flight (default 256)
+	Timeout     time.Duration // per-request timeout (default 30s)
+	Limit       int           // stop after this many records; 0 replays the whole file
+	Client      *http.Client  // optional
+}
+
+// LatencyDelta is replayed minus captured latency at each percentile
+type LatencyDelta struct {
+	MeanMS float64 `json:"mean_ms"`
+	P50MS  float64 `json:"p50_ms"`
+	P90MS  float64 `json:"p90_ms"`
+	P99MS  float64 `json:"p99_ms"`
+	P999MS float64 `json:"p999_ms"`
+	MaxMS  float64 `json:"max_ms"`
+}
+
+// ReplayReport compares replayed latencies with the ones recorded at capture time.
+// Only requests that succeeded both times are compared.
+type ReplayReport struct {
+	BaseURL          string           `json:"base_url"`
+	Speed            float64          `json:"speed"`
+	Records          int64            `json:"records"`
+	Sent             int64            `json:"sent"`
+	Errors           int64            `json:"errors"`
+	Dropped          int64            `json:"dropped"` // not sent because Concurrency requests were in flight
+	StatusMismatches int64            `json:"status_mismatches"`
+	TruncatedBodies  int64            `json:"truncated_bodies"` // replayed with a body cut at capture time
+	Statuses         map[string]int64 `json:"statuses"`
+	CapturedSeconds  float64          `json:"captured_seconds"`
+	DurationSeconds  float64          `json:"duration_seconds"`
+	ThroughputRPS    float64          `json:"throughput_rps"`
+	Captured         LatencySummary   `json:"captured"`
+	Replayed         LatencySummary   `json:"replayed"`
+	Delta            LatencyDelta     `json:"delta"`
+}
+
+type replay struct {
+	cfg    *ReplayConfig
+	client *http.Client
+
+	mu         sync.Mutex
+	captured   *Histogram
+	replayed   *Histogram
+	deltaSum   float64
+	statuses   map[string]int64
+	sent       int64
+	errors     int64
+	mismatches int64
+}
+
+// Replay sends the records read from r to cfg.BaseURL, preserving their
+// relative arrival times scaled by cfg.Speed
+func Replay(ctx context.Context, r *capture.Reader, cfg *ReplayConfig) (*ReplayReport, error) {
+	if cfg.BaseURL == "" {
+		return nil, fmt.Errorf("loadgen: base URL is required")
+	}
+	if cfg.Concurrency <= 0 {
+		cfg.Concurrency = 256
+	}
+	if cfg.Timeout <= 0 {
+		cfg.Timeout = 30 * time.Second
+	}
+	client := cfg.Client
+	if client == nil {
+		client = &http.Client{
+			Timeout: cfg.Timeout,
+			Transport: &http.Transport{
+				MaxIdleConns:        cfg.Concurrency,
+				MaxIdleConnsPerHost: cfg.Concurrency,
+				IdleConnTimeout:     90 * time.Second,
+			},
+		}
+	}
+	rp := &replay{
+		cfg:      cfg,
+		client:   client,
+		captured: NewHistogram(),
+		replayed: NewHistogram(),
+		statuses: make(map[string]int64),
+	}
+
+	rep := &ReplayReport{BaseURL: cfg.BaseURL, Speed: cfg.Speed}
+	slots := make(chan struct{}, cfg.Concurrency)
+	timer := time.NewTimer(0)
+	defer timer.Stop()
+	var wg sync.WaitGroup
+	var first, last time.Time
+	start := time.Now()
+
+loop:
+	for cfg.Limit == 0 || rep.Records < int64(cfg.Limit) {
+		rec, err := r.Next()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			wg.Wait()
+			return nil, err
+		}
+		if rep.Records == 0 {
+			first = rec.Arrival
+		}
+		if rec.Arrival.After(last) {
+			last = rec.Arrival
+		}
+		rep.Records++
+		if rec.BodySize > len(rec.Body) {
+			rep.TruncatedBodies++
+		}
+
+		intended := time.Now()
+		if cfg.Speed > 0 {
+			offset := rec.Arrival.Sub(first)
+			if offset < 0 {
+				offset = 0 // captured out of order; send right away
+			}
+			intended = start.Add(time.Duration(float64(offset) / cfg.Speed))
+			if d := time.Until(intended); d > 0 {
+				if !timer.Stop() {
+					select {
+					case <-timer.C:
+					default:
+					}
+				}
+				timer.Reset(d)
+				select {
+				case <-timer.C:
+				case <-ctx.Done():
+					break loop
+				}
+			}
+			select {
+			case slots <- struct{}{}:
+			default:
+				rep.Dropped++
+				continue
+			}
+		} else {
+			select {
+			case slots <- struct{}{}:
+			case <-ctx.Done():
+				break loop
+			}
+			intended = time.Now()
+		}
+
+		wg.Add(1)
+		go func(rec *capture.Record, intended time.Time) {
+			defer wg.Done()
+			defer func() { <-slots }()
+			rp.send(ctx, rec, intended)
+		}(rec, intended)
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	rep.Sent = rp.sent
+	rep.Errors = rp.errors
+	rep.StatusMismatches = rp.mismatches
+	rep.Statuses = rp.statuses
+	rep.CapturedSeconds = last.Sub(first).Seconds()
+	rep.DurationSeconds = elapsed.Seconds()
+	if elapsed > 0 {
+		rep.ThroughputRPS = float64(rp.sent) / elapsed.Seconds()
+	}
+	rep.Captured = summarize(rp.captured)
+	rep.Replayed = summarize(rp.replayed)
+	if n := rp.replayed.Count(); n > 0 {
+		rep.Delta.MeanMS = rp.deltaSum / float64(n) / float64(time.Millisecond)
+	}
+	rep.Delta.P50MS = rep.Replayed.P50MS - rep.Captured.P50MS
+	rep.Delta.P90MS = rep.Replayed.P90MS - rep.Captured.P90MS
+	rep.Delta.P99MS = rep.Replayed.P99MS - rep.Captured.P99MS
+	rep.Delta.P999MS = rep.Replayed.P999MS - rep.Captured.P999MS
+	rep.Delta.MaxMS = rep.Replayed.MaxMS - rep.Captured.MaxMS
+	return rep, nil
+}
+
+func (rp *replay) send(ctx context.Context, rec *capture.Record, intended time.Time) {
+	path := rec.Path
+	if rp.cfg.Function != "" {
+		path = "/functions/" + rp.cfg.Function
+	}
+	target := strings.TrimSuffix(rp.cfg.BaseURL, "/") + path
+	if len(rec.Query) > 0 {
+		q := url.Values{}
+		for k, v := range rec.Query {
+			q.Set(k, v)
+		}
+		target += "?" + q.Encode()
+	}
+
+	var body io.Reader
+	if len(rec.Body) > 0 {
+		body = bytes.NewReader(rec.Body)
+	}
+	status := "error"
+	code := 0
+	req, err := http.NewRequestWithContext(ctx, rec.Method, target, body)
+	if err == nil {
+		for k, v := range rec.Headers {
+			req.Header.Set(k, v)
+		}
+		var resp *http.Response
+		resp, err = rp.client.Do(req)
+		if err == nil {
+			io.Copy(io.Discard, resp.Body)
+			resp.Body.Close()
+			code = resp.StatusCode
+			status = strconv.Itoa(code)
+		}
+	}
+	latency := time.Since(intended)
+
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	if err != nil && ctx.Err() != nil {
+		return // interrupted
+	}
+	rp.sent++
+	rp.statuses[status]++
+	if err != nil || code >= 400 {
+		rp.errors++
+	}
+	if code != rec.Status {
+		rp.mismatches++
+	}
+	if err == nil && code < 400 && rec.Status < 400 {
+		rp.captured.Record(rec.Latency)
+		rp.replayed.Record(latency)
+		rp.deltaSum += float64(latency - rec.Latency)
+	}
+}
+
+// WriteText prints a human-readable comparison
+func (rep *ReplayReport) WriteText(w io.Writer) {
+	speed := "as fast as possible"
+	if rep.Speed > 0 {
+		speed = fmt.Sprintf("%gx", rep.Speed)
+	}
+	fmt.Fprintf(w, "== replay to %s at %s\n", rep.BaseURL, speed)
+	fmt.Fprintf(w, "records %d (%.1fs captured), sent %d in %.1fs (%.1f req/s), errors %d, dropped %d\n",
+		rep.Records, rep.CapturedSeconds, rep.Sent, rep.DurationSeconds, rep.ThroughputRPS, rep.Errors, rep.Dropped)
+	fmt.Fprintf(w, "status mismatches %d, truncated bodies %d\n", rep.StatusMismatches, rep.TruncatedBodies)
+	if len(rep.Statuses) > 0 {
+		codes := make([]string, 0, len(rep.Statuses))
+		for code := range rep.Statuses {
+			codes = append(codes, code)
+		}
+		sort.Strings(codes)
+		fmt.Fprint(w, "statuses")
+		for _, code := range codes {
+			fmt.Fprintf(w, " %s=%d", code, rep.Statuses[code])
+		}
+		fmt.Fprintln(w)
+	}
+
+	fmt.Fprintf(w, "\n%-9s %8s %9s %9s %9s %9s %9s %9s\n", "", "count", "mean", "p50", "p90", "p99", "p99.9", "max")
+	for _, row := range []struct {
+		name string
+		s    LatencySummary
+	}{{"captured", rep.Captured}, {"replayed", rep.Replayed}} {
+		fmt.Fprintf(w, "%-9s %8d %7.2fms %7.2fms %7.2fms %7.2fms %7.2fms %7.2fms\n",
+			row.name, row.s.Count, row.s.MeanMS, row.s.P50MS, row.s.P90MS, row.s.P99MS, row.s.P999MS, row.s.MaxMS)
+	}
+	d := rep.Delta
+	fmt.Fprintf(w, "%-9s %8s %+7.2fms %+7.2fms %+7.2fms %+7.2fms %+7.2fms %+7.2fms\n\n",
+		"delta", "", d.MeanMS, d.P50MS, d.P90MS, d.P99MS, d.P999MS, d.MaxMS)
+}
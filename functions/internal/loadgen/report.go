@@ -0,0 +1,132 @@
+package loadgen
+
+import (
+	"fmt"
+	"io"
+	"sort"
+	"time"
+)
+
+// LatencySummary condenses a histogram into the percentiles we compare across runs
+type LatencySummary struct {
+	Count  int64   `json:"count"`
+	MinMS  float64 `json:"min_ms"`
+	MeanMS float64 `json:"mean_ms"`
+	P50MS  float64 `json:"p50_ms"`
+	P90MS  float64 `json:"p90_ms"`
+	P99MS  float64 `json:"p99_ms"`
+	P999MS float64 `json:"p999_ms"`
+	MaxMS  float64 `json:"max_ms"`
+}
+
+// Report is the result of one load run
+type Report struct {
+	Runtime         string           `json:"runtime,omitempty"`
+	CPUAffinity     string           `json:"cpu_affinity,omitempty"` // worker placement policy of a local dev server
+	URL             string           `json:"url"`
+	Mode            string           `json:"mode"`
+	Rate            float64          `json:"rate,omitempty"`
+	Concurrency     int              `json:"concurrency"`
+	PayloadBytes    int              `json:"payload_bytes"`
+	DurationSeconds float64          `json:"duration_seconds"`
+	Requests        int64            `json:"requests"`
+	Errors          int64            `json:"errors"`
+	Dropped         int64            `json:"dropped"` // open loop arrivals skipped at the in-flight cap
+	Statuses        map[string]int64 `json:"statuses"`
+	ThroughputRPS   float64          `json:"throughput_rps"`
+	Latency         LatencySummary   `json:"latency"`
+	Cold            LatencySummary   `json:"cold"`
+	Warm            LatencySummary   `json:"warm"`
+	Samples         []Sample         `json:"samples"`
+}
+
+func summarize(h *Histogram) LatencySummary {
+	ms := func(d time.Duration) float64 { return float64(d) / float64(time.Millisecond) }
+	return LatencySummary{
+		Count:  h.Count(),
+		MinMS:  ms(h.Min()),
+		MeanMS: ms(h.Mean()),
+		P50MS:  ms(h.Quantile(0.50)),
+		P90MS:  ms(h.Quantile(0.90)),
+		P99MS:  ms(h.Quantile(0.99)),
+		P999MS: ms(h.Quantile(0.999)),
+		MaxMS:  ms(h.Max()),
+	}
+}
+
+func (r *run) report(elapsed time.Duration, samples []Sample) *Report {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	rep := &Report{
+		URL:             r.cfg.URL,
+		Mode:            r.cfg.Mode,
+		Concurrency:     r.cfg.Concurrency,
+		PayloadBytes:    r.cfg.PayloadSize,
+		DurationSeconds: elapsed.Seconds(),
+		Requests:        r.requests,
+		Errors:          r.errors,
+		Dropped:         r.dropped,
+		Statuses:        r.statuses,
+		Latency:         summarize(r.all),
+		Cold:            summarize(r.cold),
+		Warm:            summarize(r.warm),
+		Samples:         samples,
+	}
+	if r.cfg.Mode == ModeOpen {
+		rep.Rate = r.cfg.Rate
+	}
+	if elapsed > 0 {
+		rep.ThroughputRPS = float64(r.requests-r.errors) / elapsed.Seconds()
+	}
+	return rep
+}
+
+// WriteText prints a human-readable summary of the report
+func (rep *Report) WriteText(w io.Writer) {
+	title := rep.URL
+	if rep.Runtime != "" {
+		title = rep.Runtime + " " + title
+	}
+	if rep.CPUAffinity != "" {
+		title += " (cpu affinity " + rep.CPUAffinity + ")"
+	}
+	fmt.Fprintf(w, "== %s\n", title)
+	load := fmt.Sprintf("%d clients", rep.Concurrency)
+	if rep.Mode == ModeOpen {
+		load = fmt.Sprintf("%.0f req/s, max %d in flight", rep.Rate, rep.Concurrency)
+	}
+	fmt.Fprintf(w, "mode %s (%s), payload %d B, %.1fs\n", rep.Mode, load, rep.PayloadBytes, rep.DurationSeconds)
+	fmt.Fprintf(w, "requests %d, errors %d, dropped %d, throughput %.1f req/s\n",
+		rep.Requests, rep.Errors, rep.Dropped, rep.ThroughputRPS)
+	if len(rep.Statuses) > 0 {
+		codes := make([]string, 0, len(rep.Statuses))
+		for code := range rep.Statuses {
+			codes = append(codes, code)
+		}
+		sort.Strings(codes)
+		fmt.Fprint(w, "statuses")
+		for _, code := range codes {
+			fmt.Fprintf(w, " %s=%d", code, rep.Statuses[code])
+		}
+		fmt.Fprintln(w)
+	}
+
+	fmt.Fprintf(w, "\n%-6s %8s %9s %9s %9s %9s %9s %9s\n", "", "count", "mean", "p50", "p90", "p99", "p99.9", "max")
+	for _, row := range []struct {
+		name string
+		s    LatencySummary
+	}{{"all", rep.Latency}, {"warm", rep.Warm}, {"cold", rep.Cold}} {
+		fmt.Fprintf(w, "%-6s %8d %7.2fms %7.2fms %7.2fms %7.2fms %7.2fms %7.2fms\n",
+			row.name, row.s.Count, row.s.MeanMS, row.s.P50MS, row.s.P90MS, row.s.P99MS, row.s.P999MS, row.s.MaxMS)
+	}
+
+	if len(rep.Samples) > 0 {
+		fmt.Fprintf(w, "\n%8s %10s %7s %9s %6s %6s %6s %6s\n", "t", "req/s", "errors", "inflight", "warm", "busy", "total", "queue")
+		for _, s := range rep.Samples {
+			fmt.Fprintf(w, "%7.1fs %10.1f %7d %9d %6d %6d %6d %6d\n",
+				float64(s.ElapsedMS)/1000, s.ThroughputRPS, s.Errors, s.InFlight,
+				s.WarmWorkers, s.BusyWorkers, s.TotalWorkers, s.QueueDepth)
+		}
+	}
+	fmt.Fprintln(w)
+}
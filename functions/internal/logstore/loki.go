@@ -39,27 +39,53 @@ type lokiStream struct {
 	Values [][]string        `json:"values"` // [[timestamp_ns, line], ...]
 }
 
-// Append sends a log line to Loki.
+// Append sends a log line to Loki synchronously. The node pushes through a
+// Shipper instead, which batches lines off the invocation path.
 func (s *LokiStore) Append(functionID, invocationID, level, message string) error {
-	if functionID == "" {
-		functionID = "unknown"
-	}
-	if level == "" {
-		level = "info"
-	}
-	ts := time.Now().UnixNano()
-	tsStr := strconv.FormatInt(ts, 10)
-	// Escape labels: Loki allows only [a-zA-Z0-9_] in label values; replace invalid with underscore
-	stream := map[string]string{
-		"function_id":   sanitizeLabel(functionID),
-		"level":         sanitizeLabel(level),
-		"invocation_id": sanitizeLabel(invocationID),
-	}
-	body := lokiPushRequest{
-		Streams: []lokiStream{{
-			Stream: stream,
-			Values: [][]string{{tsStr, message}},
-		}},
+	return s.Push([]LogEntry{{
+		FunctionID:   functionID,
+		InvocationID: invocationID,
+		Level:        level,
+		Message:      message,
+		CreatedAt:    time.Now(),
+	}})
+}
+
+// lokiStreamKey identifies a stream by its labels
+type lokiStreamKey struct {
+	functionID, level, invocationID string
+}
+
+// Push sends log lines to Loki in one request, one stream per label set. The
+// lines of a stream keep their order. entries is not retained.
+func (s *LokiStore) Push(entries []LogEntry) error {
+	if len(entries) == 0 {
+		return nil
+	}
+	index := make(map[lokiStreamKey]int)
+	var body lokiPushRequest
+	for _, e := range entries {
+		functionID, level := e.FunctionID, e.Level
+		if functionID == "" {
+			functionID = "unknown"
+		}
+		if level == "" {
+			level = "info"
+		}
+		key := lokiStreamKey{functionID, level, e.InvocationID}
+		i, ok := index[key]
+		if !ok {
+			i = len(body.Streams)
+			index[key] = i
+			// Escape labels: Loki allows only [a-zA-Z0-9_] in label values; replace invalid with underscore
+			body.Streams = append(body.Streams, lokiStream{Stream: map[string]string{
+				"function_id":   sanitizeLabel(functionID),
+				"level":         sanitizeLabel(level),
+				"invocation_id": sanitizeLabel(e.InvocationID),
+			}})
+		}
+		ts := strconv.FormatInt(e.CreatedAt.UnixNano(), 10)
+		body.Streams[i].Values = append(body.Streams[i].Values, []string{ts, e.Message})
 	}
 	payload, err := json.Marshal(body)
 	if err != nil {
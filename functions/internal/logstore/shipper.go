@@ -0,0 +1,335 @@
+package logstore
+
+import (
+	"math/rand"
+	"os"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+)
+
+// BatchStore is a Store that also accepts log lines in batches, such as
+// LokiStore. Push must not keep entries.
+type BatchStore interface {
+	Store
+	Push(entries []LogEntry) error
+}
+
+// ShipperConfig tunes a Shipper; zero fields take the defaults below
+type ShipperConfig struct {
+	QueueSize  int           // lines buffered between Append and the sink; rounded up to a power of two
+	BatchBytes int           // message bytes that trigger a push
+	BatchWait  time.Duration // longest a line waits before it is pushed
+}
+
+const (
+	DefaultShipQueueSize  = 65536
+	DefaultShipBatchBytes = 1 << 20
+	DefaultShipBatchWait  = time.Second
+
+	// Above sampleDepth (a fraction of the queue) only 1 in sampleEvery
+	// debug and info lines is queued; warnings and errors are kept until the
+	// queue is full
+	sampleDepth = 0.75
+	sampleEvery = 10
+
+	shipPoll         = 50 * time.Millisecond
+	maxPushAttempts  = 3
+	pushRetryBackoff = 250 * time.Millisecond
+)
+
+// Shipper is the node's log pipeline. Append only puts the line on a bounded
+// lock-free queue and never blocks, so a chatty function or a slow sink
+// cannot delay the worker goroutine that also delivers responses. A single
+// goroutine drains the queue and pushes batches to the sink once they reach
+// BatchBytes or their oldest line is BatchWait old. When the sink falls
+// behind, the queue fills: low-severity lines are sampled, then lines are
+// dropped, and both are counted in fn_log_lines_dropped_total.
+type Shipper struct {
+	sink       BatchStore
+	queue      *ring
+	batchBytes int
+	batchWait  time.Duration
+	logger     *logger.Logger
+
+	wake    chan struct{}
+	stop    chan struct{}
+	done    chan struct{}
+	closing sync.Once
+	closed  atomic.Bool
+
+	sampled atomic.Uint64
+	dropped atomic.Uint64
+	failed  atomic.Uint64
+}
+
+// NewShipper starts a pipeline that ships to sink. Close it to flush.
+func NewShipper(sink BatchStore, cfg ShipperConfig, log *logger.Logger) *Shipper {
+	if cfg.QueueSize <= 0 {
+		cfg.QueueSize = DefaultShipQueueSize
+	}
+	if cfg.BatchBytes <= 0 {
+		cfg.BatchBytes = DefaultShipBatchBytes
+	}
+	if cfg.BatchWait <= 0 {
+		cfg.BatchWait = DefaultShipBatchWait
+	}
+	s := &Shipper{
+		sink:       sink,
+		queue:      newRing(cfg.QueueSize),
+		batchBytes: cfg.BatchBytes,
+		batchWait:  cfg.BatchWait,
+		logger:     log,
+		wake:       make(chan struct{}, 1),
+		stop:       make(chan struct{}),
+		done:       make(chan struct{}),
+	}
+	go s.run()
+	return s
+}
+
+// Append queues a log line; it returns at once and never fails. Lines that
+// do not fit are dropped and counted.
+func (s *Shipper) Append(functionID, invocationID, level, message string) error {
+	if s.closed.Load() {
+		s.drop("closed")
+		return nil
+	}
+	depth := s.queue.depth()
+	if depth >= int(sampleDepth*float64(s.queue.size())) && (level == "" || level == "debug" || level == "info") {
+		if rand.Intn(sampleEvery) != 0 {
+			s.sampled.Add(1)
+			prometrics.IncLogLinesDropped("sampled")
+			return nil
+		}
+	}
+	if !s.queue.push(LogEntry{
+		FunctionID:   functionID,
+		InvocationID: invocationID,
+		Level:        level,
+		Message:      message,
+		CreatedAt:    time.Now(),
+	}) {
+		s.drop("queue_full")
+		return nil
+	}
+	// Wake the shipper early when a batch is likely ready; otherwise it polls
+	if depth+1 == s.queue.size()/4 {
+		select {
+		case s.wake <- struct{}{}:
+		default:
+		}
+	}
+	return nil
+}
+
+func (s *Shipper) drop(reason string) {
+	s.dropped.Add(1)
+	prometrics.IncLogLinesDropped(reason)
+}
+
+// GetLogs queries the sink. Lines still queued are not included.
+func (s *Shipper) GetLogs(functionID string, since time.Time, limit int) ([]LogEntry, error) {
+	return s.sink.GetLogs(functionID, since, limit)
+}
+
+// ShipperStats counts lines that were not shipped
+type ShipperStats struct {
+	Sampled uint64 // skipped by sampling while the queue was filling
+	Dropped uint64 // not queued: the queue was full or the shipper closed
+	Failed  uint64 // in batches the sink rejected after every attempt
+}
+
+// Stats returns the lines lost so far
+func (s *Shipper) Stats() ShipperStats {
+	return ShipperStats{Sampled: s.sampled.Load(), Dropped: s.dropped.Load(), Failed: s.failed.Load()}
+}
+
+// Close stops accepting lines, pushes what is queued and stops the shipper
+func (s *Shipper) Close() error {
+	s.closing.Do(func() {
+		s.closed.Store(true)
+		close(s.stop)
+	})
+	<-s.done
+	return nil
+}
+
+func (s *Shipper) run() {
+	defer close(s.done)
+	ticker := time.NewTicker(shipPoll)
+	defer ticker.Stop()
+
+	var batch []LogEntry
+	var bytes int
+	var oldest time.Time
+	for {
+		stopping := false
+		select {
+		case <-s.wake:
+		case <-ticker.C:
+		case <-s.stop:
+			stopping = true
+		}
+		for {
+			e, ok := s.queue.pop()
+			if !ok {
+				break
+			}
+			if len(batch) == 0 {
+				oldest = e.CreatedAt
+			}
+			batch = append(batch, e)
+			bytes += len(e.Message)
+			if bytes >= s.batchBytes {
+				s.push(batch)
+				batch, bytes = batch[:0], 0
+			}
+		}
+		if len(batch) > 0 && (stopping || time.Since(oldest) >= s.batchWait) {
+			s.push(batch)
+			batch, bytes = batch[:0], 0
+		}
+		if stopping {
+			return
+		}
+	}
+}
+
+// push sends a batch, retrying with backoff; the queue absorbs new lines
+// meanwhile
+func (s *Shipper) push(batch []LogEntry) {
+	backoff := pushRetryBackoff
+	for attempt := 1; ; attempt++ {
+		err := s.sink.Push(batch)
+		if err == nil {
+			prometrics.IncLogPush("ok")
+			return
+		}
+		prometrics.IncLogPush("error")
+		if attempt == maxPushAttempts {
+			s.failed.Add(uint64(len(batch)))
+			prometrics.AddLogLinesDropped("push_failed", len(batch))
+			s.logger.Warn("Dropped %d log lines after %d failed pushes: %v", len(batch), attempt, err)
+			return
+		}
+		select {
+		case <-time.After(backoff):
+		case <-s.stop:
+			// Shutting down: one last attempt without waiting
+			attempt = maxPushAttempts - 1
+		}
+		backoff *= 2
+	}
+}
+
+// nodeShippers holds the node's Shipper for each Loki URL, so the gateway and
+// the IPC handler share one pipeline
+var nodeShippers = struct {
+	sync.Mutex
+	byURL map[string]*Shipper
+}{byURL: make(map[string]*Shipper)}
+
+// NewNodeStore returns the node's log store: a Shipper to Loki when a Loki
+// URL is configured (cfg.LokiURL, else LOKI_URL), otherwise a NoopStore.
+// Callers asking for the same URL get the same Shipper until it is closed.
+func NewNodeStore(cfg *config.LogsConfig, log *logger.Logger) Store {
+	var shipCfg ShipperConfig
+	lokiURL := ""
+	if cfg != nil {
+		lokiURL = cfg.LokiURL
+		shipCfg = ShipperConfig{QueueSize: cfg.ShipQueueSize, BatchBytes: cfg.ShipBatchBytes, BatchWait: cfg.ShipBatchWait}
+	}
+	if lokiURL == "" {
+		lokiURL = os.Getenv("LOKI_URL")
+	}
+	if lokiURL == "" {
+		return &NoopStore{}
+	}
+
+	nodeShippers.Lock()
+	defer nodeShippers.Unlock()
+	if s := nodeShippers.byURL[lokiURL]; s != nil && !s.closed.Load() {
+		return s
+	}
+	s := NewShipper(NewLokiStore(lokiURL), shipCfg, log)
+	nodeShippers.byURL[lokiURL] = s
+	return s
+}
+
+// ring is a bounded multi-producer, single-consumer queue. Each slot carries
+// a sequence number: a producer claims the slot at head with a CAS and
+// publishes it by advancing its sequence; the consumer takes a slot once its
+// sequence shows it was published, then hands it back to the producers one
+// lap later.
+type ring struct {
+	slots []ringSlot
+	mask  uint64
+	head  atomic.Uint64 // next position to claim
+	tail  atomic.Uint64 // next position to consume
+}
+
+type ringSlot struct {
+	seq   atomic.Uint64
+	entry LogEntry
+}
+
+func newRing(size int) *ring {
+	n := 1
+	for n < size {
+		n <<= 1
+	}
+	r := &ring{slots: make([]ringSlot, n), mask: uint64(n - 1)}
+	for i := range r.slots {
+		r.slots[i].seq.Store(uint64(i))
+	}
+	return r
+}
+
+func (r *ring) size() int {
+	return len(r.slots)
+}
+
+// depth is the number of queued entries, possibly slightly stale
+func (r *ring) depth() int {
+	return int(r.head.Load() - r.tail.Load())
+}
+
+// push adds an entry, or reports false when the queue is full
+func (r *ring) push(e LogEntry) bool {
+	for {
+		pos := r.head.Load()
+		slot := &r.slots[pos&r.mask]
+		seq := slot.seq.Load()
+		switch {
+		case seq == pos:
+			if r.head.CompareAndSwap(pos, pos+1) {
+				slot.entry = e
+				slot.seq.Store(pos + 1)
+				return true
+			}
+		case seq < pos:
+			// Not yet consumed one lap ago
+			return false
+		}
+		// Another producer claimed pos; retry with the new head
+	}
+}
+
+// pop removes the oldest entry. Only one goroutine may pop.
+func (r *ring) pop() (LogEntry, bool) {
+	pos := r.tail.Load()
+	slot := &r.slots[pos&r.mask]
+	if slot.seq.Load() != pos+1 {
+		return LogEntry{}, false
+	}
+	e := slot.entry
+	slot.entry = LogEntry{}
+	r.tail.Store(pos + 1)
+	slot.seq.Store(pos + uint64(len(r.slots)))
+	return e, true
+}
@@ -0,0 +1,140 @@
+package logstore
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+// fakeLoki is a Loki stand-in that records push requests. Each push waits
+// for delay first, to play a slow sink.
+type fakeLoki struct {
+	*httptest.Server
+	mu     sync.Mutex
+	pushes []lokiPushRequest
+	delay  time.Duration
+}
+
+func newFakeLoki(t *testing.T, delay time.Duration) *fakeLoki {
+	f := &fakeLoki{delay: delay}
+	f.Server = httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		if r.URL.Path != "/loki/api/v1/push" {
+			http.NotFound(w, r)
+			return
+		}
+		var req lokiPushRequest
+		if err := json.NewDecoder(r.Body).Decode(&req); err != nil {
+			http.Error(w, err.Error(), http.StatusBadRequest)
+			return
+		}
+		time.Sleep(f.delay)
+		f.mu.Lock()
+		f.pushes = append(f.pushes, req)
+		f.mu.Unlock()
+		w.WriteHeader(http.StatusNoContent)
+	}))
+	t.Cleanup(f.Close)
+	return f
+}
+
+// lines returns the pushed messages per stream, keyed function/level/invocation
+func (f *fakeLoki) lines() (map[string][]string, int) {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+	out := make(map[string][]string)
+	for _, p := range f.pushes {
+		for _, s := range p.Streams {
+			key := s.Stream["function_id"] + "/" + s.Stream["level"] + "/" + s.Stream["invocation_id"]
+			for _, v := range s.Values {
+				out[key] = append(out[key], v[1])
+			}
+		}
+	}
+	return out, len(f.pushes)
+}
+
+func testLogger() *logger.Logger {
+	return logger.New(io.Discard, logger.LevelError, "")
+}
+
+func TestShipperBatchesByStream(t *testing.T) {
+	loki := newFakeLoki(t, 0)
+	s := NewShipper(NewLokiStore(loki.URL), ShipperConfig{BatchWait: time.Hour}, testLogger())
+
+	for i := 0; i < 500; i++ {
+		s.Append("fn-a", "inv-1", "info", fmt.Sprintf("a%d", i))
+		s.Append("fn-b", "inv-2", "error", fmt.Sprintf("b%d", i))
+	}
+	s.Close()
+
+	streams, pushes := loki.lines()
+	if pushes != 1 {
+		t.Errorf("pushes = %d, want one batch", pushes)
+	}
+	a, b := streams["fn-a/info/inv-1"], streams["fn-b/error/inv-2"]
+	if len(streams) != 2 || len(a) != 500 || len(b) != 500 {
+		t.Fatalf("streams: %d, fn-a %d lines, fn-b %d lines", len(streams), len(a), len(b))
+	}
+	for i := range a {
+		if a[i] != fmt.Sprintf("a%d", i) {
+			t.Fatalf("fn-a line %d = %q, out of order", i, a[i])
+		}
+	}
+	if st := s.Stats(); st != (ShipperStats{}) {
+		t.Errorf("lost lines: %+v", st)
+	}
+}
+
+func TestShipperNeverBlocksOnSlowSink(t *testing.T) {
+	loki := newFakeLoki(t, 200*time.Millisecond)
+	s := NewShipper(NewLokiStore(loki.URL), ShipperConfig{QueueSize: 256, BatchBytes: 1024, BatchWait: time.Millisecond}, testLogger())
+	defer s.Close()
+
+	const n = 20000
+	start := time.Now()
+	for i := 0; i < n; i++ {
+		s.Append("fn", "inv", "info", "a chatty line")
+	}
+	if elapsed := time.Since(start); elapsed > 100*time.Millisecond {
+		t.Errorf("%d appends took %v with a slow sink", n, elapsed)
+	}
+	st := s.Stats()
+	if st.Sampled == 0 || st.Dropped == 0 {
+		t.Errorf("expected sampled and dropped lines with a full queue: %+v", st)
+	}
+	// Errors are not sampled: they are only dropped once the queue is full
+	before := st.Sampled
+	s.Append("fn", "inv", "error", "boom")
+	if s.Stats().Sampled != before {
+		t.Error("error line was sampled")
+	}
+}
+
+func TestRingWrapsAround(t *testing.T) {
+	r := newRing(4)
+	for lap := 0; lap < 3; lap++ {
+		for i := 0; i < 4; i++ {
+			if !r.push(LogEntry{Message: fmt.Sprint(lap, i)}) {
+				t.Fatalf("lap %d: push %d failed", lap, i)
+			}
+		}
+		if r.push(LogEntry{}) {
+			t.Fatalf("lap %d: push into a full ring succeeded", lap)
+		}
+		for i := 0; i < 4; i++ {
+			if e, ok := r.pop(); !ok || e.Message != fmt.Sprint(lap, i) {
+				t.Fatalf("lap %d: pop %d = %q %v", lap, i, e.Message, ok)
+			}
+		}
+		if _, ok := r.pop(); ok {
+			t.Fatalf("lap %d: pop from an empty ring succeeded", lap)
+		}
+	}
+}
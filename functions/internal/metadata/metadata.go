@@ -4,6 +4,7 @@ import (
 	"database/sql"
 	"encoding/json"
 	"fmt"
+	"sync"
 	"time"
 
 	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
@@ -52,7 +53,9 @@ type FunctionDeployment struct {
 
 // Store manages function metadata in SQLite
 type Store struct {
-	db *sql.DB
+	db       *sql.DB
+	mu       sync.Mutex
+	onChange []func(functionID string)
 }
 
 // NewStore creates a new metadata store
@@ -71,6 +74,24 @@ func NewStore(dbPath string) (*Store, error) {
 	return store, nil
 }
 
+// OnChange registers fn to be called after a function's row changes: it was
+// registered, deployed, or had its capabilities updated. fn runs on the
+// goroutine that made the change, after it was committed.
+func (s *Store) OnChange(fn func(functionID string)) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.onChange = append(s.onChange, fn)
+}
+
+func (s *Store) changed(functionID string) {
+	s.mu.Lock()
+	watchers := s.onChange
+	s.mu.Unlock()
+	for _, fn := range watchers {
+		fn(functionID)
+	}
+}
+
 // initSchema creates the database schema
 func (s *Store) initSchema() error {
 	schema := `
@@ -131,6 +152,7 @@ func (s *Store) RegisterFunction(id, name, runtime, handler string, caps *capabi
 	if err != nil {
 		return nil, fmt.Errorf("failed to register function: %w", err)
 	}
+	s.changed(id)
 
 	return s.GetFunctionByID(id)
 }
@@ -346,6 +368,7 @@ func (s *Store) DeployFunction(deploymentID, functionID, versionID string) error
 	if err := tx.Commit(); err != nil {
 		return fmt.Errorf("failed to commit transaction: %w", err)
 	}
+	s.changed(functionID)
 
 	return nil
 }
@@ -416,5 +439,6 @@ func (s *Store) UpdateFunctionCapabilities(functionID string, caps *capabilities
 	if err != nil {
 		return fmt.Errorf("failed to update capabilities: %w", err)
 	}
+	s.changed(functionID)
 	return nil
 }
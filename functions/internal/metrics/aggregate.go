@@ -0,0 +1,122 @@
+package metrics
+
+import (
+	"hash/fnv"
+	"sync"
+	"time"
+)
+
+// durationBounds are the upper bounds, in milliseconds, of the duration
+// histogram buckets. The last bucket holds everything slower.
+var durationBounds = [...]int64{
+	1, 2, 3, 5, 7, 10, 15, 20, 30, 50, 75, 100, 150, 200, 300, 500, 750,
+	1000, 1500, 2000, 3000, 5000, 7500, 10000, 15000, 20000, 30000, 60000,
+}
+
+const numBuckets = len(durationBounds) + 1
+
+// numShards stripes the in-memory aggregates so that invocations of
+// different functions rarely contend
+const numShards = 16
+
+// aggKey identifies an aggregate: a function's minute, or its day when
+// aggregates are merged for the daily table. start is Unix seconds.
+type aggKey struct {
+	functionID string
+	start      int64
+}
+
+// aggregate is the invocations of one function in one period
+type aggregate struct {
+	invocations int64
+	errors      int64
+	totalMS     int64
+	coldStarts  int64
+	last        time.Time
+	buckets     [numBuckets]int64
+}
+
+type shard struct {
+	mu   sync.Mutex
+	aggs map[aggKey]*aggregate
+}
+
+func shardFor(functionID string) int {
+	h := fnv.New32a()
+	h.Write([]byte(functionID))
+	return int(h.Sum32() % numShards)
+}
+
+// bucketFor returns the histogram bucket of a duration in milliseconds
+func bucketFor(ms int64) int {
+	lo, hi := 0, len(durationBounds)
+	for lo < hi {
+		mid := (lo + hi) / 2
+		if ms <= durationBounds[mid] {
+			hi = mid
+		} else {
+			lo = mid + 1
+		}
+	}
+	return lo
+}
+
+func (a *aggregate) record(d time.Duration, isError, isColdStart bool, now time.Time) {
+	ms := int64(d / time.Millisecond)
+	a.invocations++
+	a.totalMS += ms
+	if isError {
+		a.errors++
+	}
+	if isColdStart {
+		a.coldStarts++
+	}
+	a.buckets[bucketFor(ms)]++
+	if now.After(a.last) {
+		a.last = now
+	}
+}
+
+func (a *aggregate) merge(o *aggregate) {
+	a.invocations += o.invocations
+	a.errors += o.errors
+	a.totalMS += o.totalMS
+	a.coldStarts += o.coldStarts
+	for i, n := range o.buckets {
+		a.buckets[i] += n
+	}
+	if o.last.After(a.last) {
+		a.last = o.last
+	}
+}
+
+// percentile estimates the q-quantile (0 < q <= 1) of the durations in
+// milliseconds by interpolating linearly inside the bucket it falls in. The
+// open last bucket reports its lower bound.
+func percentile(buckets *[numBuckets]int64, q float64) int64 {
+	var total int64
+	for _, n := range buckets {
+		total += n
+	}
+	if total == 0 {
+		return 0
+	}
+	rank := q * float64(total)
+	var seen int64
+	for i, n := range buckets {
+		if n == 0 || float64(seen+n) < rank {
+			seen += n
+			continue
+		}
+		if i == len(durationBounds) {
+			return durationBounds[i-1]
+		}
+		var lower int64
+		if i > 0 {
+			lower = durationBounds[i-1]
+		}
+		frac := (rank - float64(seen)) / float64(n)
+		return lower + int64(frac*float64(durationBounds[i]-lower))
+	}
+	return durationBounds[len(durationBounds)-1]
+}
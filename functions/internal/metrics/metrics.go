@@ -11,31 +11,54 @@ import (
 
 // Metrics represents function execution metrics
 type Metrics struct {
-	FunctionID      string
-	Invocations     int64
-	Errors          int64
-	TotalDuration   int64 // milliseconds
-	ColdStarts      int64
-	LastInvoked     *time.Time
+	FunctionID    string
+	Invocations   int64
+	Errors        int64
+	TotalDuration int64 // milliseconds
+	ColdStarts    int64
+	LastInvoked   *time.Time
+	P50Duration   int64 // milliseconds, estimated from the duration histogram
+	P95Duration   int64
+	P99Duration   int64
 }
 
-// Store manages metrics storage
+// DefaultFlushInterval is how often recorded invocations are written out
+const DefaultFlushInterval = 10 * time.Second
+
+// Store manages metrics storage. Invocations are aggregated in memory per
+// function and minute, in lock-striped shards, and written to SQLite in one
+// transaction every flush interval. GetMetrics merges what has not been
+// written yet.
 type Store struct {
-	db    *sql.DB
-	mu    sync.Mutex
-	cache map[string]*Metrics // functionID -> metrics
+	db            *sql.DB
+	shards        [numShards]shard
+	flushMu       sync.RWMutex // held by Flush; readers see aggregates either in memory or in the database
+	flushInterval time.Duration
+	stop          chan struct{}
+	flushDone     chan struct{}
+	closeOnce     sync.Once
 }
 
-// NewStore creates a new metrics store
+// NewStore creates a new metrics store that flushes every DefaultFlushInterval
 func NewStore(dbPath string) (*Store, error) {
+	return NewStoreWithInterval(dbPath, DefaultFlushInterval)
+}
+
+// NewStoreWithInterval creates a new metrics store that flushes every interval
+func NewStoreWithInterval(dbPath string, interval time.Duration) (*Store, error) {
 	db, err := sql.Open("sqlite3", dbPath+"?_journal_mode=WAL")
 	if err != nil {
 		return nil, fmt.Errorf("failed to open database: %w", err)
 	}
 
 	store := &Store{
-		db:    db,
-		cache: make(map[string]*Metrics),
+		db:            db,
+		flushInterval: interval,
+		stop:          make(chan struct{}),
+		flushDone:     make(chan struct{}),
+	}
+	for i := range store.shards {
+		store.shards[i].aggs = make(map[aggKey]*aggregate)
 	}
 
 	if err := store.initSchema(); err != nil {
@@ -43,6 +66,7 @@ func NewStore(dbPath string) (*Store, error) {
 		return nil, fmt.Errorf("failed to initialize schema: %w", err)
 	}
 
+	go store.flushLoop()
 	return store, nil
 }
 
@@ -71,6 +95,14 @@ func (s *Store) initSchema() error {
 		UNIQUE(function_id, timestamp)
 	);
 
+	CREATE TABLE IF NOT EXISTS function_duration_buckets (
+		function_id TEXT NOT NULL,
+		timestamp INTEGER NOT NULL,
+		bucket INTEGER NOT NULL,
+		count INTEGER NOT NULL DEFAULT 0,
+		UNIQUE(function_id, timestamp, bucket)
+	);
+
 	CREATE INDEX IF NOT EXISTS idx_metrics_function_id ON function_metrics(function_id);
 	CREATE INDEX IF NOT EXISTS idx_metrics_date ON function_metrics(date);
 	CREATE INDEX IF NOT EXISTS idx_metrics_minute_function_id ON function_metrics_minute(function_id);
@@ -84,66 +116,173 @@ func (s *Store) initSchema() error {
 	return nil
 }
 
-// RecordInvocation records an invocation
+// RecordInvocation records an invocation. It only updates the in-memory
+// aggregate of the function's current minute; the flusher writes it out.
 func (s *Store) RecordInvocation(functionID string, duration time.Duration, isError, isColdStart bool) error {
-	s.mu.Lock()
-	defer s.mu.Unlock()
-
-	durationMS := int64(duration / time.Millisecond)
 	now := time.Now()
+	minute := now.Truncate(time.Minute).Unix()
+	sh := &s.shards[shardFor(functionID)]
+
+	sh.mu.Lock()
+	a := sh.aggs[aggKey{functionID, minute}]
+	if a == nil {
+		a = &aggregate{}
+		sh.aggs[aggKey{functionID, minute}] = a
+	}
+	a.record(duration, isError, isColdStart, now)
+	sh.mu.Unlock()
+	return nil
+}
 
-	// Update daily metrics
-	today := time.Date(now.Year(), now.Month(), now.Day(), 0, 0, 0, 0, now.Location())
-	todayUnix := today.Unix()
-
-	query := `
-		INSERT INTO function_metrics (id, function_id, date, invocations, errors, total_duration, cold_starts)
-		VALUES (?, ?, ?, 1, ?, ?, ?)
-		ON CONFLICT(function_id, date) DO UPDATE SET
-			invocations = invocations + 1,
-			errors = errors + ?,
-			total_duration = total_duration + ?,
-			cold_starts = cold_starts + ?
-	`
+// flushLoop writes the aggregates out every flushInterval until Close
+func (s *Store) flushLoop() {
+	defer close(s.flushDone)
+	ticker := time.NewTicker(s.flushInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			_ = s.Flush()
+		case <-s.stop:
+			return
+		}
+	}
+}
 
-	id := fmt.Sprintf("%s-%d", functionID, todayUnix)
-	errors := int64(0)
-	coldStarts := int64(0)
-	if isError {
-		errors = 1
+// Flush writes the aggregates recorded since the last flush to the database
+// in one transaction. On failure they are kept for the next flush.
+func (s *Store) Flush() error {
+	s.flushMu.Lock()
+	defer s.flushMu.Unlock()
+
+	batch := make(map[aggKey]*aggregate)
+	for i := range s.shards {
+		sh := &s.shards[i]
+		sh.mu.Lock()
+		aggs := sh.aggs
+		sh.aggs = make(map[aggKey]*aggregate, len(aggs))
+		sh.mu.Unlock()
+		for k, a := range aggs {
+			batch[k] = a
+		}
 	}
-	if isColdStart {
-		coldStarts = 1
+	if len(batch) == 0 {
+		return nil
 	}
+	if err := s.write(batch); err != nil {
+		for k, a := range batch {
+			sh := &s.shards[shardFor(k.functionID)]
+			sh.mu.Lock()
+			if cur := sh.aggs[k]; cur != nil {
+				cur.merge(a)
+			} else {
+				sh.aggs[k] = a
+			}
+			sh.mu.Unlock()
+		}
+		return err
+	}
+	return nil
+}
 
-	_, err := s.db.Exec(query, id, functionID, todayUnix, errors, durationMS, coldStarts, errors, durationMS, coldStarts)
-	if err != nil {
-		return fmt.Errorf("failed to record daily metrics: %w", err)
+// write upserts a batch of minute aggregates, the days they fall in and
+// their duration buckets
+func (s *Store) write(batch map[aggKey]*aggregate) error {
+	days := make(map[aggKey]*aggregate)
+	for k, a := range batch {
+		t := time.Unix(k.start, 0)
+		day := time.Date(t.Year(), t.Month(), t.Day(), 0, 0, 0, 0, t.Location()).Unix()
+		dk := aggKey{k.functionID, day}
+		if days[dk] == nil {
+			days[dk] = &aggregate{}
+		}
+		days[dk].merge(a)
 	}
 
-	// Update minute-level metrics
-	minuteTimestamp := time.Date(now.Year(), now.Month(), now.Day(), now.Hour(), now.Minute(), 0, 0, now.Location())
-	minuteUnix := minuteTimestamp.Unix()
+	tx, err := s.db.Begin()
+	if err != nil {
+		return fmt.Errorf("failed to begin metrics flush: %w", err)
+	}
+	defer tx.Rollback()
 
-	queryMinute := `
+	dayStmt, err := tx.Prepare(`
+		INSERT INTO function_metrics (id, function_id, date, invocations, errors, total_duration, cold_starts)
+		VALUES (?, ?, ?, ?, ?, ?, ?)
+		ON CONFLICT(function_id, date) DO UPDATE SET
+			invocations = invocations + excluded.invocations,
+			errors = errors + excluded.errors,
+			total_duration = total_duration + excluded.total_duration,
+			cold_starts = cold_starts + excluded.cold_starts
+	`)
+	if err != nil {
+		return fmt.Errorf("failed to prepare daily metrics: %w", err)
+	}
+	defer dayStmt.Close()
+	minuteStmt, err := tx.Prepare(`
 		INSERT INTO function_metrics_minute (id, function_id, timestamp, invocations, errors, total_duration, cold_starts)
-		VALUES (?, ?, ?, 1, ?, ?, ?)
+		VALUES (?, ?, ?, ?, ?, ?, ?)
 		ON CONFLICT(function_id, timestamp) DO UPDATE SET
-			invocations = invocations + 1,
-			errors = errors + ?,
-			total_duration = total_duration + ?,
-			cold_starts = cold_starts + ?
-	`
-
-	idMinute := fmt.Sprintf("%s-%d", functionID, minuteUnix)
-	_, err = s.db.Exec(queryMinute, idMinute, functionID, minuteUnix, errors, durationMS, coldStarts, errors, durationMS, coldStarts)
+			invocations = invocations + excluded.invocations,
+			errors = errors + excluded.errors,
+			total_duration = total_duration + excluded.total_duration,
+			cold_starts = cold_starts + excluded.cold_starts
+	`)
+	if err != nil {
+		return fmt.Errorf("failed to prepare minute metrics: %w", err)
+	}
+	defer minuteStmt.Close()
+	bucketStmt, err := tx.Prepare(`
+		INSERT INTO function_duration_buckets (function_id, timestamp, bucket, count)
+		VALUES (?, ?, ?, ?)
+		ON CONFLICT(function_id, timestamp, bucket) DO UPDATE SET
+			count = count + excluded.count
+	`)
 	if err != nil {
-		return fmt.Errorf("failed to record minute metrics: %w", err)
+		return fmt.Errorf("failed to prepare duration buckets: %w", err)
 	}
+	defer bucketStmt.Close()
 
+	for k, a := range days {
+		id := fmt.Sprintf("%s-%d", k.functionID, k.start)
+		if _, err := dayStmt.Exec(id, k.functionID, k.start, a.invocations, a.errors, a.totalMS, a.coldStarts); err != nil {
+			return fmt.Errorf("failed to record daily metrics: %w", err)
+		}
+	}
+	for k, a := range batch {
+		id := fmt.Sprintf("%s-%d", k.functionID, k.start)
+		if _, err := minuteStmt.Exec(id, k.functionID, k.start, a.invocations, a.errors, a.totalMS, a.coldStarts); err != nil {
+			return fmt.Errorf("failed to record minute metrics: %w", err)
+		}
+		for b, n := range a.buckets {
+			if n == 0 {
+				continue
+			}
+			if _, err := bucketStmt.Exec(k.functionID, k.start, b, n); err != nil {
+				return fmt.Errorf("failed to record duration buckets: %w", err)
+			}
+		}
+	}
+
+	if err := tx.Commit(); err != nil {
+		return fmt.Errorf("failed to commit metrics flush: %w", err)
+	}
 	return nil
 }
 
+// pending merges the unflushed aggregates of functionID from minute since on
+func (s *Store) pending(functionID string, since int64) *aggregate {
+	total := &aggregate{}
+	sh := &s.shards[shardFor(functionID)]
+	sh.mu.Lock()
+	defer sh.mu.Unlock()
+	for k, a := range sh.aggs {
+		if k.functionID == functionID && k.start >= since {
+			total.merge(a)
+		}
+	}
+	return total
+}
+
 // GetMetrics retrieves metrics for a function
 type MetricsPeriod string
 
@@ -153,18 +292,21 @@ const (
 	MetricsPeriodDay    MetricsPeriod = "day"
 )
 
-// GetMetrics retrieves metrics for a function
+// GetMetrics retrieves metrics for a function, including invocations that
+// have not been flushed yet
 func (s *Store) GetMetrics(functionID string, period MetricsPeriod) (*Metrics, error) {
-	s.mu.Lock()
-	defer s.mu.Unlock()
+	s.flushMu.RLock()
+	defer s.flushMu.RUnlock()
 
 	var query string
 	var args []interface{}
+	var since int64
 
+	now := time.Now()
 	switch period {
 	case MetricsPeriodMinute:
 		// Get last hour of minute-level metrics
-		oneHourAgo := time.Now().Add(-1 * time.Hour).Unix()
+		since = now.Add(-1 * time.Hour).Unix()
 		query = `
 			SELECT 
 				SUM(invocations) as invocations,
@@ -175,11 +317,10 @@ func (s *Store) GetMetrics(functionID string, period MetricsPeriod) (*Metrics, e
 			FROM function_metrics_minute
 			WHERE function_id = ? AND timestamp >= ?
 		`
-		args = []interface{}{functionID, oneHourAgo}
+		args = []interface{}{functionID, since}
 	case MetricsPeriodDay:
 		// Get today's metrics
-		today := time.Date(time.Now().Year(), time.Now().Month(), time.Now().Day(), 0, 0, 0, 0, time.Now().Location())
-		todayUnix := today.Unix()
+		since = time.Date(now.Year(), now.Month(), now.Day(), 0, 0, 0, 0, now.Location()).Unix()
 		query = `
 			SELECT 
 				invocations,
@@ -190,14 +331,13 @@ func (s *Store) GetMetrics(functionID string, period MetricsPeriod) (*Metrics, e
 			FROM function_metrics
 			WHERE function_id = ? AND date = ?
 		`
-		args = []interface{}{functionID, todayUnix}
+		args = []interface{}{functionID, since}
 	default:
 		return nil, fmt.Errorf("unsupported period: %s", period)
 	}
 
-	var m Metrics
-	var lastInvokedUnix int64
-	var invocations, errors, totalDuration, coldStarts sql.NullInt64
+	m := Metrics{FunctionID: functionID}
+	var invocations, errors, totalDuration, coldStarts, lastInvokedUnix sql.NullInt64
 
 	err := s.db.QueryRow(query, args...).Scan(
 		&invocations,
@@ -206,22 +346,10 @@ func (s *Store) GetMetrics(functionID string, period MetricsPeriod) (*Metrics, e
 		&coldStarts,
 		&lastInvokedUnix,
 	)
-	if err != nil {
-		if err == sql.ErrNoRows {
-			// Return zero metrics
-			return &Metrics{
-				FunctionID:  functionID,
-				Invocations: 0,
-				Errors:      0,
-				TotalDuration: 0,
-				ColdStarts:  0,
-				LastInvoked: nil,
-			}, nil
-		}
+	if err != nil && err != sql.ErrNoRows {
 		return nil, fmt.Errorf("failed to get metrics: %w", err)
 	}
 
-	m.FunctionID = functionID
 	if invocations.Valid {
 		m.Invocations = invocations.Int64
 	}
@@ -234,15 +362,62 @@ func (s *Store) GetMetrics(functionID string, period MetricsPeriod) (*Metrics, e
 	if coldStarts.Valid {
 		m.ColdStarts = coldStarts.Int64
 	}
-	if lastInvokedUnix > 0 {
-		t := time.Unix(lastInvokedUnix, 0)
+	if lastInvokedUnix.Valid && lastInvokedUnix.Int64 > 0 {
+		t := time.Unix(lastInvokedUnix.Int64, 0)
 		m.LastInvoked = &t
 	}
 
+	unflushed := s.pending(functionID, since)
+	m.Invocations += unflushed.invocations
+	m.Errors += unflushed.errors
+	m.TotalDuration += unflushed.totalMS
+	m.ColdStarts += unflushed.coldStarts
+	if !unflushed.last.IsZero() && (m.LastInvoked == nil || unflushed.last.After(*m.LastInvoked)) {
+		last := unflushed.last
+		m.LastInvoked = &last
+	}
+
+	buckets := unflushed.buckets
+	rows, err := s.db.Query(`
+		SELECT bucket, SUM(count)
+		FROM function_duration_buckets
+		WHERE function_id = ? AND timestamp >= ?
+		GROUP BY bucket
+	`, functionID, since)
+	if err != nil {
+		return nil, fmt.Errorf("failed to get duration buckets: %w", err)
+	}
+	defer rows.Close()
+	for rows.Next() {
+		var bucket int
+		var count int64
+		if err := rows.Scan(&bucket, &count); err != nil {
+			return nil, fmt.Errorf("failed to get duration buckets: %w", err)
+		}
+		if bucket >= 0 && bucket < numBuckets {
+			buckets[bucket] += count
+		}
+	}
+	if err := rows.Err(); err != nil {
+		return nil, fmt.Errorf("failed to get duration buckets: %w", err)
+	}
+	m.P50Duration = percentile(&buckets, 0.50)
+	m.P95Duration = percentile(&buckets, 0.95)
+	m.P99Duration = percentile(&buckets, 0.99)
+
 	return &m, nil
 }
 
-// Close closes the metrics store
+// Close flushes what has not been written yet and closes the metrics store
 func (s *Store) Close() error {
-	return s.db.Close()
+	var err error
+	s.closeOnce.Do(func() {
+		close(s.stop)
+		<-s.flushDone
+		err = s.Flush()
+		if cerr := s.db.Close(); err == nil {
+			err = cerr
+		}
+	})
+	return err
 }
@@ -0,0 +1,63 @@
+package metrics
+
+import (
+	"fmt"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestPercentileInterpolatesWithinBuckets(t *testing.T) {
+	var buckets [numBuckets]int64
+	for ms := int64(1); ms <= 100; ms++ {
+		buckets[bucketFor(ms)]++
+	}
+	for _, tc := range []struct {
+		q        float64
+		min, max int64
+	}{
+		{0.50, 45, 55},
+		{0.95, 90, 100},
+		{0.99, 95, 100},
+	} {
+		if got := percentile(&buckets, tc.q); got < tc.min || got > tc.max {
+			t.Errorf("p%v = %dms, want %d-%dms", tc.q*100, got, tc.min, tc.max)
+		}
+	}
+
+	var slow [numBuckets]int64
+	slow[bucketFor(120000)] = 3
+	if got := percentile(&slow, 0.99); got != 60000 {
+		t.Errorf("p99 of the open bucket = %dms, want its lower bound 60000", got)
+	}
+}
+
+func TestRecordInvocationAggregatesPerFunctionAndMinute(t *testing.T) {
+	s := &Store{}
+	for i := range s.shards {
+		s.shards[i].aggs = make(map[aggKey]*aggregate)
+	}
+
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < 1000; i++ {
+				_ = s.RecordInvocation(fmt.Sprintf("fn-%d", g%2), 20*time.Millisecond, i%10 == 0, i == 0)
+			}
+		}(g)
+	}
+	wg.Wait()
+
+	since := time.Now().Add(-time.Hour).Unix()
+	for _, fn := range []string{"fn-0", "fn-1"} {
+		a := s.pending(fn, since)
+		if a.invocations != 4000 || a.errors != 400 || a.coldStarts != 4 || a.totalMS != 80000 {
+			t.Errorf("%s: %+v", fn, a)
+		}
+		if p := percentile(&a.buckets, 0.5); p <= 15 || p > 20 {
+			t.Errorf("%s: p50 = %dms, want in the 15-20ms bucket", fn, p)
+		}
+	}
+}
@@ -0,0 +1,146 @@
+package pool
+
+import (
+	"math"
+	"time"
+)
+
+const (
+	// Holt double exponential smoothing factors for the arrival rate
+	rateAlpha = 0.5 // level
+	rateBeta  = 0.3 // trend
+
+	// latencyAlpha smooths spawn latency and service time
+	latencyAlpha = 0.2
+
+	// defaultSpawnLatency is assumed until the first spawn has been timed
+	defaultSpawnLatency = 200 * time.Millisecond
+)
+
+// autoscaler estimates a pool's demand and derives how many workers it should
+// keep alive. It sees every Acquire and is ticked once per interval by the
+// pool. All fields are guarded by the pool's mu.
+type autoscaler struct {
+	interval       time.Duration
+	scaleDownDelay time.Duration
+
+	arrivals int // Acquire calls since the last tick, served or not
+	peakBusy int // highest busy count since the last tick
+
+	level  float64 // smoothed arrival rate, req/s
+	trend  float64 // smoothed change of the rate per tick
+	ticks  int
+	spawn  time.Duration // EWMA spawn latency
+	timed  bool          // spawn has been measured at least once
+	target int           // workers to keep alive (warm + busy)
+	// lowSince is when demand first dropped below target; zero while it has not
+	lowSince time.Time
+}
+
+// scaleDecision is the outcome of one tick
+type scaleDecision struct {
+	Target       int
+	Previous     int
+	ArrivalRate  float64 // smoothed, req/s
+	ForecastRate float64 // predicted rate one spawn latency ahead
+	SpawnLatency time.Duration
+	ServiceTime  time.Duration
+}
+
+func newAutoscaler(interval, scaleDownDelay time.Duration, floor int) *autoscaler {
+	if interval <= 0 {
+		interval = time.Second
+	}
+	return &autoscaler{
+		interval:       interval,
+		scaleDownDelay: scaleDownDelay,
+		spawn:          defaultSpawnLatency,
+		target:         floor,
+	}
+}
+
+// observeArrival counts an Acquire call when it starts, so callers that are
+// rejected, cancel, or are still waiting at the tick count towards demand
+func (a *autoscaler) observeArrival() {
+	a.arrivals++
+}
+
+// observeBusy records the busy count after a caller got a worker
+func (a *autoscaler) observeBusy(busy int) {
+	if busy > a.peakBusy {
+		a.peakBusy = busy
+	}
+}
+
+func (a *autoscaler) observeSpawn(d time.Duration) {
+	if !a.timed {
+		a.spawn = d
+		a.timed = true
+		return
+	}
+	a.spawn = ewma(a.spawn, d)
+}
+
+// tick folds the last interval's arrivals into the rate estimate and returns
+// the new target: the forecast arrival rate times the time a request occupies
+// a worker (svc, the pool's service time) plus the time it takes to get a new
+// one, so that requests arriving while a replacement spawns still find a warm
+// worker. The target never drops below the peak concurrency just observed, is
+// clamped to [minWorkers, maxWorkers], and only decreases after demand has
+// stayed lower for scaleDownDelay.
+func (a *autoscaler) tick(now time.Time, busy int, svc time.Duration, minWorkers, maxWorkers int) scaleDecision {
+	rate := float64(a.arrivals) / a.interval.Seconds()
+	if a.ticks == 0 {
+		a.level = rate
+	} else {
+		prev := a.level
+		a.level = rateAlpha*rate + (1-rateAlpha)*(a.level+a.trend)
+		a.trend = rateBeta*(a.level-prev) + (1-rateBeta)*a.trend
+	}
+	a.ticks++
+
+	// Look one spawn latency ahead: that is how early a worker must be started
+	horizon := float64(a.spawn) / float64(a.interval)
+	forecast := math.Max(a.level+a.trend*horizon, 0)
+
+	desired := int(math.Ceil(forecast * (a.spawn + svc).Seconds()))
+	if a.peakBusy > desired {
+		desired = a.peakBusy
+	}
+	if desired < minWorkers {
+		desired = minWorkers
+	}
+	if desired > maxWorkers {
+		desired = maxWorkers
+	}
+
+	d := scaleDecision{
+		Previous:     a.target,
+		ArrivalRate:  a.level,
+		ForecastRate: forecast,
+		SpawnLatency: a.spawn,
+		ServiceTime:  svc,
+	}
+	switch {
+	case desired >= a.target:
+		a.target = desired
+		a.lowSince = time.Time{}
+	case a.lowSince.IsZero():
+		a.lowSince = now
+	case now.Sub(a.lowSince) >= a.scaleDownDelay:
+		a.target = desired
+		a.lowSince = time.Time{}
+	}
+	d.Target = a.target
+
+	a.arrivals = 0
+	a.peakBusy = busy
+	return d
+}
+
+func ewma(avg, sample time.Duration) time.Duration {
+	if avg == 0 {
+		return sample
+	}
+	return time.Duration(latencyAlpha*float64(sample) + (1-latencyAlpha)*float64(avg))
+}
@@ -0,0 +1,57 @@
+package pool
+
+import (
+	"testing"
+	"time"
+)
+
+func TestAutoscalerFollowsDemand(t *testing.T) {
+	a := newAutoscaler(time.Second, 3*time.Second, 1)
+	a.observeSpawn(500 * time.Millisecond)
+	now := time.Unix(0, 0)
+
+	// Each invocation holds a worker for 100ms
+	simulate := func(rate int) scaleDecision {
+		for i := 0; i < rate; i++ {
+			a.observeArrival()
+			a.observeBusy(1)
+		}
+		now = now.Add(time.Second)
+		return a.tick(now, 0, 100*time.Millisecond, 1, 50)
+	}
+
+	var d scaleDecision
+	for i := 0; i < 5; i++ {
+		d = simulate(20)
+	}
+	// 20 req/s * (500ms spawn + 100ms service) = 12 workers
+	if d.Target < 11 || d.Target > 14 {
+		t.Fatalf("steady 20 req/s: target = %d (rate %.1f, forecast %.1f), want ~12", d.Target, d.ArrivalRate, d.ForecastRate)
+	}
+
+	// A ramp is anticipated: the forecast runs ahead of the smoothed rate
+	d = simulate(40)
+	if d.ForecastRate <= d.ArrivalRate || d.Target <= 12 {
+		t.Fatalf("ramp: forecast %.1f, rate %.1f, target %d", d.ForecastRate, d.ArrivalRate, d.Target)
+	}
+	peak := d.Target
+
+	// When traffic stops the target holds for the scale-down delay, then drops to the floor
+	if d = simulate(0); d.Target != peak {
+		t.Fatalf("target dropped immediately: %d, want %d", d.Target, peak)
+	}
+	for i := 0; i < 4; i++ {
+		d = simulate(0)
+	}
+	if d.Target != 1 {
+		t.Fatalf("idle: target = %d, want floor 1", d.Target)
+	}
+
+	// Clamped to the pool's max
+	for i := 0; i < 5; i++ {
+		d = simulate(1000)
+	}
+	if d.Target != 50 {
+		t.Fatalf("overload: target = %d, want max 50", d.Target)
+	}
+}
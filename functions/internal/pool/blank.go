@@ -0,0 +1,179 @@
+package pool
+
+import (
+	"context"
+	"sync"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+// BlankPool keeps a few QuickJS workers started without a bundle, shared by
+// every function on the node. A pool's cold miss takes one and loads its
+// bundle into it, so the miss pays for the bundle load but not for process
+// start and runtime initialization. Taken workers are replaced in the
+// background. Blank workers are not counted against the node Budget until
+// they are bound to a function.
+type BlankPool struct {
+	size   int
+	cfg    *config.WorkerConfig
+	logger *logger.Logger
+
+	mu        sync.Mutex
+	ready     []worker.Worker
+	spawning  int
+	stopped   bool
+	newWorker func() worker.Worker // tests only; overrides NewBlankQuickJSWorker
+}
+
+// BlankPoolStats is a snapshot of the blank pool
+type BlankPoolStats struct {
+	Size     int
+	Ready    int
+	Spawning int
+}
+
+// NewBlankPool returns nil when cfg.BlankWorkers is 0. The pool fills right
+// away when QuickJS is the default runtime and on first use otherwise.
+func NewBlankPool(cfg *config.WorkerConfig, log *logger.Logger) *BlankPool {
+	if cfg.BlankWorkers <= 0 {
+		return nil
+	}
+	b := &BlankPool{size: cfg.BlankWorkers, cfg: cfg, logger: log}
+	if cfg.Runtime == "quickjs" || cfg.Runtime == "quickjs-ng" {
+		b.mu.Lock()
+		b.fillLocked()
+		b.mu.Unlock()
+	}
+	return b
+}
+
+// take returns a ready blank worker, or nil when none is ready, and starts
+// replacements for what has been taken
+func (b *BlankPool) take() worker.Worker {
+	if b == nil {
+		return nil
+	}
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	var w worker.Worker
+	for w == nil && len(b.ready) > 0 {
+		w = b.ready[0]
+		b.ready = b.ready[1:]
+		if !w.HealthCheck() {
+			go w.Terminate()
+			w = nil
+		}
+	}
+	b.fillLocked()
+	return w
+}
+
+// fillLocked starts spawns until ready and spawning workers reach the pool
+// size. Must be called with b.mu held.
+func (b *BlankPool) fillLocked() {
+	for !b.stopped && len(b.ready)+b.spawning < b.size {
+		b.spawning++
+		go b.spawn()
+	}
+}
+
+func (b *BlankPool) spawn() {
+	var w worker.Worker
+	if b.newWorker != nil {
+		w = b.newWorker()
+	} else {
+		w = worker.NewBlankQuickJSWorker(b.logger)
+	}
+	err := w.Spawn(b.cfg, "", "", nil)
+
+	b.mu.Lock()
+	b.spawning--
+	if err != nil {
+		// Not refilled here: a broken setup would otherwise spawn in a loop.
+		// The next take tries again.
+		b.mu.Unlock()
+		b.logger.Warn("Failed to spawn blank worker: %v", err)
+		return
+	}
+	if b.stopped {
+		b.mu.Unlock()
+		w.Terminate()
+		return
+	}
+	b.ready = append(b.ready, w)
+	b.mu.Unlock()
+}
+
+// Stop terminates the ready blank workers; workers already bound to a
+// function belong to their pools
+func (b *BlankPool) Stop() {
+	if b == nil {
+		return
+	}
+	b.mu.Lock()
+	b.stopped = true
+	ready := b.ready
+	b.ready = nil
+	b.mu.Unlock()
+	for _, w := range ready {
+		w.Terminate()
+	}
+}
+
+// Stats returns the pool's current state
+func (b *BlankPool) Stats() BlankPoolStats {
+	if b == nil {
+		return BlankPoolStats{}
+	}
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	return BlankPoolStats{Size: b.size, Ready: len(b.ready), Spawning: b.spawning}
+}
+
+// bindBlank takes a worker from the node's blank pool and loads this pool's
+// function into it. It returns nil when no blank worker can be used, in which
+// case the caller spawns a dedicated worker. Workers that need per-function
+// environment variables cannot be bound, as the environment is fixed at exec.
+func (p *WorkerPool) bindBlank() worker.Worker {
+	blank := p.blank.Load()
+	if blank == nil || p.cfg == nil || len(p.env) > 0 || (p.newWorker == nil && !p.quickJS()) {
+		return nil
+	}
+	w := blank.take()
+	if w == nil {
+		prometrics.IncBlankBind(p.functionID, "empty")
+		return nil
+	}
+	loader, ok := w.(worker.Loader)
+	if !ok {
+		w.Terminate()
+		return nil
+	}
+	if qw, ok := w.(*worker.QuickJSWorker); ok && p.logStore != nil {
+		qw.SetLogStore(p.logStore)
+	}
+
+	timeout := p.cfg.StartupTimeout
+	if timeout <= 0 {
+		timeout = 10 * time.Second
+	}
+	ctx, cancel := context.WithTimeout(context.Background(), timeout)
+	defer cancel()
+	if err := loader.Load(ctx, p.functionID, p.version, p.bundlePath, p.cfg.Capabilities, p.cfg.EnableProfiling); err != nil {
+		prometrics.IncBlankBind(p.functionID, "error")
+		p.logger.Warn("Failed to bind blank worker %s to function %s: %v", w.GetID(), p.functionID, err)
+		w.Terminate()
+		return nil
+	}
+	prometrics.IncBlankBind(p.functionID, "ok")
+	return w
+}
+
+// quickJS reports whether the pool runs the QuickJS runtime
+func (p *WorkerPool) quickJS() bool {
+	return p.cfg.Runtime == "quickjs" || p.cfg.Runtime == "quickjs-ng"
+}
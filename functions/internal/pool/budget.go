@@ -0,0 +1,336 @@
+package pool
+
+import (
+	"math"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+// heatHalfLife is how quickly a pool's invocation count fades when ranking
+// pools for eviction
+const heatHalfLife = time.Minute
+
+// Budget bounds the live workers, and their measured memory, of every pool on
+// a node. Pools reserve a slot before each spawn. When the node is full, a
+// caller that has to wait for a worker evicts an idle worker from a colder
+// pool; pools are ranked by heat, an invocation count that halves every
+// heatHalfLife, so both how recently and how often a function runs count.
+// A pool with every worker busy may run up to BorrowWorkers more than
+// MaxWorkersPerFunction while the node has room; borrowed workers are retired
+// rather than kept warm once they go idle.
+//
+// Lock order: a pool's mu may be held when calling into the Budget, never the
+// other way round.
+type Budget struct {
+	maxWorkers int64
+	maxRSS     int64 // bytes
+	borrow     int
+	logger     *logger.Logger
+
+	workers atomic.Int64 // live and spawning workers across pools
+	rss     atomic.Int64 // last measured RSS plus estimates for workers spawned since
+
+	mu      sync.Mutex
+	pools   map[*WorkerPool]struct{}
+	wanting map[*WorkerPool]struct{} // pools with callers waiting for a slot
+	stop    chan struct{}
+	stopped bool
+}
+
+// BudgetStats is a snapshot of node-wide worker usage
+type BudgetStats struct {
+	Workers     int
+	MaxWorkers  int // 0 is unlimited
+	RSSBytes    int64
+	MaxRSSBytes int64 // 0 is unlimited
+	Pools       int
+}
+
+// NewBudget returns nil unless cfg sets MaxWorkersPerNode or MaxNodeMemoryMB
+func NewBudget(cfg *config.WorkerConfig, log *logger.Logger) *Budget {
+	if cfg.MaxWorkersPerNode <= 0 && cfg.MaxNodeMemoryMB <= 0 {
+		return nil
+	}
+	b := &Budget{
+		borrow:  cfg.BorrowWorkers,
+		logger:  log,
+		pools:   make(map[*WorkerPool]struct{}),
+		wanting: make(map[*WorkerPool]struct{}),
+		stop:    make(chan struct{}),
+	}
+	if cfg.MaxWorkersPerNode > 0 {
+		b.maxWorkers = int64(cfg.MaxWorkersPerNode)
+	}
+	if cfg.MaxNodeMemoryMB > 0 {
+		b.maxRSS = int64(cfg.MaxNodeMemoryMB) * 1024 * 1024
+		interval := cfg.MemorySampleInterval
+		if interval <= 0 {
+			interval = 10 * time.Second
+		}
+		go b.sampleLoop(interval)
+	}
+	return b
+}
+
+// Attach puts p under the budget, counting the workers it already has
+func (b *Budget) Attach(p *WorkerPool) {
+	if b == nil {
+		return
+	}
+	p.mu.Lock()
+	if p.budget.Swap(b) == b {
+		p.mu.Unlock()
+		return
+	}
+	b.workers.Add(int64(len(p.warm) + len(p.busy) + p.spawning))
+	p.mu.Unlock()
+
+	b.mu.Lock()
+	b.pools[p] = struct{}{}
+	b.mu.Unlock()
+}
+
+// Detach stops considering p for eviction. Its workers keep their slots until
+// they are terminated, normally by p.Stop.
+func (b *Budget) Detach(p *WorkerPool) {
+	if b == nil {
+		return
+	}
+	b.mu.Lock()
+	delete(b.pools, p)
+	delete(b.wanting, p)
+	b.mu.Unlock()
+}
+
+// Stop ends memory sampling
+func (b *Budget) Stop() {
+	if b == nil {
+		return
+	}
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if !b.stopped {
+		b.stopped = true
+		close(b.stop)
+	}
+}
+
+// Stats returns node-wide usage
+func (b *Budget) Stats() BudgetStats {
+	if b == nil {
+		return BudgetStats{}
+	}
+	b.mu.Lock()
+	pools := len(b.pools)
+	b.mu.Unlock()
+	return BudgetStats{
+		Workers:     int(b.workers.Load()),
+		MaxWorkers:  int(b.maxWorkers),
+		RSSBytes:    b.rss.Load(),
+		MaxRSSBytes: b.maxRSS,
+		Pools:       pools,
+	}
+}
+
+// reserve takes a slot for a new worker of p and returns the memory it
+// reserved for it, which release must be given back. When the node is full
+// and demand is set (a caller is waiting), p is remembered for the next freed
+// slot and an idle worker of a colder pool is evicted. Called with p.mu held.
+func (b *Budget) reserve(p *WorkerPool, demand bool) (int64, bool) {
+	if b == nil {
+		return 0, true
+	}
+	est := p.rssEstimate.Load()
+	for {
+		n := b.workers.Load()
+		if (b.maxWorkers > 0 && n >= b.maxWorkers) || (b.maxRSS > 0 && b.rss.Load()+est > b.maxRSS) {
+			if demand {
+				b.mu.Lock()
+				b.wanting[p] = struct{}{}
+				b.mu.Unlock()
+				go b.evictFor(p)
+			}
+			return 0, false
+		}
+		if b.workers.CompareAndSwap(n, n+1) {
+			b.rss.Add(est)
+			prometrics.SetNodeWorkers(int(n + 1))
+			return est, true
+		}
+	}
+}
+
+// release frees the slot of a worker that exited or failed to spawn, with
+// the memory reserve took for it, and offers it to a pool with waiting callers
+func (b *Budget) release(reserved int64) {
+	if b == nil {
+		return
+	}
+	prometrics.SetNodeWorkers(int(b.workers.Add(-1)))
+	b.rss.Add(-reserved)
+
+	b.mu.Lock()
+	var next *WorkerPool
+	for q := range b.wanting {
+		next = q
+		delete(b.wanting, q)
+		break
+	}
+	b.mu.Unlock()
+	if next != nil {
+		go func() {
+			next.mu.Lock()
+			next.spawnForWaiters()
+			next.mu.Unlock()
+		}()
+	}
+}
+
+// canBorrow reports whether a pool may spawn past MaxWorkersPerFunction
+func (b *Budget) canBorrow() bool {
+	return b != nil && b.borrow > 0 && b.maxWorkers > 0 && b.workers.Load() < b.maxWorkers
+}
+
+func (b *Budget) snapshot() []*WorkerPool {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	pools := make([]*WorkerPool, 0, len(b.pools))
+	for p := range b.pools {
+		pools = append(pools, p)
+	}
+	return pools
+}
+
+// coldest returns the pool with idle workers and the lowest heat below
+// limit, skipping exclude
+func (b *Budget) coldest(exclude *WorkerPool, limit float64, now time.Time) *WorkerPool {
+	var victim *WorkerPool
+	for _, q := range b.snapshot() {
+		if q == exclude {
+			continue
+		}
+		heat, idle := q.evictionRank(now)
+		if idle > 0 && heat < limit {
+			victim, limit = q, heat
+		}
+	}
+	return victim
+}
+
+// evictFor retires an idle worker of a pool colder than p so that p can spawn
+func (b *Budget) evictFor(p *WorkerPool) {
+	now := time.Now()
+	heat, _ := p.evictionRank(now)
+	if victim := b.coldest(p, heat, now); victim != nil {
+		victim.evictIdle("workers")
+	}
+}
+
+func (b *Budget) sampleLoop(interval time.Duration) {
+	ticker := time.NewTicker(interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			b.sample()
+		case <-b.stop:
+			return
+		}
+	}
+}
+
+// sample measures every worker's RSS and evicts idle workers, coldest pool
+// first, while the total is over budget
+func (b *Budget) sample() {
+	var total int64
+	for _, p := range b.snapshot() {
+		total += p.measureRSS()
+	}
+	b.rss.Store(total)
+
+	for total > b.maxRSS {
+		victim := b.coldest(nil, math.Inf(1), time.Now())
+		if victim == nil {
+			b.logger.Warn("Worker memory %d MB is over the node budget of %d MB with no idle workers to evict",
+				total>>20, b.maxRSS>>20)
+			break
+		}
+		est := victim.rssEstimate.Load()
+		if !victim.evictIdle("memory") {
+			break
+		}
+		total -= est
+	}
+	prometrics.SetNodeRSS(b.rss.Load())
+}
+
+// heatAt returns the pool's decayed invocation count. Must be called with p.mu held.
+func (p *WorkerPool) heatAt(now time.Time) float64 {
+	if p.heatUpdated.IsZero() {
+		return 0
+	}
+	return p.heat * math.Exp2(-float64(now.Sub(p.heatUpdated))/float64(heatHalfLife))
+}
+
+// evictionRank returns the pool's heat and idle worker count
+func (p *WorkerPool) evictionRank(now time.Time) (float64, int) {
+	p.mu.RLock()
+	defer p.mu.RUnlock()
+	if p.stopped {
+		return 0, 0
+	}
+	return p.heatAt(now), len(p.warm)
+}
+
+// evictIdle terminates the most recently released idle worker, if any
+func (p *WorkerPool) evictIdle(reason string) bool {
+	p.mu.Lock()
+	if p.stopped || len(p.warm) == 0 {
+		p.mu.Unlock()
+		return false
+	}
+	w := p.warm[len(p.warm)-1]
+	p.warm = p.warm[:len(p.warm)-1]
+	p.mu.Unlock()
+
+	prometrics.IncBudgetEviction(p.functionID, reason)
+	p.logger.Info("Evicting idle worker %s of function %s to stay within the node %s budget", w.GetID(), p.functionID, reason)
+	p.terminate(w)
+	return true
+}
+
+// measureRSS sums the RSS of the pool's workers and updates its per-worker
+// estimate; workers that cannot report their memory are skipped
+func (p *WorkerPool) measureRSS() int64 {
+	p.mu.RLock()
+	workers := make([]worker.Worker, 0, len(p.warm)+len(p.busy))
+	workers = append(workers, p.warm...)
+	workers = append(workers, p.busy...)
+	p.mu.RUnlock()
+
+	var total int64
+	measured := 0
+	for _, w := range workers {
+		mr, ok := w.(worker.MemoryReporter)
+		if !ok {
+			continue
+		}
+		rss, err := mr.RSSBytes()
+		if err != nil {
+			continue
+		}
+		total += rss
+		measured++
+	}
+	if measured > 0 {
+		p.rssEstimate.Store(total / int64(measured))
+	}
+	prometrics.SetPoolRSS(p.functionID, total)
+	return total
+}
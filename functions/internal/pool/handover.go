@@ -0,0 +1,163 @@
+package pool
+
+import (
+	"context"
+	"maps"
+	"reflect"
+	"sync"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+// handoverPoll is how often TakeOver and Drain check on workers they wait for
+const handoverPoll = 10 * time.Millisecond
+
+// TakeOver prepares p to replace old, the pool of the function's previous
+// deployment, before any traffic is routed to p. old's idle workers are
+// reloaded with p's bundle and moved to p's warm list, and p spawns workers
+// until it has as many as old had live (at least WarmWorkersPerFunction), so
+// switching traffic to p costs no cold start. It returns once those workers
+// are ready or ctx is done, and reports how many warm workers p has.
+//
+// Only workers that implement worker.Reloader are moved, and only when both
+// pools run the same runtime with the same capabilities and environment;
+// workers whose reload fails go back to old. Call after p is attached to
+// the node budget (it is then the same budget as old's, so moved workers
+// keep their slots) and before the scheduler is switched to p.
+func (p *WorkerPool) TakeOver(ctx context.Context, old *WorkerPool) int {
+	p.rssEstimate.Store(old.rssEstimate.Load())
+
+	old.mu.Lock()
+	var idle []worker.Worker
+	if p.reloadCompatible(old) {
+		kept := make([]worker.Worker, 0, len(old.warm))
+		for _, w := range old.warm {
+			if _, ok := w.(worker.Reloader); ok {
+				idle = append(idle, w)
+			} else {
+				kept = append(kept, w)
+			}
+		}
+		old.warm = kept
+	}
+	target := len(old.warm) + len(old.busy) + old.spawning + len(idle)
+	old.mu.Unlock()
+	if target < p.warmWorkers {
+		target = p.warmWorkers
+	}
+	if target > p.maxWorkers {
+		target = p.maxWorkers
+	}
+
+	var wg sync.WaitGroup
+	for _, w := range idle {
+		wg.Add(1)
+		go func(w worker.Worker) {
+			defer wg.Done()
+			if err := w.(worker.Reloader).Reload(ctx, p.version, p.bundlePath); err != nil {
+				prometrics.IncWorkerReload(p.functionID, "error")
+				p.logger.Warn("Failed to reload worker %s for function %s version %s: %v", w.GetID(), p.functionID, p.version, err)
+				old.giveBack(w)
+				return
+			}
+			if _, ok := w.(*worker.HostedWorker); ok {
+				p.hosted.Store(true)
+			}
+			reserved := old.takeReservation(w)
+			p.mu.Lock()
+			if reserved != 0 {
+				p.reserved[w.GetID()] = reserved
+			}
+			p.warm = append(p.warm, w)
+			p.mu.Unlock()
+			prometrics.IncWorkerReload(p.functionID, "ok")
+		}(w)
+	}
+	wg.Wait()
+
+	p.mu.Lock()
+	reloaded := len(p.warm)
+	for n := len(p.warm) + p.spawning; n < target; n++ {
+		if !p.startSpawn(true) {
+			break
+		}
+	}
+	p.mu.Unlock()
+
+	ticker := time.NewTicker(handoverPoll)
+	defer ticker.Stop()
+	for {
+		p.mu.RLock()
+		warm, spawning := len(p.warm), p.spawning
+		p.mu.RUnlock()
+		if spawning == 0 || warm >= target {
+			p.logger.Info("Function %s version %s took over %d reloaded and %d new warm workers", p.functionID, p.version, reloaded, warm-reloaded)
+			return warm
+		}
+		select {
+		case <-ticker.C:
+		case <-ctx.Done():
+			p.logger.Warn("Function %s version %s switching with %d of %d warm workers: %v", p.functionID, p.version, warm, target, ctx.Err())
+			return warm
+		}
+	}
+}
+
+// reloadCompatible reports whether old's workers can serve p after a reload,
+// which swaps the bundle but keeps the process, its limits and its environment
+func (p *WorkerPool) reloadCompatible(old *WorkerPool) bool {
+	return p.cfg.Runtime == old.cfg.Runtime &&
+		p.cfg.EnableProfiling == old.cfg.EnableProfiling &&
+		p.cfg.WorkerThreads == old.cfg.WorkerThreads &&
+		reflect.DeepEqual(p.cfg.Capabilities, old.cfg.Capabilities) &&
+		maps.Equal(p.env, old.env)
+}
+
+// giveBack returns a worker TakeOver could not move to old's warm list, or
+// terminates it when it is no longer usable
+func (p *WorkerPool) giveBack(w worker.Worker) {
+	p.mu.Lock()
+	if !p.stopped && !p.draining && w.HealthCheck() {
+		p.warm = append(p.warm, w)
+		p.mu.Unlock()
+		return
+	}
+	p.mu.Unlock()
+	p.terminate(w)
+}
+
+// Drain retires a pool that no longer receives new traffic. Idle workers are
+// terminated right away; busy ones finish their invocations, serve callers
+// already queued on the pool, and are terminated as they are released. The
+// pool is stopped once nothing is busy, queued or spawning, or after timeout.
+func (p *WorkerPool) Drain(timeout time.Duration) {
+	p.mu.Lock()
+	if p.stopped {
+		p.mu.Unlock()
+		return
+	}
+	p.draining = true
+	idle := p.warm
+	p.warm = nil
+	busy := len(p.busy)
+	p.mu.Unlock()
+
+	p.logger.Info("Draining pool for function %s version %s (%d busy)", p.functionID, p.version, busy)
+	for _, w := range idle {
+		p.terminate(w)
+	}
+
+	deadline := time.Now().Add(timeout)
+	for time.Now().Before(deadline) {
+		p.mu.RLock()
+		done := p.stopped || len(p.busy)+p.waiters.Len()+p.spawning == 0
+		p.mu.RUnlock()
+		if done {
+			break
+		}
+		time.Sleep(handoverPoll)
+	}
+	p.Stop()
+}
@@ -0,0 +1,146 @@
+package pool
+
+import (
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+// heartbeatMisses is how many StatsInterval periods a worker may go without
+// a heartbeat before it is considered wedged. The heartbeat comes from a
+// thread beside the JS runtime, so a busy handler does not delay it; only a
+// stopped process or a stuck pipe does.
+const heartbeatMisses = 3
+
+// checkHealth runs every StatsInterval and recycles workers whose latest
+// heartbeat crossed a threshold, before an invocation lands on them. Warm
+// workers are terminated and replaced at once; busy ones are marked and
+// terminated when they are released. Release itself only reads the mark.
+// The slots of a threaded process share its heartbeat, so they are recycled
+// together and the process is retired: it hands out no more slots and exits
+// with its last one. Hosted workers are left to HostGroup, which kills the
+// whole host.
+func (p *WorkerPool) checkHealth() {
+	ticker := time.NewTicker(p.cfg.StatsInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+		case <-p.cleanupStop:
+			return
+		}
+
+		now := time.Now()
+		p.mu.Lock()
+		if p.stopped {
+			p.mu.Unlock()
+			return
+		}
+		var recycle []worker.Worker
+		retire := make(map[*worker.ThreadedProcess]bool)
+		for i := len(p.warm) - 1; i >= 0; i-- {
+			w := p.warm[i]
+			if reason := p.recycleReason(w, now); reason != "" {
+				p.warm = append(p.warm[:i], p.warm[i+1:]...)
+				recycle = append(recycle, w)
+				p.logRecycle(w, reason, "now")
+				p.retireProcess(w, retire)
+			}
+		}
+		for _, w := range p.busy {
+			if _, marked := p.retiring[w.GetID()]; marked {
+				continue
+			}
+			if reason := p.recycleReason(w, now); reason != "" {
+				p.retiring[w.GetID()] = reason
+				p.logRecycle(w, reason, "after its invocation")
+				p.retireProcess(w, retire)
+			}
+		}
+		for range recycle {
+			if !p.startSpawn(true) {
+				break
+			}
+		}
+		p.mu.Unlock()
+
+		for t := range retire {
+			t.Retire()
+		}
+		for _, w := range recycle {
+			p.terminate(w)
+		}
+	}
+}
+
+// retireProcess adds the threaded process of a recycled slot to retire and
+// stops the pool from claiming its remaining slots. Must be called with p.mu
+// held.
+func (p *WorkerPool) retireProcess(w worker.Worker, retire map[*worker.ThreadedProcess]bool) {
+	s, ok := w.(*worker.ThreadSlot)
+	if !ok {
+		return
+	}
+	retire[s.Process()] = true
+	if p.threaded == s.Process() {
+		p.threaded = nil
+	}
+}
+
+// recycleReason returns why w should be recycled, or "" if its latest
+// heartbeat is fine or it sends none. Must be called with p.mu held.
+func (p *WorkerPool) recycleReason(w worker.Worker, now time.Time) string {
+	sr, ok := w.(worker.StatsReporter)
+	if !ok {
+		return ""
+	}
+	st, ok := sr.Stats()
+	if !ok {
+		return ""
+	}
+	return heartbeatReason(p.cfg, st, p.memoryLimit(), now)
+}
+
+// heartbeatReason returns why a process whose latest heartbeat is st should
+// be recycled, or "" if it is fine. memoryLimit is in bytes; 0 is unlimited.
+func heartbeatReason(cfg *config.WorkerConfig, st worker.WorkerStats, memoryLimit int64, now time.Time) string {
+	if now.Sub(st.ReceivedAt) > heartbeatMisses*cfg.StatsInterval {
+		return "unresponsive"
+	}
+	if memoryLimit > 0 && cfg.RecycleMemoryRatio > 0 {
+		threshold := int64(cfg.RecycleMemoryRatio * float64(memoryLimit))
+		if st.RSS > threshold {
+			return "rss"
+		}
+		if st.Heap > threshold {
+			return "heap"
+		}
+	}
+	lag := cfg.RecycleLag
+	if lag <= 0 {
+		lag = cfg.ExecutionTimeout
+	}
+	if lag > 0 && time.Duration(st.LagMS)*time.Millisecond > lag {
+		return "lag"
+	}
+	return ""
+}
+
+// memoryLimit is the memory a worker of the pool may use, in bytes: its
+// MaxMemory capability, else MemoryLimitMB; 0 is unlimited
+func (p *WorkerPool) memoryLimit() int64 {
+	if caps := p.cfg.Capabilities; caps != nil && caps.MaxMemory > 0 {
+		return caps.MaxMemory
+	}
+	return int64(p.cfg.MemoryLimitMB) << 20
+}
+
+func (p *WorkerPool) logRecycle(w worker.Worker, reason, when string) {
+	prometrics.IncWorkerRecycle(p.functionID, reason)
+	if st, ok := w.(worker.StatsReporter).Stats(); ok {
+		p.logger.Warn("Recycling worker %s of function %s %s: %s (rss %d, heap %d, gcs %d, invocations %d, lag %dms, heartbeat %v ago)",
+			w.GetID(), p.functionID, when, reason, st.RSS, st.Heap, st.GCs, st.Invocations, st.LagMS, time.Since(st.ReceivedAt).Round(time.Millisecond))
+	}
+}
@@ -0,0 +1,258 @@
+package pool
+
+import (
+	"fmt"
+	"slices"
+	"sync"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+// hostMaxHeat is the heat from which a pool's workers are all dedicated
+// processes. A function invoked steadily n times a minute settles at a heat
+// of about 1.44n, so this is roughly 40 invocations a minute.
+const hostMaxHeat = 60
+
+// HostGroup runs up to HostProcesses QuickJS host processes shared by every
+// function on the node. Each pool's first worker is a HostedWorker in one of
+// them, so a cold function that never needs more than one worker at a time
+// costs a context in a shared runtime instead of a process; workers beyond
+// the first are dedicated processes as usual, and a function that turns hot
+// or concurrent leaves the host for good (see leaveHost). Functions whose
+// capabilities set max_memory or max_fds are only hosted with
+// HostLimitedFunctions, since a shared process cannot apply them. A function
+// stays with the host it was assigned to while that host is alive and the
+// function has a hosted worker; new functions go to the host with the fewest
+// functions. A host runs one invocation at a time, so when its heartbeat
+// shows one running past ExecutionTimeout, or crosses another recycle
+// threshold, the host is killed and its functions move to a new one.
+type HostGroup struct {
+	cfg    *config.WorkerConfig
+	logger *logger.Logger
+
+	mu       sync.Mutex
+	hosts    []*worker.HostProcess
+	assigned map[string]*worker.HostProcess // functionID -> host
+	stopped  bool
+	stop     chan struct{}
+	start    func() (*worker.HostProcess, error) // tests only; overrides StartHostProcess
+}
+
+// HostGroupStats is a snapshot of the host processes
+type HostGroupStats struct {
+	Hosts     int
+	Functions int
+}
+
+// NewHostGroup returns nil when cfg.HostProcesses is 0. Host processes are
+// started on first use.
+func NewHostGroup(cfg *config.WorkerConfig, log *logger.Logger) *HostGroup {
+	if cfg.HostProcesses <= 0 {
+		return nil
+	}
+	g := &HostGroup{cfg: cfg, logger: log, assigned: make(map[string]*worker.HostProcess), stop: make(chan struct{})}
+	if cfg.StatsInterval > 0 {
+		go g.watch()
+	}
+	return g
+}
+
+// host returns the host process for functionID, starting one if the group
+// has room and no live host is assigned. Starting a host holds g.mu; it only
+// happens the first HostProcesses times and after a host dies.
+func (g *HostGroup) host(functionID string) (*worker.HostProcess, error) {
+	g.mu.Lock()
+	defer g.mu.Unlock()
+	if g.stopped {
+		return nil, fmt.Errorf("host group stopped")
+	}
+	if h, ok := g.assigned[functionID]; ok && h.Alive() {
+		return h, nil
+	}
+
+	live := g.hosts[:0]
+	for _, h := range g.hosts {
+		if h.Alive() {
+			live = append(live, h)
+		}
+	}
+	g.hosts = live
+
+	var best *worker.HostProcess
+	for _, h := range g.hosts {
+		if best == nil || h.Functions() < best.Functions() {
+			best = h
+		}
+	}
+	if best == nil || (len(g.hosts) < g.cfg.HostProcesses && best.Functions() > 0) {
+		start := g.start
+		if start == nil {
+			start = func() (*worker.HostProcess, error) { return worker.StartHostProcess(g.cfg, g.logger) }
+		}
+		h, err := start()
+		if err != nil {
+			if best == nil {
+				return nil, fmt.Errorf("failed to start host process: %w", err)
+			}
+			g.logger.Warn("Failed to start host process, sharing an existing one: %v", err)
+		} else {
+			g.hosts = append(g.hosts, h)
+			best = h
+		}
+	}
+	g.assigned[functionID] = best
+	prometrics.SetHostProcesses(len(g.hosts))
+	return best, nil
+}
+
+// release forgets which host functionID was assigned to, once the function
+// has no hosted worker left, so that the table only holds live functions
+func (g *HostGroup) release(functionID string) {
+	if g == nil {
+		return
+	}
+	g.mu.Lock()
+	defer g.mu.Unlock()
+	delete(g.assigned, functionID)
+}
+
+// Stop terminates the host processes
+func (g *HostGroup) Stop() {
+	if g == nil {
+		return
+	}
+	g.mu.Lock()
+	if !g.stopped {
+		close(g.stop)
+	}
+	g.stopped = true
+	hosts := g.hosts
+	g.hosts = nil
+	g.mu.Unlock()
+	for _, h := range hosts {
+		h.Stop()
+	}
+	prometrics.SetHostProcesses(0)
+}
+
+// watch checks the hosts' heartbeats every StatsInterval
+func (g *HostGroup) watch() {
+	ticker := time.NewTicker(g.cfg.StatsInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			g.checkHosts()
+		case <-g.stop:
+			return
+		}
+	}
+}
+
+// checkHosts kills the hosts whose latest heartbeat crossed a recycle
+// threshold: unresponsive, over RecycleMemoryRatio of MemoryLimitMB, or an
+// invocation running past RecycleLag (default ExecutionTimeout). Their hosted
+// workers are marked terminated and the next invocation of each function
+// loads it into another host.
+func (g *HostGroup) checkHosts() {
+	now := time.Now()
+	g.mu.Lock()
+	var stuck []*worker.HostProcess
+	live := g.hosts[:0]
+	for _, h := range g.hosts {
+		st, ok := h.Stats()
+		reason := ""
+		if ok {
+			reason = heartbeatReason(g.cfg, st, int64(g.cfg.MemoryLimitMB)<<20, now)
+		}
+		if reason == "" {
+			live = append(live, h)
+			continue
+		}
+		g.logger.Warn("Killing host process %s with %d functions: %s (rss %d, heap %d, lag %dms, heartbeat %v ago)",
+			h.ID(), h.Functions(), reason, st.RSS, st.Heap, st.LagMS, now.Sub(st.ReceivedAt).Round(time.Millisecond))
+		stuck = append(stuck, h)
+	}
+	g.hosts = live
+	for id, h := range g.assigned {
+		if !h.Alive() || slices.Contains(stuck, h) {
+			delete(g.assigned, id)
+		}
+	}
+	prometrics.SetHostProcesses(len(g.hosts))
+	g.mu.Unlock()
+
+	for _, h := range stuck {
+		h.Stop()
+	}
+}
+
+// Stats returns the group's current state
+func (g *HostGroup) Stats() HostGroupStats {
+	if g == nil {
+		return HostGroupStats{}
+	}
+	g.mu.Lock()
+	defer g.mu.Unlock()
+	st := HostGroupStats{Hosts: len(g.hosts)}
+	for _, h := range g.hosts {
+		st.Functions += h.Functions()
+	}
+	return st
+}
+
+// hostedWorker returns an unspawned HostedWorker when the pool has none yet
+// and may be hosted, or nil when the pool should spawn a dedicated worker
+func (p *WorkerPool) hostedWorker() worker.Worker {
+	g := p.hosts.Load()
+	if g == nil || p.cfg == nil || len(p.env) > 0 || (g.start == nil && !p.quickJS()) {
+		return nil
+	}
+	if caps := p.cfg.Capabilities; caps != nil && (caps.MaxMemory > 0 || caps.MaxFileDescriptors > 0) && !p.cfg.HostLimitedFunctions {
+		return nil
+	}
+	if heat, _ := p.evictionRank(time.Now()); heat >= hostMaxHeat {
+		return nil
+	}
+	p.mu.RLock()
+	dedicated := p.dedicated
+	p.mu.RUnlock()
+	if dedicated {
+		return nil
+	}
+	if !p.hosted.CompareAndSwap(false, true) {
+		return nil
+	}
+	h, err := g.host(p.functionID)
+	if err != nil {
+		p.hosted.Store(false)
+		p.logger.Warn("No host process for function %s: %v", p.functionID, err)
+		return nil
+	}
+	if p.logStore != nil {
+		h.SetLogStore(p.logStore)
+	}
+	w := worker.NewHostedWorker(h, p.functionID, p.version, p.bundlePath, p.logger)
+	w.SetCapabilities(p.cfg.Capabilities)
+	return w
+}
+
+// leaveHost moves the pool to dedicated workers once it is hot or has had
+// concurrent invocations: a host runs one invocation at a time, so such a
+// function would queue behind itself and every other function in the host.
+// The hosted worker is retired when it is next released and none is spawned
+// again. Must be called with p.mu held.
+func (p *WorkerPool) leaveHost(now time.Time, concurrent bool) {
+	if p.dedicated || !p.hosted.Load() {
+		return
+	}
+	if !concurrent && p.heatAt(now) < hostMaxHeat {
+		return
+	}
+	p.dedicated = true
+	p.logger.Info("Function %s leaves its host process for dedicated workers", p.functionID)
+}
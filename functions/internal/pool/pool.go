@@ -1,23 +1,48 @@
 package pool
 
 import (
+	"container/list"
 	"context"
 	"fmt"
+	"sort"
+	"strconv"
+	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
 
+	"github.com/kartikbazzad/bunbase/functions/internal/cgroup"
 	"github.com/kartikbazzad/bunbase/functions/internal/config"
-	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/tracing"
 	"github.com/kartikbazzad/bunbase/functions/internal/worker"
 )
 
 var (
-	ErrPoolStopped       = fmt.Errorf("pool is stopped")
-	ErrMaxWorkersReached = fmt.Errorf("max workers reached")
-	ErrNoWorkers         = fmt.Errorf("no workers available")
+	ErrPoolStopped   = fmt.Errorf("pool is stopped")
+	ErrQueueFull     = fmt.Errorf("max workers reached and invocation queue is full")
+	ErrNoWorkers     = fmt.Errorf("no workers available")
+	ErrNotProfilable = fmt.Errorf("runtime does not support profiling")
+
+	ErrDeadlineUnmeetable = fmt.Errorf("deadline cannot be met at the current queue depth")
 )
 
+// AdmissionError rejects an invocation before it is queued. Reason is
+// ErrQueueFull or ErrDeadlineUnmeetable; RetryAfter estimates when the queue
+// will have drained.
+type AdmissionError struct {
+	Reason     error
+	RetryAfter time.Duration
+}
+
+func (e *AdmissionError) Error() string {
+	return fmt.Sprintf("%v (retry after %v)", e.Reason, e.RetryAfter)
+}
+
+func (e *AdmissionError) Unwrap() error { return e.Reason }
+
 // WorkerPool manages workers for a function version
 type WorkerPool struct {
 	functionID    string
@@ -26,6 +51,7 @@ type WorkerPool struct {
 	warm          []worker.Worker
 	busy          []worker.Worker
 	maxWorkers    int
+	maxQueued     int // callers that may wait for a busy worker; <= 0 is unbounded
 	warmWorkers   int
 	idleTimeout   time.Duration
 	mu            sync.RWMutex
@@ -35,9 +61,33 @@ type WorkerPool struct {
 	initScript    string
 	env           map[string]string
 	stopped       bool
+	draining      bool // replaced by a new deployment; see Drain
 	cleanupTicker *time.Ticker
 	cleanupStop   chan struct{}
 	logStore      logstore.Store // optional; when set, workers persist logs here
+	scaler        *autoscaler    // nil when autoscaling is disabled
+	spawning      int            // spawns in progress, pre-warm or for waiters
+	waiters       *list.List     // *acquireWaiter, earliest deadline first
+	acquiredAt    map[string]time.Time
+	serviceTime   time.Duration        // EWMA of acquire-to-release time; 0 until measured
+	retiring      map[string]string    // busy workers to recycle on release, with the reason; see checkHealth
+	reserved      map[string]int64     // memory each worker reserved from the node budget, bytes
+	newWorker     func() worker.Worker // tests only; overrides createWorker
+
+	// Node budget; see Budget
+	budget      atomic.Pointer[Budget]
+	heat        float64 // invocations, halving every heatHalfLife
+	heatUpdated time.Time
+	rssEstimate atomic.Int64 // measured RSS per worker, bytes; 0 until sampled
+
+	blank     atomic.Pointer[BlankPool] // optional; cold misses bind a blank worker
+	hosts     atomic.Pointer[HostGroup] // optional; the first worker runs in a shared host process
+	hosted    atomic.Bool               // a HostedWorker is live or being spawned
+	dedicated bool                      // hot or concurrent: no more hosted workers; see leaveHost; guarded by mu
+
+	threaded *worker.ThreadedProcess // WorkerThreads > 1: process handing out the next slots; guarded by mu
+
+	cgroups *cgroup.Manager // nil unless QuickJS workers are placed in cgroups; its pressure pauses pre-warming
 }
 
 // NewPool creates a new worker pool
@@ -47,6 +97,7 @@ func NewPool(functionID, version, bundlePath string, cfg *config.WorkerConfig, w
 		version:      version,
 		bundlePath:   bundlePath,
 		maxWorkers:   cfg.MaxWorkersPerFunction,
+		maxQueued:    cfg.MaxQueuedPerFunction,
 		warmWorkers:  cfg.WarmWorkersPerFunction,
 		idleTimeout:  cfg.IdleTimeout,
 		logger:       log,
@@ -57,12 +108,28 @@ func NewPool(functionID, version, bundlePath string, cfg *config.WorkerConfig, w
 		warm:         make([]worker.Worker, 0),
 		busy:         make([]worker.Worker, 0),
 		cleanupStop:  make(chan struct{}),
+		waiters:      list.New(),
+		acquiredAt:   make(map[string]time.Time),
+		retiring:     make(map[string]string),
+		reserved:     make(map[string]int64),
+	}
+
+	if p.quickJS() {
+		p.cgroups = cgroup.ForRoot(cfg.CgroupRoot, log)
 	}
 
 	// Start cleanup goroutine
 	p.cleanupTicker = time.NewTicker(30 * time.Second)
 	go p.cleanupIdleWorkers()
 
+	if cfg.Autoscale {
+		p.scaler = newAutoscaler(cfg.AutoscaleInterval, cfg.ScaleDownDelay, p.warmWorkers)
+		go p.autoscale()
+	}
+	if cfg.StatsInterval > 0 {
+		go p.checkHealth()
+	}
+
 	return p
 }
 
@@ -71,8 +138,24 @@ func (p *WorkerPool) SetLogStore(store logstore.Store) {
 	p.logStore = store
 }
 
+// SetBlankPool lets cold misses bind a pre-spawned blank worker instead of
+// starting a new process. Optional; call after NewPool to enable.
+func (p *WorkerPool) SetBlankPool(b *BlankPool) {
+	p.blank.Store(b)
+}
+
+// SetHostGroup runs the pool's first worker inside a shared host process.
+// Optional; call after NewPool to enable.
+func (p *WorkerPool) SetHostGroup(g *HostGroup) {
+	p.hosts.Store(g)
+}
+
 // createWorker creates a new worker instance based on runtime configuration
 func (p *WorkerPool) createWorker() worker.Worker {
+	if p.newWorker != nil {
+		return p.newWorker()
+	}
+
 	// Determine runtime from config (default to "bun" for backward compatibility)
 	runtime := "bun"
 	if p.cfg != nil && p.cfg.Runtime != "" {
@@ -82,6 +165,9 @@ func (p *WorkerPool) createWorker() worker.Worker {
 	var w worker.Worker
 	switch runtime {
 	case "quickjs", "quickjs-ng":
+		if p.cfg.WorkerThreads > 1 {
+			return p.threadSlot()
+		}
 		w = worker.NewQuickJSWorker(p.functionID, p.version, p.bundlePath, p.logger)
 		if qw, ok := w.(*worker.QuickJSWorker); ok {
 			if p.cfg != nil && p.cfg.Capabilities != nil {
@@ -99,99 +185,454 @@ func (p *WorkerPool) createWorker() worker.Worker {
 	}
 }
 
-// Acquire gets a warm worker or spawns a new one
-func (p *WorkerPool) Acquire(ctx context.Context) (worker.Worker, error) {
-	p.mu.Lock()
-	defer p.mu.Unlock()
+// acquireWaiter is an Acquire call waiting for a worker
+type acquireWaiter struct {
+	ch       chan acquireResult // buffered; written once, under p.mu
+	elem     *list.Element      // position in p.waiters; nil once served or cancelled
+	deadline time.Time          // from the caller's context; zero sorts last
+}
+
+// before reports whether w should be served ahead of o
+func (w *acquireWaiter) before(o *acquireWaiter) bool {
+	if w.deadline.IsZero() {
+		return false
+	}
+	return o.deadline.IsZero() || w.deadline.Before(o.deadline)
+}
+
+type acquireResult struct {
+	w          worker.Worker
+	err        error
+	spawnStart time.Time // set when w was spawned for this waiter
+	spawnEnd   time.Time
+}
 
+// Acquire gets a warm worker or waits for one. When none is warm it reserves a
+// spawn slot, unless spawns already in flight cover every waiter, so a burst
+// of misses does not start more workers than it needs. Spawning runs in the
+// background without p.mu held and the caller is handed whichever comes
+// first: a worker released by another invocation or a newly spawned one.
+// At MaxWorkersPerFunction the caller joins the same queue and Release hands
+// it the next freed worker. The queue is ordered earliest deadline first (FIFO
+// among equal deadlines). An *AdmissionError is returned instead of queueing
+// once MaxQueuedPerFunction callers are waiting beyond the spawns in flight,
+// or when the measured service time says the caller's deadline would pass
+// before it got a worker and finished. When the node budget has no room for
+// a spawn, the caller also queues and the spawn is retried once a slot frees.
+// cold reports whether the worker was spawned for this call.
+func (p *WorkerPool) Acquire(ctx context.Context) (w worker.Worker, cold bool, err error) {
+	p.mu.Lock()
 	if p.stopped {
-		return nil, ErrPoolStopped
+		p.mu.Unlock()
+		return nil, false, ErrPoolStopped
+	}
+	if p.scaler != nil {
+		p.scaler.observeArrival()
 	}
 
 	// Try to get a warm worker
 	if len(p.warm) > 0 {
 		w := p.warm[0]
 		p.warm = p.warm[1:]
-		p.busy = append(p.busy, w)
+		p.markBusy(w, time.Now())
+		p.mu.Unlock()
 		p.logger.Debug("Acquired warm worker %s for function %s", w.GetID(), p.functionID)
-		return w, nil
+		return w, false, nil
 	}
 
-	// Check if we can spawn a new worker
-	totalWorkers := len(p.warm) + len(p.busy)
-	if totalWorkers >= p.maxWorkers {
-		return nil, ErrMaxWorkersReached
+	wt := &acquireWaiter{ch: make(chan acquireResult, 1)}
+	wt.deadline, _ = ctx.Deadline()
+	mark, ahead := p.queuePosition(wt)
+
+	// Spawns in flight are spoken for by earlier waiters first
+	if queued := p.waiters.Len() - p.spawning; queued >= 0 {
+		if len(p.busy)+p.spawning < p.workerLimit() && p.startSpawn(false) {
+			p.logger.Info("Spawning new worker for function %s (cold start)", p.functionID)
+		} else if err := p.admit(wt, queued, ahead); err != nil {
+			p.mu.Unlock()
+			return nil, false, err
+		}
+	}
+	if mark == nil {
+		wt.elem = p.waiters.PushFront(wt)
+	} else {
+		wt.elem = p.waiters.InsertAfter(wt, mark)
 	}
+	queueLen := p.waiters.Len()
+	p.leaveHost(time.Now(), len(p.busy) > 0)
+	p.mu.Unlock()
+	waitStart := time.Now()
 
-	// Spawn new worker
-	p.logger.Info("Spawning new worker for function %s (cold start)", p.functionID)
-	w := p.createWorker()
-	if err := w.Spawn(p.cfg, p.workerScript, p.initScript, p.env); err != nil {
-		p.logger.Error("Failed to spawn worker for function %s: %v", p.functionID, err)
-		return nil, fmt.Errorf("failed to spawn worker: %w", err)
+	select {
+	case res := <-wt.ch:
+		if res.err != nil {
+			return nil, false, res.err
+		}
+		cold = !res.spawnStart.IsZero()
+		if cold {
+			tracing.FromContext(ctx).Record("pool.spawn", res.spawnStart, res.spawnEnd, "worker.id", res.w.GetID())
+		} else {
+			waitEnd := time.Now()
+			tracing.FromContext(ctx).Record("pool.queue_wait", waitStart, waitEnd, "queue.length", strconv.Itoa(queueLen))
+			prometrics.ObserveQueueWait(p.functionID, waitEnd.Sub(waitStart).Seconds())
+		}
+		return res.w, cold, nil
+	case <-ctx.Done():
+		p.mu.Lock()
+		if wt.elem != nil {
+			// The spawn keeps going and its worker joins the warm list
+			p.waiters.Remove(wt.elem)
+			wt.elem = nil
+			p.mu.Unlock()
+			return nil, false, ctx.Err()
+		}
+		p.mu.Unlock()
+		// Served while being cancelled: hand the worker on
+		if res := <-wt.ch; res.w != nil {
+			p.Release(res.w)
+		}
+		return nil, false, ctx.Err()
+	}
+}
+
+// queuePosition finds where wt goes in the deadline-ordered queue: after
+// mark (nil for the front), with ahead waiters before it. It walks from the
+// back, which is O(1) when deadlines arrive in order. Must be called with p.mu held.
+func (p *WorkerPool) queuePosition(wt *acquireWaiter) (mark *list.Element, ahead int) {
+	ahead = p.waiters.Len()
+	for e := p.waiters.Back(); e != nil; e = e.Prev() {
+		if !wt.before(e.Value.(*acquireWaiter)) {
+			return e, ahead
+		}
+		ahead--
+	}
+	return nil, 0
+}
+
+// admit decides whether a caller may queue for a busy worker. queued is the
+// number of waiters beyond the spawns in flight and ahead the number that
+// would be served first. Must be called with p.mu held.
+func (p *WorkerPool) admit(wt *acquireWaiter, queued, ahead int) error {
+	// Time for the queue to drain through every worker
+	retryAfter := time.Second
+	if p.serviceTime > 0 {
+		drain := time.Duration(float64(p.serviceTime) * float64(queued+1) / float64(p.maxWorkers))
+		if drain > retryAfter {
+			retryAfter = drain
+		}
+	}
+
+	if p.maxQueued > 0 && queued >= p.maxQueued {
+		prometrics.IncAdmissionRejected(p.functionID, "queue_full")
+		return &AdmissionError{Reason: ErrQueueFull, RetryAfter: retryAfter}
+	}
+
+	if wt.deadline.IsZero() || p.serviceTime == 0 || len(p.busy) == 0 {
+		return nil
+	}
+	// The busy workers free up one every serviceTime/busy on average; the
+	// caller needs ahead+1 of those releases and then its own service time
+	wait := time.Duration(float64(p.serviceTime) * float64(ahead+1) / float64(len(p.busy)))
+	if time.Until(wt.deadline) < wait+p.serviceTime {
+		prometrics.IncAdmissionRejected(p.functionID, "deadline")
+		return &AdmissionError{Reason: ErrDeadlineUnmeetable, RetryAfter: retryAfter}
 	}
+	return nil
+}
 
+// markBusy moves an acquired worker to the busy list. Must be called with p.mu held.
+func (p *WorkerPool) markBusy(w worker.Worker, now time.Time) {
 	p.busy = append(p.busy, w)
-	p.logger.Info("Successfully spawned worker %s for function %s", w.GetID(), p.functionID)
-	return w, nil
+	p.acquiredAt[w.GetID()] = now
+	p.heat = p.heatAt(now) + 1
+	p.heatUpdated = now
+	p.leaveHost(now, len(p.busy) > 1)
+	if p.scaler != nil {
+		p.scaler.observeBusy(len(p.busy))
+	}
 }
 
-// Release returns a worker to the warm pool
-func (p *WorkerPool) Release(w worker.Worker) {
+// markIdle updates the service time estimate for a worker that left the busy
+// list. Must be called with p.mu held.
+func (p *WorkerPool) markIdle(w worker.Worker, now time.Time) {
+	start, ok := p.acquiredAt[w.GetID()]
+	if !ok {
+		return
+	}
+	delete(p.acquiredAt, w.GetID())
+	p.serviceTime = ewma(p.serviceTime, now.Sub(start))
+}
+
+// serve hands res to the first waiter and reports whether there was one.
+// Waiters whose deadline has already passed are dropped rather than given a
+// worker they cannot use. Must be called with p.mu held.
+func (p *WorkerPool) serve(res acquireResult) bool {
+	now := time.Now()
+	for {
+		front := p.waiters.Front()
+		if front == nil {
+			return false
+		}
+		wt := p.waiters.Remove(front).(*acquireWaiter)
+		wt.elem = nil
+		if res.w != nil && !wt.deadline.IsZero() && !now.Before(wt.deadline) {
+			prometrics.IncQueueExpired(p.functionID)
+			wt.ch <- acquireResult{err: context.DeadlineExceeded}
+			continue
+		}
+		if res.w != nil {
+			p.markBusy(res.w, now)
+		}
+		wt.ch <- res
+		return true
+	}
+}
+
+// spawnForWaiters replaces a worker that left the pool while callers were
+// queued for it. Must be called with p.mu held.
+func (p *WorkerPool) spawnForWaiters() {
+	for !p.stopped && p.waiters.Len() > p.spawning && len(p.busy)+len(p.warm)+p.spawning < p.workerLimit() {
+		if !p.startSpawn(false) {
+			return
+		}
+	}
+}
+
+// workerLimit is MaxWorkersPerFunction, raised by the node budget's
+// BorrowWorkers while the node has room. Must be called with p.mu held.
+func (p *WorkerPool) workerLimit() int {
+	if b := p.budget.Load(); b.canBorrow() {
+		return p.maxWorkers + b.borrow
+	}
+	return p.maxWorkers
+}
+
+// startSpawn reserves a slot and spawns a worker in the background. It
+// returns false when the node budget has no room; pre-warm spawns then give
+// up, while spawns for waiting callers are retried when a slot frees. A
+// draining pool does not pre-warm, and no pool pre-warms while the worker
+// cgroups are under CPU or memory pressure. Must be called with p.mu held.
+func (p *WorkerPool) startSpawn(prewarm bool) bool {
+	if prewarm && p.draining {
+		return false
+	}
+	if prewarm && p.cgroups.Pressured(p.cfg.PrewarmMaxPressure) {
+		// Another worker would compete with the ones already stalled
+		prometrics.IncPoolPrewarm(p.functionID, "pressure")
+		return false
+	}
+	reserved, ok := p.budget.Load().reserve(p, !prewarm)
+	if !ok {
+		return false
+	}
+	p.spawning++
+	go p.spawnWorker(prewarm, reserved)
+	return true
+}
+
+// terminate stops a worker that has left the pool's lists and frees its node
+// budget slot. Must be called without p.mu held.
+func (p *WorkerPool) terminate(w worker.Worker) {
+	w.Terminate()
+	if _, ok := w.(*worker.HostedWorker); ok {
+		p.hosted.Store(false)
+		p.hosts.Load().release(p.functionID)
+	}
+	p.budget.Load().release(p.takeReservation(w))
+}
+
+// takeReservation removes and returns the budget memory w reserved when it
+// was spawned
+func (p *WorkerPool) takeReservation(w worker.Worker) int64 {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	reserved := p.reserved[w.GetID()]
+	delete(p.reserved, w.GetID())
+	return reserved
+}
+
+// threadSlot returns the next thread of the pool's threaded process, starting
+// a new process when the current one has no free thread
+func (p *WorkerPool) threadSlot() worker.Worker {
 	p.mu.Lock()
 	defer p.mu.Unlock()
+	if p.threaded != nil {
+		if s := p.threaded.Slot(); s != nil {
+			return s
+		}
+	}
+	p.threaded = worker.NewThreadedProcess(p.functionID, p.version, p.bundlePath, p.cfg.WorkerThreads, p.logger)
+	if p.cfg.Capabilities != nil {
+		p.threaded.SetCapabilities(p.cfg.Capabilities)
+	}
+	if p.logStore != nil {
+		p.threaded.SetLogStore(p.logStore)
+	}
+	return p.threaded.Slot()
+}
+
+// spawnWorker spawns a worker without holding p.mu, loads the function into
+// a shared host process, or binds a blank worker for a waiting caller. It
+// gives the worker to the first waiter in deadline order, or to the warm
+// list when nobody is waiting any more.
+func (p *WorkerPool) spawnWorker(prewarm bool, reserved int64) {
+	spawnStart := time.Now()
+	var w worker.Worker
+	var err error
+	kind := "hosted"
+	if w = p.hostedWorker(); w != nil {
+		if err = w.Spawn(p.cfg, p.workerScript, p.initScript, p.env); err != nil {
+			p.hosted.Store(false)
+		}
+	} else if !prewarm {
+		// A caller is waiting: bind a blank worker if the node has one
+		kind = "blank"
+		w = p.bindBlank()
+	}
+	if w == nil {
+		kind = "process"
+		w = p.createWorker()
+		err = w.Spawn(p.cfg, p.workerScript, p.initScript, p.env)
+	}
+	spawnEnd := time.Now()
+
+	p.mu.Lock()
+	p.spawning--
+	if err != nil {
+		// Fail a waiter that the remaining spawns no longer cover
+		if p.waiters.Len() > p.spawning {
+			p.serve(acquireResult{err: fmt.Errorf("failed to spawn worker: %w", err)})
+		}
+		p.mu.Unlock()
+		p.budget.Load().release(reserved)
+		if prewarm {
+			prometrics.IncPoolPrewarm(p.functionID, "error")
+		}
+		p.logger.Error("Failed to spawn worker for function %s: %v", p.functionID, err)
+		return
+	}
+	if reserved != 0 {
+		p.reserved[w.GetID()] = reserved
+	}
+	if p.stopped {
+		p.mu.Unlock()
+		p.terminate(w)
+		return
+	}
+	if p.scaler != nil {
+		p.scaler.observeSpawn(spawnEnd.Sub(spawnStart))
+	}
+	prometrics.ObserveSpawn(p.functionID, kind, spawnEnd.Sub(spawnStart).Seconds())
+	if !p.serve(acquireResult{w: w, spawnStart: spawnStart, spawnEnd: spawnEnd}) {
+		p.warm = append(p.warm, w)
+	}
+	p.mu.Unlock()
+
+	if prewarm {
+		prometrics.IncPoolPrewarm(p.functionID, "ok")
+	}
+	p.logger.Info("Successfully spawned worker %s for function %s in %v", w.GetID(), p.functionID, spawnEnd.Sub(spawnStart))
+}
+
+// Release hands a worker to the oldest waiter or returns it to the warm pool
+func (p *WorkerPool) Release(w worker.Worker) {
+	p.mu.Lock()
 
 	// Find worker in busy list
+	found := false
 	for i, bw := range p.busy {
 		if bw.GetID() == w.GetID() {
 			// Remove from busy
 			p.busy = append(p.busy[:i], p.busy[i+1:]...)
+			found = true
+			break
+		}
+	}
+	if !found {
+		p.mu.Unlock()
+		p.logger.Warn("Attempted to release worker %s that is not in busy list", w.GetID())
+		return
+	}
+	p.markIdle(w, time.Now())
 
-			// Check if worker is still healthy
-			if !w.HealthCheck() {
-				p.logger.Warn("Worker %s failed health check, terminating", w.GetID())
-				w.Terminate()
-				return
-			}
+	// Recycle a worker whose heartbeat crossed a threshold while it was
+	// busy, and the hosted worker of a pool that left its host
+	_, retiring := p.retiring[w.GetID()]
+	if _, ok := w.(*worker.HostedWorker); ok && p.dedicated {
+		retiring = true
+	}
+	if retiring {
+		delete(p.retiring, w.GetID())
+		p.spawnForWaiters()
+		p.mu.Unlock()
+		p.terminate(w)
+		return
+	}
 
-			// Add to warm pool if we need more warm workers
-			if len(p.warm) < p.warmWorkers {
-				p.warm = append(p.warm, w)
-				p.logger.Debug("Released worker %s to warm pool", w.GetID())
-			} else {
-				// Too many warm workers, terminate this one
-				p.logger.Debug("Too many warm workers, terminating %s", w.GetID())
-				w.Terminate()
-			}
-			return
-		}
+	// Check if worker is still healthy
+	if !w.HealthCheck() {
+		p.spawnForWaiters()
+		p.mu.Unlock()
+		p.logger.Warn("Worker %s failed health check, terminating", w.GetID())
+		p.terminate(w)
+		return
+	}
+
+	if p.serve(acquireResult{w: w}) {
+		p.mu.Unlock()
+		p.logger.Debug("Handed worker %s to a waiting invocation", w.GetID())
+		return
+	}
+
+	// Add to warm pool if we need more warm workers; borrowed workers beyond
+	// MaxWorkersPerFunction are returned to the node instead
+	if !p.draining && len(p.warm) < p.keepWarm() && len(p.busy)+len(p.warm)+p.spawning < p.maxWorkers {
+		p.warm = append(p.warm, w)
+		p.mu.Unlock()
+		p.logger.Debug("Released worker %s to warm pool", w.GetID())
+		return
 	}
+	p.mu.Unlock()
 
-	p.logger.Warn("Attempted to release worker %s that is not in busy list", w.GetID())
+	// Too many warm workers, terminate this one
+	p.logger.Debug("Too many warm workers, terminating %s", w.GetID())
+	p.terminate(w)
 }
 
-// Terminate kills a worker (e.g., on error)
+// Terminate kills a worker (e.g., on error). A worker the pool no longer
+// holds, such as one already terminated by Stop, is killed again but its
+// node budget slot is not released twice.
 func (p *WorkerPool) TerminateWorker(w worker.Worker) {
 	p.mu.Lock()
-	defer p.mu.Unlock()
+	found := false
 
 	// Remove from busy
 	for i, bw := range p.busy {
 		if bw.GetID() == w.GetID() {
 			p.busy = append(p.busy[:i], p.busy[i+1:]...)
+			p.markIdle(w, time.Now())
+			found = true
 			break
 		}
 	}
+	delete(p.retiring, w.GetID())
 
 	// Remove from warm
 	for i, ww := range p.warm {
 		if ww.GetID() == w.GetID() {
 			p.warm = append(p.warm[:i], p.warm[i+1:]...)
+			found = true
 			break
 		}
 	}
+	p.spawnForWaiters()
+	p.mu.Unlock()
 
-	w.Terminate()
+	if !found {
+		w.Terminate()
+		return
+	}
+	p.terminate(w)
 }
 
 // cleanupIdleWorkers periodically terminates idle workers
@@ -203,8 +644,12 @@ func (p *WorkerPool) cleanupIdleWorkers() {
 			now := time.Now()
 			var toTerminate []worker.Worker
 
-			// Check warm workers
+			// Check warm workers; with autoscaling the autoscaler owns the
+			// warm set down to its target
 			for i := len(p.warm) - 1; i >= 0; i-- {
+				if p.scaler != nil && len(p.warm) <= p.keepWarm() {
+					break
+				}
 				w := p.warm[i]
 				if now.Sub(w.GetLastUsed()) > p.idleTimeout {
 					toTerminate = append(toTerminate, w)
@@ -212,12 +657,13 @@ func (p *WorkerPool) cleanupIdleWorkers() {
 				}
 			}
 
+			p.mu.Unlock()
+
 			// Terminate idle workers
 			for _, w := range toTerminate {
 				p.logger.Debug("Terminating idle worker %s", w.GetID())
-				w.Terminate()
+				p.terminate(w)
 			}
-			p.mu.Unlock()
 
 		case <-p.cleanupStop:
 			return
@@ -236,6 +682,16 @@ func (p *WorkerPool) Stop() {
 	p.stopped = true
 	p.cleanupTicker.Stop()
 	close(p.cleanupStop)
+	for p.waiters.Len() > 0 {
+		p.serve(acquireResult{err: ErrPoolStopped})
+	}
+	if p.scaler != nil {
+		prometrics.DeletePoolScaling(p.functionID)
+	}
+	if p.budget.Load() != nil {
+		prometrics.DeletePoolRSS(p.functionID)
+	}
+	p.hosts.Load().release(p.functionID)
 
 	// Copy workers to avoid holding lock during termination
 	warmWorkers := make([]worker.Worker, len(p.warm))
@@ -255,13 +711,13 @@ func (p *WorkerPool) Stop() {
 
 	for _, w := range warmWorkers {
 		go func(w worker.Worker) {
-			w.Terminate()
+			p.terminate(w)
 			done <- true
 		}(w)
 	}
 	for _, w := range busyWorkers {
 		go func(w worker.Worker) {
-			w.Terminate()
+			p.terminate(w)
 			done <- true
 		}(w)
 	}
@@ -290,19 +746,211 @@ func (p *WorkerPool) Stop() {
 	p.logger.Info("Worker pool stopped for function %s", p.functionID)
 }
 
+// keepWarm is how many idle workers Release keeps. Must be called with p.mu held.
+func (p *WorkerPool) keepWarm() int {
+	if p.scaler == nil {
+		return p.warmWorkers
+	}
+	keep := p.scaler.target - len(p.busy) - p.spawning
+	if keep < p.warmWorkers {
+		keep = p.warmWorkers
+	}
+	return keep
+}
+
+// autoscale ticks the autoscaler: it starts workers in the background when
+// the target grows and retires idle ones when it shrinks
+func (p *WorkerPool) autoscale() {
+	ticker := time.NewTicker(p.scaler.interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+		case <-p.cleanupStop:
+			return
+		}
+
+		p.mu.Lock()
+		if p.stopped {
+			p.mu.Unlock()
+			return
+		}
+		d := p.scaler.tick(time.Now(), len(p.busy), p.serviceTime, p.warmWorkers, p.maxWorkers)
+		live := len(p.warm) + len(p.busy) + p.spawning
+		toSpawn := d.Target - live
+		if toSpawn < 0 {
+			toSpawn = 0
+		}
+		var retire []worker.Worker
+		if excess := len(p.warm) - p.keepWarm(); d.Target < d.Previous && excess > 0 {
+			// Retire the least recently used workers; Acquire takes from the front
+			retire = append(retire, p.warm[len(p.warm)-excess:]...)
+			p.warm = p.warm[:len(p.warm)-excess]
+		}
+		for i := 0; i < toSpawn; i++ {
+			if !p.startSpawn(true) {
+				break
+			}
+		}
+		p.mu.Unlock()
+
+		prometrics.SetPoolScaling(p.functionID, d.Target, d.ArrivalRate, d.ForecastRate, d.SpawnLatency.Seconds(), d.ServiceTime.Seconds())
+		if d.Target > d.Previous {
+			prometrics.IncPoolScaleEvent(p.functionID, "up")
+			p.logger.Info("Scaling function %s up to %d workers (%.1f req/s, forecast %.1f req/s, spawn %v, service %v)",
+				p.functionID, d.Target, d.ArrivalRate, d.ForecastRate, d.SpawnLatency, d.ServiceTime)
+		} else if d.Target < d.Previous {
+			prometrics.IncPoolScaleEvent(p.functionID, "down")
+			p.logger.Info("Scaling function %s down to %d workers (%.1f req/s), retiring %d idle",
+				p.functionID, d.Target, d.ArrivalRate, len(retire))
+		}
+
+		for _, w := range retire {
+			p.terminate(w)
+		}
+	}
+}
+
+// Profile collects a CPU profile from every live worker in the pool over the
+// given duration and merges the samples. Workers spawned while the profile is
+// running are not included.
+func (p *WorkerPool) Profile(ctx context.Context, duration time.Duration, hz int) (*ProfileResult, error) {
+	p.mu.RLock()
+	if p.stopped {
+		p.mu.RUnlock()
+		return nil, ErrPoolStopped
+	}
+	var profilers []worker.Profiler
+	for _, w := range p.warm {
+		if pw, ok := w.(worker.Profiler); ok {
+			profilers = append(profilers, pw)
+		}
+	}
+	for _, w := range p.busy {
+		if pw, ok := w.(worker.Profiler); ok {
+			profilers = append(profilers, pw)
+		}
+	}
+	total := len(p.warm) + len(p.busy)
+	p.mu.RUnlock()
+
+	if total == 0 {
+		return nil, ErrNoWorkers
+	}
+	if len(profilers) == 0 {
+		return nil, ErrNotProfilable
+	}
+
+	type profileOutcome struct {
+		profile *worker.ProfilePayload
+		err     error
+	}
+	outcomes := make(chan profileOutcome, len(profilers))
+	for _, pw := range profilers {
+		go func(pw worker.Profiler) {
+			profile, err := pw.Profile(ctx, duration, hz)
+			outcomes <- profileOutcome{profile: profile, err: err}
+		}(pw)
+	}
+
+	result := &ProfileResult{
+		FunctionID: p.functionID,
+		Version:    p.version,
+		Stacks:     make(map[string]int64),
+	}
+	var lastErr error
+	for range profilers {
+		outcome := <-outcomes
+		if outcome.err != nil {
+			p.logger.Warn("Failed to collect profile for function %s: %v", p.functionID, outcome.err)
+			lastErr = outcome.err
+			continue
+		}
+		result.Workers++
+		result.Samples += outcome.profile.Samples
+		result.Dropped += outcome.profile.Dropped
+		result.addFolded(outcome.profile.Folded)
+	}
+
+	if result.Workers == 0 {
+		return nil, fmt.Errorf("no worker returned a profile: %w", lastErr)
+	}
+	return result, nil
+}
+
+// ProfileResult is a CPU profile merged across a pool's workers
+type ProfileResult struct {
+	FunctionID string
+	Version    string
+	Workers    int
+	Samples    int64
+	Dropped    int64
+	Stacks     map[string]int64 // folded stack -> sample count
+}
+
+// addFolded merges "stack count" lines into the result
+func (r *ProfileResult) addFolded(folded string) {
+	for _, line := range strings.Split(folded, "\n") {
+		sep := strings.LastIndexByte(line, ' ')
+		if sep <= 0 {
+			continue
+		}
+		count, err := strconv.ParseInt(line[sep+1:], 10, 64)
+		if err != nil {
+			continue
+		}
+		r.Stacks[line[:sep]] += count
+	}
+}
+
+// Folded renders the merged profile in folded-stack format (as consumed by
+// flamegraph.pl and speedscope), heaviest stacks first
+func (r *ProfileResult) Folded() string {
+	stacks := make([]string, 0, len(r.Stacks))
+	for stack := range r.Stacks {
+		stacks = append(stacks, stack)
+	}
+	sort.Slice(stacks, func(i, j int) bool {
+		if r.Stacks[stacks[i]] != r.Stacks[stacks[j]] {
+			return r.Stacks[stacks[i]] > r.Stacks[stacks[j]]
+		}
+		return stacks[i] < stacks[j]
+	})
+
+	var b strings.Builder
+	for _, stack := range stacks {
+		b.WriteString(stack)
+		b.WriteByte(' ')
+		b.WriteString(strconv.FormatInt(r.Stacks[stack], 10))
+		b.WriteByte('\n')
+	}
+	return b.String()
+}
+
 // GetStats returns pool statistics
 func (p *WorkerPool) GetStats() PoolStats {
 	p.mu.RLock()
 	defer p.mu.RUnlock()
 
-	return PoolStats{
-		FunctionID:   p.functionID,
-		Version:      p.version,
-		WarmWorkers:  len(p.warm),
-		BusyWorkers:  len(p.busy),
-		MaxWorkers:   p.maxWorkers,
-		TotalWorkers: len(p.warm) + len(p.busy),
+	stats := PoolStats{
+		FunctionID:      p.functionID,
+		Version:         p.version,
+		WarmWorkers:     len(p.warm),
+		BusyWorkers:     len(p.busy),
+		MaxWorkers:      p.maxWorkers,
+		TotalWorkers:    len(p.warm) + len(p.busy),
+		SpawningWorkers: p.spawning,
+		ServiceTime:     p.serviceTime,
+		QueueDepth:      p.waiters.Len(),
+		TargetWorkers:   p.warmWorkers,
+		RSSBytes:        p.rssEstimate.Load() * int64(len(p.warm)+len(p.busy)),
+		Heat:            p.heatAt(time.Now()),
+	}
+	if p.scaler != nil {
+		stats.TargetWorkers = p.scaler.target
+		stats.ArrivalRate = p.scaler.level
 	}
+	return stats
 }
 
 // PoolStats represents pool statistics
@@ -313,4 +961,13 @@ type PoolStats struct {
 	BusyWorkers  int
 	MaxWorkers   int
 	TotalWorkers int
+	QueueDepth   int           // callers waiting for a worker
+	ServiceTime  time.Duration // smoothed acquire-to-release time
+	// Autoscaling; TargetWorkers is WarmWorkersPerFunction when it is disabled
+	SpawningWorkers int
+	TargetWorkers   int
+	ArrivalRate     float64 // smoothed req/s
+	// Node budget; RSSBytes is 0 until worker memory has been sampled
+	RSSBytes int64
+	Heat     float64 // decayed invocation count used to rank eviction victims
 }
@@ -0,0 +1,656 @@
+package pool
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/worker"
+)
+
+func TestProfileResultMergesFoldedStacks(t *testing.T) {
+	r := &ProfileResult{Stacks: make(map[string]int64)}
+	r.addFolded("main (a.js:1);handler (a.js:5) 3\nmain (a.js:1) 1\n")
+	r.addFolded("main (a.js:1);handler (a.js:5) 2\nmalformed\n\n")
+
+	if got := r.Stacks["main (a.js:1);handler (a.js:5)"]; got != 5 {
+		t.Errorf("Expected merged count 5, got %d", got)
+	}
+	if len(r.Stacks) != 2 {
+		t.Errorf("Expected 2 distinct stacks, got %d", len(r.Stacks))
+	}
+
+	want := "main (a.js:1);handler (a.js:5) 5\nmain (a.js:1) 1\n"
+	if got := r.Folded(); got != want {
+		t.Errorf("Folded() = %q, want %q", got, want)
+	}
+}
+
+// fakeWorker spawns after a delay and never fails
+type fakeWorker struct {
+	id         string
+	spawnDelay time.Duration
+}
+
+func (f *fakeWorker) Spawn(*config.WorkerConfig, string, string, map[string]string) error {
+	time.Sleep(f.spawnDelay)
+	return nil
+}
+func (f *fakeWorker) Invoke(context.Context, *worker.InvokePayload) (*worker.ResponsePayload, *worker.ErrorPayload, error) {
+	return &worker.ResponsePayload{Status: 200}, nil, nil
+}
+func (f *fakeWorker) Terminate() error             { return nil }
+func (f *fakeWorker) HealthCheck() bool            { return true }
+func (f *fakeWorker) GetState() worker.WorkerState { return worker.WorkerStateReady }
+func (f *fakeWorker) GetID() string                { return f.id }
+func (f *fakeWorker) GetLastUsed() time.Time       { return time.Now() }
+func (f *fakeWorker) GetInvocations() int64        { return 0 }
+
+func newFakePool(t *testing.T, maxWorkers int, spawnDelay time.Duration) (*WorkerPool, *int32) {
+	t.Helper()
+	cfg := &config.WorkerConfig{MaxWorkersPerFunction: maxWorkers, IdleTimeout: time.Minute}
+	p := NewPool("fn", "v1", "", cfg, "", "", nil, logger.New(io.Discard, logger.LevelError, ""))
+	var spawned int32
+	p.newWorker = func() worker.Worker {
+		n := atomic.AddInt32(&spawned, 1)
+		return &fakeWorker{id: fmt.Sprintf("w%d", n), spawnDelay: spawnDelay}
+	}
+	t.Cleanup(p.Stop)
+	return p, &spawned
+}
+
+func TestAcquireTakesReleasedWorkerBeforeSpawnCompletes(t *testing.T) {
+	p, spawned := newFakePool(t, 4, 200*time.Millisecond)
+	ctx := context.Background()
+
+	w1, cold, err := p.Acquire(ctx)
+	if err != nil || !cold {
+		t.Fatalf("first acquire: cold=%v err=%v, want a cold start", cold, err)
+	}
+
+	got := make(chan worker.Worker, 1)
+	go func() {
+		w, cold, err := p.Acquire(ctx)
+		if err != nil || cold {
+			t.Errorf("second acquire: cold=%v err=%v, want the released worker", cold, err)
+		}
+		got <- w
+	}()
+
+	// The second caller is waiting on a spawn; the pool lock must not be held meanwhile
+	time.Sleep(20 * time.Millisecond)
+	statsDone := make(chan PoolStats, 1)
+	go func() { statsDone <- p.GetStats() }()
+	select {
+	case st := <-statsDone:
+		if st.SpawningWorkers != 1 {
+			t.Errorf("spawning = %d, want 1", st.SpawningWorkers)
+		}
+	case <-time.After(50 * time.Millisecond):
+		t.Fatal("GetStats blocked behind a spawn")
+	}
+
+	start := time.Now()
+	p.Release(w1)
+	if w := <-got; w != w1 {
+		t.Fatalf("waiter got %v, want released %s", w, w1.GetID())
+	}
+	if waited := time.Since(start); waited > 100*time.Millisecond {
+		t.Fatalf("waiter waited %v for the spawn instead of taking the released worker", waited)
+	}
+
+	// The spawn still completes and its worker is kept warm
+	time.Sleep(250 * time.Millisecond)
+	if st := p.GetStats(); st.WarmWorkers != 1 || st.BusyWorkers != 1 || atomic.LoadInt32(spawned) != 2 {
+		t.Fatalf("after spawn: %+v, spawned %d", st, atomic.LoadInt32(spawned))
+	}
+}
+
+func TestAcquireCancelledWhileWaiting(t *testing.T) {
+	p, _ := newFakePool(t, 1, 100*time.Millisecond)
+	ctx, cancel := context.WithTimeout(context.Background(), 10*time.Millisecond)
+	defer cancel()
+	if _, _, err := p.Acquire(ctx); err != context.DeadlineExceeded {
+		t.Fatalf("err = %v, want deadline exceeded", err)
+	}
+	time.Sleep(150 * time.Millisecond)
+	if st := p.GetStats(); st.WarmWorkers != 1 || p.waiters.Len() != 0 {
+		t.Fatalf("abandoned spawn: %+v, waiters %d", st, p.waiters.Len())
+	}
+
+}
+
+func TestAutoscalerCountsUnservedArrivals(t *testing.T) {
+	p, _ := newFakePool(t, 1, 0)
+	p.scaler = newAutoscaler(time.Second, time.Second, 0)
+	if _, _, err := p.Acquire(context.Background()); err != nil {
+		t.Fatalf("acquire: %v", err)
+	}
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	if _, _, err := p.Acquire(ctx); err != context.Canceled {
+		t.Fatalf("err = %v, want canceled", err)
+	}
+	p.mu.RLock()
+	defer p.mu.RUnlock()
+	if p.scaler.arrivals != 2 || p.scaler.peakBusy != 1 {
+		t.Errorf("arrivals %d, peak busy %d; want 2 arrivals (one unserved) and peak 1", p.scaler.arrivals, p.scaler.peakBusy)
+	}
+}
+
+func TestAcquireQueuesAtMaxWorkers(t *testing.T) {
+	p, spawned := newFakePool(t, 1, 0)
+	p.maxQueued = 2
+	w, _, err := p.Acquire(context.Background())
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Two callers queue in order, the third is rejected
+	order := make(chan int, 2)
+	for i := 0; i < 2; i++ {
+		i := i
+		go func() {
+			w, cold, err := p.Acquire(context.Background())
+			if err != nil || cold {
+				t.Errorf("queued acquire %d: cold=%v err=%v", i, cold, err)
+				return
+			}
+			order <- i
+			p.Release(w)
+		}()
+		for p.GetStats().QueueDepth != i+1 {
+			time.Sleep(time.Millisecond)
+		}
+	}
+	if _, _, err := p.Acquire(context.Background()); !errors.Is(err, ErrQueueFull) {
+		t.Fatalf("err = %v, want ErrQueueFull", err)
+	}
+
+	// A cancelled waiter leaves the queue without disturbing the others
+	ctx, cancel := context.WithCancel(context.Background())
+	p.mu.Lock()
+	p.maxQueued = 3
+	p.mu.Unlock()
+	cancelled := make(chan error, 1)
+	go func() {
+		_, _, err := p.Acquire(ctx)
+		cancelled <- err
+	}()
+	for p.GetStats().QueueDepth != 3 {
+		time.Sleep(time.Millisecond)
+	}
+	cancel()
+	if err := <-cancelled; err != context.Canceled {
+		t.Fatalf("cancelled waiter: %v", err)
+	}
+
+	p.Release(w)
+	if first, second := <-order, <-order; first != 0 || second != 1 {
+		t.Fatalf("served %d then %d, want FIFO", first, second)
+	}
+	if n := atomic.LoadInt32(spawned); n != 1 {
+		t.Fatalf("spawned %d workers, want 1", n)
+	}
+}
+
+func TestAcquireEarliestDeadlineFirstAndAdmission(t *testing.T) {
+	p, _ := newFakePool(t, 1, 0)
+	w, _, err := p.Acquire(context.Background())
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Queued out of deadline order, served in it
+	served := make(chan time.Duration, 2)
+	for i, d := range []time.Duration{time.Minute, time.Second} {
+		d := d
+		go func() {
+			ctx, cancel := context.WithTimeout(context.Background(), d)
+			defer cancel()
+			w, _, err := p.Acquire(ctx)
+			if err != nil {
+				t.Errorf("acquire with %v deadline: %v", d, err)
+				return
+			}
+			served <- d
+			p.Release(w)
+		}()
+		for p.GetStats().QueueDepth != i+1 {
+			time.Sleep(time.Millisecond)
+		}
+	}
+	p.Release(w)
+	if first, second := <-served, <-served; first != time.Second || second != time.Minute {
+		t.Fatalf("served %v then %v, want earliest deadline first", first, second)
+	}
+
+	// With a 200ms service time, a 100ms deadline cannot be met behind a busy worker
+	w, _, err = p.Acquire(context.Background())
+	if err != nil {
+		t.Fatal(err)
+	}
+	p.mu.Lock()
+	p.serviceTime = 200 * time.Millisecond
+	p.mu.Unlock()
+	ctx, cancel := context.WithTimeout(context.Background(), 100*time.Millisecond)
+	defer cancel()
+	_, _, err = p.Acquire(ctx)
+	var ae *AdmissionError
+	if !errors.As(err, &ae) || !errors.Is(err, ErrDeadlineUnmeetable) || ae.RetryAfter < time.Second {
+		t.Fatalf("err = %v, want ErrDeadlineUnmeetable with Retry-After", err)
+	}
+
+	// A waiter whose deadline passes while queued is not handed the worker
+	p.mu.Lock()
+	p.serviceTime = 0
+	p.mu.Unlock()
+	ctx, cancel = context.WithTimeout(context.Background(), 20*time.Millisecond)
+	defer cancel()
+	expired := make(chan error, 1)
+	go func() {
+		_, _, err := p.Acquire(ctx)
+		expired <- err
+	}()
+	for p.GetStats().QueueDepth != 1 {
+		time.Sleep(time.Millisecond)
+	}
+	p.mu.Lock()
+	time.Sleep(30 * time.Millisecond) // deadline passes while the waiter cannot unlink itself
+	p.mu.Unlock()
+	p.Release(w)
+	if err := <-expired; err != context.DeadlineExceeded {
+		t.Fatalf("expired waiter: %v", err)
+	}
+	if st := p.GetStats(); st.BusyWorkers != 0 {
+		t.Fatalf("worker went to an expired waiter: %+v", st)
+	}
+}
+
+func TestBudgetEvictsIdleWorkerOfColderPool(t *testing.T) {
+	log := logger.New(io.Discard, logger.LevelError, "")
+	budget := NewBudget(&config.WorkerConfig{MaxWorkersPerNode: 2}, log)
+	defer budget.Stop()
+	cold, _ := newFakePool(t, 2, 0)
+	hot, _ := newFakePool(t, 2, 0)
+	cold.warmWorkers = 1
+	budget.Attach(cold)
+	budget.Attach(hot)
+	ctx := context.Background()
+
+	w, _, err := cold.Acquire(ctx)
+	if err != nil {
+		t.Fatal(err)
+	}
+	cold.Release(w)
+	if _, _, err := hot.Acquire(ctx); err != nil {
+		t.Fatal(err)
+	}
+	hot.mu.Lock()
+	hot.heat, hot.heatUpdated = 10, time.Now()
+	hot.mu.Unlock()
+
+	// The node is full; the hot pool's caller takes the cold pool's idle slot
+	ctx, cancel := context.WithTimeout(ctx, 2*time.Second)
+	defer cancel()
+	if _, cold, err := hot.Acquire(ctx); err != nil || !cold {
+		t.Fatalf("acquire at node capacity: cold=%v err=%v", cold, err)
+	}
+	if st := cold.GetStats(); st.WarmWorkers != 0 {
+		t.Errorf("cold pool kept %d idle workers, want the idle one evicted", st.WarmWorkers)
+	}
+	if st := budget.Stats(); st.Workers != 2 {
+		t.Errorf("node workers = %d, want 2", st.Workers)
+	}
+}
+
+func TestBudgetLendsWorkersBeyondPoolMax(t *testing.T) {
+	budget := NewBudget(&config.WorkerConfig{MaxWorkersPerNode: 4, BorrowWorkers: 1}, logger.New(io.Discard, logger.LevelError, ""))
+	defer budget.Stop()
+	p, spawned := newFakePool(t, 1, 0)
+	p.warmWorkers = 1
+	budget.Attach(p)
+	ctx := context.Background()
+
+	w1, _, err := p.Acquire(ctx)
+	if err != nil {
+		t.Fatal(err)
+	}
+	w2, cold, err := p.Acquire(ctx)
+	if err != nil || !cold {
+		t.Fatalf("borrowed acquire: cold=%v err=%v", cold, err)
+	}
+
+	// The borrowed worker is returned to the node instead of kept warm
+	p.Release(w2)
+	p.Release(w1)
+	if st := p.GetStats(); st.WarmWorkers != 1 || atomic.LoadInt32(spawned) != 2 {
+		t.Fatalf("after release: %+v, spawned %d", st, atomic.LoadInt32(spawned))
+	}
+	if st := budget.Stats(); st.Workers != 1 {
+		t.Errorf("node workers = %d, want 1", st.Workers)
+	}
+}
+
+func TestBudgetReleasesEachWorkerOnce(t *testing.T) {
+	budget := NewBudget(&config.WorkerConfig{MaxWorkersPerNode: 4, MaxNodeMemoryMB: 1024, MemorySampleInterval: time.Hour}, logger.New(io.Discard, logger.LevelError, ""))
+	defer budget.Stop()
+	p, _ := newFakePool(t, 2, 0)
+	budget.Attach(p)
+	p.rssEstimate.Store(10 << 20)
+	ctx := context.Background()
+
+	w, _, err := p.Acquire(ctx)
+	if err != nil {
+		t.Fatal(err)
+	}
+	// A new sample changes the estimate; the worker gives back what it reserved
+	p.rssEstimate.Store(30 << 20)
+	p.TerminateWorker(w)
+	p.TerminateWorker(w)
+	if st := budget.Stats(); st.Workers != 0 || st.RSSBytes != 0 {
+		t.Errorf("after terminating twice: %d workers, %d bytes; want 0 and 0", st.Workers, st.RSSBytes)
+	}
+}
+
+// loaderWorker is a blank worker that records the function loaded into it
+type loaderWorker struct {
+	fakeWorker
+	loaded string
+}
+
+func (l *loaderWorker) Load(_ context.Context, functionID, _, _ string, _ *capabilities.Capabilities, _ bool) error {
+	l.loaded = functionID
+	return nil
+}
+
+func TestColdAcquireBindsBlankWorker(t *testing.T) {
+	blank := NewBlankPool(&config.WorkerConfig{BlankWorkers: 1}, logger.New(io.Discard, logger.LevelError, ""))
+	defer blank.Stop()
+	var blanks int32
+	blank.newWorker = func() worker.Worker {
+		n := atomic.AddInt32(&blanks, 1)
+		return &loaderWorker{fakeWorker: fakeWorker{id: fmt.Sprintf("b%d", n)}}
+	}
+	waitBlank := func(ready int) {
+		t.Helper()
+		deadline := time.Now().Add(2 * time.Second)
+		for blank.Stats().Ready != ready {
+			if time.Now().After(deadline) {
+				t.Fatalf("Expected %d ready blank workers, got %+v", ready, blank.Stats())
+			}
+			time.Sleep(time.Millisecond)
+		}
+	}
+	blank.mu.Lock()
+	blank.fillLocked()
+	blank.mu.Unlock()
+	waitBlank(1)
+
+	p, spawned := newFakePool(t, 2, 0)
+	p.SetBlankPool(blank)
+	w, cold, err := p.Acquire(context.Background())
+	if err != nil || !cold {
+		t.Fatalf("cold acquire: cold=%v err=%v", cold, err)
+	}
+	lw, ok := w.(*loaderWorker)
+	if !ok || lw.loaded != "fn" {
+		t.Fatalf("Expected a blank worker bound to fn, got %T %+v", w, w)
+	}
+	if n := atomic.LoadInt32(spawned); n != 0 {
+		t.Errorf("Expected no dedicated spawn, got %d", n)
+	}
+	// The taken worker is replaced in the background
+	waitBlank(1)
+	if n := atomic.LoadInt32(&blanks); n != 2 {
+		t.Errorf("Expected 2 blank spawns, got %d", n)
+	}
+}
+
+// reloaderWorker is a worker that records the bundle versions reloaded into it
+type reloaderWorker struct {
+	fakeWorker
+	mu         sync.Mutex
+	version    string
+	terminated bool
+}
+
+func (r *reloaderWorker) Reload(_ context.Context, version, _ string) error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.version = version
+	return nil
+}
+
+func (r *reloaderWorker) Terminate() error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.terminated = true
+	return nil
+}
+
+func TestTakeOverReloadsIdleWorkersAndDrainsBusyOnes(t *testing.T) {
+	old, _ := newFakePool(t, 4, 0)
+	old.warmWorkers = 2
+	var n int32
+	old.newWorker = func() worker.Worker {
+		id := fmt.Sprintf("old%d", atomic.AddInt32(&n, 1))
+		return &reloaderWorker{fakeWorker: fakeWorker{id: id}, version: "v1"}
+	}
+	ctx := context.Background()
+	var acquired []worker.Worker
+	for i := 0; i < 3; i++ {
+		w, _, err := old.Acquire(ctx)
+		if err != nil {
+			t.Fatalf("acquire: %v", err)
+		}
+		acquired = append(acquired, w)
+	}
+	old.Release(acquired[0])
+	old.Release(acquired[1])
+
+	p, spawned := newFakePool(t, 4, 0)
+	p.version = "v2"
+	if warm := p.TakeOver(ctx, old); warm != 3 {
+		t.Fatalf("TakeOver: %d warm workers, want 3 (2 reloaded, 1 new)", warm)
+	}
+	if n := atomic.LoadInt32(spawned); n != 1 {
+		t.Errorf("Expected 1 new worker, got %d", n)
+	}
+	for _, w := range acquired[:2] {
+		rw := w.(*reloaderWorker)
+		if rw.version != "v2" || rw.terminated {
+			t.Errorf("worker %s: version %s terminated %v, want reloaded to v2", rw.id, rw.version, rw.terminated)
+		}
+	}
+
+	drained := make(chan struct{})
+	go func() {
+		old.Drain(time.Minute)
+		close(drained)
+	}()
+	select {
+	case <-drained:
+		t.Fatal("Drain returned while an invocation was in flight")
+	case <-time.After(50 * time.Millisecond):
+	}
+	old.Release(acquired[2])
+	select {
+	case <-drained:
+	case <-time.After(2 * time.Second):
+		t.Fatal("Drain did not return after the last worker was released")
+	}
+	if rw := acquired[2].(*reloaderWorker); !rw.terminated || rw.version != "v1" {
+		t.Errorf("busy worker: version %s terminated %v, want v1 terminated after release", rw.version, rw.terminated)
+	}
+	if _, _, err := old.Acquire(ctx); err != ErrPoolStopped {
+		t.Errorf("acquire on drained pool: %v, want ErrPoolStopped", err)
+	}
+}
+
+type statsWorker struct {
+	reloaderWorker
+	stats atomic.Pointer[worker.WorkerStats]
+}
+
+func (s *statsWorker) Stats() (worker.WorkerStats, bool) {
+	if st := s.stats.Load(); st != nil {
+		return *st, true
+	}
+	return worker.WorkerStats{}, false
+}
+
+func (s *statsWorker) isTerminated() bool {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.terminated
+}
+
+func TestHealthCheckRecyclesWorkers(t *testing.T) {
+	cfg := &config.WorkerConfig{
+		MaxWorkersPerFunction: 4,
+		IdleTimeout:           time.Minute,
+		MemoryLimitMB:         100,
+		StatsInterval:         20 * time.Millisecond,
+		RecycleMemoryRatio:    0.9,
+		ExecutionTimeout:      time.Second,
+	}
+	p := NewPool("fn", "v1", "", cfg, "", "", nil, logger.New(io.Discard, logger.LevelError, ""))
+	t.Cleanup(p.Stop)
+	var n int32
+	p.newWorker = func() worker.Worker {
+		sw := &statsWorker{reloaderWorker: reloaderWorker{fakeWorker: fakeWorker{id: fmt.Sprintf("w%d", atomic.AddInt32(&n, 1))}}}
+		sw.stats.Store(&worker.WorkerStats{ReceivedAt: time.Now().Add(time.Hour)})
+		return sw
+	}
+
+	ctx := context.Background()
+	var ws []*statsWorker
+	for i := 0; i < 3; i++ {
+		w, _, err := p.Acquire(ctx)
+		if err != nil {
+			t.Fatalf("acquire: %v", err)
+		}
+		ws = append(ws, w.(*statsWorker))
+	}
+	p.Release(ws[0])
+	p.Release(ws[1])
+
+	// ws[0] is warm and over its memory limit, ws[1] stopped sending
+	// heartbeats, ws[2] is busy and lagging
+	ws[0].stats.Store(&worker.WorkerStats{StatsPayload: worker.StatsPayload{RSS: 95 << 20}, ReceivedAt: time.Now().Add(time.Hour)})
+	ws[1].stats.Store(&worker.WorkerStats{ReceivedAt: time.Now().Add(-time.Second)})
+	ws[2].stats.Store(&worker.WorkerStats{StatsPayload: worker.StatsPayload{LagMS: 2000}, ReceivedAt: time.Now().Add(time.Hour)})
+
+	marked := func() string {
+		p.mu.RLock()
+		defer p.mu.RUnlock()
+		return p.retiring[ws[2].GetID()]
+	}
+	deadline := time.Now().Add(2 * time.Second)
+	for !(ws[0].isTerminated() && ws[1].isTerminated() && marked() != "") {
+		if time.Now().After(deadline) {
+			t.Fatal("workers over a threshold were not recycled")
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+	if ws[2].isTerminated() {
+		t.Fatal("busy worker was terminated during its invocation")
+	}
+	if reason := marked(); reason != "lag" {
+		t.Fatalf("busy worker marked %q, want lag", reason)
+	}
+	p.Release(ws[2])
+	if !ws[2].isTerminated() {
+		t.Error("marked worker was returned to the pool on release")
+	}
+	if st := p.GetStats(); st.BusyWorkers != 0 {
+		t.Errorf("after recycling: %+v", st)
+	}
+}
+
+func TestHostingLeavesHotAndConcurrentFunctions(t *testing.T) {
+	p, _ := newFakePool(t, 4, 0)
+	g := NewHostGroup(&config.WorkerConfig{HostProcesses: 1}, p.logger)
+	starts := 0
+	g.start = func() (*worker.HostProcess, error) {
+		starts++
+		return nil, errors.New("no host in tests")
+	}
+	p.SetHostGroup(g)
+
+	// A function with rlimits is hosted only when the operator opts in
+	p.cfg.Capabilities = &capabilities.Capabilities{MaxMemory: 64 << 20}
+	if p.hostedWorker(); starts != 0 {
+		t.Fatal("Expected a function with max_memory not to be hosted by default")
+	}
+	p.cfg.HostLimitedFunctions = true
+	if p.hostedWorker(); starts != 1 {
+		t.Fatal("Expected HostLimitedFunctions to host it")
+	}
+	p.cfg.Capabilities = nil
+
+	p.mu.Lock()
+	p.heat, p.heatUpdated = 2*hostMaxHeat, time.Now()
+	p.mu.Unlock()
+	if p.hostedWorker(); starts != 1 {
+		t.Fatal("Expected a hot function not to be hosted")
+	}
+
+	// A second concurrent invocation moves a cold function off its host
+	hosted := worker.NewHostedWorker(nil, "fn", "v1", "", p.logger)
+	p.mu.Lock()
+	p.heat = 0
+	p.hosted.Store(true)
+	p.warm = append(p.warm, hosted)
+	p.mu.Unlock()
+	ctx := context.Background()
+	w1, _, err := p.Acquire(ctx)
+	if err != nil || w1 != hosted {
+		t.Fatalf("Expected the hosted worker first, got %v (%v)", w1, err)
+	}
+	w2, cold, err := p.Acquire(ctx)
+	if err != nil || !cold {
+		t.Fatalf("Expected a dedicated worker spawned, got cold=%v (%v)", cold, err)
+	}
+	p.Release(w1)
+	p.Release(w2)
+	if hosted.GetState() != worker.WorkerStateTerminated || p.hosted.Load() {
+		t.Errorf("Expected the hosted worker retired, got %s", hosted.GetState())
+	}
+	if p.hostedWorker(); starts != 1 {
+		t.Error("Expected no hosted worker after the function left its host")
+	}
+}
+
+func TestHostGroupForgetsFunctionsWithoutHostedWorkers(t *testing.T) {
+	p, _ := newFakePool(t, 1, 0)
+	g := NewHostGroup(&config.WorkerConfig{HostProcesses: 1}, p.logger)
+	p.SetHostGroup(g)
+	assigned := func() int {
+		g.mu.Lock()
+		defer g.mu.Unlock()
+		return len(g.assigned)
+	}
+
+	g.assigned["fn"] = &worker.HostProcess{}
+	p.hosted.Store(true)
+	p.terminate(worker.NewHostedWorker(nil, "fn", "v1", "", p.logger))
+	if n := assigned(); n != 0 {
+		t.Fatalf("Expected the function forgotten once its hosted worker terminated, got %d", n)
+	}
+
+	g.assigned["fn"] = &worker.HostProcess{}
+	p.Stop()
+	if n := assigned(); n != 0 {
+		t.Errorf("Expected the function forgotten when its pool stopped, got %d", n)
+	}
+}
@@ -3,6 +3,7 @@ package prometrics
 import (
 	"net/http"
 	"sync"
+	"sync/atomic"
 
 	"github.com/prometheus/client_golang/prometheus"
 	"github.com/prometheus/client_golang/prometheus/promauto"
@@ -10,10 +11,120 @@ import (
 )
 
 var (
-	once     sync.Once
-	logLines *prometheus.CounterVec
+	once            sync.Once
+	logLines        *prometheus.CounterVec
+	logLinesDropped *prometheus.CounterVec
+	logPushes       *prometheus.CounterVec
+
+	poolTargetWorkers *prometheus.GaugeVec
+	poolArrivalRate   *prometheus.GaugeVec
+	poolForecastRate  *prometheus.GaugeVec
+	poolSpawnLatency  *prometheus.GaugeVec
+	poolServiceTime   *prometheus.GaugeVec
+	poolScaleEvents   *prometheus.CounterVec
+	poolPrewarms      *prometheus.CounterVec
+
+	admissionRejected *prometheus.CounterVec
+	queueExpired      *prometheus.CounterVec
+
+	tenantQueueWait *prometheus.HistogramVec
+	tenantThrottled *prometheus.CounterVec
+	tenantRunning   *prometheus.GaugeVec
+
+	nodeWorkers     prometheus.Gauge
+	nodeRSS         prometheus.Gauge
+	workerPressure  *prometheus.GaugeVec
+	poolRSS         *prometheus.GaugeVec
+	budgetEvictions *prometheus.CounterVec
+	blankBinds      *prometheus.CounterVec
+	hostProcesses   prometheus.Gauge
+	workerReloads   *prometheus.CounterVec
+
+	invocationDuration *prometheus.HistogramVec
+	queueWait          *prometheus.HistogramVec
+	spawnDuration      *prometheus.HistogramVec
+	responseBodyBytes  *prometheus.HistogramVec
+	workerHeapBytes    *prometheus.HistogramVec
+	workerRSSBytes     *prometheus.HistogramVec
+	workerGCs          *prometheus.CounterVec
+	ipcBytes           *prometheus.CounterVec
+	deadlineExceeded   *prometheus.CounterVec
+	workerCrashes      *prometheus.CounterVec
+	workerRecycles     *prometheus.CounterVec
+
+	pools = &poolCollector{
+		workers: prometheus.NewDesc("fn_pool_workers",
+			"Workers of a function's pool by state (warm, busy, spawning); their sum is the pool's total",
+			[]string{"function_id", "state"}, nil),
+		queueDepth: prometheus.NewDesc("fn_pool_queue_depth",
+			"Callers waiting in a function's pool for a worker",
+			[]string{"function_id"}, nil),
+	}
 )
 
+// maxFunctionLabels bounds the function_id values a metric can carry. Functions
+// seen after the limit is reached are reported as OtherFunctions, so a node
+// hosting many short-lived functions cannot grow the series without bound.
+const maxFunctionLabels = 2000
+
+// maxProjectLabels bounds the project_id values of the tenant metrics the same
+// way. Project IDs come from a request header, so they are capped too.
+const maxProjectLabels = 1000
+
+// OtherFunctions is the function_id of functions beyond maxFunctionLabels, and
+// the project_id of projects beyond maxProjectLabels.
+// SharedProcess is the function_id of traffic of processes not dedicated to one
+// function (host and blank workers).
+const (
+	OtherFunctions = "_other"
+	SharedProcess  = "_shared"
+)
+
+// labelSet admits up to max distinct values of a label; later values are
+// reported as OtherFunctions
+type labelSet struct {
+	sync.RWMutex
+	max  int
+	seen map[string]struct{}
+}
+
+var (
+	functionLabels = &labelSet{max: maxFunctionLabels, seen: make(map[string]struct{})}
+	projectLabels  = &labelSet{max: maxProjectLabels, seen: make(map[string]struct{})}
+)
+
+func (s *labelSet) label(value string) string {
+	if value == "" {
+		return "unknown"
+	}
+	s.RLock()
+	_, ok := s.seen[value]
+	s.RUnlock()
+	if ok {
+		return value
+	}
+	s.Lock()
+	defer s.Unlock()
+	if _, ok := s.seen[value]; ok {
+		return value
+	}
+	if len(s.seen) >= s.max {
+		return OtherFunctions
+	}
+	s.seen[value] = struct{}{}
+	return value
+}
+
+// functionLabel returns the function_id label value of a function
+func functionLabel(functionID string) string {
+	return functionLabels.label(functionID)
+}
+
+// projectLabel returns the project_id label value of a project
+func projectLabel(projectID string) string {
+	return projectLabels.label(projectID)
+}
+
 func init() {
 	logLines = promauto.NewCounterVec(
 		prometheus.CounterOpts{
@@ -22,17 +133,495 @@ func init() {
 		},
 		[]string{"function_id", "level"},
 	)
+	logLinesDropped = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_log_lines_dropped_total",
+			Help: "Function log lines not shipped because the log pipeline was behind or its sink failed",
+		},
+		[]string{"reason"},
+	)
+	logPushes = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_log_pushes_total",
+			Help: "Batched pushes of function log lines to the log sink",
+		},
+		[]string{"result"},
+	)
+
+	poolTargetWorkers = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_target_workers",
+			Help: "Workers the autoscaler keeps alive for a function (warm + busy)",
+		},
+		[]string{"function_id"},
+	)
+	poolArrivalRate = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_arrival_rate",
+			Help: "Smoothed invocation arrival rate per second",
+		},
+		[]string{"function_id"},
+	)
+	poolForecastRate = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_forecast_arrival_rate",
+			Help: "Arrival rate per second predicted one spawn latency ahead",
+		},
+		[]string{"function_id"},
+	)
+	poolSpawnLatency = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_spawn_latency_seconds",
+			Help: "Smoothed worker spawn latency used for scaling",
+		},
+		[]string{"function_id"},
+	)
+	poolServiceTime = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_service_time_seconds",
+			Help: "Smoothed time a worker is held per invocation",
+		},
+		[]string{"function_id"},
+	)
+	poolScaleEvents = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_pool_scale_events_total",
+			Help: "Autoscaler target changes",
+		},
+		[]string{"function_id", "direction"},
+	)
+	poolPrewarms = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_pool_prewarm_spawns_total",
+			Help: "Workers spawned ahead of demand by the autoscaler",
+		},
+		[]string{"function_id", "result"},
+	)
+
+	admissionRejected = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_admission_rejected_total",
+			Help: "Invocations rejected before queueing",
+		},
+		[]string{"function_id", "reason"},
+	)
+	queueExpired = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_queue_expired_total",
+			Help: "Queued invocations dropped because their deadline passed before a worker was free",
+		},
+		[]string{"function_id"},
+	)
+
+	tenantQueueWait = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_tenant_queue_wait_seconds",
+			Help:    "Time invocations waited in the fair queue for a project slot",
+			Buckets: prometheus.ExponentialBuckets(0.001, 2, 15),
+		},
+		[]string{"project_id"},
+	)
+	tenantThrottled = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_tenant_throttled_total",
+			Help: "Invocations that had to wait for a project slot",
+		},
+		[]string{"project_id", "reason"},
+	)
+	tenantRunning = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_tenant_running",
+			Help: "Invocations currently holding a project slot",
+		},
+		[]string{"project_id"},
+	)
+
+	nodeWorkers = promauto.NewGauge(
+		prometheus.GaugeOpts{
+			Name: "fn_node_workers",
+			Help: "Live and spawning workers counted against the node budget",
+		},
+	)
+	nodeRSS = promauto.NewGauge(
+		prometheus.GaugeOpts{
+			Name: "fn_node_worker_rss_bytes",
+			Help: "Measured resident memory of all workers on the node",
+		},
+	)
+	workerPressure = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_worker_pressure_percent",
+			Help: "Share of the last 10s in which worker tasks stalled on a resource (PSI some avg10), from the worker cgroup root",
+		},
+		[]string{"resource"},
+	)
+	poolRSS = promauto.NewGaugeVec(
+		prometheus.GaugeOpts{
+			Name: "fn_pool_rss_bytes",
+			Help: "Measured resident memory of a function's workers",
+		},
+		[]string{"function_id"},
+	)
+	budgetEvictions = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_budget_evictions_total",
+			Help: "Idle workers evicted to keep the node within its worker or memory budget",
+		},
+		[]string{"function_id", "reason"},
+	)
+	blankBinds = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_blank_worker_binds_total",
+			Help: "Cold misses served by binding a pre-spawned blank worker",
+		},
+		[]string{"function_id", "result"},
+	)
+	workerReloads = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_worker_reloads_total",
+			Help: "Idle workers moved to a new deployment by reloading their bundle in place",
+		},
+		[]string{"function_id", "result"},
+	)
+	hostProcesses = promauto.NewGauge(
+		prometheus.GaugeOpts{
+			Name: "fn_host_processes",
+			Help: "Live QuickJS host processes running functions in shared runtimes",
+		},
+	)
+
+	invocationDuration = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_invocation_duration_seconds",
+			Help:    "Invocation latency from scheduling to response, including queueing and cold starts",
+			Buckets: prometheus.ExponentialBuckets(0.001, 2, 16),
+		},
+		[]string{"function_id", "start", "outcome"},
+	)
+	queueWait = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_pool_queue_wait_seconds",
+			Help:    "Time callers that found every worker busy waited for one to be released",
+			Buckets: prometheus.ExponentialBuckets(0.0005, 2, 16),
+		},
+		[]string{"function_id"},
+	)
+	spawnDuration = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_worker_spawn_seconds",
+			Help:    "Time to make a worker ready: start a process, bind a blank worker or load into a host",
+			Buckets: prometheus.ExponentialBuckets(0.005, 2, 12),
+		},
+		[]string{"function_id", "kind"},
+	)
+	responseBodyBytes = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_response_body_bytes",
+			Help:    "Size of decoded invocation response bodies",
+			Buckets: prometheus.ExponentialBuckets(64, 4, 12),
+		},
+		[]string{"function_id"},
+	)
+	workerHeapBytes = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_worker_heap_bytes",
+			Help:    "JS heap size reported by workers with responses and heartbeats, sampled at most once a second per worker",
+			Buckets: prometheus.ExponentialBuckets(1<<20, 2, 12),
+		},
+		[]string{"function_id"},
+	)
+	workerRSSBytes = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "fn_worker_rss_bytes",
+			Help:    "Resident set size of worker processes, from their heartbeats",
+			Buckets: prometheus.ExponentialBuckets(1<<20, 2, 12),
+		},
+		[]string{"function_id"},
+	)
+	workerGCs = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_worker_gc_total",
+			Help: "Garbage collections run by workers, from their heartbeats",
+		},
+		[]string{"function_id"},
+	)
+	ipcBytes = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_worker_ipc_bytes_total",
+			Help: "Bytes exchanged with worker processes over stdin (out) and stdout (in)",
+		},
+		[]string{"function_id", "direction"},
+	)
+	deadlineExceeded = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_deadline_exceeded_total",
+			Help: "Invocations whose deadline passed while queued for a worker or while executing",
+		},
+		[]string{"function_id", "stage"},
+	)
+	workerCrashes = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_worker_crashes_total",
+			Help: "Worker processes that exited without being terminated",
+		},
+		[]string{"function_id"},
+	)
+	workerRecycles = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "fn_worker_recycles_total",
+			Help: "Workers recycled because their heartbeats crossed a threshold, by reason (unresponsive, rss, heap, lag)",
+		},
+		[]string{"function_id", "reason"},
+	)
+	prometheus.MustRegister(pools)
 }
 
 // IncLogLines increments the log line counter for the given function and level.
 func IncLogLines(functionID, level string) {
-	if functionID == "" {
-		functionID = "unknown"
-	}
 	if level == "" {
 		level = "info"
 	}
-	logLines.WithLabelValues(functionID, level).Inc()
+	logLines.WithLabelValues(functionLabel(functionID), level).Inc()
+}
+
+// IncLogLinesDropped counts a log line not shipped; reason is "sampled", "queue_full" or "closed".
+func IncLogLinesDropped(reason string) {
+	logLinesDropped.WithLabelValues(reason).Inc()
+}
+
+// AddLogLinesDropped counts n lines not shipped; reason is "push_failed" (a batch the sink
+// rejected) or "rate_limited" (over the per-invocation log limits in the worker).
+func AddLogLinesDropped(reason string, n int) {
+	logLinesDropped.WithLabelValues(reason).Add(float64(n))
+}
+
+// IncLogPush counts a push attempt; result is "ok" or "error".
+func IncLogPush(result string) {
+	logPushes.WithLabelValues(result).Inc()
+}
+
+// SetPoolScaling records the autoscaler's latest estimates for a function.
+func SetPoolScaling(functionID string, target int, arrivalRate, forecastRate, spawnSeconds, serviceSeconds float64) {
+	functionID = functionLabel(functionID)
+	poolTargetWorkers.WithLabelValues(functionID).Set(float64(target))
+	poolArrivalRate.WithLabelValues(functionID).Set(arrivalRate)
+	poolForecastRate.WithLabelValues(functionID).Set(forecastRate)
+	poolSpawnLatency.WithLabelValues(functionID).Set(spawnSeconds)
+	poolServiceTime.WithLabelValues(functionID).Set(serviceSeconds)
+}
+
+// DeletePoolScaling removes a function's autoscaler gauges when its pool stops.
+func DeletePoolScaling(functionID string) {
+	poolTargetWorkers.DeleteLabelValues(functionID)
+	poolArrivalRate.DeleteLabelValues(functionID)
+	poolForecastRate.DeleteLabelValues(functionID)
+	poolSpawnLatency.DeleteLabelValues(functionID)
+	poolServiceTime.DeleteLabelValues(functionID)
+}
+
+// IncPoolScaleEvent counts an autoscaler decision; direction is "up" or "down".
+func IncPoolScaleEvent(functionID, direction string) {
+	poolScaleEvents.WithLabelValues(functionLabel(functionID), direction).Inc()
+}
+
+// IncPoolPrewarm counts a background spawn; result is "ok", "error" or
+// "pressure" (skipped while the worker cgroups are under pressure).
+func IncPoolPrewarm(functionID, result string) {
+	poolPrewarms.WithLabelValues(functionLabel(functionID), result).Inc()
+}
+
+// IncAdmissionRejected counts a shed invocation; reason is "queue_full" or "deadline".
+func IncAdmissionRejected(functionID, reason string) {
+	admissionRejected.WithLabelValues(functionLabel(functionID), reason).Inc()
+}
+
+// IncQueueExpired counts a queued invocation dropped at dispatch because its deadline passed.
+func IncQueueExpired(functionID string) {
+	queueExpired.WithLabelValues(functionLabel(functionID)).Inc()
+}
+
+// ObserveTenantQueueWait records how long an invocation waited for its project's turn.
+func ObserveTenantQueueWait(projectID string, seconds float64) {
+	tenantQueueWait.WithLabelValues(projectLabel(projectID)).Observe(seconds)
+}
+
+// IncTenantThrottled counts a queued invocation; reason is "node_capacity" or "project_cap".
+func IncTenantThrottled(projectID, reason string) {
+	tenantThrottled.WithLabelValues(projectLabel(projectID), reason).Inc()
+}
+
+// AddTenantRunning adds delta to a project's in-flight invocations. Projects
+// beyond the label limit share a series, so it is only ever added to.
+func AddTenantRunning(projectID string, delta int) {
+	tenantRunning.WithLabelValues(projectLabel(projectID)).Add(float64(delta))
+}
+
+// SetNodeWorkers records the workers counted against the node budget.
+func SetNodeWorkers(n int) {
+	nodeWorkers.Set(float64(n))
+}
+
+// SetNodeRSS records the measured memory of all workers.
+func SetNodeRSS(bytes int64) {
+	nodeRSS.Set(float64(bytes))
+}
+
+// SetWorkerPressure records the PSI of the worker cgroups; resource is "cpu" or "memory".
+func SetWorkerPressure(resource string, percent float64) {
+	workerPressure.WithLabelValues(resource).Set(percent)
+}
+
+// SetPoolRSS records the measured memory of a function's workers.
+func SetPoolRSS(functionID string, bytes int64) {
+	poolRSS.WithLabelValues(functionLabel(functionID)).Set(float64(bytes))
+}
+
+// DeletePoolRSS removes a function's memory gauge when its pool stops.
+func DeletePoolRSS(functionID string) {
+	poolRSS.DeleteLabelValues(functionID)
+}
+
+// IncBudgetEviction counts an evicted idle worker; reason is "workers" or "memory".
+func IncBudgetEviction(functionID, reason string) {
+	budgetEvictions.WithLabelValues(functionLabel(functionID), reason).Inc()
+}
+
+// IncBlankBind counts a cold miss that tried the blank pool; result is "ok", "error" or "empty".
+func IncBlankBind(functionID, result string) {
+	blankBinds.WithLabelValues(functionLabel(functionID), result).Inc()
+}
+
+// SetHostProcesses sets the number of live host processes
+func SetHostProcesses(n int) {
+	hostProcesses.Set(float64(n))
+}
+
+// IncWorkerReload counts an idle worker handed to a new deployment; result is "ok" or "error".
+func IncWorkerReload(functionID, result string) {
+	workerReloads.WithLabelValues(functionLabel(functionID), result).Inc()
+}
+
+// ObserveInvocation records an invocation's latency; outcome is "ok", "error" or "timeout".
+func ObserveInvocation(functionID string, cold bool, outcome string, seconds float64) {
+	start := "warm"
+	if cold {
+		start = "cold"
+	}
+	invocationDuration.WithLabelValues(functionLabel(functionID), start, outcome).Observe(seconds)
+}
+
+// ObserveQueueWait records how long a caller waited for a busy pool's next free worker.
+func ObserveQueueWait(functionID string, seconds float64) {
+	queueWait.WithLabelValues(functionLabel(functionID)).Observe(seconds)
+}
+
+// ObserveSpawn records a worker spawn; kind is "process", "blank" or "hosted".
+func ObserveSpawn(functionID, kind string, seconds float64) {
+	spawnDuration.WithLabelValues(functionLabel(functionID), kind).Observe(seconds)
+}
+
+// ObserveResponseBody records the size of a response body.
+func ObserveResponseBody(functionID string, bytes int) {
+	responseBodyBytes.WithLabelValues(functionLabel(functionID)).Observe(float64(bytes))
+}
+
+// ObserveWorkerHeap records a heap size a worker reported with a response.
+func ObserveWorkerHeap(functionID string, bytes int64) {
+	workerHeapBytes.WithLabelValues(functionLabel(functionID)).Observe(float64(bytes))
+}
+
+// ObserveWorkerStats records a worker heartbeat: its RSS and heap, and the
+// garbage collections since its previous heartbeat. Use SharedProcess for
+// processes that serve more than one function.
+func ObserveWorkerStats(functionID string, rss, heap, gcs int64) {
+	if functionID != SharedProcess {
+		functionID = functionLabel(functionID)
+	}
+	workerRSSBytes.WithLabelValues(functionID).Observe(float64(rss))
+	workerHeapBytes.WithLabelValues(functionID).Observe(float64(heap))
+	if gcs > 0 {
+		workerGCs.WithLabelValues(functionID).Add(float64(gcs))
+	}
+}
+
+// IPCBytes returns the counter of a worker process's bytes in one direction,
+// "in" or "out", for the worker to add to as it reads or writes. Use
+// SharedProcess for processes that serve more than one function.
+func IPCBytes(functionID, direction string) prometheus.Counter {
+	if functionID != SharedProcess {
+		functionID = functionLabel(functionID)
+	}
+	return ipcBytes.WithLabelValues(functionID, direction)
+}
+
+// IncDeadlineExceeded counts an invocation that ran out of time; stage is "queue" or "execution".
+func IncDeadlineExceeded(functionID, stage string) {
+	deadlineExceeded.WithLabelValues(functionLabel(functionID), stage).Inc()
+}
+
+// IncWorkerCrash counts a worker process that exited on its own.
+func IncWorkerCrash(functionID string) {
+	if functionID != SharedProcess {
+		functionID = functionLabel(functionID)
+	}
+	workerCrashes.WithLabelValues(functionID).Inc()
+}
+
+// IncWorkerRecycle counts a worker recycled after its heartbeats crossed a
+// threshold.
+func IncWorkerRecycle(functionID, reason string) {
+	workerRecycles.WithLabelValues(functionLabel(functionID), reason).Inc()
+}
+
+// PoolSample is the state of one function's pool at scrape time
+type PoolSample struct {
+	FunctionID string
+	Warm       int
+	Busy       int
+	Spawning   int
+	Queued     int
+}
+
+// SetPoolSource sets the function the pool gauges are read from when
+// /metrics is scraped, so they cost nothing between scrapes.
+func SetPoolSource(source func() []PoolSample) {
+	pools.source.Store(&source)
+}
+
+// poolCollector reports the pools of the current source at scrape time
+type poolCollector struct {
+	workers    *prometheus.Desc
+	queueDepth *prometheus.Desc
+	source     atomic.Pointer[func() []PoolSample]
+}
+
+func (c *poolCollector) Describe(ch chan<- *prometheus.Desc) {
+	ch <- c.workers
+	ch <- c.queueDepth
+}
+
+func (c *poolCollector) Collect(ch chan<- prometheus.Metric) {
+	source := c.source.Load()
+	if source == nil {
+		return
+	}
+	// Functions beyond the label limit share a series and are summed
+	byLabel := make(map[string]PoolSample)
+	for _, s := range (*source)() {
+		label := functionLabel(s.FunctionID)
+		sum := byLabel[label]
+		sum.Warm += s.Warm
+		sum.Busy += s.Busy
+		sum.Spawning += s.Spawning
+		sum.Queued += s.Queued
+		byLabel[label] = sum
+	}
+	for label, s := range byLabel {
+		ch <- prometheus.MustNewConstMetric(c.workers, prometheus.GaugeValue, float64(s.Warm), label, "warm")
+		ch <- prometheus.MustNewConstMetric(c.workers, prometheus.GaugeValue, float64(s.Busy), label, "busy")
+		ch <- prometheus.MustNewConstMetric(c.workers, prometheus.GaugeValue, float64(s.Spawning), label, "spawning")
+		ch <- prometheus.MustNewConstMetric(c.queueDepth, prometheus.GaugeValue, float64(s.Queued), label)
+	}
 }
 
 // Handler returns the Prometheus HTTP handler for /metrics.
@@ -1,8 +1,10 @@
 package router
 
 import (
+	"context"
 	"fmt"
 	"sync"
+	"sync/atomic"
 
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
 	"github.com/kartikbazzad/bunbase/functions/internal/metadata"
@@ -15,67 +17,275 @@ var (
 	ErrNotDeployed      = fmt.Errorf("function not deployed")
 )
 
-// Router routes function invocations to appropriate pools
+// Router routes function invocations to appropriate pools. Functions, their
+// active versions and their pools are kept in an in-memory routing table, so
+// routing an invocation never queries the metadata store: the table is
+// loaded by Load and refreshed when the store reports a change.
 type Router struct {
 	metadata  *metadata.Store
 	scheduler *scheduler.Scheduler
-	pools     map[string]*pool.WorkerPool // functionID -> pool
-	mu        sync.RWMutex
+	table     atomic.Pointer[routeTable] // copy-on-write; replaced under mu
+	mu        sync.RWMutex               // serializes table updates and pool registration
 	logger    *logger.Logger
+	budget    *pool.Budget    // optional node-wide worker budget
+	blank     *pool.BlankPool // optional pre-spawned blank workers
+	hosts     *pool.HostGroup // optional shared host processes
 }
 
-// NewRouter creates a new router
+// route is a function's entry in the routing table. Entries are never
+// modified once published; a change publishes a new one.
+type route struct {
+	fn      *metadata.Function        // nil for a pool registered without metadata
+	version *metadata.FunctionVersion // active version; nil when not deployed
+	pool    *pool.WorkerPool
+}
+
+// routeTable is a snapshot of the routing table, indexed by function ID and
+// by name
+type routeTable struct {
+	byID   map[string]*route
+	byName map[string]*route
+}
+
+// NewRouter creates a new router. It follows changes to meta from now on;
+// call Load to read the functions already in it.
 func NewRouter(meta *metadata.Store, sched *scheduler.Scheduler, log *logger.Logger) *Router {
-	return &Router{
+	r := &Router{
 		metadata:  meta,
 		scheduler: sched,
-		pools:     make(map[string]*pool.WorkerPool),
 		logger:    log,
 	}
+	r.table.Store(&routeTable{byID: map[string]*route{}, byName: map[string]*route{}})
+	if meta != nil {
+		meta.OnChange(r.Refresh)
+	}
+	return r
 }
 
-// ResolveFunction resolves a function name or ID to a function
-func (r *Router) ResolveFunction(nameOrID string) (*metadata.Function, error) {
-	// Try as ID first
-	fn, err := r.metadata.GetFunctionByID(nameOrID)
-	if err == nil {
-		return fn, nil
+// Load reads every function and its active version from the metadata store
+// into the routing table. Call once at startup, before serving.
+func (r *Router) Load() error {
+	functions, err := r.metadata.ListFunctions()
+	if err != nil {
+		return fmt.Errorf("failed to load routing table: %w", err)
+	}
+	versions := make([]*metadata.FunctionVersion, len(functions))
+	for i, fn := range functions {
+		versions[i] = r.activeVersion(fn)
 	}
 
-	// Try as name
-	fn, err = r.metadata.GetFunctionByName(nameOrID)
-	if err == nil {
-		return fn, nil
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.publish(func(t *routeTable) {
+		for i, fn := range functions {
+			t.set(fn.ID, func(rt *route) { rt.fn, rt.version = fn, versions[i] })
+		}
+	})
+	r.logger.Info("Loaded %d functions into the routing table", len(functions))
+	return nil
+}
+
+// Refresh re-reads a function from the metadata store into the routing
+// table. The store calls it after every change to a function; a function
+// that is no longer found is removed from the table, keeping its pool.
+func (r *Router) Refresh(functionID string) {
+	// Reading under mu keeps concurrent refreshes of a function in order
+	r.mu.Lock()
+	defer r.mu.Unlock()
+
+	fn, err := r.metadata.GetFunctionByID(functionID)
+	if err != nil {
+		r.logger.Warn("Removing function %s from the routing table: %v", functionID, err)
+		fn = nil
 	}
+	var version *metadata.FunctionVersion
+	if fn != nil {
+		version = r.activeVersion(fn)
+	}
+	r.publish(func(t *routeTable) {
+		t.set(functionID, func(rt *route) { rt.fn, rt.version = fn, version })
+	})
+}
 
-	return nil, ErrFunctionNotFound
+// activeVersion reads a function's active version, or returns nil
+func (r *Router) activeVersion(fn *metadata.Function) *metadata.FunctionVersion {
+	if fn.ActiveVersionID == "" {
+		return nil
+	}
+	version, err := r.metadata.GetVersionByID(fn.ActiveVersionID)
+	if err != nil {
+		r.logger.Warn("Failed to get version %s for function %s: %v", fn.ActiveVersionID, fn.ID, err)
+		return nil
+	}
+	return version
+}
+
+// publish replaces the routing table with a copy changed by update, so
+// readers see either the old table or the new one. Must be called with r.mu held.
+func (r *Router) publish(update func(t *routeTable)) {
+	old := r.table.Load()
+	t := &routeTable{
+		byID:   make(map[string]*route, len(old.byID)+1),
+		byName: make(map[string]*route, len(old.byName)+1),
+	}
+	for id, rt := range old.byID {
+		t.byID[id] = rt
+	}
+	for name, rt := range old.byName {
+		t.byName[name] = rt
+	}
+	update(t)
+	r.table.Store(t)
+}
+
+// set replaces a function's entry in an unpublished table with a copy
+// changed by update; an entry left without function and pool is removed
+func (t *routeTable) set(functionID string, update func(rt *route)) {
+	var rt route
+	if cur := t.byID[functionID]; cur != nil {
+		rt = *cur
+		if cur.fn != nil && t.byName[cur.fn.Name] == cur {
+			delete(t.byName, cur.fn.Name)
+		}
+	}
+	update(&rt)
+	if rt.fn == nil && rt.pool == nil {
+		delete(t.byID, functionID)
+		return
+	}
+	t.byID[functionID] = &rt
+	if rt.fn != nil {
+		t.byName[rt.fn.Name] = &rt
+	}
+}
+
+// lookup finds a function's entry by ID, then by name
+func (r *Router) lookup(nameOrID string) *route {
+	t := r.table.Load()
+	if rt := t.byID[nameOrID]; rt != nil && rt.fn != nil {
+		return rt
+	}
+	return t.byName[nameOrID]
+}
+
+// SetBudget puts pools registered from now on under a node-wide worker
+// budget. Optional; call before registering pools.
+func (r *Router) SetBudget(b *pool.Budget) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.budget = b
+}
+
+// SetBlankPool lets pools registered from now on bind blank workers on cold
+// misses. Optional; call before registering pools.
+func (r *Router) SetBlankPool(b *pool.BlankPool) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.blank = b
+}
+
+// SetHostGroup lets pools registered from now on run their first worker in a
+// shared host process. Optional; call before registering pools.
+func (r *Router) SetHostGroup(g *pool.HostGroup) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.hosts = g
+}
+
+// ResolveFunction resolves a function name or ID to a function. The function
+// is shared with the routing table and must not be modified.
+func (r *Router) ResolveFunction(nameOrID string) (*metadata.Function, error) {
+	rt := r.lookup(nameOrID)
+	if rt == nil {
+		return nil, ErrFunctionNotFound
+	}
+	return rt.fn, nil
+}
+
+// ActiveVersion returns the active version of a function in the routing table
+func (r *Router) ActiveVersion(functionID string) (*metadata.FunctionVersion, error) {
+	rt := r.table.Load().byID[functionID]
+	if rt == nil || rt.version == nil {
+		return nil, fmt.Errorf("no active version for function %s", functionID)
+	}
+	return rt.version, nil
 }
 
 // GetPool gets the worker pool for a function
 func (r *Router) GetPool(functionID string) (*pool.WorkerPool, error) {
-	r.mu.RLock()
-	p, exists := r.pools[functionID]
-	r.mu.RUnlock()
-
-	if !exists {
+	rt := r.table.Load().byID[functionID]
+	if rt == nil || rt.pool == nil {
 		return nil, fmt.Errorf("no pool found for function %s", functionID)
 	}
+	return rt.pool, nil
+}
 
-	return p, nil
+// currentPool returns a function's pool, or nil
+func (r *Router) currentPool(functionID string) *pool.WorkerPool {
+	if rt := r.table.Load().byID[functionID]; rt != nil {
+		return rt.pool
+	}
+	return nil
 }
 
 // RegisterPool registers a worker pool for a function
 func (r *Router) RegisterPool(functionID string, p *pool.WorkerPool) {
 	r.mu.Lock()
 	defer r.mu.Unlock()
+	r.swapPool(functionID, p)
+}
 
-	if _, exists := r.pools[functionID]; exists {
+// swapPool makes p the function's pool and returns the pool it replaced, or
+// nil. Must be called with r.mu held.
+func (r *Router) swapPool(functionID string, p *pool.WorkerPool) *pool.WorkerPool {
+	old := r.currentPool(functionID)
+	if old != nil {
 		r.logger.Debug("Pool already exists for function %s, replacing", functionID)
+		r.budget.Detach(old)
 	}
 
-	r.pools[functionID] = p
+	r.publish(func(t *routeTable) {
+		t.set(functionID, func(rt *route) { rt.pool = p })
+	})
+	r.attach(p)
 	r.scheduler.RegisterPool(functionID, p)
 	r.logger.Info("Registered pool for function %s", functionID)
+	return old
+}
+
+// ReplacePool switches a function's traffic to p, the pool of a new
+// deployment, without a cold start: p joins the node budget and takes over
+// the current pool's idle workers (see WorkerPool.TakeOver) before the
+// scheduler routes to it. It returns the pool p replaced, which still runs
+// its in-flight invocations and should be drained by the caller, or nil.
+// When deploys of the same function overlap, that is the pool in place at
+// the switch, which may not be the one p took workers from.
+func (r *Router) ReplacePool(ctx context.Context, functionID string, p *pool.WorkerPool) *pool.WorkerPool {
+	r.mu.RLock()
+	old := r.currentPool(functionID)
+	if old != nil {
+		r.attach(p)
+	}
+	r.mu.RUnlock()
+
+	if old != nil {
+		p.TakeOver(ctx, old)
+	}
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	return r.swapPool(functionID, p)
+}
+
+// attach puts p under the router's node budget, blank pool and host group.
+// Must be called with r.mu held.
+func (r *Router) attach(p *pool.WorkerPool) {
+	r.budget.Attach(p)
+	if r.blank != nil {
+		p.SetBlankPool(r.blank)
+	}
+	if r.hosts != nil {
+		p.SetHostGroup(r.hosts)
+	}
 }
 
 // UnregisterPool unregisters a worker pool
@@ -83,7 +293,12 @@ func (r *Router) UnregisterPool(functionID string) {
 	r.mu.Lock()
 	defer r.mu.Unlock()
 
-	delete(r.pools, functionID)
+	if p := r.currentPool(functionID); p != nil {
+		r.budget.Detach(p)
+	}
+	r.publish(func(t *routeTable) {
+		t.set(functionID, func(rt *route) { rt.pool = nil })
+	})
 	r.scheduler.UnregisterPool(functionID)
 	r.logger.Info("Unregistered pool for function %s", functionID)
 }
@@ -93,45 +308,37 @@ func (r *Router) EnsurePool(functionID string, p *pool.WorkerPool) {
 	r.mu.Lock()
 	defer r.mu.Unlock()
 
-	if _, exists := r.pools[functionID]; !exists {
-		r.pools[functionID] = p
+	if r.currentPool(functionID) == nil {
+		r.publish(func(t *routeTable) {
+			t.set(functionID, func(rt *route) { rt.pool = p })
+		})
+		r.attach(p)
 		r.scheduler.RegisterPool(functionID, p)
 		r.logger.Info("Created pool for function %s", functionID)
 	}
 }
 
-// Route routes an invocation request to the appropriate pool
+// Route routes an invocation request to the appropriate pool. It only reads
+// the routing table. A nil pool with a function means the function is
+// deployed but its pool is not running yet; the caller (Gateway) creates it.
 func (r *Router) Route(nameOrID string) (*metadata.Function, *pool.WorkerPool, error) {
-	// Resolve function
-	fn, err := r.ResolveFunction(nameOrID)
-	if err != nil {
-		return nil, nil, err
+	rt := r.lookup(nameOrID)
+	if rt == nil {
+		return nil, nil, ErrFunctionNotFound
 	}
-
-	// Check if deployed
-	if fn.Status != metadata.FunctionStatusDeployed {
+	if rt.fn.Status != metadata.FunctionStatusDeployed {
 		return nil, nil, ErrNotDeployed
 	}
-
-	// Get pool
-	p, err := r.GetPool(fn.ID)
-	if err != nil {
-		// Pool not active, return nil pool but function info
-		// This signals the caller (Gateway) to create the pool
-		return fn, nil, nil
-	}
-
-	return fn, p, nil
+	return rt.fn, rt.pool, nil
 }
 
 // ListPools returns all registered pools
 func (r *Router) ListPools() map[string]*pool.WorkerPool {
-	r.mu.RLock()
-	defer r.mu.RUnlock()
-
 	result := make(map[string]*pool.WorkerPool)
-	for k, v := range r.pools {
-		result[k] = v
+	for id, rt := range r.table.Load().byID {
+		if rt.pool != nil {
+			result[id] = rt.pool
+		}
 	}
 	return result
 }
@@ -0,0 +1,175 @@
+package router
+
+import (
+	"context"
+	"fmt"
+	"io"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/metadata"
+	"github.com/kartikbazzad/bunbase/functions/internal/pool"
+	"github.com/kartikbazzad/bunbase/functions/internal/scheduler"
+)
+
+func newTestRouter() *Router {
+	log := logger.New(io.Discard, logger.LevelError, "")
+	return NewRouter(nil, scheduler.NewScheduler(log), log)
+}
+
+// setFunction publishes a function as Refresh does after reading it
+func (r *Router) setFunction(id string, fn *metadata.Function, version *metadata.FunctionVersion) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.publish(func(t *routeTable) {
+		t.set(id, func(rt *route) { rt.fn, rt.version = fn, version })
+	})
+}
+
+func TestRouteFollowsTableUpdates(t *testing.T) {
+	r := newTestRouter()
+	fn := &metadata.Function{ID: "f1", Name: "hello", Status: metadata.FunctionStatusRegistered}
+	r.setFunction("f1", fn, nil)
+	if _, _, err := r.Route("hello"); err != ErrNotDeployed {
+		t.Fatalf("registered function: err %v, want ErrNotDeployed", err)
+	}
+
+	deployed := *fn
+	deployed.Status, deployed.ActiveVersionID = metadata.FunctionStatusDeployed, "v1"
+	r.setFunction("f1", &deployed, &metadata.FunctionVersion{ID: "v1", FunctionID: "f1", Version: "1"})
+	got, p, err := r.Route("f1")
+	if err != nil || got != &deployed || p != nil {
+		t.Fatalf("deployed function without pool: %v %v %v", got, p, err)
+	}
+	if v, err := r.ActiveVersion("f1"); err != nil || v.ID != "v1" {
+		t.Fatalf("ActiveVersion: %v %v", v, err)
+	}
+
+	wp := new(pool.WorkerPool)
+	r.RegisterPool("f1", wp)
+	if _, p, _ := r.Route("hello"); p != wp {
+		t.Fatalf("Route after RegisterPool returned pool %p, want %p", p, wp)
+	}
+	r.UnregisterPool("f1")
+	if got, p, err := r.Route("hello"); err != nil || got == nil || p != nil {
+		t.Fatalf("Route after UnregisterPool: %v %v %v", got, p, err)
+	}
+
+	r.setFunction("f1", nil, nil)
+	if _, _, err := r.Route("hello"); err != ErrFunctionNotFound {
+		t.Errorf("removed function by name: err %v", err)
+	}
+	if _, _, err := r.Route("f1"); err != ErrFunctionNotFound {
+		t.Errorf("removed function by ID: err %v", err)
+	}
+}
+
+func TestOverlappingReplacePoolsHandEachPoolBackOnce(t *testing.T) {
+	r := newTestRouter()
+	log := logger.New(io.Discard, logger.LevelError, "")
+	cfg := &config.WorkerConfig{MaxWorkersPerFunction: 1, IdleTimeout: time.Minute}
+	pools := make([]*pool.WorkerPool, 3)
+	for i := range pools {
+		pools[i] = pool.NewPool("f1", fmt.Sprintf("v%d", i), "", cfg, "", "", nil, log)
+		defer pools[i].Stop()
+	}
+	r.RegisterPool("f1", pools[0])
+
+	// Two deploys race; every pool but the winner must come back to be drained
+	replaced := make(chan *pool.WorkerPool, 2)
+	var wg sync.WaitGroup
+	for _, p := range pools[1:] {
+		wg.Add(1)
+		go func(p *pool.WorkerPool) {
+			defer wg.Done()
+			replaced <- r.ReplacePool(context.Background(), "f1", p)
+		}(p)
+	}
+	wg.Wait()
+	close(replaced)
+
+	seen := map[*pool.WorkerPool]int{r.currentPool("f1"): 1}
+	for p := range replaced {
+		seen[p]++
+	}
+	for i, p := range pools {
+		if seen[p] != 1 {
+			t.Errorf("pool %d is current or replaced %d times, want once", i, seen[p])
+		}
+	}
+}
+
+// benchRouter is a router with n deployed functions named fn-0..fn-(n-1),
+// each with a pool, and their names
+func benchRouter(n int) (*Router, []string) {
+	r := newTestRouter()
+	r.mu.Lock()
+	r.publish(func(t *routeTable) {
+		for i := 0; i < n; i++ {
+			id := fmt.Sprintf("id-%d", i)
+			fn := &metadata.Function{ID: id, Name: fmt.Sprintf("fn-%d", i), Status: metadata.FunctionStatusDeployed}
+			t.set(id, func(rt *route) { rt.fn, rt.pool = fn, new(pool.WorkerPool) })
+		}
+	})
+	r.mu.Unlock()
+	names := make([]string, n)
+	for i := range names {
+		names[i] = fmt.Sprintf("fn-%d", i)
+	}
+	return r, names
+}
+
+// BenchmarkRoute measures routing one invocation by name. cores@50krps is
+// the CPU it costs at 50,000 invocations per second.
+func BenchmarkRoute(b *testing.B) {
+	r, names := benchRouter(1000)
+	b.ReportAllocs()
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		if _, p, err := r.Route(names[i%len(names)]); err != nil || p == nil {
+			b.Fatal(err)
+		}
+	}
+	perOp := time.Since(start).Seconds() / float64(b.N)
+	b.ReportMetric(perOp*50000, "cores@50krps")
+}
+
+// BenchmarkRouteParallelWithDeploys routes from every CPU while a deploy
+// republishes the table every millisecond
+func BenchmarkRouteParallelWithDeploys(b *testing.B) {
+	r, names := benchRouter(1000)
+	stop := make(chan struct{})
+	done := make(chan struct{})
+	go func() {
+		defer close(done)
+		ticker := time.NewTicker(time.Millisecond)
+		defer ticker.Stop()
+		for i := 0; ; i++ {
+			select {
+			case <-stop:
+				return
+			case <-ticker.C:
+				r.RegisterPool(fmt.Sprintf("id-%d", i%1000), new(pool.WorkerPool))
+			}
+		}
+	}()
+	b.ReportAllocs()
+	b.ResetTimer()
+	b.RunParallel(func(pb *testing.PB) {
+		i := 0
+		for pb.Next() {
+			if _, _, err := r.Route(names[i%len(names)]); err != nil {
+				b.Error(err)
+				return
+			}
+			i++
+		}
+	})
+	b.StopTimer()
+	close(stop)
+	<-done
+}
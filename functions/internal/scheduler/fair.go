@@ -0,0 +1,312 @@
+package scheduler
+
+import (
+	"container/heap"
+	"container/list"
+	"context"
+	"sync"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+)
+
+// defaultProject is the tenant of requests that carry no project ID
+const defaultProject = "default"
+
+// minTenantSweep is the tenant count below which idle tenants are not swept
+const minTenantSweep = 64
+
+// fairQueue shares invocation slots between projects with start-time fair
+// queuing. Every queued invocation gets a virtual start tag
+//
+//	S = max(V - burst/share, F)    F = S + 1/share
+//
+// where V is the virtual time (the largest start tag dispatched so far) and F
+// the finish tag of the project's previous invocation. Free slots always go to
+// the project with the smallest head tag, so under contention each project
+// runs in proportion to its share; a project that has been idle starts up to
+// burst invocations ahead of V. Projects at their concurrency cap leave the
+// ready heap until one of their invocations completes.
+//
+// Invocations are admitted without queuing while a slot is free and the
+// project has nobody waiting, so an uncontended node only pays for a mutex.
+type fairQueue struct {
+	cfg config.TenancyConfig
+
+	mu       sync.Mutex
+	capacity int // node-wide slots; 0 is unlimited
+	running  int
+	vtime    float64
+	tenants  map[string]*tenant
+	sweepAt  int        // tenant count at which idle tenants are swept; see sweepLocked
+	ready    tenantHeap // tenants with waiters that are under their cap
+}
+
+type tenant struct {
+	id      string
+	share   float64
+	burst   float64 // in virtual time: burst invocations / share
+	cap     int     // 0 is uncapped
+	running int
+	finish  float64
+	waiters *list.List // *fairWaiter, FIFO with increasing start tags
+	index   int        // position in the ready heap; -1 when not in it
+}
+
+type fairWaiter struct {
+	start    float64
+	ready    chan struct{}
+	admitted bool
+}
+
+// newFairQueue returns nil when cfg sets neither a node limit nor any
+// project cap, leaving scheduling unchanged
+func newFairQueue(cfg *config.TenancyConfig) *fairQueue {
+	if cfg == nil {
+		return nil
+	}
+	enabled := cfg.MaxConcurrent > 0 || cfg.DefaultMaxConcurrent > 0
+	for _, q := range cfg.Projects {
+		enabled = enabled || q.MaxConcurrent > 0
+	}
+	if !enabled {
+		return nil
+	}
+	capacity := cfg.MaxConcurrent
+	if capacity < 0 {
+		capacity = 0
+	}
+	return &fairQueue{
+		cfg:      *cfg,
+		capacity: capacity,
+		tenants:  make(map[string]*tenant),
+		sweepAt:  minTenantSweep,
+	}
+}
+
+// acquire waits for a slot for projectID and returns the function that gives
+// it back, plus how long the caller was queued. A nil fairQueue admits
+// everything immediately.
+func (f *fairQueue) acquire(ctx context.Context, projectID string) (func(), time.Duration, error) {
+	if f == nil {
+		return func() {}, 0, nil
+	}
+	if projectID == "" {
+		projectID = defaultProject
+	}
+
+	f.mu.Lock()
+	t := f.tenantLocked(projectID)
+	start := f.startTagLocked(t)
+	if t.waiters.Len() == 0 && f.hasSlotLocked() && t.underCap() {
+		f.admitLocked(t, start)
+		f.mu.Unlock()
+		return f.releaseFunc(t), 0, nil
+	}
+
+	reason := "node_capacity"
+	if !t.underCap() {
+		reason = "project_cap"
+	}
+	prometrics.IncTenantThrottled(projectID, reason)
+	w := &fairWaiter{start: start, ready: make(chan struct{})}
+	elem := t.waiters.PushBack(w)
+	if t.index >= 0 {
+		heap.Fix(&f.ready, t.index)
+	} else if t.underCap() {
+		heap.Push(&f.ready, t)
+	}
+	f.dispatchLocked()
+	f.mu.Unlock()
+
+	queuedAt := time.Now()
+	select {
+	case <-w.ready:
+		waited := time.Since(queuedAt)
+		prometrics.ObserveTenantQueueWait(projectID, waited.Seconds())
+		return f.releaseFunc(t), waited, nil
+	case <-ctx.Done():
+	}
+
+	f.mu.Lock()
+	if w.admitted {
+		// Dispatched while we were giving up; hand the slot back
+		f.mu.Unlock()
+		f.release(t)
+		return nil, time.Since(queuedAt), ctx.Err()
+	}
+	t.waiters.Remove(elem)
+	if t.index >= 0 {
+		if t.waiters.Len() == 0 {
+			heap.Remove(&f.ready, t.index)
+		} else {
+			heap.Fix(&f.ready, t.index)
+		}
+	}
+	f.forgetLocked(t)
+	f.mu.Unlock()
+	return nil, time.Since(queuedAt), ctx.Err()
+}
+
+func (f *fairQueue) releaseFunc(t *tenant) func() {
+	var once sync.Once
+	return func() { once.Do(func() { f.release(t) }) }
+}
+
+func (f *fairQueue) release(t *tenant) {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+	f.running--
+	t.running--
+	prometrics.AddTenantRunning(t.id, -1)
+	if t.index < 0 && t.waiters.Len() > 0 && t.underCap() {
+		heap.Push(&f.ready, t)
+	}
+	f.dispatchLocked()
+	f.forgetLocked(t)
+}
+
+// dispatchLocked hands free slots to the eligible tenants with the smallest
+// head start tags
+func (f *fairQueue) dispatchLocked() {
+	for f.ready.Len() > 0 && f.hasSlotLocked() {
+		t := heap.Pop(&f.ready).(*tenant)
+		w := t.waiters.Remove(t.waiters.Front()).(*fairWaiter)
+		f.admitLocked(t, w.start)
+		w.admitted = true
+		close(w.ready)
+		if t.waiters.Len() > 0 && t.underCap() {
+			heap.Push(&f.ready, t)
+		}
+	}
+}
+
+func (f *fairQueue) admitLocked(t *tenant, start float64) {
+	f.running++
+	t.running++
+	if start > f.vtime {
+		f.vtime = start
+	}
+	prometrics.AddTenantRunning(t.id, 1)
+}
+
+// startTagLocked assigns the next start tag of t and advances its finish tag
+func (f *fairQueue) startTagLocked(t *tenant) float64 {
+	start := f.vtime - t.burst
+	if t.finish > start {
+		start = t.finish
+	}
+	t.finish = start + 1/t.share
+	return start
+}
+
+func (f *fairQueue) hasSlotLocked() bool {
+	return f.capacity == 0 || f.running < f.capacity
+}
+
+func (f *fairQueue) tenantLocked(id string) *tenant {
+	if t, ok := f.tenants[id]; ok {
+		return t
+	}
+	if len(f.tenants) >= f.sweepAt {
+		f.sweepLocked()
+	}
+	share, burst, limit := f.cfg.DefaultShare, f.cfg.DefaultBurst, f.cfg.DefaultMaxConcurrent
+	if q, ok := f.cfg.Projects[id]; ok {
+		if q.Share > 0 {
+			share = q.Share
+		}
+		if q.Burst != 0 {
+			burst = q.Burst
+		}
+		if q.MaxConcurrent != 0 {
+			limit = q.MaxConcurrent
+		}
+	}
+	if share <= 0 {
+		share = 1
+	}
+	if burst < 0 {
+		burst = 0
+	}
+	if limit < 0 {
+		limit = 0
+	}
+	t := &tenant{
+		id:      id,
+		share:   share,
+		burst:   float64(burst) / share,
+		cap:     limit,
+		waiters: list.New(),
+		index:   -1,
+	}
+	f.tenants[id] = t
+	return t
+}
+
+// forgetLocked drops an idle tenant once its full burst credit is back;
+// recreating it later yields the same start tags, so only recently active
+// projects keep state
+func (f *fairQueue) forgetLocked(t *tenant) {
+	if t.running == 0 && t.waiters.Len() == 0 && t.finish <= f.vtime-t.burst {
+		delete(f.tenants, t.id)
+	}
+}
+
+// sweepLocked drops every tenant with nothing running or waiting, including
+// those forgetLocked kept because their burst credit was not back yet. A
+// recreated tenant starts at vtime-burst, so this at most hands it that
+// credit early. Project IDs come from a request header; sweeping whenever the
+// map has doubled since the last sweep bounds it at twice the active projects
+// for amortized O(1) per new tenant.
+func (f *fairQueue) sweepLocked() {
+	for id, t := range f.tenants {
+		if t.running == 0 && t.waiters.Len() == 0 {
+			delete(f.tenants, id)
+		}
+	}
+	f.sweepAt = 2 * len(f.tenants)
+	if f.sweepAt < minTenantSweep {
+		f.sweepAt = minTenantSweep
+	}
+}
+
+func (t *tenant) underCap() bool {
+	return t.cap == 0 || t.running < t.cap
+}
+
+// tenantHeap orders tenants by the start tag of their oldest waiter
+type tenantHeap []*tenant
+
+func (h tenantHeap) Len() int { return len(h) }
+
+func (h tenantHeap) Less(i, j int) bool {
+	a := h[i].waiters.Front().Value.(*fairWaiter).start
+	b := h[j].waiters.Front().Value.(*fairWaiter).start
+	if a != b {
+		return a < b
+	}
+	return h[i].id < h[j].id
+}
+
+func (h tenantHeap) Swap(i, j int) {
+	h[i], h[j] = h[j], h[i]
+	h[i].index = i
+	h[j].index = j
+}
+
+func (h *tenantHeap) Push(x any) {
+	t := x.(*tenant)
+	t.index = len(*h)
+	*h = append(*h, t)
+}
+
+func (h *tenantHeap) Pop() any {
+	old := *h
+	t := old[len(old)-1]
+	old[len(old)-1] = nil
+	t.index = -1
+	*h = old[:len(old)-1]
+	return t
+}
@@ -0,0 +1,171 @@
+package scheduler
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+)
+
+// waitQueued waits until n invocations are waiting in f
+func waitQueued(t *testing.T, f *fairQueue, n int) {
+	t.Helper()
+	deadline := time.Now().Add(2 * time.Second)
+	for time.Now().Before(deadline) {
+		f.mu.Lock()
+		queued := 0
+		for _, tn := range f.tenants {
+			queued += tn.waiters.Len()
+		}
+		f.mu.Unlock()
+		if queued == n {
+			return
+		}
+		time.Sleep(time.Millisecond)
+	}
+	t.Fatalf("Expected %d queued invocations", n)
+}
+
+func TestFairQueueDisabledWithoutLimits(t *testing.T) {
+	cfg := config.DefaultConfig().Tenancy
+	if f := newFairQueue(&cfg); f != nil {
+		t.Fatal("Expected no fair queue without limits")
+	}
+	var f *fairQueue
+	release, waited, err := f.acquire(context.Background(), "p")
+	if err != nil || waited != 0 {
+		t.Fatalf("Expected immediate admission, got waited=%v err=%v", waited, err)
+	}
+	release()
+}
+
+func TestFairQueueDispatchesByShare(t *testing.T) {
+	f := newFairQueue(&config.TenancyConfig{
+		MaxConcurrent: 1,
+		DefaultShare:  1,
+		Projects:      map[string]config.ProjectQuota{"a": {Share: 3}},
+	})
+	hold, _, err := f.acquire(context.Background(), "hold")
+	if err != nil {
+		t.Fatalf("acquire: %v", err)
+	}
+
+	type admitted struct {
+		project string
+		release func()
+	}
+	got := make(chan admitted)
+	for i := 0; i < 8; i++ {
+		for _, p := range []string{"a", "b"} {
+			go func(p string) {
+				release, _, err := f.acquire(context.Background(), p)
+				if err != nil {
+					t.Errorf("acquire %s: %v", p, err)
+					return
+				}
+				got <- admitted{p, release}
+			}(p)
+		}
+	}
+	waitQueued(t, f, 16)
+	hold()
+
+	counts := map[string]int{}
+	for i := 0; i < 16; i++ {
+		a := <-got
+		if i < 8 {
+			counts[a.project]++
+		}
+		a.release()
+	}
+	if counts["a"] != 6 || counts["b"] != 2 {
+		t.Errorf("Expected 6:2 split of the first 8 slots, got %v", counts)
+	}
+}
+
+func TestFairQueueProjectCap(t *testing.T) {
+	f := newFairQueue(&config.TenancyConfig{DefaultMaxConcurrent: 2, DefaultShare: 1})
+	ctx := context.Background()
+	r1, _, _ := f.acquire(ctx, "p")
+	r2, _, _ := f.acquire(ctx, "p")
+
+	// Other projects are not held back by p's cap
+	other, waited, err := f.acquire(ctx, "q")
+	if err != nil || waited != 0 {
+		t.Fatalf("Expected q to be admitted immediately, got waited=%v err=%v", waited, err)
+	}
+	other()
+
+	done := make(chan func())
+	go func() {
+		release, _, err := f.acquire(ctx, "p")
+		if err != nil {
+			t.Errorf("acquire: %v", err)
+		}
+		done <- release
+	}()
+	waitQueued(t, f, 1)
+	r1()
+	r1() // releasing twice is a no-op
+	select {
+	case release := <-done:
+		release()
+	case <-time.After(2 * time.Second):
+		t.Fatal("Expected the capped invocation to run after a release")
+	}
+	r2()
+
+	f.mu.Lock()
+	defer f.mu.Unlock()
+	if f.running != 0 {
+		t.Errorf("Expected no running invocations, got %d", f.running)
+	}
+}
+
+func TestFairQueueCancelledWhileWaiting(t *testing.T) {
+	f := newFairQueue(&config.TenancyConfig{MaxConcurrent: 1, DefaultShare: 1})
+	hold, _, _ := f.acquire(context.Background(), "a")
+
+	ctx, cancel := context.WithTimeout(context.Background(), 20*time.Millisecond)
+	defer cancel()
+	if _, _, err := f.acquire(ctx, "b"); !errors.Is(err, context.DeadlineExceeded) {
+		t.Fatalf("Expected deadline exceeded, got %v", err)
+	}
+	hold()
+
+	release, waited, err := f.acquire(context.Background(), "c")
+	if err != nil || waited != 0 {
+		t.Fatalf("Expected the slot to be free, got waited=%v err=%v", waited, err)
+	}
+	release()
+	if f.ready.Len() != 0 {
+		t.Errorf("Expected an empty ready heap, got %d", f.ready.Len())
+	}
+}
+
+func TestFairQueueForgetsIdleProjects(t *testing.T) {
+	f := newFairQueue(&config.TenancyConfig{MaxConcurrent: 4, DefaultShare: 1, DefaultBurst: 10})
+	hold, _, err := f.acquire(context.Background(), "busy")
+	if err != nil {
+		t.Fatalf("acquire: %v", err)
+	}
+	for i := 0; i < 1000; i++ {
+		release, _, err := f.acquire(context.Background(), fmt.Sprintf("p%d", i))
+		if err != nil {
+			t.Fatalf("acquire: %v", err)
+		}
+		release()
+	}
+
+	f.mu.Lock()
+	tenants := len(f.tenants)
+	_, busy := f.tenants["busy"]
+	f.mu.Unlock()
+	if tenants > 2*minTenantSweep || !busy {
+		t.Errorf("Expected idle projects to be swept while keeping the busy one, got %d tenants (busy kept: %v)", tenants, busy)
+	}
+	hold()
+}
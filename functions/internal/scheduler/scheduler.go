@@ -2,12 +2,17 @@ package scheduler
 
 import (
 	"context"
+	"errors"
 	"fmt"
 	"sync"
+	"sync/atomic"
 	"time"
 
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
 	"github.com/kartikbazzad/bunbase/functions/internal/pool"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/tracing"
 	"github.com/kartikbazzad/bunbase/functions/internal/worker"
 )
 
@@ -29,64 +34,96 @@ type InvokeResult struct {
 	Success      bool
 	Status       int
 	Headers      map[string]string
-	Body         []byte
+	Body         []byte // may be a pooled buffer; see worker.ReleaseBody
 	Error        string
 	ExecutionTime time.Duration
 	IsColdStart  bool
 }
 
-// Invocation represents a pending invocation
-type Invocation struct {
-	ID      string
-	Request *InvokeRequest
-	Result  chan *InvokeResult
-	Context context.Context
-}
-
-// Scheduler manages invocation queue and worker assignment
+// Scheduler assigns invocations to worker pools. Waiting for a busy worker
+// happens in the pool's dispatch queue, so the hot path only does a lock-free
+// lookup of the function's pool. With tenancy limits configured, invocations
+// first take a project slot from the fair queue.
 type Scheduler struct {
-	pools    map[string]*pool.WorkerPool // functionID -> pool
-	queues   map[string][]*Invocation     // functionID -> queue
-	mu       sync.RWMutex
-	logger   *logger.Logger
-	stopped  bool
+	pools   atomic.Value // map[string]*pool.WorkerPool (functionID -> pool); copy-on-write
+	mu      sync.Mutex   // serializes pool registration
+	fair    atomic.Pointer[fairQueue]
+	logger  *logger.Logger
+	stopped atomic.Bool
 }
 
-// NewScheduler creates a new scheduler
+// NewScheduler creates a new scheduler. Its pools are reported by the
+// fn_pool_workers and fn_pool_queue_depth gauges.
 func NewScheduler(log *logger.Logger) *Scheduler {
-	return &Scheduler{
-		pools:  make(map[string]*pool.WorkerPool),
-		queues: make(map[string][]*Invocation),
-		logger: log,
+	s := &Scheduler{logger: log}
+	s.pools.Store(map[string]*pool.WorkerPool{})
+	prometrics.SetPoolSource(s.poolSamples)
+	return s
+}
+
+// poolSamples reads the state of every registered pool for a metrics scrape
+func (s *Scheduler) poolSamples() []prometrics.PoolSample {
+	pools := s.loadPools()
+	samples := make([]prometrics.PoolSample, 0, len(pools))
+	for functionID, p := range pools {
+		stats := p.GetStats()
+		samples = append(samples, prometrics.PoolSample{
+			FunctionID: functionID,
+			Warm:       stats.WarmWorkers,
+			Busy:       stats.BusyWorkers,
+			Spawning:   stats.SpawningWorkers,
+			Queued:     stats.QueueDepth,
+		})
 	}
+	return samples
 }
 
-// RegisterPool registers a worker pool for a function
-func (s *Scheduler) RegisterPool(functionID string, p *pool.WorkerPool) {
+func (s *Scheduler) loadPools() map[string]*pool.WorkerPool {
+	return s.pools.Load().(map[string]*pool.WorkerPool)
+}
+
+// updatePools replaces the pool map with a modified copy
+func (s *Scheduler) updatePools(fn func(pools map[string]*pool.WorkerPool)) {
 	s.mu.Lock()
 	defer s.mu.Unlock()
-	s.pools[functionID] = p
+	old := s.loadPools()
+	pools := make(map[string]*pool.WorkerPool, len(old)+1)
+	for id, p := range old {
+		pools[id] = p
+	}
+	fn(pools)
+	s.pools.Store(pools)
+}
+
+// SetTenancy enables fair queuing of invocations across projects. Call before
+// serving; invocations already holding a slot keep it.
+func (s *Scheduler) SetTenancy(cfg *config.TenancyConfig) {
+	s.fair.Store(newFairQueue(cfg))
+}
+
+// RegisterPool registers a worker pool for a function
+func (s *Scheduler) RegisterPool(functionID string, p *pool.WorkerPool) {
+	s.updatePools(func(pools map[string]*pool.WorkerPool) {
+		pools[functionID] = p
+	})
 	s.logger.Info("Registered pool for function %s", functionID)
 }
 
 // UnregisterPool unregisters a worker pool
 func (s *Scheduler) UnregisterPool(functionID string) {
-	s.mu.Lock()
-	defer s.mu.Unlock()
-	delete(s.pools, functionID)
-	delete(s.queues, functionID)
+	s.updatePools(func(pools map[string]*pool.WorkerPool) {
+		delete(pools, functionID)
+	})
 	s.logger.Info("Unregistered pool for function %s", functionID)
 }
 
 // Schedule schedules an invocation
 func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *InvokeRequest) (*InvokeResult, error) {
-	if s.stopped {
+	if s.stopped.Load() {
 		return nil, fmt.Errorf("scheduler is stopped")
 	}
 
-	s.mu.RLock()
-	p, exists := s.pools[functionID]
-	s.mu.RUnlock()
+	p, exists := s.loadPools()[functionID]
 
 	if !exists {
 		return nil, fmt.Errorf("no pool registered for function %s", functionID)
@@ -106,17 +143,32 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 	}
 
 	startTime := time.Now()
-	isColdStart := false
+	trace := tracing.FromContext(ctx)
 
-	// Acquire worker
+	// Wait for the project's turn when the node or the project is saturated
+	release, waited, err := s.fair.Load().acquire(ctx, req.ProjectID)
+	if waited > 0 {
+		trace.Record("scheduler.tenant_wait", startTime, startTime.Add(waited))
+	}
+	if err != nil {
+		return &InvokeResult{
+			Success:       false,
+			Error:         err.Error(),
+			ExecutionTime: time.Since(startTime),
+		}, err
+	}
+	defer release()
+	acquireStart := time.Now()
+
+	// Acquire worker; waits in the pool's queue when all workers are busy
 	s.logger.Debug("Acquiring worker for function %s", functionID)
-	w, err := p.Acquire(ctx)
+	w, isColdStart, err := p.Acquire(ctx)
+	trace.Record("pool.acquire", acquireStart, time.Now())
 	if err != nil {
-		s.logger.Error("Failed to acquire worker for function %s: %v", functionID, err)
-		if err == pool.ErrMaxWorkersReached {
-			// Queue invocation
-			return s.queueInvocation(ctx, functionID, req)
+		if errors.Is(err, context.DeadlineExceeded) {
+			prometrics.IncDeadlineExceeded(functionID, "queue")
 		}
+		s.logger.Error("Failed to acquire worker for function %s: %v", functionID, err)
 		return &InvokeResult{
 			Success:       false,
 			Error:         err.Error(),
@@ -126,11 +178,9 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 
 	s.logger.Debug("Acquired worker %s for function %s", w.GetID(), functionID)
 
-	// Check if this was a cold start (no warm workers available before)
-	stats := p.GetStats()
-	if stats.WarmWorkers == 0 && stats.BusyWorkers == 1 {
-		isColdStart = true
+	if isColdStart {
 		s.logger.Debug("Cold start detected for function %s", functionID)
+		trace.SetAttribute("faas.coldstart", "true")
 	}
 
 	// Execute invocation
@@ -144,6 +194,12 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 	executionTime := time.Since(startTime)
 
 	if err != nil {
+		outcome := "error"
+		if errors.Is(err, context.DeadlineExceeded) {
+			outcome = "timeout"
+			prometrics.IncDeadlineExceeded(functionID, "execution")
+		}
+		prometrics.ObserveInvocation(functionID, isColdStart, outcome, executionTime.Seconds())
 		return &InvokeResult{
 			Success:       false,
 			Error:         err.Error(),
@@ -153,6 +209,7 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 	}
 
 	if errPayload != nil {
+		prometrics.ObserveInvocation(functionID, isColdStart, "error", executionTime.Seconds())
 		return &InvokeResult{
 			Success:       false,
 			Error:         errPayload.Message,
@@ -162,8 +219,12 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 	}
 
 	// Decode response body
-	body, err := worker.DecodeBody(result.Body)
+	if result.Heap > 0 {
+		prometrics.ObserveWorkerHeap(functionID, result.Heap)
+	}
+	body, err := result.DecodedBody()
 	if err != nil {
+		prometrics.ObserveInvocation(functionID, isColdStart, "error", executionTime.Seconds())
 		return &InvokeResult{
 			Success:       false,
 			Error:         fmt.Sprintf("failed to decode response body: %v", err),
@@ -172,6 +233,9 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 		}, nil
 	}
 
+	prometrics.ObserveInvocation(functionID, isColdStart, "ok", executionTime.Seconds())
+	prometrics.ObserveResponseBody(functionID, len(body))
+
 	return &InvokeResult{
 		Success:       true,
 		Status:        result.Status,
@@ -182,98 +246,26 @@ func (s *Scheduler) Schedule(ctx context.Context, functionID string, req *Invoke
 	}, nil
 }
 
-// queueInvocation queues an invocation when workers are busy
-func (s *Scheduler) queueInvocation(ctx context.Context, functionID string, req *InvokeRequest) (*InvokeResult, error) {
-	invocation := &Invocation{
-		ID:      fmt.Sprintf("invoke-%d", time.Now().UnixNano()),
-		Request: req,
-		Result:  make(chan *InvokeResult, 1),
-		Context: ctx,
-	}
-
-	s.mu.Lock()
-	s.queues[functionID] = append(s.queues[functionID], invocation)
-	queueLen := len(s.queues[functionID])
-	s.mu.Unlock()
-
-	s.logger.Debug("Queued invocation %s for function %s (queue length: %d)", invocation.ID, functionID, queueLen)
-
-	// Process queue in background
-	go s.processQueue(functionID)
-
-	// Wait for result
-	select {
-	case result := <-invocation.Result:
-		return result, nil
-	case <-ctx.Done():
-		// Remove from queue
-		s.mu.Lock()
-		queue := s.queues[functionID]
-		for i, inv := range queue {
-			if inv.ID == invocation.ID {
-				s.queues[functionID] = append(queue[:i], queue[i+1:]...)
-				break
-			}
-		}
-		s.mu.Unlock()
-		return nil, ctx.Err()
-	}
-}
-
-// processQueue processes queued invocations
-func (s *Scheduler) processQueue(functionID string) {
-	s.mu.RLock()
-	_, exists := s.pools[functionID]
-	queue := s.queues[functionID]
-	s.mu.RUnlock()
-
-	if !exists || len(queue) == 0 {
-		return
-	}
-
-	// Process invocations one at a time
-	for {
-		s.mu.Lock()
-		if len(queue) == 0 {
-			s.mu.Unlock()
-			return
-		}
-		invocation := queue[0]
-		queue = queue[1:]
-		s.queues[functionID] = queue
-		s.mu.Unlock()
-
-		// Execute invocation
-		result, err := s.Schedule(invocation.Context, functionID, invocation.Request)
-		if err != nil {
-			result = &InvokeResult{
-				Success: false,
-				Error:   err.Error(),
-			}
-		}
-
-		// Send result
-		select {
-		case invocation.Result <- result:
-		default:
-			// Channel closed or receiver gone
-		}
+// QueueDepth returns the number of invocations waiting for a worker of the function
+func (s *Scheduler) QueueDepth(functionID string) int {
+	p, exists := s.loadPools()[functionID]
+	if !exists {
+		return 0
 	}
+	return p.GetStats().QueueDepth
 }
 
 // Stop stops the scheduler
 func (s *Scheduler) Stop() {
-	s.mu.Lock()
-	defer s.mu.Unlock()
+	s.stopped.Store(true)
 
-	s.stopped = true
+	s.mu.Lock()
+	pools := s.loadPools()
+	s.pools.Store(map[string]*pool.WorkerPool{})
+	s.mu.Unlock()
 
-	// Stop all pools
-	for _, p := range s.pools {
+	// Stop all pools; their queued callers fail with pool.ErrPoolStopped
+	for _, p := range pools {
 		p.Stop()
 	}
-
-	// Clear queues
-	s.queues = make(map[string][]*Invocation)
-	s.pools = make(map[string]*pool.WorkerPool)
 }
@@ -0,0 +1,357 @@
+package tracing
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+const (
+	defaultQueueSize     = 4096
+	defaultBatchSize     = 512
+	defaultFlushInterval = time.Second
+	serviceName          = "bunbase-functions"
+)
+
+// Exporter ships finished spans to a trace backend
+type Exporter interface {
+	Export(spans []Span) error
+	Close() error
+}
+
+// Tracer starts traces and exports their spans in the background. Exports
+// are batched; when the queue is full new spans are dropped rather than
+// slowing down invocations.
+type Tracer struct {
+	exporter Exporter
+	logger   *logger.Logger
+	queue    chan []Span
+	done     chan struct{}
+	closed   bool
+	mu       sync.RWMutex // guards closed; held while sending on queue
+	dropped  atomic.Int64
+}
+
+// NewTracer creates a tracer that exports through exp
+func NewTracer(exp Exporter, log *logger.Logger) *Tracer {
+	t := &Tracer{
+		exporter: exp,
+		logger:   log,
+		queue:    make(chan []Span, defaultQueueSize),
+		done:     make(chan struct{}),
+	}
+	go t.run()
+	return t
+}
+
+// NewTracerFromConfig builds a tracer for the given OTLP/HTTP endpoint or
+// file path (endpoint wins). Returns nil when neither is set, which disables
+// tracing.
+func NewTracerFromConfig(endpoint, filePath string, log *logger.Logger) (*Tracer, error) {
+	switch {
+	case endpoint != "":
+		return NewTracer(NewOTLPHTTPExporter(endpoint), log), nil
+	case filePath != "":
+		exp, err := NewFileExporter(filePath)
+		if err != nil {
+			return nil, err
+		}
+		return NewTracer(exp, log), nil
+	default:
+		return nil, nil
+	}
+}
+
+// StartTrace starts the root span for an invocation. traceparent is the
+// incoming W3C header (may be empty). Returns nil when tracing is disabled or
+// the caller asked not to sample.
+func (t *Tracer) StartTrace(traceparent, name string) *Trace {
+	if t == nil {
+		return nil
+	}
+	root := Span{
+		SpanID:     newSpanID(),
+		Name:       name,
+		Start:      time.Now(),
+		Attributes: make(map[string]string),
+	}
+	if traceparent != "" {
+		if sc, err := ParseTraceparent(traceparent); err == nil {
+			if !sc.Sampled {
+				return nil
+			}
+			root.TraceID = sc.TraceID
+			root.ParentID = sc.SpanID
+		}
+	}
+	if root.TraceID.IsZero() {
+		root.TraceID = newTraceID()
+	}
+	return &Trace{tracer: t, root: root}
+}
+
+// Dropped returns the number of spans dropped because the export queue was
+// full or the tracer was closed
+func (t *Tracer) Dropped() int64 {
+	if t == nil {
+		return 0
+	}
+	return t.dropped.Load()
+}
+
+func (t *Tracer) enqueue(spans []Span) {
+	if t == nil {
+		return
+	}
+	t.mu.RLock()
+	defer t.mu.RUnlock()
+	if t.closed {
+		t.dropped.Add(int64(len(spans)))
+		return
+	}
+	select {
+	case t.queue <- spans:
+	default:
+		t.dropped.Add(int64(len(spans)))
+	}
+}
+
+func (t *Tracer) run() {
+	defer close(t.done)
+	ticker := time.NewTicker(defaultFlushInterval)
+	defer ticker.Stop()
+
+	var batch []Span
+	flush := func() {
+		if len(batch) == 0 {
+			return
+		}
+		if err := t.exporter.Export(batch); err != nil && t.logger != nil {
+			t.logger.Warn("Failed to export %d spans: %v", len(batch), err)
+		}
+		batch = nil
+	}
+
+	for {
+		select {
+		case spans, ok := <-t.queue:
+			if !ok {
+				flush()
+				return
+			}
+			batch = append(batch, spans...)
+			if len(batch) >= defaultBatchSize {
+				flush()
+			}
+		case <-ticker.C:
+			flush()
+		}
+	}
+}
+
+// Close flushes pending spans and closes the exporter. Spans of traces that
+// end afterwards, such as handlers outliving a shutdown timeout, are dropped.
+func (t *Tracer) Close() error {
+	if t == nil {
+		return nil
+	}
+	t.mu.Lock()
+	if t.closed {
+		t.mu.Unlock()
+		return nil
+	}
+	t.closed = true
+	close(t.queue)
+	t.mu.Unlock()
+	<-t.done
+	return t.exporter.Close()
+}
+
+// OTLP/JSON encoding (opentelemetry-proto ExportTraceServiceRequest)
+
+type otlpRequest struct {
+	ResourceSpans []otlpResourceSpans `json:"resourceSpans"`
+}
+
+type otlpResourceSpans struct {
+	Resource   otlpResource     `json:"resource"`
+	ScopeSpans []otlpScopeSpans `json:"scopeSpans"`
+}
+
+type otlpResource struct {
+	Attributes []otlpKeyValue `json:"attributes"`
+}
+
+type otlpScopeSpans struct {
+	Scope otlpScope  `json:"scope"`
+	Spans []otlpSpan `json:"spans"`
+}
+
+type otlpScope struct {
+	Name string `json:"name"`
+}
+
+type otlpSpan struct {
+	TraceID           string         `json:"traceId"`
+	SpanID            string         `json:"spanId"`
+	ParentSpanID      string         `json:"parentSpanId,omitempty"`
+	Name              string         `json:"name"`
+	Kind              int            `json:"kind"`
+	StartTimeUnixNano string         `json:"startTimeUnixNano"`
+	EndTimeUnixNano   string         `json:"endTimeUnixNano"`
+	Attributes        []otlpKeyValue `json:"attributes,omitempty"`
+	Status            *otlpStatus    `json:"status,omitempty"`
+}
+
+type otlpKeyValue struct {
+	Key   string       `json:"key"`
+	Value otlpAnyValue `json:"value"`
+}
+
+type otlpAnyValue struct {
+	StringValue string `json:"stringValue"`
+}
+
+type otlpStatus struct {
+	Code    int    `json:"code"` // 2 = STATUS_CODE_ERROR
+	Message string `json:"message,omitempty"`
+}
+
+const (
+	otlpSpanKindInternal = 1
+	otlpSpanKindServer   = 2
+)
+
+// encodeOTLP encodes spans as an OTLP/JSON ExportTraceServiceRequest
+func encodeOTLP(spans []Span) ([]byte, error) {
+	out := make([]otlpSpan, 0, len(spans))
+	for _, s := range spans {
+		o := otlpSpan{
+			TraceID:           s.TraceID.String(),
+			SpanID:            s.SpanID.String(),
+			Name:              s.Name,
+			Kind:              otlpSpanKindInternal,
+			StartTimeUnixNano: strconv.FormatInt(s.Start.UnixNano(), 10),
+			EndTimeUnixNano:   strconv.FormatInt(s.End.UnixNano(), 10),
+		}
+		if !s.ParentID.IsZero() {
+			o.ParentSpanID = s.ParentID.String()
+		}
+		if strings.HasPrefix(s.Name, "invoke ") {
+			o.Kind = otlpSpanKindServer
+		}
+		for k, v := range s.Attributes {
+			o.Attributes = append(o.Attributes, otlpKeyValue{Key: k, Value: otlpAnyValue{StringValue: v}})
+		}
+		if s.Error != "" {
+			o.Status = &otlpStatus{Code: 2, Message: s.Error}
+		}
+		out = append(out, o)
+	}
+	return json.Marshal(otlpRequest{
+		ResourceSpans: []otlpResourceSpans{{
+			Resource: otlpResource{Attributes: []otlpKeyValue{
+				{Key: "service.name", Value: otlpAnyValue{StringValue: serviceName}},
+			}},
+			ScopeSpans: []otlpScopeSpans{{
+				Scope: otlpScope{Name: "github.com/kartikbazzad/bunbase/functions"},
+				Spans: out,
+			}},
+		}},
+	})
+}
+
+// OTLPHTTPExporter posts OTLP/JSON to a collector's /v1/traces endpoint
+type OTLPHTTPExporter struct {
+	url        string
+	httpClient *http.Client
+}
+
+// NewOTLPHTTPExporter creates an exporter for the collector at endpoint
+// (e.g. http://localhost:4318)
+func NewOTLPHTTPExporter(endpoint string) *OTLPHTTPExporter {
+	url := strings.TrimSuffix(endpoint, "/")
+	if !strings.HasSuffix(url, "/v1/traces") {
+		url += "/v1/traces"
+	}
+	return &OTLPHTTPExporter{
+		url: url,
+		httpClient: &http.Client{
+			Timeout: 10 * time.Second,
+		},
+	}
+}
+
+// Export sends one batch of spans
+func (e *OTLPHTTPExporter) Export(spans []Span) error {
+	payload, err := encodeOTLP(spans)
+	if err != nil {
+		return fmt.Errorf("otlp marshal: %w", err)
+	}
+	req, err := http.NewRequest(http.MethodPost, e.url, bytes.NewReader(payload))
+	if err != nil {
+		return fmt.Errorf("otlp request: %w", err)
+	}
+	req.Header.Set("Content-Type", "application/json")
+	resp, err := e.httpClient.Do(req)
+	if err != nil {
+		return fmt.Errorf("otlp export: %w", err)
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode/100 != 2 {
+		b, _ := io.ReadAll(resp.Body)
+		return fmt.Errorf("otlp export status %d: %s", resp.StatusCode, string(b))
+	}
+	return nil
+}
+
+// Close is a no-op for the HTTP exporter
+func (e *OTLPHTTPExporter) Close() error {
+	return nil
+}
+
+// FileExporter appends one OTLP/JSON request per line to a file, which the
+// OpenTelemetry Collector's otlpjsonfile receiver can ingest
+type FileExporter struct {
+	mu   sync.Mutex
+	file *os.File
+}
+
+// NewFileExporter opens (or creates) path for appending
+func NewFileExporter(path string) (*FileExporter, error) {
+	f, err := os.OpenFile(path, os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0o644)
+	if err != nil {
+		return nil, fmt.Errorf("failed to open trace file: %w", err)
+	}
+	return &FileExporter{file: f}, nil
+}
+
+// Export writes one batch of spans
+func (e *FileExporter) Export(spans []Span) error {
+	payload, err := encodeOTLP(spans)
+	if err != nil {
+		return fmt.Errorf("otlp marshal: %w", err)
+	}
+	payload = append(payload, '\n')
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	_, err = e.file.Write(payload)
+	return err
+}
+
+// Close closes the file
+func (e *FileExporter) Close() error {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	return e.file.Close()
+}
@@ -0,0 +1,210 @@
+package tracing
+
+import (
+	"context"
+	"encoding/hex"
+	"fmt"
+	"math/rand"
+	"strings"
+	"sync"
+	"time"
+)
+
+// TraceID identifies a trace (W3C trace-id, 16 bytes)
+type TraceID [16]byte
+
+// SpanID identifies a span (W3C parent-id, 8 bytes)
+type SpanID [8]byte
+
+func (t TraceID) String() string { return hex.EncodeToString(t[:]) }
+func (s SpanID) String() string  { return hex.EncodeToString(s[:]) }
+
+// IsZero reports whether the ID is unset
+func (t TraceID) IsZero() bool { return t == TraceID{} }
+
+// IsZero reports whether the ID is unset
+func (s SpanID) IsZero() bool { return s == SpanID{} }
+
+// SpanContext is the propagated part of a trace: what arrives in and leaves
+// through a traceparent header
+type SpanContext struct {
+	TraceID TraceID
+	SpanID  SpanID
+	Sampled bool
+}
+
+// ParseTraceparent parses a W3C traceparent header
+// ("00-<32 hex trace-id>-<16 hex parent-id>-<2 hex flags>")
+func ParseTraceparent(header string) (SpanContext, error) {
+	var sc SpanContext
+	parts := strings.Split(strings.TrimSpace(header), "-")
+	if len(parts) < 4 {
+		return sc, fmt.Errorf("invalid traceparent: %q", header)
+	}
+	version, traceID, spanID, flags := parts[0], parts[1], parts[2], parts[3]
+	if len(version) != 2 || version == "ff" || len(traceID) != 32 || len(spanID) != 16 || len(flags) != 2 {
+		return sc, fmt.Errorf("invalid traceparent: %q", header)
+	}
+	// Version 00 has exactly four fields; later versions may append more
+	if version == "00" && len(parts) != 4 {
+		return sc, fmt.Errorf("invalid traceparent: %q", header)
+	}
+	if _, err := hex.Decode(sc.TraceID[:], []byte(traceID)); err != nil {
+		return sc, fmt.Errorf("invalid traceparent trace-id: %w", err)
+	}
+	if _, err := hex.Decode(sc.SpanID[:], []byte(spanID)); err != nil {
+		return sc, fmt.Errorf("invalid traceparent parent-id: %w", err)
+	}
+	var flagByte [1]byte
+	if _, err := hex.Decode(flagByte[:], []byte(flags)); err != nil {
+		return sc, fmt.Errorf("invalid traceparent flags: %w", err)
+	}
+	if sc.TraceID.IsZero() || sc.SpanID.IsZero() {
+		return sc, fmt.Errorf("invalid traceparent: all-zero id")
+	}
+	sc.Sampled = flagByte[0]&0x01 != 0
+	return sc, nil
+}
+
+// Traceparent formats the span context as a W3C traceparent header
+func (sc SpanContext) Traceparent() string {
+	flags := "00"
+	if sc.Sampled {
+		flags = "01"
+	}
+	return "00-" + sc.TraceID.String() + "-" + sc.SpanID.String() + "-" + flags
+}
+
+func newTraceID() TraceID {
+	var t TraceID
+	for t.IsZero() {
+		rand.Read(t[:])
+	}
+	return t
+}
+
+func newSpanID() SpanID {
+	var s SpanID
+	for s.IsZero() {
+		rand.Read(s[:])
+	}
+	return s
+}
+
+// Span is a finished unit of work within a trace
+type Span struct {
+	TraceID    TraceID
+	SpanID     SpanID
+	ParentID   SpanID // zero for a root span
+	Name       string
+	Start      time.Time
+	End        time.Time
+	Attributes map[string]string
+	Error      string // non-empty marks the span as failed
+}
+
+// Trace collects the spans of one invocation. The invocation's root span is
+// created with the trace and finished by End; every other span recorded on
+// the trace is a child of the root.
+//
+// All methods are safe to call on a nil *Trace, so call sites don't need to
+// check whether tracing is enabled.
+type Trace struct {
+	tracer *Tracer
+	root   Span
+	mu     sync.Mutex
+	spans  []Span
+}
+
+// SpanContext returns the context to propagate downstream (root span as parent)
+func (t *Trace) SpanContext() SpanContext {
+	if t == nil {
+		return SpanContext{}
+	}
+	return SpanContext{TraceID: t.root.TraceID, SpanID: t.root.SpanID, Sampled: true}
+}
+
+// TraceID returns the trace ID, or "" when t is nil
+func (t *Trace) TraceID() string {
+	if t == nil {
+		return ""
+	}
+	return t.root.TraceID.String()
+}
+
+// SetAttribute sets an attribute on the root span
+func (t *Trace) SetAttribute(key, value string) {
+	if t == nil {
+		return
+	}
+	t.mu.Lock()
+	t.root.Attributes[key] = value
+	t.mu.Unlock()
+}
+
+// SetError marks the root span as failed
+func (t *Trace) SetError(msg string) {
+	if t == nil {
+		return
+	}
+	t.mu.Lock()
+	t.root.Error = msg
+	t.mu.Unlock()
+}
+
+// Record adds a finished child span covering [start, end). Spans with an
+// unknown start (zero time) are skipped.
+func (t *Trace) Record(name string, start, end time.Time, attrs ...string) {
+	if t == nil || start.IsZero() || end.Before(start) {
+		return
+	}
+	span := Span{
+		TraceID:  t.root.TraceID,
+		SpanID:   newSpanID(),
+		ParentID: t.root.SpanID,
+		Name:     name,
+		Start:    start,
+		End:      end,
+	}
+	if len(attrs) > 1 {
+		span.Attributes = make(map[string]string, len(attrs)/2)
+		for i := 0; i+1 < len(attrs); i += 2 {
+			span.Attributes[attrs[i]] = attrs[i+1]
+		}
+	}
+	t.mu.Lock()
+	t.spans = append(t.spans, span)
+	t.mu.Unlock()
+}
+
+// End finishes the root span and hands the trace to the exporter
+func (t *Trace) End() {
+	if t == nil {
+		return
+	}
+	t.mu.Lock()
+	t.root.End = time.Now()
+	spans := append(t.spans, t.root)
+	t.spans = nil
+	t.mu.Unlock()
+	t.tracer.enqueue(spans)
+}
+
+type traceKey struct{}
+
+// ContextWithTrace returns a context carrying the trace
+func ContextWithTrace(ctx context.Context, t *Trace) context.Context {
+	if t == nil {
+		return ctx
+	}
+	return context.WithValue(ctx, traceKey{}, t)
+}
+
+// FromContext returns the trace carried by ctx, or nil
+func FromContext(ctx context.Context) *Trace {
+	if ctx == nil {
+		return nil
+	}
+	t, _ := ctx.Value(traceKey{}).(*Trace)
+	return t
+}
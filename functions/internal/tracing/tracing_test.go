@@ -0,0 +1,118 @@
+package tracing
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+func TestParseTraceparent(t *testing.T) {
+	header := "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"
+	sc, err := ParseTraceparent(header)
+	if err != nil {
+		t.Fatalf("ParseTraceparent failed: %v", err)
+	}
+	if sc.TraceID.String() != "4bf92f3577b34da6a3ce929d0e0e4736" {
+		t.Errorf("Unexpected trace ID %s", sc.TraceID)
+	}
+	if sc.SpanID.String() != "00f067aa0ba902b7" {
+		t.Errorf("Unexpected span ID %s", sc.SpanID)
+	}
+	if !sc.Sampled {
+		t.Error("Expected sampled flag")
+	}
+	if sc.Traceparent() != header {
+		t.Errorf("Round trip mismatch: %s", sc.Traceparent())
+	}
+
+	invalid := []string{
+		"",
+		"00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7",
+		"00-00000000000000000000000000000000-00f067aa0ba902b7-01",
+		"00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01",
+		"ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01",
+		"00-4bf92f3577b34da6a3ce929d0e0e473z-00f067aa0ba902b7-01",
+		"00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-extra",
+	}
+	for _, h := range invalid {
+		if _, err := ParseTraceparent(h); err == nil {
+			t.Errorf("Expected error for %q", h)
+		}
+	}
+}
+
+func TestNilTraceIsNoop(t *testing.T) {
+	var tracer *Tracer
+	trace := tracer.StartTrace("", "invoke test")
+	if trace != nil {
+		t.Fatal("Disabled tracer should return nil trace")
+	}
+	trace.Record("span", time.Now(), time.Now())
+	trace.SetAttribute("k", "v")
+	trace.End()
+}
+
+func TestTracerExportsToFile(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "spans.jsonl")
+	tracer, err := NewTracerFromConfig("", path, nil)
+	if err != nil {
+		t.Fatalf("NewTracerFromConfig failed: %v", err)
+	}
+
+	// Unsampled parent: no trace
+	if tr := tracer.StartTrace("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00", "invoke x"); tr != nil {
+		t.Error("Expected unsampled traceparent to disable the trace")
+	}
+
+	trace := tracer.StartTrace("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", "invoke hello")
+	start := time.Now()
+	trace.Record("js.execute", start, start.Add(time.Millisecond))
+	trace.End()
+	if err := tracer.Close(); err != nil {
+		t.Fatalf("Close failed: %v", err)
+	}
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	var req otlpRequest
+	if err := json.Unmarshal(data, &req); err != nil {
+		t.Fatalf("Invalid OTLP JSON: %v", err)
+	}
+	spans := req.ResourceSpans[0].ScopeSpans[0].Spans
+	if len(spans) != 2 {
+		t.Fatalf("Expected 2 spans, got %d", len(spans))
+	}
+	for _, s := range spans {
+		if s.TraceID != "4bf92f3577b34da6a3ce929d0e0e4736" {
+			t.Errorf("Span %s has trace ID %s", s.Name, s.TraceID)
+		}
+	}
+	if spans[1].Name != "invoke hello" || spans[1].ParentSpanID != "00f067aa0ba902b7" {
+		t.Errorf("Root span should continue the incoming trace, got %+v", spans[1])
+	}
+	if spans[0].ParentSpanID != spans[1].SpanID {
+		t.Error("Child span should be parented to the root span")
+	}
+}
+
+func TestTraceEndAfterClose(t *testing.T) {
+	tracer, err := NewTracerFromConfig("", filepath.Join(t.TempDir(), "spans.jsonl"), nil)
+	if err != nil {
+		t.Fatalf("NewTracerFromConfig failed: %v", err)
+	}
+	trace := tracer.StartTrace("", "invoke late")
+	if err := tracer.Close(); err != nil {
+		t.Fatalf("Close failed: %v", err)
+	}
+	trace.End()
+	if got := tracer.Dropped(); got != 1 {
+		t.Errorf("Expected the late span to be dropped, got %d dropped", got)
+	}
+	if err := tracer.Close(); err != nil {
+		t.Errorf("Second Close failed: %v", err)
+	}
+}
@@ -0,0 +1,58 @@
+package worker
+
+import (
+	"math/bits"
+	"sync"
+)
+
+// Buffers for message lines and decoded response bodies are pooled by
+// power-of-two size class, from 1 KB (class 0) to 16 MB. Larger buffers are
+// allocated on demand and left to the GC.
+const (
+	minBufferShift = 10
+	maxBufferShift = 24
+)
+
+var bufferPools [maxBufferShift - minBufferShift + 1]sync.Pool
+
+// bufferClass returns the size class that holds n bytes, or -1 when n is
+// larger than the largest class
+func bufferClass(n int) int {
+	if n <= 1<<minBufferShift {
+		return 0
+	}
+	c := bits.Len(uint(n-1)) - minBufferShift
+	if c >= len(bufferPools) {
+		return -1
+	}
+	return c
+}
+
+// getBuffer returns a zero-length buffer with room for at least n bytes
+func getBuffer(n int) []byte {
+	c := bufferClass(n)
+	if c < 0 {
+		return make([]byte, 0, n)
+	}
+	if b, ok := bufferPools[c].Get().(*[]byte); ok {
+		return (*b)[:0]
+	}
+	return make([]byte, 0, 1<<(c+minBufferShift))
+}
+
+// putBuffer returns a buffer obtained from getBuffer to its pool
+func putBuffer(b []byte) {
+	c := bufferClass(cap(b))
+	if c < 0 || cap(b) != 1<<(c+minBufferShift) {
+		return
+	}
+	b = b[:0]
+	bufferPools[c].Put(&b)
+}
+
+// ReleaseBody returns a ResponsePayload.RawBody (and so an InvokeResult body)
+// to the buffer pool once it has been written out. The caller must not use
+// the body afterwards. Bodies that did not come from the pool are ignored.
+func ReleaseBody(body []byte) {
+	putBuffer(body)
+}
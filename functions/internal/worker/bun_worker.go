@@ -15,6 +15,7 @@ import (
 	"github.com/google/uuid"
 	"github.com/kartikbazzad/bunbase/functions/internal/config"
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
 )
 
 // WorkerState represents the state of a worker
@@ -200,8 +201,8 @@ func (w *BunWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string, ini
 	}
 
 	w.process = cmd
-	w.reader = NewMessageReader(stdout)
-	w.writer = NewMessageWriter(stdin)
+	w.reader = NewMessageReader(&countingReader{r: stdout, n: prometrics.IPCBytes(w.functionID, "in")})
+	w.writer = NewMessageWriter(&countingWriter{w: stdin, n: prometrics.IPCBytes(w.functionID, "out")})
 	w.state = WorkerStateStarting
 
 	w.logger.Info("Worker %s process started (PID: %d), waiting for READY message (timeout: %v)", w.id, cmd.Process.Pid, cfg.StartupTimeout)
@@ -318,6 +319,7 @@ func (w *BunWorker) readMessages() {
 				if w.state != WorkerStateTerminated {
 					w.state = WorkerStateTerminated
 					w.logger.Warn("Worker %s process exited unexpectedly", w.id)
+					prometrics.IncWorkerCrash(w.functionID)
 				}
 				w.mu.Unlock()
 				// Notify all pending invocations
@@ -587,3 +589,15 @@ func (w *BunWorker) GetInvocations() int64 {
 	defer w.mu.Unlock()
 	return w.invocations
 }
+
+// RSSBytes returns the resident set size of the worker process
+func (w *BunWorker) RSSBytes() (int64, error) {
+	w.mu.Lock()
+	process := w.process
+	terminated := w.state == WorkerStateTerminated
+	w.mu.Unlock()
+	if process == nil || process.Process == nil || terminated {
+		return 0, fmt.Errorf("worker %s is not running", w.id)
+	}
+	return processRSS(process.Process.Pid)
+}
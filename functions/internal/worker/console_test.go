@@ -0,0 +1,71 @@
+package worker
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
+)
+
+// memoryLogs records the console lines a worker stores
+type memoryLogs struct {
+	mu    sync.Mutex
+	lines []string
+}
+
+func (m *memoryLogs) Append(_, _, _, message string) error {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	m.lines = append(m.lines, message)
+	return nil
+}
+
+func (m *memoryLogs) GetLogs(string, time.Time, int) ([]logstore.LogEntry, error) {
+	return nil, nil
+}
+
+func TestQuickJSConsoleFormatting(t *testing.T) {
+	binary, _ := filepath.Abs("../../cmd/quickjs-worker/quickjs-worker")
+	if _, err := os.Stat(binary); err != nil {
+		t.Skipf("quickjs-worker not built at %s, skipping integration test", binary)
+	}
+	bundle, _ := filepath.Abs("testdata/console.js")
+
+	w := NewQuickJSWorker("console-test", "v1", bundle, logger.Default())
+	logs := &memoryLogs{}
+	w.SetLogStore(logs)
+	cfg := &config.WorkerConfig{QuickJSPath: binary, StartupTimeout: 10 * time.Second}
+	if err := w.Spawn(cfg, "", "", nil); err != nil {
+		t.Fatalf("Failed to spawn worker: %v", err)
+	}
+	defer w.Terminate()
+
+	payload := &InvokePayload{Method: "GET", Path: "/", Headers: map[string]string{}, Query: map[string]string{}, DeadlineMS: 5000}
+	if _, invokeErr, err := w.Invoke(context.Background(), payload); err != nil || invokeErr != nil {
+		t.Fatalf("Invoke failed: %v %v", err, invokeErr)
+	}
+
+	want := []string{
+		`{"a":1}`, // toJSON returning itself is called once, as in JSON.stringify
+		`"1970-01-01T00:00:00.000Z"`,
+		`{"d":"1970-01-01T00:00:00.000Z"}`,
+		` x`,
+		`a! `,
+	}
+	logs.mu.Lock()
+	defer logs.mu.Unlock()
+	if len(logs.lines) != len(want) {
+		t.Fatalf("Expected %d log lines, got %q", len(want), logs.lines)
+	}
+	for i, line := range logs.lines {
+		if line != want[i] {
+			t.Errorf("Line %d = %q, want %q", i, line, want[i])
+		}
+	}
+}
@@ -0,0 +1,310 @@
+package worker
+
+import (
+	"context"
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/google/uuid"
+	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
+)
+
+// HostProcess is a quickjs-worker in host mode: one process and runtime with
+// a separate JSContext per loaded function version. Invocations name their
+// function (hostKey) and are multiplexed over the process's pipes; the process runs them one at
+// a time. When its function table is full or its runtime memory is over
+// HostMemoryMB, the process unloads its least recently used function, and a
+// later invoke of that function fails with NOT_LOADED and is retried after
+// loading it again.
+type HostProcess struct {
+	proc *QuickJSWorker
+
+	mu        sync.Mutex
+	functions map[string]int             // bound HostedWorkers per hostKey
+	workers   map[*HostedWorker]struct{} // spawned and not yet terminated
+}
+
+// hostKey names a function version inside a host process, so that a new
+// version's pool does not reuse the previous version's context
+func hostKey(functionID, version string) string {
+	return functionID + "@" + version
+}
+
+// StartHostProcess spawns a host process
+func StartHostProcess(cfg *config.WorkerConfig, log *logger.Logger) (*HostProcess, error) {
+	proc := NewHostQuickJSWorker(log)
+	if err := proc.Spawn(cfg, "", "", nil); err != nil {
+		return nil, err
+	}
+	return newHostProcess(proc), nil
+}
+
+func newHostProcess(proc *QuickJSWorker) *HostProcess {
+	return &HostProcess{proc: proc, functions: make(map[string]int), workers: make(map[*HostedWorker]struct{})}
+}
+
+// ID returns the host process's worker ID
+func (h *HostProcess) ID() string {
+	return h.proc.GetID()
+}
+
+// Alive reports whether the process is still running
+func (h *HostProcess) Alive() bool {
+	return h.proc.GetState() != WorkerStateTerminated
+}
+
+// Functions returns how many function versions have workers bound to the host
+func (h *HostProcess) Functions() int {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	return len(h.functions)
+}
+
+// Stop terminates the process and marks its hosted workers terminated, so
+// that their pools drop them instead of handing them out again
+func (h *HostProcess) Stop() error {
+	err := h.proc.Terminate()
+	h.mu.Lock()
+	workers := make([]*HostedWorker, 0, len(h.workers))
+	for w := range h.workers {
+		workers = append(workers, w)
+	}
+	h.mu.Unlock()
+	for _, w := range workers {
+		w.setState(WorkerStateTerminated)
+	}
+	return err
+}
+
+// Stats returns the host process's latest heartbeat
+func (h *HostProcess) Stats() (WorkerStats, bool) {
+	return h.proc.Stats()
+}
+
+// SetLogStore sets the log store for the hosted functions' logs. Optional.
+func (h *HostProcess) SetLogStore(store logstore.Store) {
+	h.proc.SetLogStore(store)
+}
+
+// RSSBytes returns the resident set size of the host process
+func (h *HostProcess) RSSBytes() (int64, error) {
+	return h.proc.RSSBytes()
+}
+
+func (h *HostProcess) load(ctx context.Context, functionID, version, bundlePath string, caps *capabilities.Capabilities, allowProfiling bool) error {
+	payload := newLoadPayload(hostKey(functionID, version), version, bundlePath, caps, allowProfiling)
+	msg, err := h.proc.roundTrip(ctx, functionID, func(id string) error {
+		return h.proc.writer.WriteLoad(id, payload)
+	})
+	if err != nil {
+		return fmt.Errorf("failed to load function %s: %w", functionID, err)
+	}
+	if msg.Type == MessageTypeError {
+		errPayload, err := ParseErrorPayload(msg)
+		if err != nil {
+			return fmt.Errorf("failed to parse error: %w", err)
+		}
+		return fmt.Errorf("failed to load bundle: %s", errPayload.Message)
+	}
+	if msg.Type != MessageTypeLoaded {
+		return fmt.Errorf("unexpected message type: %s", msg.Type)
+	}
+	return nil
+}
+
+func (h *HostProcess) attach(w *HostedWorker) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.workers[w] = struct{}{}
+}
+
+func (h *HostProcess) detach(w *HostedWorker) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	delete(h.workers, w)
+}
+
+func (h *HostProcess) bind(functionID, version string) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.functions[hostKey(functionID, version)]++
+}
+
+// unbind drops a function's worker and unloads the function once no worker
+// of it is left
+func (h *HostProcess) unbind(functionID, version string) {
+	key := hostKey(functionID, version)
+	h.mu.Lock()
+	h.functions[key]--
+	last := h.functions[key] <= 0
+	if last {
+		delete(h.functions, key)
+	}
+	h.mu.Unlock()
+	if !last || !h.Alive() {
+		return
+	}
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	_, _ = h.proc.roundTrip(ctx, functionID, func(id string) error {
+		return h.proc.writer.WriteUnload(id, &UnloadPayload{FunctionID: key})
+	})
+}
+
+// HostedWorker is one function's worker inside a HostProcess. It implements
+// Worker so that pools can use it like a dedicated process.
+type HostedWorker struct {
+	id             string
+	functionID     string
+	version        string
+	bundlePath     string
+	host           *HostProcess
+	logger         *logger.Logger
+	capabilities   *capabilities.Capabilities
+	allowProfiling bool
+
+	slotState
+	bound bool
+}
+
+// NewHostedWorker creates a worker for functionID in host (does not load it)
+func NewHostedWorker(host *HostProcess, functionID, version, bundlePath string, log *logger.Logger) *HostedWorker {
+	return &HostedWorker{
+		id:         uuid.New().String(),
+		functionID: functionID,
+		version:    version,
+		bundlePath: bundlePath,
+		host:       host,
+		logger:     log,
+		slotState:  slotState{state: WorkerStateStarting},
+	}
+}
+
+// SetCapabilities sets the security capabilities the function is loaded with
+func (w *HostedWorker) SetCapabilities(caps *capabilities.Capabilities) {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	w.capabilities = caps
+}
+
+// Spawn loads the function into the host process. Environment variables
+// cannot be set per function in a shared process, so env must be empty.
+func (w *HostedWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string, initScriptPath string, env map[string]string) error {
+	if len(env) > 0 {
+		return fmt.Errorf("hosted workers do not support per-function environment variables")
+	}
+	w.mu.Lock()
+	if w.bound {
+		w.mu.Unlock()
+		return fmt.Errorf("worker already spawned")
+	}
+	w.allowProfiling = cfg.EnableProfiling
+	w.mu.Unlock()
+
+	timeout := cfg.StartupTimeout
+	if timeout <= 0 {
+		timeout = 10 * time.Second
+	}
+	ctx, cancel := context.WithTimeout(context.Background(), timeout)
+	defer cancel()
+	if err := w.load(ctx); err != nil {
+		w.setState(WorkerStateTerminated)
+		return err
+	}
+	w.host.bind(w.functionID, w.version)
+	w.host.attach(w)
+
+	w.mu.Lock()
+	w.bound = true
+	w.mu.Unlock()
+	w.setState(WorkerStateReady)
+	w.logger.Info("Hosted worker %s for function %s ready in host %s", w.id, w.functionID, w.host.ID())
+	return nil
+}
+
+func (w *HostedWorker) load(ctx context.Context) error {
+	w.mu.Lock()
+	caps, allowProfiling := w.capabilities, w.allowProfiling
+	w.mu.Unlock()
+	return w.host.load(ctx, w.functionID, w.version, w.bundlePath, caps, allowProfiling)
+}
+
+// Reload loads another version of the function into the host and moves the
+// worker to it; the previous version's context is unloaded once no worker is
+// bound to it
+func (w *HostedWorker) Reload(ctx context.Context, version, bundlePath string) error {
+	w.mu.Lock()
+	if !w.bound || w.state != WorkerStateReady {
+		state := w.state
+		w.mu.Unlock()
+		return fmt.Errorf("worker not ready (state: %s)", state)
+	}
+	w.state = WorkerStateBusy
+	caps, allowProfiling, previous := w.capabilities, w.allowProfiling, w.version
+	w.mu.Unlock()
+
+	if err := w.host.load(ctx, w.functionID, version, bundlePath, caps, allowProfiling); err != nil {
+		w.end()
+		return err
+	}
+	w.host.bind(w.functionID, version)
+	w.mu.Lock()
+	w.version = version
+	w.bundlePath = bundlePath
+	w.mu.Unlock()
+	w.end()
+	w.host.unbind(w.functionID, previous)
+	return nil
+}
+
+// Invoke runs the function in the host process, loading it again first if
+// the host has unloaded it
+func (w *HostedWorker) Invoke(ctx context.Context, payload *InvokePayload) (*ResponsePayload, *ErrorPayload, error) {
+	if err := w.begin(); err != nil {
+		return nil, nil, err
+	}
+	defer w.end()
+
+	payload.FunctionID = hostKey(w.functionID, w.version)
+	resp, errPayload, err := w.host.proc.invokeMultiplexed(ctx, w.functionID, payload)
+	if errPayload != nil && errPayload.Code == "NOT_LOADED" {
+		w.logger.Debug("Function %s was unloaded from host %s, loading it again", w.functionID, w.host.ID())
+		if err := w.load(ctx); err != nil {
+			return nil, nil, err
+		}
+		resp, errPayload, err = w.host.proc.invokeMultiplexed(ctx, w.functionID, payload)
+	}
+	if err != nil && !w.host.Alive() {
+		w.setState(WorkerStateTerminated)
+	}
+	return resp, errPayload, err
+}
+
+// Terminate releases the function's slot in the host; the host process
+// itself keeps running for its other functions
+func (w *HostedWorker) Terminate() error {
+	w.mu.Lock()
+	bound := w.bound
+	w.bound = false
+	w.state = WorkerStateTerminated
+	w.mu.Unlock()
+	if bound {
+		w.host.detach(w)
+		w.host.unbind(w.functionID, w.version)
+	}
+	return nil
+}
+
+// HealthCheck reports whether the worker and its host process are usable
+func (w *HostedWorker) HealthCheck() bool {
+	return w.GetState() != WorkerStateTerminated && w.host.Alive()
+}
+
+// GetID returns the worker ID
+func (w *HostedWorker) GetID() string {
+	return w.id
+}
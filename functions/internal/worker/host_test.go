@@ -0,0 +1,197 @@
+package worker
+
+import (
+	"context"
+	"encoding/json"
+	"io"
+	"testing"
+	"time"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+)
+
+// pipeProcess connects proc to handle in place of a quickjs-worker process
+func pipeProcess(t *testing.T, proc *QuickJSWorker, handle func(w *MessageWriter, msg *Message)) {
+	t.Helper()
+	toHost, fromGo := io.Pipe()
+	fromHost, toGo := io.Pipe()
+	proc.reader = NewMessageReader(fromHost)
+	proc.writer = NewMessageWriter(fromGo)
+	proc.state = WorkerStateReady
+	go proc.readMessages()
+	go func() {
+		r, w := NewMessageReader(toHost), NewMessageWriter(toGo)
+		for {
+			msg, err := r.Read()
+			if err != nil {
+				return
+			}
+			handle(w, msg)
+		}
+	}()
+	t.Cleanup(func() {
+		proc.cancel()
+		fromGo.Close()
+		toGo.Close()
+	})
+}
+
+// fakeHost answers host-mode messages like quickjs-worker does, holding at
+// most one function so that loading a second one evicts the first
+func fakeHost(t *testing.T) (*HostProcess, *int) {
+	t.Helper()
+	proc := NewHostQuickJSWorker(logger.New(io.Discard, logger.LevelError, ""))
+	loads := 0
+	loaded := ""
+	pipeProcess(t, proc, func(w *MessageWriter, msg *Message) {
+		var p struct {
+			FunctionID string `json:"function_id"`
+		}
+		_ = json.Unmarshal(msg.Payload, &p)
+		switch msg.Type {
+		case MessageTypeLoad:
+			loads++
+			loaded = p.FunctionID
+			_ = w.Write(&Message{ID: msg.ID, Type: MessageTypeLoaded, Payload: json.RawMessage(`{}`)})
+		case MessageTypeUnload:
+			if loaded == p.FunctionID {
+				loaded = ""
+			}
+			_ = w.Write(&Message{ID: msg.ID, Type: MessageTypeUnloaded, Payload: json.RawMessage(`{}`)})
+		case MessageTypeInvoke:
+			if p.FunctionID != loaded {
+				_ = w.WriteError(msg.ID, &ErrorPayload{Message: "not loaded", Code: "NOT_LOADED"})
+				return
+			}
+			_ = w.WriteResponse(msg.ID, &ResponsePayload{Status: 200, Body: p.FunctionID})
+		}
+	})
+	return newHostProcess(proc), &loads
+}
+
+func TestHostedWorkersShareHostAndReloadAfterEviction(t *testing.T) {
+	host, loads := fakeHost(t)
+	log := logger.New(io.Discard, logger.LevelError, "")
+	cfg := &config.WorkerConfig{}
+	a := NewHostedWorker(host, "a", "v1", "/a.js", log)
+	b := NewHostedWorker(host, "b", "v1", "/b.js", log)
+	for _, w := range []*HostedWorker{a, b} {
+		if err := w.Spawn(cfg, "", "", nil); err != nil {
+			t.Fatalf("spawn: %v", err)
+		}
+	}
+	if n := host.Functions(); n != 2 {
+		t.Fatalf("Expected 2 functions bound, got %d", n)
+	}
+
+	// b's load evicted a; invoking a loads it again and retries
+	resp, errPayload, err := a.Invoke(context.Background(), &InvokePayload{DeadlineMS: 1000})
+	if err != nil || errPayload != nil {
+		t.Fatalf("invoke: err=%v errPayload=%+v", err, errPayload)
+	}
+	if resp.Body != "a@v1" || *loads != 3 {
+		t.Errorf("Expected a reloaded and invoked, got body %q after %d loads", resp.Body, *loads)
+	}
+	if a.GetState() != WorkerStateReady || a.GetInvocations() != 1 {
+		t.Errorf("Expected a ready after 1 invocation, got %s/%d", a.GetState(), a.GetInvocations())
+	}
+
+	a.Terminate()
+	if n := host.Functions(); n != 1 || !b.HealthCheck() {
+		t.Errorf("Expected b to stay bound, got %d functions", n)
+	}
+}
+
+func TestHostStopTerminatesHostedWorkers(t *testing.T) {
+	host, _ := fakeHost(t)
+	w := NewHostedWorker(host, "a", "v1", "/a.js", logger.New(io.Discard, logger.LevelError, ""))
+	if err := w.Spawn(&config.WorkerConfig{}, "", "", nil); err != nil {
+		t.Fatalf("spawn: %v", err)
+	}
+	host.proc.stats.Store(&WorkerStats{StatsPayload: StatsPayload{LagMS: 5000}, ReceivedAt: time.Now()})
+	if st, ok := host.Stats(); !ok || st.LagMS != 5000 {
+		t.Fatalf("Expected the host's heartbeat, got %+v (%v)", st, ok)
+	}
+
+	host.Stop()
+	if w.GetState() != WorkerStateTerminated || w.HealthCheck() {
+		t.Errorf("Expected the hosted worker terminated with its host, got %s", w.GetState())
+	}
+	w.Terminate()
+	if n := host.Functions(); n != 0 {
+		t.Errorf("Expected no functions bound after terminate, got %d", n)
+	}
+}
+
+func TestThreadSlotsMultiplexOneProcess(t *testing.T) {
+	tp := NewThreadedProcess("fn", "v1", "/fn.js", 2, logger.New(io.Discard, logger.LevelError, ""))
+	tp.startOnce.Do(func() {}) // the pipes below stand in for the process
+
+	// Answer only once both invocations are in flight, in reverse order
+	var held []*Message
+	pipeProcess(t, tp.proc, func(w *MessageWriter, msg *Message) {
+		held = append(held, msg)
+		if len(held) == 2 {
+			for i := len(held) - 1; i >= 0; i-- {
+				_ = w.WriteResponse(held[i].ID, &ResponsePayload{Status: 200})
+			}
+		}
+	})
+
+	slots := []*ThreadSlot{tp.Slot(), tp.Slot()}
+	if tp.Slot() != nil {
+		t.Fatal("Expected no third slot from a 2-thread process")
+	}
+	errs := make(chan error, 2)
+	for _, s := range slots {
+		if err := s.Spawn(&config.WorkerConfig{}, "", "", nil); err != nil {
+			t.Fatalf("spawn: %v", err)
+		}
+		go func(s *ThreadSlot) {
+			_, _, err := s.Invoke(context.Background(), &InvokePayload{DeadlineMS: 2000})
+			errs <- err
+		}(s)
+	}
+	for range slots {
+		if err := <-errs; err != nil {
+			t.Fatalf("invoke: %v", err)
+		}
+	}
+
+	slots[0].Terminate()
+	if !tp.alive() {
+		t.Fatal("Expected the process to outlive its first slot")
+	}
+	slots[1].Terminate()
+	if tp.alive() || tp.Slot() != nil {
+		t.Error("Expected the last slot to stop the process")
+	}
+}
+
+func TestRetiredThreadedProcessExitsWithItsLastSlot(t *testing.T) {
+	tp := NewThreadedProcess("fn", "v1", "/fn.js", 3, logger.New(io.Discard, logger.LevelError, ""))
+	tp.startOnce.Do(func() {})
+	pipeProcess(t, tp.proc, func(*MessageWriter, *Message) {})
+
+	slots := []*ThreadSlot{tp.Slot(), tp.Slot()}
+	tp.proc.stats.Store(&WorkerStats{StatsPayload: StatsPayload{RSS: 1 << 30}, ReceivedAt: time.Now()})
+	for _, s := range slots {
+		if st, ok := s.Stats(); !ok || st.RSS != 1<<30 || s.Process() != tp {
+			t.Fatalf("Expected each slot to report its process's heartbeat, got %+v (%v)", st, ok)
+		}
+	}
+
+	tp.Retire()
+	if tp.Slot() != nil {
+		t.Fatal("Expected a retired process to hand out no more slots")
+	}
+	slots[0].Terminate()
+	if !tp.alive() {
+		t.Fatal("Expected the process to outlive its first slot")
+	}
+	slots[1].Terminate()
+	if tp.alive() {
+		t.Error("Expected the process to exit with its last slot")
+	}
+}
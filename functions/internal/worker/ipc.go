@@ -15,7 +15,16 @@ const (
 	MessageTypeInvoke   = "invoke"
 	MessageTypeResponse = "response"
 	MessageTypeLog      = "log"
+	MessageTypeLogs     = "logs"
 	MessageTypeError    = "error"
+	MessageTypeProfile  = "profile"
+	MessageTypeLoad     = "load"
+	MessageTypeLoaded   = "loaded"
+	MessageTypeUnload   = "unload"
+	MessageTypeUnloaded = "unloaded"
+	MessageTypeReload   = "reload"
+	MessageTypeReloaded = "reloaded"
+	MessageTypeStats    = "stats"
 )
 
 // Message represents a JSON message in the IPC protocol
@@ -23,6 +32,8 @@ type Message struct {
 	ID      string          `json:"id"`
 	Type    string          `json:"type"`
 	Payload json.RawMessage `json:"payload"`
+
+	response *ResponsePayload // decoded by MessageReader instead of Payload
 }
 
 // ReadyPayload is sent by Bun worker when ready
@@ -39,6 +50,8 @@ type InvokePayload struct {
 	ProjectID     string            `json:"project_id"`   // optional: project ID for admin context
 	ProjectAPIKey string            `json:"project_api_key"` // optional: project public API key
 	GatewayURL    string            `json:"gateway_url"`  // optional: gateway base URL
+	Traceparent   string            `json:"traceparent,omitempty"` // optional: W3C trace context; worker reports timings when set
+	FunctionID    string            `json:"function_id,omitempty"` // set for host workers, which route invokes by function version
 }
 
 // ResponsePayload is sent by Bun worker after successful execution
@@ -46,6 +59,27 @@ type ResponsePayload struct {
 	Status  int               `json:"status"`
 	Headers map[string]string  `json:"headers"`
 	Body    string            `json:"body"` // base64-encoded
+	Timings *WorkerTimings    `json:"timings,omitempty"`
+	Heap    int64             `json:"heap,omitempty"` // JS heap bytes; sampled by the worker at most once a second
+	RawBody []byte            `json:"-"` // Body as decoded by MessageReader into a pooled buffer (see ReleaseBody); Body is then empty
+}
+
+// DecodedBody returns the response body bytes
+func (r *ResponsePayload) DecodedBody() ([]byte, error) {
+	if r.RawBody != nil {
+		return r.RawBody, nil
+	}
+	return DecodeBody(r.Body)
+}
+
+// WorkerTimings are the worker's internal timestamps for one invocation, in
+// Unix nanoseconds. Only reported for traced invocations.
+type WorkerTimings struct {
+	Parsed         int64 `json:"parsed"`          // invoke message parsed
+	RequestBuilt   int64 `json:"request_built"`   // JS Request object created
+	HandlerStart   int64 `json:"handler_start"`   // handler called
+	HandlerSettled int64 `json:"handler_settled"` // returned value/promise settled
+	Serialized     int64 `json:"serialized"`      // response encoded, about to be written
 }
 
 // LogPayload is sent by Bun worker for log messages
@@ -55,6 +89,25 @@ type LogPayload struct {
 	Metadata map[string]interface{} `json:"metadata,omitempty"`
 }
 
+// LogsPayload is sent by the QuickJS worker with an invocation's buffered
+// console lines. Dropped counts lines over the per-invocation log limits.
+type LogsPayload struct {
+	Entries []LogPayload `json:"entries"`
+	Dropped int          `json:"dropped,omitempty"`
+}
+
+// StatsPayload is the QuickJS worker's heartbeat, sent every
+// WorkerConfig.StatsInterval from a thread beside the JS runtimes. Heap and
+// GCs sum over the process's runtimes and are updated as each message is
+// handled.
+type StatsPayload struct {
+	Heap        int64 `json:"heap"`        // JS runtime malloc bytes, sampled at most once a second
+	GCs         int64 `json:"gcs"`         // automatic garbage collections
+	RSS         int64 `json:"rss"`         // resident set size of the process, bytes
+	Invocations int64 `json:"invocations"` // invoke messages received since start
+	LagMS       int64 `json:"lag_ms"`      // how long the longest-running message has run; 0 when idle
+}
+
 // ErrorPayload is sent by Bun worker when handler execution fails
 type ErrorPayload struct {
 	Message string `json:"message"`
@@ -62,40 +115,167 @@ type ErrorPayload struct {
 	Code    string `json:"code,omitempty"`
 }
 
-// MessageReader reads NDJSON messages from an io.Reader
+// ProfileRequestPayload is sent by Go to start or stop the sampling profiler
+type ProfileRequestPayload struct {
+	Action string `json:"action"`       // "start" or "stop"
+	HZ     int    `json:"hz,omitempty"` // sampling rate for "start"
+}
+
+// ProfilePayload is sent by the QuickJS worker in reply to a profile stop
+type ProfilePayload struct {
+	HZ      int    `json:"hz"`
+	Samples int64  `json:"samples"`
+	Dropped int64  `json:"dropped"` // samples lost because the stack table was full
+	Folded  string `json:"folded"`  // "outer;inner count" lines
+}
+
+// LoadPayload is sent by Go to bind a blank QuickJS worker to a function.
+// The capability fields mirror the environment a dedicated worker is started with.
+type LoadPayload struct {
+	FunctionID        string `json:"function_id"`
+	Version           string `json:"version"`
+	BundlePath        string `json:"bundle_path"`
+	AllowFilesystem   bool   `json:"allow_filesystem,omitempty"`
+	AllowNetwork      bool   `json:"allow_network,omitempty"`
+	AllowChildProcess bool   `json:"allow_child_process,omitempty"`
+	AllowEval         bool   `json:"allow_eval,omitempty"`
+	AllowProfiling    bool   `json:"allow_profiling,omitempty"`
+	MaxMemory         int64  `json:"max_memory,omitempty"`
+	MaxFDs            int    `json:"max_fds,omitempty"`
+	LogLevel          string `json:"log_level,omitempty"`
+}
+
+// UnloadPayload is sent by Go to drop a function from a host worker
+type UnloadPayload struct {
+	FunctionID string `json:"function_id"`
+}
+
+// ReloadPayload is sent by Go to swap a loaded QuickJS worker to a new
+// version of its function's bundle
+type ReloadPayload struct {
+	Version    string `json:"version"`
+	BundlePath string `json:"bundle_path"`
+}
+
+// maxMessageBytes bounds one message line from a worker
+const maxMessageBytes = 256 << 20
+
+// MessageReader reads NDJSON messages from an io.Reader. A line that fits
+// the reader's buffer is decoded where it lies; a longer one is assembled in
+// a pooled buffer, so messages are limited only by maxMessageBytes. Response
+// messages are decoded in one pass, with the base64 body decoded straight
+// into a pooled buffer (ResponsePayload.RawBody); other messages keep their
+// payload as raw JSON for the Parse*Payload functions.
 type MessageReader struct {
-	scanner *bufio.Scanner
+	reader *bufio.Reader
+}
+
+// byteCounter is the part of a Prometheus counter that counts stream bytes
+type byteCounter interface {
+	Add(float64)
+}
+
+// countingReader counts the bytes read from a worker's stdout. MessageReader
+// reads it in 64 KB chunks, so the counter is updated about once per chunk.
+type countingReader struct {
+	r io.Reader
+	n byteCounter
+}
+
+func (c *countingReader) Read(p []byte) (int, error) {
+	n, err := c.r.Read(p)
+	if n > 0 {
+		c.n.Add(float64(n))
+	}
+	return n, err
+}
+
+// countingWriter counts the bytes written to a worker's stdin
+type countingWriter struct {
+	w io.Writer
+	n byteCounter
+}
+
+func (c *countingWriter) Write(p []byte) (int, error) {
+	n, err := c.w.Write(p)
+	if n > 0 {
+		c.n.Add(float64(n))
+	}
+	return n, err
 }
 
 // NewMessageReader creates a new message reader
 func NewMessageReader(r io.Reader) *MessageReader {
 	return &MessageReader{
-		scanner: bufio.NewScanner(r),
+		reader: bufio.NewReaderSize(r, 64*1024),
 	}
 }
 
 // Read reads the next message from the stream
 // This blocks until a complete line is available
 func (mr *MessageReader) Read() (*Message, error) {
-	if !mr.scanner.Scan() {
-		if err := mr.scanner.Err(); err != nil {
+	for {
+		line, pooled, err := mr.readLine()
+		if err != nil {
 			return nil, err
 		}
-		return nil, io.EOF
+		if len(line) == 0 {
+			// Empty line, try again
+			continue
+		}
+		msg, err := decodeMessage(line)
+		if pooled != nil {
+			putBuffer(pooled)
+		}
+		return msg, err
 	}
+}
 
-	line := mr.scanner.Bytes()
-	if len(line) == 0 {
-		// Empty line, try again
-		return mr.Read()
+// readLine returns the next line without its newline. pooled is set when the
+// line was assembled in a pooled buffer, which the caller returns once it is
+// done with the line; otherwise the line is only valid until the next read.
+func (mr *MessageReader) readLine() (line, pooled []byte, err error) {
+	line, err = mr.reader.ReadSlice('\n')
+	for err == bufio.ErrBufferFull {
+		if len(pooled)+len(line) > maxMessageBytes {
+			putBuffer(pooled)
+			return nil, nil, fmt.Errorf("message exceeds %d bytes", maxMessageBytes)
+		}
+		pooled = appendPooled(pooled, line)
+		line, err = mr.reader.ReadSlice('\n')
 	}
-
-	var msg Message
-	if err := json.Unmarshal(line, &msg); err != nil {
-		return nil, fmt.Errorf("failed to unmarshal message: %w", err)
+	if pooled != nil {
+		pooled = appendPooled(pooled, line)
+		line = pooled
 	}
+	if err == io.EOF && len(line) > 0 {
+		// Final line without a newline
+		err = nil
+	}
+	if err != nil {
+		if pooled != nil {
+			putBuffer(pooled)
+		}
+		return nil, nil, err
+	}
+	for len(line) > 0 && (line[len(line)-1] == '\n' || line[len(line)-1] == '\r') {
+		line = line[:len(line)-1]
+	}
+	return line, pooled, nil
+}
 
-	return &msg, nil
+// appendPooled appends data to a pooled buffer, moving it to a pooled buffer
+// of the next fitting size class when it is full
+func appendPooled(buf, data []byte) []byte {
+	if len(buf)+len(data) > cap(buf) {
+		grown := getBuffer(len(buf) + len(data))
+		grown = append(grown, buf...)
+		if buf != nil {
+			putBuffer(buf)
+		}
+		buf = grown
+	}
+	return append(buf, data...)
 }
 
 // MessageWriter writes NDJSON messages to an io.Writer
@@ -153,6 +333,45 @@ func (mw *MessageWriter) WriteInvoke(id string, payload *InvokePayload) error {
 	})
 }
 
+// WriteLoad writes a LOAD message
+func (mw *MessageWriter) WriteLoad(id string, payload *LoadPayload) error {
+	payloadData, err := json.Marshal(payload)
+	if err != nil {
+		return err
+	}
+	return mw.Write(&Message{
+		ID:      id,
+		Type:    MessageTypeLoad,
+		Payload: payloadData,
+	})
+}
+
+// WriteUnload writes an UNLOAD message
+func (mw *MessageWriter) WriteUnload(id string, payload *UnloadPayload) error {
+	payloadData, err := json.Marshal(payload)
+	if err != nil {
+		return err
+	}
+	return mw.Write(&Message{
+		ID:      id,
+		Type:    MessageTypeUnload,
+		Payload: payloadData,
+	})
+}
+
+// WriteReload writes a RELOAD message
+func (mw *MessageWriter) WriteReload(id string, payload *ReloadPayload) error {
+	payloadData, err := json.Marshal(payload)
+	if err != nil {
+		return err
+	}
+	return mw.Write(&Message{
+		ID:      id,
+		Type:    MessageTypeReload,
+		Payload: payloadData,
+	})
+}
+
 // WriteResponse writes a RESPONSE message
 func (mw *MessageWriter) WriteResponse(id string, payload *ResponsePayload) error {
 	payloadData, err := json.Marshal(payload)
@@ -192,6 +411,19 @@ func (mw *MessageWriter) WriteError(id string, payload *ErrorPayload) error {
 	})
 }
 
+// WriteProfile writes a PROFILE control message
+func (mw *MessageWriter) WriteProfile(id string, payload *ProfileRequestPayload) error {
+	payloadData, err := json.Marshal(payload)
+	if err != nil {
+		return err
+	}
+	return mw.Write(&Message{
+		ID:      id,
+		Type:    MessageTypeProfile,
+		Payload: payloadData,
+	})
+}
+
 // EncodeBody encodes a byte slice to base64 string
 func EncodeBody(body []byte) string {
 	if len(body) == 0 {
@@ -225,6 +457,9 @@ func ParseResponsePayload(msg *Message) (*ResponsePayload, error) {
 	if msg.Type != MessageTypeResponse {
 		return nil, fmt.Errorf("expected response message, got %s", msg.Type)
 	}
+	if msg.response != nil {
+		return msg.response, nil
+	}
 	var payload ResponsePayload
 	if err := json.Unmarshal(msg.Payload, &payload); err != nil {
 		return nil, err
@@ -244,6 +479,30 @@ func ParseLogPayload(msg *Message) (*LogPayload, error) {
 	return &payload, nil
 }
 
+// ParseLogsPayload parses a LogsPayload from a message
+func ParseLogsPayload(msg *Message) (*LogsPayload, error) {
+	if msg.Type != MessageTypeLogs {
+		return nil, fmt.Errorf("expected logs message, got %s", msg.Type)
+	}
+	var payload LogsPayload
+	if err := json.Unmarshal(msg.Payload, &payload); err != nil {
+		return nil, err
+	}
+	return &payload, nil
+}
+
+// ParseStatsPayload parses a StatsPayload from a message
+func ParseStatsPayload(msg *Message) (*StatsPayload, error) {
+	if msg.Type != MessageTypeStats {
+		return nil, fmt.Errorf("expected stats message, got %s", msg.Type)
+	}
+	var payload StatsPayload
+	if err := json.Unmarshal(msg.Payload, &payload); err != nil {
+		return nil, err
+	}
+	return &payload, nil
+}
+
 // ParseErrorPayload parses an ErrorPayload from a message
 func ParseErrorPayload(msg *Message) (*ErrorPayload, error) {
 	if msg.Type != MessageTypeError {
@@ -256,6 +515,18 @@ func ParseErrorPayload(msg *Message) (*ErrorPayload, error) {
 	return &payload, nil
 }
 
+// ParseProfilePayload parses a ProfilePayload from a message
+func ParseProfilePayload(msg *Message) (*ProfilePayload, error) {
+	if msg.Type != MessageTypeProfile {
+		return nil, fmt.Errorf("expected profile message, got %s", msg.Type)
+	}
+	var payload ProfilePayload
+	if err := json.Unmarshal(msg.Payload, &payload); err != nil {
+		return nil, err
+	}
+	return &payload, nil
+}
+
 // CheckDeadline checks if the deadline has passed
 func CheckDeadline(deadlineMS int64) bool {
 	if deadlineMS <= 0 {
@@ -0,0 +1,177 @@
+package worker
+
+import (
+	"bytes"
+	"encoding/base64"
+	"encoding/json"
+	"fmt"
+	"io"
+	"testing"
+)
+
+// responseLine is a response message line with a body of n bytes
+func responseLine(id string, n int) ([]byte, []byte) {
+	body := bytes.Repeat([]byte("0123456789abcdef"), n/16+1)[:n]
+	var buf bytes.Buffer
+	_ = NewMessageWriter(&buf).WriteResponse(id, &ResponsePayload{
+		Status:  200,
+		Headers: map[string]string{"content-type": "text/plain"},
+		Body:    EncodeBody(body),
+	})
+	return buf.Bytes(), body
+}
+
+func TestMessageReaderDecodesLargeAndSmallMessages(t *testing.T) {
+	large, body := responseLine("r1", 3<<20)
+	var stream bytes.Buffer
+	stream.Write(large)
+	stream.WriteString("\n\n")
+	stream.WriteString(`{"id":"l1","type":"log","payload":{"level":"info","message":"hi"}}` + "\n")
+	stream.WriteString(`{"id":"l2","type":"logs","payload":{"entries":[{"level":"info","message":"a\"b"},{"level":"warn","message":"c"}],"dropped":3}}` + "\n")
+	stream.WriteString(`{"id":"w1","type":"stats","payload":{"heap":2048,"gcs":3,"rss":8192,"invocations":7,"lag_ms":1500}}` + "\n")
+	stream.WriteString(`{"id":"r2","type":"response","payload":{"status":500,"body":"not base64!","heap":1048576}}`)
+
+	mr := NewMessageReader(&stream)
+	msg, err := mr.Read()
+	if err != nil {
+		t.Fatalf("large response: %v", err)
+	}
+	resp, err := ParseResponsePayload(msg)
+	if err != nil || msg.ID != "r1" || resp.Status != 200 || resp.Headers["content-type"] != "text/plain" {
+		t.Fatalf("large response: %+v %v", msg, err)
+	}
+	got, err := resp.DecodedBody()
+	if err != nil || !bytes.Equal(got, body) {
+		t.Fatalf("large response body: %d bytes, err %v; want %d bytes", len(got), err, len(body))
+	}
+	ReleaseBody(got)
+
+	msg, err = mr.Read()
+	if err != nil || msg.Type != MessageTypeLog {
+		t.Fatalf("log after blank line: %+v %v", msg, err)
+	}
+	if lp, err := ParseLogPayload(msg); err != nil || lp.Message != "hi" {
+		t.Fatalf("log payload: %+v %v", lp, err)
+	}
+	msg, err = mr.Read()
+	if err != nil || msg.Type != MessageTypeLogs {
+		t.Fatalf("logs: %+v %v", msg, err)
+	}
+	if lp, err := ParseLogsPayload(msg); err != nil || len(lp.Entries) != 2 || lp.Entries[0].Message != `a"b` || lp.Entries[1].Level != "warn" || lp.Dropped != 3 {
+		t.Fatalf("logs payload: %+v %v", lp, err)
+	}
+	msg, err = mr.Read()
+	if err != nil || msg.Type != MessageTypeStats {
+		t.Fatalf("stats: %+v %v", msg, err)
+	}
+	if sp, err := ParseStatsPayload(msg); err != nil || *sp != (StatsPayload{Heap: 2048, GCs: 3, RSS: 8192, Invocations: 7, LagMS: 1500}) {
+		t.Fatalf("stats payload: %+v %v", sp, err)
+	}
+
+	// A body that is not base64 is passed on as text; decoding it fails later,
+	// where it did before
+	msg, err = mr.Read()
+	if err != nil {
+		t.Fatalf("final line without newline: %v", err)
+	}
+	resp, _ = ParseResponsePayload(msg)
+	if resp.RawBody != nil || resp.Body != "not base64!" {
+		t.Errorf("invalid body: raw %q text %q", resp.RawBody, resp.Body)
+	}
+	if resp.Heap != 1<<20 {
+		t.Errorf("heap = %d, want %d", resp.Heap, 1<<20)
+	}
+	if _, err := mr.Read(); err != io.EOF {
+		t.Errorf("Expected io.EOF, got %v", err)
+	}
+}
+
+// repeatReader returns the same line forever
+type repeatReader struct {
+	line []byte
+	off  int
+}
+
+func (r *repeatReader) Read(p []byte) (int, error) {
+	n := copy(p, r.line[r.off:])
+	r.off = (r.off + n) % len(r.line)
+	return n, nil
+}
+
+var benchSizes = []int{1 << 10, 64 << 10, 1 << 20, 8 << 20}
+
+func sizeName(n int) string {
+	if n >= 1<<20 {
+		return fmt.Sprintf("%dMB", n>>20)
+	}
+	return fmt.Sprintf("%dKB", n>>10)
+}
+
+// BenchmarkMessageReaderResponse reads response messages the way a worker's
+// reader goroutine and the scheduler do, returning each body to the pool as
+// the gateway does once it has written it
+func BenchmarkMessageReaderResponse(b *testing.B) {
+	for _, n := range benchSizes {
+		b.Run(sizeName(n), func(b *testing.B) {
+			line, _ := responseLine("bench", n)
+			mr := NewMessageReader(&repeatReader{line: line})
+			b.SetBytes(int64(n))
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				msg, err := mr.Read()
+				if err != nil {
+					b.Fatal(err)
+				}
+				resp, _ := ParseResponsePayload(msg)
+				body, err := resp.DecodedBody()
+				if err != nil || len(body) != n {
+					b.Fatalf("body: %d bytes, err %v", len(body), err)
+				}
+				ReleaseBody(body)
+			}
+		})
+	}
+}
+
+// BenchmarkLegacyResponseDecode is the decoding the reader replaced: the
+// whole line into Message, the payload again into ResponsePayload, then the
+// base64 body. It starts from a line in memory, as bufio.Scanner could not
+// read lines over 64 KB.
+func BenchmarkLegacyResponseDecode(b *testing.B) {
+	for _, n := range benchSizes {
+		b.Run(sizeName(n), func(b *testing.B) {
+			line, _ := responseLine("bench", n)
+			b.SetBytes(int64(n))
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				var msg Message
+				if err := json.Unmarshal(line, &msg); err != nil {
+					b.Fatal(err)
+				}
+				var resp ResponsePayload
+				if err := json.Unmarshal(msg.Payload, &resp); err != nil {
+					b.Fatal(err)
+				}
+				body, err := base64.StdEncoding.DecodeString(resp.Body)
+				if err != nil || len(body) != n {
+					b.Fatalf("body: %d bytes, err %v", len(body), err)
+				}
+			}
+		})
+	}
+}
+
+func TestBufferClasses(t *testing.T) {
+	for _, n := range []int{0, 1, 1024, 1025, 8 << 20, 16 << 20} {
+		b := getBuffer(n)
+		if cap(b) < n || len(b) != 0 {
+			t.Errorf("getBuffer(%d): len %d cap %d", n, len(b), cap(b))
+		}
+		putBuffer(b)
+	}
+	if c := bufferClass(16<<20 + 1); c != -1 {
+		t.Errorf("bufferClass beyond 16 MB = %d, want -1", c)
+	}
+}
@@ -10,15 +10,19 @@ import (
 	"os/exec"
 	"path/filepath"
 	"sync"
+	"sync/atomic"
 	"syscall"
 	"time"
 
 	"github.com/google/uuid"
+	"github.com/kartikbazzad/bunbase/functions/internal/affinity"
 	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
+	"github.com/kartikbazzad/bunbase/functions/internal/cgroup"
 	"github.com/kartikbazzad/bunbase/functions/internal/config"
 	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
 	"github.com/kartikbazzad/bunbase/functions/internal/logger"
 	"github.com/kartikbazzad/bunbase/functions/internal/prometrics"
+	"github.com/kartikbazzad/bunbase/functions/internal/tracing"
 )
 
 // QuickJSWorker represents a QuickJS-NG worker process
@@ -43,6 +47,13 @@ type QuickJSWorker struct {
 	pendingInvocations map[string]chan *Message
 	invocationMu       sync.RWMutex
 	logStore           logstore.Store // optional; when set, log messages are appended here
+	blank              bool           // started without a bundle; bound to a function by Load
+	host               bool           // hosts many functions; see HostProcess
+	hostInvocations    map[string]string // host workers: function of each pending invocation, for logs
+	threads            int               // runtimes in the process (WORKER_THREADS); see ThreadedProcess
+	cgroup             *cgroup.Group     // the process's cgroup when WorkerConfig.CgroupRoot is usable
+	cpus               *affinity.Slot    // the CPUs the process is pinned to when WorkerConfig.CPUAffinity is set
+	stats              atomic.Pointer[WorkerStats] // latest heartbeat; nil until the first
 }
 
 // NewQuickJSWorker creates a new QuickJS worker instance (does not spawn process)
@@ -61,6 +72,24 @@ func NewQuickJSWorker(functionID, version, bundlePath string, log *logger.Logger
 	}
 }
 
+// NewBlankQuickJSWorker creates a worker that starts without a bundle. After
+// Spawn it has an initialized runtime and waits for Load to bind it to a
+// function.
+func NewBlankQuickJSWorker(log *logger.Logger) *QuickJSWorker {
+	w := NewQuickJSWorker("", "", "", log)
+	w.blank = true
+	return w
+}
+
+// NewHostQuickJSWorker creates a worker that runs in host mode, loading many
+// functions into separate contexts of one runtime. It is driven by HostProcess.
+func NewHostQuickJSWorker(log *logger.Logger) *QuickJSWorker {
+	w := NewQuickJSWorker("", "", "", log)
+	w.host = true
+	w.hostInvocations = make(map[string]string)
+	return w
+}
+
 // SetCapabilities sets the security capabilities for this worker
 func (w *QuickJSWorker) SetCapabilities(caps *capabilities.Capabilities) {
 	w.mu.Lock()
@@ -93,17 +122,22 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 	// Get absolute path to QuickJS worker binary
 	absQuickJSPath, err := filepath.Abs(quickjsPath)
 	if err != nil {
+		w.mu.Unlock()
 		return fmt.Errorf("failed to get absolute path to QuickJS worker: %w", err)
 	}
 
 	// Verify QuickJS worker binary exists
 	if _, err := os.Stat(absQuickJSPath); err != nil {
+		w.mu.Unlock()
 		return fmt.Errorf("QuickJS worker binary not found: %s", absQuickJSPath)
 	}
 
 	// Verify bundle exists
-	if _, err := os.Stat(w.bundlePath); err != nil {
-		return fmt.Errorf("bundle not found: %s", w.bundlePath)
+	if !w.blank && !w.host {
+		if _, err := os.Stat(w.bundlePath); err != nil {
+			w.mu.Unlock()
+			return fmt.Errorf("bundle not found: %s", w.bundlePath)
+		}
 	}
 
 	w.logger.Debug("Spawning QuickJS worker: binary=%s bundle=%s", absQuickJSPath, w.bundlePath)
@@ -113,8 +147,23 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 
 	// Set environment variables
 	cmd.Env = os.Environ()
-	cmd.Env = append(cmd.Env, fmt.Sprintf("BUNDLE_PATH=%s", w.bundlePath))
+	if w.host {
+		cmd.Env = append(cmd.Env, "HOST_WORKER=1")
+		if cfg.FunctionsPerHost > 0 {
+			cmd.Env = append(cmd.Env, fmt.Sprintf("HOST_MAX_FUNCTIONS=%d", cfg.FunctionsPerHost))
+		}
+		if cfg.HostMemoryMB > 0 {
+			cmd.Env = append(cmd.Env, fmt.Sprintf("HOST_MEMORY_MB=%d", cfg.HostMemoryMB))
+		}
+	} else if w.blank {
+		cmd.Env = append(cmd.Env, "BLANK_WORKER=1")
+	} else {
+		cmd.Env = append(cmd.Env, fmt.Sprintf("BUNDLE_PATH=%s", w.bundlePath))
+	}
 	cmd.Env = append(cmd.Env, fmt.Sprintf("WORKER_ID=%s", w.id))
+	if w.threads > 1 {
+		cmd.Env = append(cmd.Env, fmt.Sprintf("WORKER_THREADS=%d", w.threads))
+	}
 
 	// Add capabilities to environment (as JSON)
 	if w.capabilities != nil {
@@ -124,6 +173,19 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 		}
 	}
 
+	if cfg.EnableProfiling {
+		cmd.Env = append(cmd.Env, "ALLOW_PROFILING=1")
+	}
+	if cfg.MaxLogLinesPerInvocation > 0 {
+		cmd.Env = append(cmd.Env, fmt.Sprintf("LOG_MAX_LINES=%d", cfg.MaxLogLinesPerInvocation))
+	}
+	if cfg.MaxLogBytesPerInvocation > 0 {
+		cmd.Env = append(cmd.Env, fmt.Sprintf("LOG_MAX_BYTES=%d", cfg.MaxLogBytesPerInvocation))
+	}
+	if cfg.StatsInterval > 0 {
+		cmd.Env = append(cmd.Env, fmt.Sprintf("STATS_INTERVAL_MS=%d", cfg.StatsInterval.Milliseconds()))
+	}
+
 	for k, v := range env {
 		cmd.Env = append(cmd.Env, fmt.Sprintf("%s=%s", k, v))
 	}
@@ -143,11 +205,16 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 		if w.capabilities.MaxFileDescriptors > 0 {
 			cmd.Env = append(cmd.Env, fmt.Sprintf("MAX_FDS=%d", w.capabilities.MaxFileDescriptors))
 		}
+
+		if w.capabilities.LogLevel != "" {
+			cmd.Env = append(cmd.Env, fmt.Sprintf("LOG_LEVEL=%s", w.capabilities.LogLevel))
+		}
 	}
 
 	// Set up stdin/stdout/stderr pipes
 	stdin, err := cmd.StdinPipe()
 	if err != nil {
+		w.mu.Unlock()
 		return fmt.Errorf("failed to create stdin pipe: %w", err)
 	}
 	w.stdin = stdin
@@ -155,6 +222,7 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 	stdout, err := cmd.StdoutPipe()
 	if err != nil {
 		stdin.Close()
+		w.mu.Unlock()
 		return fmt.Errorf("failed to create stdout pipe: %w", err)
 	}
 	w.stdout = stdout
@@ -164,6 +232,7 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 	if err != nil {
 		stdin.Close()
 		stdout.Close()
+		w.mu.Unlock()
 		return fmt.Errorf("failed to create stderr pipe: %w", err)
 	}
 
@@ -208,8 +277,24 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 	}
 
 	w.process = cmd
-	w.reader = NewMessageReader(stdout)
-	w.writer = NewMessageWriter(stdin)
+	if m := cgroup.ForRoot(cfg.CgroupRoot, w.logger); m != nil {
+		group, limits := w.cgroupPlacement()
+		if g, err := m.Place(group, w.id, cmd.Process.Pid, limits); err != nil {
+			w.logger.Warn("QuickJS Worker %s runs outside its cgroup: %v", w.id, err)
+		} else {
+			w.cgroup = g
+		}
+	}
+	if placer := affinity.ForPolicy(cfg.CPUAffinity, cfg.GatewayCores, w.logger); placer != nil {
+		if slot, err := placer.Place(w.functionID, w.threads, cmd.Process.Pid); err != nil {
+			w.logger.Warn("QuickJS Worker %s is not pinned to worker CPUs: %v", w.id, err)
+		} else {
+			w.cpus = slot
+		}
+	}
+	label := w.metricsFunction()
+	w.reader = NewMessageReader(&countingReader{r: stdout, n: prometrics.IPCBytes(label, "in")})
+	w.writer = NewMessageWriter(&countingWriter{w: stdin, n: prometrics.IPCBytes(label, "out")})
 	w.state = WorkerStateStarting
 
 	w.logger.Info("QuickJS Worker %s process started (PID: %d), waiting for READY message (timeout: %v)", w.id, cmd.Process.Pid, cfg.StartupTimeout)
@@ -275,6 +360,14 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 				w.logger.Info("QuickJS Worker %s startup log: %s", w.id, payload.Message)
 			}
 		}
+		if msg.Type == MessageTypeLogs {
+			var payload LogsPayload
+			if err := json.Unmarshal(msg.Payload, &payload); err == nil {
+				for _, e := range payload.Entries {
+					w.logger.Info("QuickJS Worker %s startup log: %s", w.id, e.Message)
+				}
+			}
+		}
 	}
 
 	w.logger.Debug("QuickJS Worker %s startup loop completed, starting readMessages goroutine", w.id)
@@ -296,6 +389,29 @@ func (w *QuickJSWorker) Spawn(cfg *config.WorkerConfig, workerScriptPath string,
 	return nil
 }
 
+// storeLogs appends an invocation's console lines to the log store. dropped
+// counts lines the worker discarded under the per-invocation limits.
+func (w *QuickJSWorker) storeLogs(invocationID string, entries []LogPayload, dropped int) {
+	w.mu.Lock()
+	store, functionID := w.logStore, w.functionID
+	w.mu.Unlock()
+	if w.host {
+		w.invocationMu.RLock()
+		functionID = w.hostInvocations[invocationID]
+		w.invocationMu.RUnlock()
+	}
+	for _, e := range entries {
+		w.logger.Info("QuickJS Worker %s log [%s]: %s", w.id, e.Level, e.Message)
+		if store != nil {
+			_ = store.Append(functionID, invocationID, e.Level, e.Message)
+		}
+		prometrics.IncLogLines(functionID, e.Level)
+	}
+	if dropped > 0 {
+		prometrics.AddLogLinesDropped("rate_limited", dropped)
+	}
+}
+
 // readMessages reads messages from the worker and routes them
 func (w *QuickJSWorker) readMessages() {
 	for {
@@ -314,6 +430,7 @@ func (w *QuickJSWorker) readMessages() {
 				if w.state != WorkerStateTerminated {
 					w.state = WorkerStateTerminated
 					w.logger.Warn("QuickJS Worker %s process exited unexpectedly", w.id)
+					prometrics.IncWorkerCrash(w.metricsFunction())
 				}
 				w.mu.Unlock()
 				w.invocationMu.Lock()
@@ -339,16 +456,27 @@ func (w *QuickJSWorker) readMessages() {
 		case MessageTypeLog:
 			payload, err := ParseLogPayload(msg)
 			if err == nil {
-				w.logger.Info("QuickJS Worker %s log [%s]: %s", w.id, payload.Level, payload.Message)
+				w.storeLogs(msg.ID, []LogPayload{*payload}, 0)
+			}
+		case MessageTypeLogs:
+			payload, err := ParseLogsPayload(msg)
+			if err == nil {
+				w.storeLogs(msg.ID, payload.Entries, payload.Dropped)
+			}
+		case MessageTypeStats:
+			payload, err := ParseStatsPayload(msg)
+			if err == nil {
+				prev := w.stats.Swap(&WorkerStats{StatsPayload: *payload, ReceivedAt: time.Now()})
+				gcs := payload.GCs
+				if prev != nil && prev.GCs <= gcs {
+					gcs -= prev.GCs
+				}
 				w.mu.Lock()
-				store := w.logStore
+				label := w.metricsFunction()
 				w.mu.Unlock()
-				if store != nil {
-					_ = store.Append(w.functionID, msg.ID, payload.Level, payload.Message)
-				}
-				prometrics.IncLogLines(w.functionID, payload.Level)
+				prometrics.ObserveWorkerStats(label, payload.RSS, payload.Heap, gcs)
 			}
-		case MessageTypeResponse, MessageTypeError:
+		case MessageTypeResponse, MessageTypeError, MessageTypeProfile, MessageTypeLoaded, MessageTypeUnloaded, MessageTypeReloaded:
 			w.invocationMu.RLock()
 			ch, exists := w.pendingInvocations[msg.ID]
 			w.invocationMu.RUnlock()
@@ -369,6 +497,16 @@ func (w *QuickJSWorker) readMessages() {
 	}
 }
 
+// metricsFunction is the function_id the process is reported under: its
+// function, or prometrics.SharedProcess for host workers and unbound blank
+// ones. Must be called with w.mu held.
+func (w *QuickJSWorker) metricsFunction() string {
+	if w.host || w.functionID == "" {
+		return prometrics.SharedProcess
+	}
+	return w.functionID
+}
+
 // Invoke sends an invoke message to the worker and waits for response
 func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*ResponsePayload, *ErrorPayload, error) {
 	w.mu.Lock()
@@ -391,14 +529,21 @@ func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*Re
 	w.pendingInvocations[invokeID] = msgCh
 	w.invocationMu.Unlock()
 
+	// readMessages closes the channel if the worker exits; closing it here
+	// as well would race with that and with a late reply
 	defer func() {
 		w.invocationMu.Lock()
 		delete(w.pendingInvocations, invokeID)
-		close(msgCh)
 		w.invocationMu.Unlock()
 		w.logger.Debug("QuickJS Worker %s cleaned up invocation channel for %s", w.id, invokeID)
 	}()
 
+	trace := tracing.FromContext(ctx)
+	if trace != nil && payload.Traceparent == "" {
+		payload.Traceparent = trace.SpanContext().Traceparent()
+	}
+
+	writeStart := time.Now()
 	if err := w.writer.WriteInvoke(invokeID, payload); err != nil {
 		w.mu.Lock()
 		w.state = WorkerStateReady
@@ -421,6 +566,7 @@ func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*Re
 			return nil, nil, fmt.Errorf("worker process exited")
 		}
 
+		receivedAt := time.Now()
 		switch msg.Type {
 		case MessageTypeResponse:
 			resp, err := ParseResponsePayload(msg)
@@ -430,6 +576,7 @@ func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*Re
 				w.mu.Unlock()
 				return nil, nil, fmt.Errorf("failed to parse response: %w", err)
 			}
+			recordWorkerSpans(trace, w.id, writeStart, receivedAt, resp.Timings)
 			w.mu.Lock()
 			w.state = WorkerStateReady
 			w.mu.Unlock()
@@ -442,6 +589,7 @@ func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*Re
 				w.mu.Unlock()
 				return nil, nil, fmt.Errorf("failed to parse error: %w", err)
 			}
+			recordWorkerSpans(trace, w.id, writeStart, receivedAt, nil)
 			w.mu.Lock()
 			w.state = WorkerStateReady
 			w.mu.Unlock()
@@ -461,6 +609,291 @@ func (w *QuickJSWorker) Invoke(ctx context.Context, payload *InvokePayload) (*Re
 	}
 }
 
+// Load binds a blank worker to a function: the worker loads the bundle,
+// applies the capabilities and replies "loaded". The worker is not usable
+// until Load has returned successfully, and a worker can only be loaded once.
+func (w *QuickJSWorker) Load(ctx context.Context, functionID, version, bundlePath string, caps *capabilities.Capabilities, allowProfiling bool) error {
+	w.mu.Lock()
+	if !w.blank || w.functionID != "" {
+		w.mu.Unlock()
+		return fmt.Errorf("worker %s is not blank", w.id)
+	}
+	if w.state != WorkerStateReady {
+		state := w.state
+		w.mu.Unlock()
+		return fmt.Errorf("worker not ready (state: %s)", state)
+	}
+	w.state = WorkerStateBusy
+	w.mu.Unlock()
+
+	payload := newLoadPayload(functionID, version, bundlePath, caps, allowProfiling)
+	loadID := uuid.New().String()
+	msgCh := make(chan *Message, 1)
+	w.invocationMu.Lock()
+	w.pendingInvocations[loadID] = msgCh
+	w.invocationMu.Unlock()
+	defer func() {
+		w.invocationMu.Lock()
+		delete(w.pendingInvocations, loadID)
+		w.invocationMu.Unlock()
+	}()
+
+	fail := func(err error) error {
+		w.mu.Lock()
+		w.state = WorkerStateTerminated
+		w.mu.Unlock()
+		return err
+	}
+	if err := w.writer.WriteLoad(loadID, payload); err != nil {
+		return fail(fmt.Errorf("failed to send load message: %w", err))
+	}
+
+	select {
+	case msg := <-msgCh:
+		if msg == nil {
+			return fail(fmt.Errorf("worker process exited"))
+		}
+		if msg.Type == MessageTypeError {
+			errPayload, err := ParseErrorPayload(msg)
+			if err != nil {
+				return fail(fmt.Errorf("failed to parse error: %w", err))
+			}
+			return fail(fmt.Errorf("failed to load bundle: %s", errPayload.Message))
+		}
+		if msg.Type != MessageTypeLoaded {
+			return fail(fmt.Errorf("unexpected message type: %s", msg.Type))
+		}
+	case <-ctx.Done():
+		// The worker may be half-loaded; it must not be reused
+		return fail(fmt.Errorf("load cancelled: %w", ctx.Err()))
+	}
+
+	w.mu.Lock()
+	w.functionID = functionID
+	w.version = version
+	w.bundlePath = bundlePath
+	w.capabilities = caps
+	if w.cgroup != nil {
+		group, limits := w.cgroupPlacement()
+		if g, err := w.cgroup.Move(group, w.id, w.process.Process.Pid, limits); err != nil {
+			w.logger.Warn("QuickJS Worker %s stays in its blank cgroup: %v", w.id, err)
+		} else {
+			w.cgroup = g
+		}
+	}
+	if w.cpus != nil {
+		if slot, err := w.cpus.Move(functionID, w.threads, w.process.Process.Pid); err != nil {
+			w.logger.Warn("QuickJS Worker %s stays on its blank CPUs: %v", w.id, err)
+		} else {
+			w.cpus = slot
+		}
+	}
+	w.state = WorkerStateReady
+	w.lastUsed = time.Now()
+	w.mu.Unlock()
+	w.logger.Debug("QuickJS Worker %s loaded function %s (version %s)", w.id, functionID, version)
+	return nil
+}
+
+// Reload swaps the worker's bundle for another version of the same function
+// without restarting the process. The worker must be idle; it is busy until
+// the new bundle is loaded. When loading fails the worker keeps serving the
+// previous version and Reload returns the error.
+func (w *QuickJSWorker) Reload(ctx context.Context, version, bundlePath string) error {
+	w.mu.Lock()
+	if w.host || w.threads > 1 || w.functionID == "" {
+		w.mu.Unlock()
+		return fmt.Errorf("worker %s cannot reload", w.id)
+	}
+	if w.state != WorkerStateReady {
+		state := w.state
+		w.mu.Unlock()
+		return fmt.Errorf("worker not ready (state: %s)", state)
+	}
+	w.state = WorkerStateBusy
+	functionID := w.functionID
+	w.mu.Unlock()
+
+	msg, err := w.roundTrip(ctx, functionID, func(id string) error {
+		return w.writer.WriteReload(id, &ReloadPayload{Version: version, BundlePath: bundlePath})
+	})
+	if err != nil {
+		// The worker may be between contexts; it must not be reused
+		w.mu.Lock()
+		w.state = WorkerStateTerminated
+		w.mu.Unlock()
+		return fmt.Errorf("failed to reload worker %s: %w", w.id, err)
+	}
+
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	w.state = WorkerStateReady
+	if msg.Type == MessageTypeError {
+		errPayload, err := ParseErrorPayload(msg)
+		if err != nil {
+			return fmt.Errorf("failed to parse error: %w", err)
+		}
+		return fmt.Errorf("failed to reload bundle: %s", errPayload.Message)
+	}
+	if msg.Type != MessageTypeReloaded {
+		return fmt.Errorf("unexpected message type: %s", msg.Type)
+	}
+	w.version = version
+	w.bundlePath = bundlePath
+	w.lastUsed = time.Now()
+	w.logger.Debug("QuickJS Worker %s reloaded function %s (version %s)", w.id, functionID, version)
+	return nil
+}
+
+func newLoadPayload(functionID, version, bundlePath string, caps *capabilities.Capabilities, allowProfiling bool) *LoadPayload {
+	payload := &LoadPayload{
+		FunctionID:     functionID,
+		Version:        version,
+		BundlePath:     bundlePath,
+		AllowProfiling: allowProfiling,
+	}
+	if caps != nil {
+		payload.AllowFilesystem = caps.AllowFilesystem
+		payload.AllowNetwork = caps.AllowNetwork
+		payload.AllowChildProcess = caps.AllowChildProcess
+		payload.AllowEval = caps.AllowEval
+		payload.MaxMemory = caps.MaxMemory
+		payload.MaxFDs = caps.MaxFileDescriptors
+		payload.LogLevel = caps.LogLevel
+	}
+	return payload
+}
+
+// roundTrip sends one message written by write under a new ID and waits for
+// the reply with that ID. It does not touch the worker state, so host workers
+// can have many requests in flight. functionID attributes the request's log
+// lines on host workers.
+func (w *QuickJSWorker) roundTrip(ctx context.Context, functionID string, write func(id string) error) (*Message, error) {
+	id := uuid.New().String()
+	msgCh := make(chan *Message, 1)
+	w.invocationMu.Lock()
+	w.pendingInvocations[id] = msgCh
+	if w.host {
+		w.hostInvocations[id] = functionID
+	}
+	w.invocationMu.Unlock()
+	defer func() {
+		w.invocationMu.Lock()
+		delete(w.pendingInvocations, id)
+		delete(w.hostInvocations, id)
+		w.invocationMu.Unlock()
+	}()
+
+	if err := write(id); err != nil {
+		return nil, err
+	}
+	select {
+	case msg := <-msgCh:
+		if msg == nil {
+			return nil, fmt.Errorf("worker process exited")
+		}
+		return msg, nil
+	case <-ctx.Done():
+		return nil, ctx.Err()
+	}
+}
+
+// recordWorkerSpans breaks the IPC round trip of one invocation into spans
+// using the worker's own timestamps (same host, same wall clock). Without
+// timings the round trip is recorded as a single span.
+func recordWorkerSpans(trace *tracing.Trace, workerID string, writeStart, receivedAt time.Time, t *WorkerTimings) {
+	if trace == nil {
+		return
+	}
+	if t == nil || t.Parsed == 0 || t.Serialized == 0 {
+		trace.Record("worker.invoke", writeStart, receivedAt, "worker.id", workerID)
+		return
+	}
+	ts := func(ns int64) time.Time { return time.Unix(0, ns) }
+	trace.Record("ipc.write", writeStart, ts(t.Parsed), "worker.id", workerID)
+	trace.Record("worker.build_request", ts(t.Parsed), ts(t.RequestBuilt))
+	trace.Record("js.execute", ts(t.HandlerStart), ts(t.HandlerSettled))
+	trace.Record("worker.serialize", ts(t.HandlerSettled), ts(t.Serialized))
+	trace.Record("ipc.read", ts(t.Serialized), receivedAt, "worker.id", workerID)
+}
+
+// Profile runs the worker's sampling profiler for the given duration.
+// Sampling happens inside the worker process; invocations keep being served
+// while the profile is collected.
+func (w *QuickJSWorker) Profile(ctx context.Context, duration time.Duration, hz int) (*ProfilePayload, error) {
+	w.mu.Lock()
+	if w.state == WorkerStateStarting || w.state == WorkerStateTerminated {
+		state := w.state
+		w.mu.Unlock()
+		return nil, fmt.Errorf("worker not running (state: %s)", state)
+	}
+	w.mu.Unlock()
+
+	profileID := uuid.New().String()
+	msgCh := make(chan *Message, 1)
+	w.invocationMu.Lock()
+	w.pendingInvocations[profileID] = msgCh
+	w.invocationMu.Unlock()
+
+	defer func() {
+		w.invocationMu.Lock()
+		delete(w.pendingInvocations, profileID)
+		w.invocationMu.Unlock()
+	}()
+
+	if err := w.writer.WriteProfile(profileID, &ProfileRequestPayload{Action: "start", HZ: hz}); err != nil {
+		return nil, fmt.Errorf("failed to start profiler: %w", err)
+	}
+
+	timer := time.NewTimer(duration)
+	defer timer.Stop()
+
+	select {
+	case msg := <-msgCh:
+		// The worker only replies to "start" when it failed
+		if msg != nil && msg.Type == MessageTypeError {
+			errPayload, err := ParseErrorPayload(msg)
+			if err == nil {
+				return nil, fmt.Errorf("profiler error: %s", errPayload.Message)
+			}
+		}
+		return nil, fmt.Errorf("worker process exited")
+	case <-timer.C:
+	case <-ctx.Done():
+	}
+
+	// Always stop the profiler, even if the caller gave up, so the worker
+	// doesn't keep sampling
+	if err := w.writer.WriteProfile(profileID, &ProfileRequestPayload{Action: "stop"}); err != nil {
+		return nil, fmt.Errorf("failed to stop profiler: %w", err)
+	}
+
+	// The stop reply is queued behind any invocation the worker is running
+	waitCtx, cancel := context.WithTimeout(context.Background(), 30*time.Second)
+	defer cancel()
+
+	select {
+	case msg := <-msgCh:
+		if msg == nil {
+			return nil, fmt.Errorf("worker process exited")
+		}
+		switch msg.Type {
+		case MessageTypeProfile:
+			return ParseProfilePayload(msg)
+		case MessageTypeError:
+			errPayload, err := ParseErrorPayload(msg)
+			if err != nil {
+				return nil, fmt.Errorf("failed to parse error: %w", err)
+			}
+			return nil, fmt.Errorf("profiler error: %s", errPayload.Message)
+		default:
+			return nil, fmt.Errorf("unexpected message type: %s", msg.Type)
+		}
+	case <-waitCtx.Done():
+		return nil, fmt.Errorf("timed out waiting for profile from worker %s", w.id)
+	}
+}
+
 // Terminate kills the worker process
 func (w *QuickJSWorker) Terminate() error {
 	w.mu.Lock()
@@ -468,8 +901,11 @@ func (w *QuickJSWorker) Terminate() error {
 	process := w.process
 	stdin := w.stdin
 	stdout := w.stdout
+	cpus := w.cpus
 	w.mu.Unlock()
 
+	cpus.Release()
+
 	w.cancel()
 
 	if process != nil {
@@ -494,6 +930,10 @@ func (w *QuickJSWorker) Terminate() error {
 
 			select {
 			case <-done:
+				w.mu.Lock()
+				group := w.cgroup
+				w.mu.Unlock()
+				group.Remove()
 			case <-time.After(2 * time.Second):
 				w.logger.Warn("QuickJS Worker %s (PID: %d) did not exit within 2 seconds", w.id, pid)
 			}
@@ -504,28 +944,22 @@ func (w *QuickJSWorker) Terminate() error {
 	return nil
 }
 
-// HealthCheck checks if the worker process is still alive
+// HealthCheck reports whether the worker process is usable. Pools call it
+// on every release, so it makes no system calls: readMessages marks the
+// worker terminated when the process's stdout closes, and heartbeats (see
+// Stats) are judged by the pool in the background.
 func (w *QuickJSWorker) HealthCheck() bool {
 	w.mu.Lock()
 	defer w.mu.Unlock()
+	return w.process != nil && w.state != WorkerStateTerminated
+}
 
-	if w.process == nil || w.state == WorkerStateTerminated {
-		return false
+// Stats returns the worker's latest heartbeat
+func (w *QuickJSWorker) Stats() (WorkerStats, bool) {
+	if s := w.stats.Load(); s != nil {
+		return *s, true
 	}
-
-	if w.process.ProcessState != nil && w.process.ProcessState.Exited() {
-		w.state = WorkerStateTerminated
-		return false
-	}
-
-	// Check if process is still alive by sending signal 0 (doesn't kill, just checks)
-	// Use syscall.SIGCONT (0) which is a no-op signal that just checks if process exists
-	if err := w.process.Process.Signal(syscall.Signal(0)); err != nil {
-		w.state = WorkerStateTerminated
-		return false
-	}
-
-	return true
+	return WorkerStats{}, false
 }
 
 // GetState returns the current worker state
@@ -553,3 +987,82 @@ func (w *QuickJSWorker) GetInvocations() int64 {
 	defer w.mu.Unlock()
 	return w.invocations
 }
+
+// RSSBytes returns the memory of the worker process: what its cgroup is
+// charged when it has one, its resident set size otherwise
+func (w *QuickJSWorker) RSSBytes() (int64, error) {
+	w.mu.Lock()
+	process := w.process
+	group := w.cgroup
+	terminated := w.state == WorkerStateTerminated
+	w.mu.Unlock()
+	if process == nil || process.Process == nil || terminated {
+		return 0, fmt.Errorf("worker %s is not running", w.id)
+	}
+	if group != nil {
+		if n, err := group.MemoryBytes(); err == nil {
+			return n, nil
+		}
+	}
+	return processRSS(process.Process.Pid)
+}
+
+// cgroupPlacement returns the group the worker's process belongs in and its
+// limits. Blank and host processes get none: their functions are not known
+// yet, or many share the process. Must be called with w.mu held.
+func (w *QuickJSWorker) cgroupPlacement() (string, cgroup.Limits) {
+	switch {
+	case w.host:
+		return cgroup.HostsGroup, cgroup.Limits{}
+	case w.functionID == "":
+		return cgroup.BlankGroup, cgroup.Limits{}
+	}
+	var limits cgroup.Limits
+	if caps := w.capabilities; caps != nil {
+		limits = cgroup.Limits{CPUPerSecond: caps.CPUQuota, CPUWeight: caps.CPUWeight, MemoryMax: caps.MaxMemory}
+	}
+	return w.functionID, limits
+}
+
+// invokeMultiplexed sends an invoke without taking the worker's single
+// invocation slot, for processes that run several invocations (host and
+// threaded workers). functionID attributes the invocation's logs.
+func (w *QuickJSWorker) invokeMultiplexed(ctx context.Context, functionID string, payload *InvokePayload) (*ResponsePayload, *ErrorPayload, error) {
+	trace := tracing.FromContext(ctx)
+	if trace != nil && payload.Traceparent == "" {
+		payload.Traceparent = trace.SpanContext().Traceparent()
+	}
+	deadline := time.Now().Add(time.Duration(payload.DeadlineMS) * time.Millisecond)
+	ctx, cancel := context.WithDeadline(ctx, deadline)
+	defer cancel()
+
+	writeStart := time.Now()
+	msg, err := w.roundTrip(ctx, functionID, func(id string) error {
+		return w.writer.WriteInvoke(id, payload)
+	})
+	if err != nil {
+		if ctx.Err() != nil {
+			return nil, nil, fmt.Errorf("invocation deadline exceeded: %w", err)
+		}
+		return nil, nil, err
+	}
+	receivedAt := time.Now()
+	switch msg.Type {
+	case MessageTypeResponse:
+		resp, err := ParseResponsePayload(msg)
+		if err != nil {
+			return nil, nil, fmt.Errorf("failed to parse response: %w", err)
+		}
+		recordWorkerSpans(trace, w.id, writeStart, receivedAt, resp.Timings)
+		return resp, nil, nil
+	case MessageTypeError:
+		errPayload, err := ParseErrorPayload(msg)
+		if err != nil {
+			return nil, nil, fmt.Errorf("failed to parse error: %w", err)
+		}
+		recordWorkerSpans(trace, w.id, writeStart, receivedAt, nil)
+		return nil, errPayload, nil
+	default:
+		return nil, nil, fmt.Errorf("unexpected message type: %s", msg.Type)
+	}
+}
@@ -0,0 +1,42 @@
+package worker
+
+import (
+	"bufio"
+	"bytes"
+	"fmt"
+	"os"
+	"strconv"
+)
+
+// MemoryReporter is implemented by workers that can report the resident
+// memory of their process
+type MemoryReporter interface {
+	// RSSBytes returns the worker process's resident set size
+	RSSBytes() (int64, error)
+}
+
+// processRSS reads VmRSS from /proc/<pid>/status. It fails on systems
+// without procfs, where callers fall back to not measuring.
+func processRSS(pid int) (int64, error) {
+	data, err := os.ReadFile(fmt.Sprintf("/proc/%d/status", pid))
+	if err != nil {
+		return 0, err
+	}
+	sc := bufio.NewScanner(bytes.NewReader(data))
+	for sc.Scan() {
+		line := sc.Bytes()
+		if !bytes.HasPrefix(line, []byte("VmRSS:")) {
+			continue
+		}
+		fields := bytes.Fields(line[len("VmRSS:"):])
+		if len(fields) == 0 {
+			break
+		}
+		kb, err := strconv.ParseInt(string(fields[0]), 10, 64)
+		if err != nil {
+			return 0, err
+		}
+		return kb * 1024, nil
+	}
+	return 0, fmt.Errorf("no VmRSS in /proc/%d/status", pid)
+}
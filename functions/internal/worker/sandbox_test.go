@@ -2,7 +2,6 @@ package worker
 
 import (
 	"context"
-	"encoding/base64"
 	"os"
 	"os/exec"
 	"path/filepath"
@@ -92,7 +91,7 @@ func TestSandboxIsolation(t *testing.T) {
 	}
 
 	// Check response body for the specific error message from the script
-	decodedBytes, err := base64.StdEncoding.DecodeString(resp.Body)
+	decodedBytes, err := resp.DecodedBody()
 	if err != nil {
 		t.Fatalf("Failed to decode response body: %v", err)
 	}
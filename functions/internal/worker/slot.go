@@ -0,0 +1,69 @@
+package worker
+
+import (
+	"fmt"
+	"sync"
+	"time"
+)
+
+// slotState is the bookkeeping of a Worker that is one slot of a shared
+// process (HostedWorker, ThreadSlot): the process is multiplexed, so each
+// slot tracks its own state and runs one invocation at a time.
+type slotState struct {
+	mu          sync.Mutex
+	state       WorkerState
+	lastUsed    time.Time
+	invocations int64
+}
+
+// begin marks the slot busy for an invocation
+func (s *slotState) begin() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.state != WorkerStateReady {
+		return fmt.Errorf("worker not ready (state: %s)", s.state)
+	}
+	s.state = WorkerStateBusy
+	s.lastUsed = time.Now()
+	s.invocations++
+	return nil
+}
+
+// end marks the slot ready again unless it was terminated meanwhile
+func (s *slotState) end() {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.state == WorkerStateBusy {
+		s.state = WorkerStateReady
+	}
+}
+
+func (s *slotState) setState(state WorkerState) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.state = state
+	if state == WorkerStateReady {
+		s.lastUsed = time.Now()
+	}
+}
+
+// GetState returns the current worker state
+func (s *slotState) GetState() WorkerState {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.state
+}
+
+// GetLastUsed returns the last used timestamp
+func (s *slotState) GetLastUsed() time.Time {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.lastUsed
+}
+
+// GetInvocations returns the number of invocations
+func (s *slotState) GetInvocations() int64 {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.invocations
+}
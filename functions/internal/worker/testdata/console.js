@@ -0,0 +1,9 @@
+// Logs the values whose console formatting console_test.go checks, one line each.
+export default function handler(req) {
+  console.log({ a: 1, toJSON() { return this; } });
+  console.log(new Date(0));
+  console.log({ d: new Date(0) });
+  console.log("", "x");
+  console.log("%s!", "a", "");
+  return new Response("ok");
+}
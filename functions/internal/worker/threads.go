@@ -0,0 +1,196 @@
+package worker
+
+import (
+	"context"
+	"fmt"
+	"sync"
+
+	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
+	"github.com/kartikbazzad/bunbase/functions/internal/config"
+	"github.com/kartikbazzad/bunbase/functions/internal/logger"
+	"github.com/kartikbazzad/bunbase/functions/internal/logstore"
+)
+
+// ThreadedProcess is a quickjs-worker started with WORKER_THREADS: one
+// process running a function on several threads, each with its own runtime
+// instantiated from bytecode compiled once. Invocations share one pipe pair
+// and reader and run on whichever thread is idle. Each thread is handed out
+// as a ThreadSlot, so a pool sees one Worker per thread; the process is
+// started by the first slot to spawn and exits when its last slot is
+// terminated.
+type ThreadedProcess struct {
+	proc    *QuickJSWorker
+	threads int
+
+	startOnce sync.Once
+	startErr  error
+
+	mu      sync.Mutex
+	claimed int  // slots handed out
+	live    int  // handed out and not terminated
+	closed  bool // no more slots; the process is exiting or has exited
+}
+
+// NewThreadedProcess creates a process with threads slots (does not spawn it)
+func NewThreadedProcess(functionID, version, bundlePath string, threads int, log *logger.Logger) *ThreadedProcess {
+	proc := NewQuickJSWorker(functionID, version, bundlePath, log)
+	proc.threads = threads
+	return &ThreadedProcess{proc: proc, threads: threads}
+}
+
+// SetCapabilities sets the security capabilities of the process
+func (t *ThreadedProcess) SetCapabilities(caps *capabilities.Capabilities) {
+	t.proc.SetCapabilities(caps)
+}
+
+// SetLogStore sets the log store for persisting function logs. Optional.
+func (t *ThreadedProcess) SetLogStore(store logstore.Store) {
+	t.proc.SetLogStore(store)
+}
+
+// Slot claims the next thread, or returns nil when all have been claimed or
+// the process is gone
+func (t *ThreadedProcess) Slot() *ThreadSlot {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.closed || t.claimed >= t.threads {
+		return nil
+	}
+	t.claimed++
+	t.live++
+	return &ThreadSlot{
+		id:        fmt.Sprintf("%s/%d", t.proc.id, t.claimed),
+		process:   t,
+		slotState: slotState{state: WorkerStateStarting},
+	}
+}
+
+func (t *ThreadedProcess) start(cfg *config.WorkerConfig, workerScriptPath, initScriptPath string, env map[string]string) error {
+	t.startOnce.Do(func() {
+		t.startErr = t.proc.Spawn(cfg, workerScriptPath, initScriptPath, env)
+		if t.startErr != nil {
+			t.mu.Lock()
+			t.closed = true
+			t.mu.Unlock()
+		}
+	})
+	return t.startErr
+}
+
+// release returns a slot and stops the process once no slot is live. A
+// process whose slots were partly unused is stopped too; the pool starts a
+// new one when it needs more workers.
+func (t *ThreadedProcess) release() {
+	t.mu.Lock()
+	t.live--
+	last := t.live == 0
+	if last {
+		t.closed = true
+	}
+	t.mu.Unlock()
+	if last {
+		t.proc.Terminate()
+	}
+}
+
+// Retire stops handing out slots; the process exits once its live slots
+// are terminated
+func (t *ThreadedProcess) Retire() {
+	t.mu.Lock()
+	t.closed = true
+	last := t.live == 0
+	t.mu.Unlock()
+	if last {
+		t.proc.Terminate()
+	}
+}
+
+// Stats returns the process's latest heartbeat
+func (t *ThreadedProcess) Stats() (WorkerStats, bool) {
+	return t.proc.Stats()
+}
+
+func (t *ThreadedProcess) alive() bool {
+	return t.proc.GetState() != WorkerStateTerminated
+}
+
+// ThreadSlot is one thread of a ThreadedProcess, used by pools as a Worker
+type ThreadSlot struct {
+	id      string
+	process *ThreadedProcess
+
+	slotState
+	released bool
+}
+
+// Spawn starts the process if this is its first slot to spawn and waits
+// until its threads are ready
+func (s *ThreadSlot) Spawn(cfg *config.WorkerConfig, workerScriptPath string, initScriptPath string, env map[string]string) error {
+	if err := s.process.start(cfg, workerScriptPath, initScriptPath, env); err != nil {
+		s.setState(WorkerStateTerminated)
+		return err
+	}
+	if !s.process.alive() {
+		s.setState(WorkerStateTerminated)
+		return fmt.Errorf("worker process exited")
+	}
+	s.setState(WorkerStateReady)
+	return nil
+}
+
+// Invoke runs an invocation on an idle thread of the process
+func (s *ThreadSlot) Invoke(ctx context.Context, payload *InvokePayload) (*ResponsePayload, *ErrorPayload, error) {
+	if err := s.begin(); err != nil {
+		return nil, nil, err
+	}
+	defer s.end()
+	resp, errPayload, err := s.process.proc.invokeMultiplexed(ctx, s.process.proc.functionID, payload)
+	if err != nil && !s.process.alive() {
+		s.setState(WorkerStateTerminated)
+	}
+	return resp, errPayload, err
+}
+
+// Terminate gives the slot back; the last slot stops the process
+func (s *ThreadSlot) Terminate() error {
+	s.mu.Lock()
+	released := s.released
+	s.released = true
+	s.state = WorkerStateTerminated
+	s.mu.Unlock()
+	if !released {
+		s.process.release()
+	}
+	return nil
+}
+
+// HealthCheck reports whether the slot and its process are usable
+func (s *ThreadSlot) HealthCheck() bool {
+	return s.GetState() != WorkerStateTerminated && s.process.alive()
+}
+
+// GetID returns the slot ID: the process's worker ID and the slot number
+func (s *ThreadSlot) GetID() string {
+	return s.id
+}
+
+// Process returns the process the slot is a thread of
+func (s *ThreadSlot) Process() *ThreadedProcess {
+	return s.process
+}
+
+// Stats returns the heartbeat of the slot's process. Every slot of a process
+// reports the same one, so a pool recycles them together.
+func (s *ThreadSlot) Stats() (WorkerStats, bool) {
+	return s.process.Stats()
+}
+
+// RSSBytes returns the process's resident set size divided among its
+// threads, so that summing over slots counts the process once
+func (s *ThreadSlot) RSSBytes() (int64, error) {
+	rss, err := s.process.proc.RSSBytes()
+	if err != nil {
+		return 0, err
+	}
+	return rss / int64(s.process.threads), nil
+}
@@ -0,0 +1,357 @@
+package worker
+
+import (
+	"bytes"
+	"encoding/base64"
+	"encoding/json"
+	"fmt"
+)
+
+// decodeMessage decodes one message line in a single pass. The envelope and
+// response payloads are scanned by hand: the body string is located with
+// memchr-speed searches and base64-decoded straight into a pooled buffer,
+// and only small values (headers, timings) go through encoding/json. The
+// payload of other message types is copied out of the line as raw JSON.
+// Lines the scanner does not accept are decoded with encoding/json instead,
+// which also reports the error for malformed ones.
+func decodeMessage(line []byte) (*Message, error) {
+	if msg, ok := scanMessage(line); ok {
+		return msg, nil
+	}
+	var msg Message
+	if err := json.Unmarshal(line, &msg); err != nil {
+		return nil, fmt.Errorf("failed to unmarshal message: %w", err)
+	}
+	return &msg, nil
+}
+
+func scanMessage(line []byte) (*Message, bool) {
+	s := lineScanner{b: line}
+	msg := &Message{}
+	var payload []byte
+	ok := s.object(func(key []byte) bool {
+		var ok bool
+		switch string(key) {
+		case "id":
+			msg.ID, ok = s.stringValue()
+		case "type":
+			var raw []byte
+			if raw, ok = s.plainString(); ok {
+				msg.Type = messageType(raw)
+			}
+		case "payload":
+			payload, ok = s.value()
+		default:
+			_, ok = s.value()
+		}
+		return ok
+	})
+	if !ok || !s.end() {
+		return nil, false
+	}
+	if msg.Type != MessageTypeResponse || payload == nil || payload[0] != '{' {
+		if payload != nil {
+			msg.Payload = append(json.RawMessage(nil), payload...)
+		}
+		return msg, true
+	}
+	resp, ok := scanResponse(payload)
+	if !ok {
+		return nil, false
+	}
+	msg.response = resp
+	return msg, true
+}
+
+// scanResponse decodes a response payload object
+func scanResponse(payload []byte) (*ResponsePayload, bool) {
+	s := lineScanner{b: payload}
+	resp := &ResponsePayload{}
+	ok := s.object(func(key []byte) bool {
+		v, ok := s.value()
+		if !ok {
+			return false
+		}
+		switch string(key) {
+		case "status":
+			resp.Status, ok = parseInt(v)
+		case "headers":
+			resp.Headers, ok = scanHeaders(v)
+		case "body":
+			ok = decodeBody(v, resp)
+		case "timings":
+			ok = json.Unmarshal(v, &resp.Timings) == nil
+		case "heap":
+			var heap int
+			heap, ok = parseInt(v)
+			resp.Heap = int64(heap)
+		}
+		return ok
+	})
+	if !ok {
+		ReleaseBody(resp.RawBody)
+		return nil, false
+	}
+	return resp, true
+}
+
+// scanHeaders decodes a headers object of string values
+func scanHeaders(v []byte) (map[string]string, bool) {
+	if v[0] != '{' {
+		var headers map[string]string
+		return headers, json.Unmarshal(v, &headers) == nil
+	}
+	s := lineScanner{b: v}
+	headers := make(map[string]string)
+	ok := s.object(func(key []byte) bool {
+		value, ok := s.stringValue()
+		if ok {
+			headers[string(key)] = value
+		}
+		return ok
+	})
+	return headers, ok
+}
+
+// decodeBody decodes a body string into a pooled RawBody. A body that is
+// escaped or not valid base64 is kept as text, for DecodeBody to handle or
+// report as before.
+func decodeBody(v []byte, resp *ResponsePayload) bool {
+	if v[0] != '"' {
+		return json.Unmarshal(v, &resp.Body) == nil
+	}
+	str := v[1 : len(v)-1]
+	if len(str) == 0 {
+		return true
+	}
+	if bytes.IndexByte(str, '\\') >= 0 {
+		return json.Unmarshal(v, &resp.Body) == nil
+	}
+	ReleaseBody(resp.RawBody) // a repeated key
+	buf := getBuffer(base64.StdEncoding.DecodedLen(len(str)))
+	n, err := base64.StdEncoding.Decode(buf[:cap(buf)], str)
+	if err != nil {
+		putBuffer(buf)
+		resp.RawBody = nil
+		resp.Body = string(str)
+		return true
+	}
+	resp.RawBody = buf[:n]
+	return true
+}
+
+// messageType returns the constant for a known message type, so reading a
+// message does not allocate its type
+func messageType(raw []byte) string {
+	switch string(raw) {
+	case MessageTypeReady:
+		return MessageTypeReady
+	case MessageTypeResponse:
+		return MessageTypeResponse
+	case MessageTypeLog:
+		return MessageTypeLog
+	case MessageTypeLogs:
+		return MessageTypeLogs
+	case MessageTypeError:
+		return MessageTypeError
+	case MessageTypeProfile:
+		return MessageTypeProfile
+	case MessageTypeLoaded:
+		return MessageTypeLoaded
+	case MessageTypeUnloaded:
+		return MessageTypeUnloaded
+	case MessageTypeReloaded:
+		return MessageTypeReloaded
+	case MessageTypeStats:
+		return MessageTypeStats
+	}
+	return string(raw)
+}
+
+func parseInt(v []byte) (int, bool) {
+	neg := len(v) > 0 && v[0] == '-'
+	if neg {
+		v = v[1:]
+	}
+	if len(v) == 0 || len(v) > 18 {
+		return 0, false
+	}
+	n := 0
+	for _, c := range v {
+		if c < '0' || c > '9' {
+			return 0, false
+		}
+		n = n*10 + int(c-'0')
+	}
+	if neg {
+		n = -n
+	}
+	return n, true
+}
+
+// lineScanner walks the JSON of one message. It finds value boundaries
+// without validating everything in between; anything it does not expect
+// makes it fail, and the caller falls back to encoding/json.
+type lineScanner struct {
+	b []byte
+	i int
+}
+
+func (s *lineScanner) skipSpace() {
+	for s.i < len(s.b) {
+		switch s.b[s.i] {
+		case ' ', '\t', '\r', '\n':
+			s.i++
+		default:
+			return
+		}
+	}
+}
+
+// end reports whether only whitespace is left
+func (s *lineScanner) end() bool {
+	s.skipSpace()
+	return s.i == len(s.b)
+}
+
+// object calls field for each key of the object at the cursor; field must
+// consume the key's value
+func (s *lineScanner) object(field func(key []byte) bool) bool {
+	s.skipSpace()
+	if s.i >= len(s.b) || s.b[s.i] != '{' {
+		return false
+	}
+	s.i++
+	s.skipSpace()
+	if s.i < len(s.b) && s.b[s.i] == '}' {
+		s.i++
+		return true
+	}
+	for {
+		key, ok := s.plainString()
+		if !ok {
+			return false
+		}
+		s.skipSpace()
+		if s.i >= len(s.b) || s.b[s.i] != ':' {
+			return false
+		}
+		s.i++
+		if !field(key) {
+			return false
+		}
+		s.skipSpace()
+		if s.i >= len(s.b) {
+			return false
+		}
+		switch s.b[s.i] {
+		case ',':
+			s.i++
+		case '}':
+			s.i++
+			return true
+		default:
+			return false
+		}
+	}
+}
+
+// str returns the raw contents of the string at the cursor and whether they
+// contain escapes
+func (s *lineScanner) str() (raw []byte, escaped, ok bool) {
+	s.skipSpace()
+	if s.i >= len(s.b) || s.b[s.i] != '"' {
+		return nil, false, false
+	}
+	start := s.i + 1
+	j := start
+	for {
+		k := bytes.IndexByte(s.b[j:], '"')
+		if k < 0 {
+			return nil, false, false
+		}
+		j += k
+		// The quote is escaped when an odd number of backslashes precede it
+		bs := 0
+		for p := j - 1; p >= start && s.b[p] == '\\'; p-- {
+			bs++
+		}
+		if bs%2 == 0 {
+			break
+		}
+		escaped = true
+		j++
+	}
+	raw = s.b[start:j]
+	s.i = j + 1
+	if !escaped {
+		escaped = bytes.IndexByte(raw, '\\') >= 0
+	}
+	return raw, escaped, true
+}
+
+// plainString returns a string without escapes
+func (s *lineScanner) plainString() ([]byte, bool) {
+	raw, escaped, ok := s.str()
+	return raw, ok && !escaped
+}
+
+// stringValue returns the string at the cursor, unescaped
+func (s *lineScanner) stringValue() (string, bool) {
+	start := s.i
+	raw, escaped, ok := s.str()
+	if !ok {
+		return "", false
+	}
+	if !escaped {
+		return string(raw), true
+	}
+	var v string
+	return v, json.Unmarshal(bytes.TrimSpace(s.b[start:s.i]), &v) == nil
+}
+
+// value returns the raw bytes of the value at the cursor
+func (s *lineScanner) value() ([]byte, bool) {
+	s.skipSpace()
+	if s.i >= len(s.b) {
+		return nil, false
+	}
+	start := s.i
+	switch s.b[s.i] {
+	case '"':
+		if _, _, ok := s.str(); !ok {
+			return nil, false
+		}
+	case '{', '[':
+		depth := 0
+		for s.i < len(s.b) {
+			switch s.b[s.i] {
+			case '"':
+				if _, _, ok := s.str(); !ok {
+					return nil, false
+				}
+				continue
+			case '{', '[':
+				depth++
+			case '}', ']':
+				depth--
+			}
+			s.i++
+			if depth == 0 {
+				break
+			}
+		}
+		if depth != 0 {
+			return nil, false
+		}
+	default:
+		for s.i < len(s.b) {
+			switch s.b[s.i] {
+			case ',', '}', ']', ' ', '\t', '\r', '\n':
+				return s.b[start:s.i], s.i > start
+			}
+			s.i++
+		}
+	}
+	return s.b[start:s.i], true
+}
@@ -4,6 +4,7 @@ import (
 	"context"
 	"time"
 
+	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
 	"github.com/kartikbazzad/bunbase/functions/internal/config"
 )
 
@@ -33,3 +34,41 @@ type Worker interface {
 	// GetInvocations returns the number of invocations handled by this worker
 	GetInvocations() int64
 }
+
+// Profiler is implemented by workers that support in-process CPU sampling
+type Profiler interface {
+	// Profile samples the worker's JS stack at hz for the given duration and
+	// returns the aggregated samples in folded-stack format
+	Profile(ctx context.Context, duration time.Duration, hz int) (*ProfilePayload, error)
+}
+
+// Loader is implemented by workers that start without a bundle and are bound
+// to a function after Spawn
+type Loader interface {
+	// Load loads the function's bundle into the running worker with the given
+	// capabilities; the worker can be invoked once it returns nil
+	Load(ctx context.Context, functionID, version, bundlePath string, caps *capabilities.Capabilities, allowProfiling bool) error
+}
+
+// Reloader is implemented by workers that can switch to another version of
+// their function's bundle without restarting
+type Reloader interface {
+	// Reload loads bundlePath in place of the current bundle. The worker must
+	// be idle. On error the worker still serves the previous version unless
+	// it is no longer healthy.
+	Reload(ctx context.Context, version, bundlePath string) error
+}
+
+// WorkerStats is the latest heartbeat of a worker process
+type WorkerStats struct {
+	StatsPayload
+	ReceivedAt time.Time
+}
+
+// StatsReporter is implemented by workers whose processes send heartbeats
+// (stats messages). Stats makes no system calls: it returns what the
+// worker's reader goroutine last stored.
+type StatsReporter interface {
+	// Stats returns the latest heartbeat; ok is false until the first one
+	Stats() (stats WorkerStats, ok bool)
+}
@@ -2,6 +2,7 @@ package worker
 
 import (
 	"context"
+	"os"
 	"testing"
 
 	"github.com/kartikbazzad/bunbase/functions/internal/capabilities"
@@ -15,6 +16,13 @@ func TestWorkerInterface(t *testing.T) {
 	
 	// Test that QuickJSWorker implements Worker interface
 	var _ Worker = (*QuickJSWorker)(nil)
+	var _ Worker = (*HostedWorker)(nil)
+	var _ Worker = (*ThreadSlot)(nil)
+	var _ MemoryReporter = (*ThreadSlot)(nil)
+
+	var _ MemoryReporter = (*BunWorker)(nil)
+	var _ MemoryReporter = (*QuickJSWorker)(nil)
+	var _ StatsReporter = (*QuickJSWorker)(nil)
 }
 
 func TestBunWorkerCreation(t *testing.T) {
@@ -156,3 +164,16 @@ func TestWorkerConfigRuntime(t *testing.T) {
 		t.Error("Failed to set runtime")
 	}
 }
+
+func TestProcessRSS(t *testing.T) {
+	if _, err := os.Stat("/proc/self/status"); err != nil {
+		t.Skip("no procfs")
+	}
+	rss, err := processRSS(os.Getpid())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if rss <= 0 {
+		t.Errorf("rss = %d, want > 0", rss)
+	}
+}